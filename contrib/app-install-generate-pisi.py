@@ -27,8 +27,8 @@
 #
 # 1. gets a list of all the packages in a repo that ship a desktop file
 # 2. downloads all the files and extracts them to $dist/root
-# 3. process each desktop file using pk-ap-install-generate and pipe the output
-#    to a file. This tool also copies the correct icons.
+# 3. process each desktop file in-process using libappinstall, which adds the
+#    application to the database and also copies the correct icons.
 
 import os
 import sys
@@ -37,6 +37,7 @@ import pisi
 import shutil
 import tarfile
 import subprocess
+from gi.repository import GObject, GLib, AppInstall
 
 def usage():
     print "%s --repo=rawhide --dist=./dist" % sys.argv[0]
@@ -79,18 +80,30 @@ def main():
     if not os.path.exists(dist):
         os.makedirs(dist)
 
-    # open sql file
-    db = dist + "/%s.db" % reponame
-    cmd = "app-install-admin --force --create --database=%s" % db
+    # the icon encoder uses threads
+    GObject.threads_init()
+
+    # create the database, which stays open for the whole run
+    dbfile = dist + "/%s.db" % reponame
     print 'creating database'
-    p = subprocess.Popen(cmd, cwd='.', shell=True, stdout=subprocess.PIPE)
-    p.wait()
-    if p.returncode:
-        print 'cannot create database', db, 'using', cmd
-        for line in p.stdout:
-            print line
+    db = AppInstall.Database.new()
+    try:
+        db.set_filename(dbfile)
+        db.open(False)
+        db.create()
+    except GLib.GError, e:
+        print 'cannot create database', dbfile, ':', e.message
         sys.exit()
 
+    # find out which icon sizes we ship
+    config = AppInstall.Config.new()
+    try:
+        config.load(None)
+    except GLib.GError, e:
+        print 'cannot load config:', e.message
+        sys.exit()
+    encoder = AppInstall.IconEncoder.new()
+
     # create a cache directory
     if not os.path.exists(dist + '/cache'):
         os.makedirs(dist + '/cache')
@@ -99,6 +112,7 @@ def main():
     icondir = dist + '/icons'
     if not os.path.exists(icondir):
         os.makedirs(icondir)
+    AppInstall.generator_create_icon_directories(config, icondir)
 
     # find all packages
     pkgs = pdb.list_packages(reponame)
@@ -163,14 +177,11 @@ def main():
         # find desktop files
         for instfile in desktop_files:
             print 'generating sql for', instfile
-            cwd = os.getcwd()
-            cmd = "app-install-generate --icondir=%s --repo=%s --root=%s/install --desktopfile=/%s --package=%s --database=%s" % (icondir, reponame, directory, instfile, pkg.name, db)
-            p = subprocess.Popen(cmd, shell=True, cwd=cwd, stdout=subprocess.PIPE)
-            p.wait()
-            if p.returncode:
-                print 'failed to generate sql for', instfile, 'using', cmd, ':'
-                for line in p.stdout:
-                    print line
+            try:
+                AppInstall.generator_add_desktop_file(db, config, encoder, None, directory + '/install',
+                                                      '/' + instfile, reponame, pkg.name, icondir)
+            except GLib.GError, e:
+                print 'failed to generate sql for', instfile, ':', e.message
                 continue
 
         # do this per package else it takes ages at the end
@@ -183,6 +194,12 @@ def main():
         license_string += "%s and " % license
     print 'license = ', license_string
 
+    # flush everything to disk
+    try:
+        db.close(False)
+    except GLib.GError, e:
+        print 'cannot close database:', e.message
+
     # create tar archive
     print 'creating archive'
     cwd = os.getcwd()
@@ -22,8 +22,8 @@
 #
 # 1. gets a list of all the packages in a repo that ship a desktop file
 # 2. downloads all the files and extracts them to $dist/root
-# 3. process each desktop file using pk-ap-install-generate and pipe the output
-#    to a file. This tool also copies the correct icons.
+# 3. process each desktop file in-process using libappinstall, which adds the
+#    application to the database and also copies the correct icons.
 
 import os
 import sys
@@ -31,7 +31,7 @@ import getopt
 import yum
 import shutil
 import tarfile
-import subprocess
+from gi.repository import GObject, GLib, AppInstall
 
 def usage():
     print "yum-app-install-generate.py --repo=rawhide --dist=./dist"
@@ -71,17 +71,29 @@ def main():
     yb.doConfigSetup(errorlevel=-1, debuglevel=-1)
     yb.conf.cache = 0
 
-    # open sql file
-    db = dist + "/%s.db" % reponame
-    cmd = "../src/app-install-admin --force --create --database=%s" % db
+    # the icon encoder uses threads
+    GObject.threads_init()
+
+    # create the database, which stays open for the whole run
+    dbfile = dist + "/%s.db" % reponame
     print 'creating database'
-    p = subprocess.Popen(cmd, cwd='.', shell=True, stdout=subprocess.PIPE)
-    p.wait()
-    if p.returncode:
-        print 'cannot create database', db, 'using', cmd
-        for line in p.stdout:
-            print line
+    db = AppInstall.Database.new()
+    try:
+        db.set_filename(dbfile)
+        db.open(False)
+        db.create()
+    except GLib.GError, e:
+        print 'cannot create database', dbfile, ':', e.message
+        sys.exit()
+
+    # find out which icon sizes we ship
+    config = AppInstall.Config.new()
+    try:
+        config.load(None)
+    except GLib.GError, e:
+        print 'cannot load config:', e.message
         sys.exit()
+    encoder = AppInstall.IconEncoder.new()
 
     # create a cache directory
     if not os.path.exists(dist + '/cache'):
@@ -91,6 +103,7 @@ def main():
     icondir = dist + '/icons'
     if not os.path.exists(icondir):
         os.makedirs(icondir)
+    AppInstall.generator_create_icon_directories(config, icondir)
 
     # find all packages
     pkgs = yb.pkgSack
@@ -138,28 +151,22 @@ def main():
 
         # extract
         directory = dist + '/root'
-        path = '../cache/' + relativepath
-        cmd = "app-install-extract-package --package=%s --directory=%s" % (path, directory)
+        path = dist + '/cache/' + relativepath
         print 'extracting', path
-        p = subprocess.Popen(cmd, cwd=directory, shell=True, stdout=subprocess.PIPE)
-        p.wait()
-        if p.returncode:
-            print 'cannot extract package', relativepath
-            for line in p.stdout:
-                print line
+        try:
+            AppInstall.utils_extract_archive(path, directory)
+        except GLib.GError, e:
+            print 'cannot extract package', relativepath, ':', e.message
             continue
 
         # find desktop files
         for instfile in desktop_files:
             print 'generating sql for', instfile
-            cwd = os.getcwd()
-            cmd = "../src/app-install-generate --icondir=%s --repo=%s --root=%s --desktopfile=%s --package=%s --database=%s" % (icondir, pkg.repoid, directory, instfile, pkg.name, db)
-            p = subprocess.Popen(cmd, shell=True, cwd=cwd, stdout=subprocess.PIPE)
-            p.wait()
-            if p.returncode:
-                print 'failed to generate sql for', instfile, 'using', cmd, ':'
-                for line in p.stdout:
-                    print line
+            try:
+                AppInstall.generator_add_desktop_file(db, config, encoder, None, directory, instfile,
+                                                      pkg.repoid, pkg.name, icondir)
+            except GLib.GError, e:
+                print 'failed to generate sql for', instfile, ':', e.message
                 continue
 
         # do this per package else it takes ages at the end
@@ -174,6 +181,12 @@ def main():
         license_string += "%s and " % license
     print 'license = ', license_string
 
+    # flush everything to disk
+    try:
+        db.close(False)
+    except GLib.GError, e:
+        print 'cannot close database:', e.message
+
     # create tar archive
     print 'creating archive'
     cwd = os.getcwd()
@@ -44,7 +44,10 @@ main (int argc, char *argv[])
 	gchar *icondir = NULL;
 	gchar *source_database = NULL;
 	gchar *source_icondir = NULL;
+	gchar *source_icon_archive = NULL;
 	guint number = 0;
+	gboolean icon_pack = FALSE;
+	gboolean icon_atlas = FALSE;
 	gboolean ret;
 	GError *error = NULL;
 	AiDatabase *db = NULL;
@@ -64,6 +67,15 @@ main (int argc, char *argv[])
 		{ "source-icondir", '\0', 0, G_OPTION_ARG_STRING, &source_icondir,
 		  /* TRANSLATORS: the icon directory */
 		  _("Icon directory"), NULL},
+		{ "source-icon-archive", '\0', 0, G_OPTION_ARG_STRING, &source_icon_archive,
+		  /* TRANSLATORS: the icons are only extracted when they are first used */
+		  _("Icon archive to use the icons from when they are needed"), NULL},
+		{ "icon-pack", '\0', 0, G_OPTION_ARG_NONE, &icon_pack,
+		  /* TRANSLATORS: all the icons of each size are put in one file */
+		  _("Write an icon pack for each icon size"), NULL},
+		{ "icon-atlas", '\0', 0, G_OPTION_ARG_NONE, &icon_atlas,
+		  /* TRANSLATORS: the icons of each size are drawn into a few large images */
+		  _("Write an icon atlas for each icon size"), NULL},
 		{ "repo", 'r', 0, G_OPTION_ARG_STRING, &repo,
 		  /* TRANSLATORS: the repo of the software source, e.g. fedora */
 		  _("Name of the remote repo"), NULL},
@@ -106,6 +118,16 @@ main (int argc, char *argv[])
 		retval = 1;
 		goto out;
 	}
+	if ((icon_pack || icon_atlas) && icondir == NULL) {
+		g_print ("%s\n", _("An icon pack or atlas needs an icon directory"));
+		retval = 1;
+		goto out;
+	}
+	if (source_icon_archive != NULL && repo == NULL) {
+		g_print ("%s\n", _("An icon archive can only be added for a repo"));
+		retval = 1;
+		goto out;
+	}
 
 	/* open database */
 	db = ai_database_new ();
@@ -144,6 +166,19 @@ main (int argc, char *argv[])
 			goto out;
 		}
 		egg_debug ("%i additions to the database", number);
+
+		/* only index the icons, they are written out when first used */
+		if (source_icon_archive != NULL) {
+			number = 0;
+			ret = ai_database_import_icon_archive (db, source_icon_archive, repo, &number, &error);
+			if (!ret) {
+				g_print ("%s: %s\n", _("Failed to add icon archive"), error->message);
+				g_error_free (error);
+				retval = 1;
+				goto out;
+			}
+			egg_debug ("%i icons in the archive", number);
+		}
 	}
 
 	if (package != NULL) {
@@ -173,6 +208,33 @@ main (int argc, char *argv[])
 		egg_debug ("%i additions to the database", number);
 	}
 
+	/* existing packs and atlases are always refreshed so they match the directories */
+	if (icondir != NULL) {
+		ret = ai_database_update_icon_packs (db, icon_pack, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to update icon packs"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+		ret = ai_database_update_icon_atlases (db, icon_atlas, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to update icon atlases"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* only the localized names of the changed applications */
+	ret = ai_database_refresh_display (db, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to update display table"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+
 out:
 	/* close it */
 	if (db != NULL) {
@@ -190,6 +252,7 @@ out:
 	g_free (icondir);
 	g_free (source_database);
 	g_free (source_icondir);
+	g_free (source_icon_archive);
 	return retval;
 }
 
@@ -127,6 +127,15 @@ main (int argc, char *argv[])
 			retval = 1;
 			goto out;
 		}
+
+		/* an upgraded database gets an empty display table */
+		ret = ai_database_update_display (db, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to update display table"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
 	}
 
 	/* refresh it */
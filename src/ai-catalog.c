@@ -0,0 +1,857 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <sqlite3.h>
+
+#include "egg-debug.h"
+
+#include "ai-catalog.h"
+#include "ai-common.h"
+#include "ai-result.h"
+#include "ai-utils-private.h"
+
+static void     ai_catalog_finalize	(GObject     *object);
+
+#define AI_CATALOG_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_CATALOG, AiCatalogPrivate))
+
+/*
+ * AiCatalogApp:
+ *
+ * All the strings live in the snapshot string chunk, and repeated values
+ * such as the repo and categories are only stored once.
+ */
+typedef struct {
+	const gchar	*application_id;
+	const gchar	*package_name;
+	const gchar	*categories;
+	const gchar	*repo_id;
+	const gchar	*icon_name;
+	const gchar	*application_name;
+	const gchar	*application_summary;
+	const gchar	*screenshot_url;
+	const gchar	*name_folded;
+	guint		 rating;
+	gboolean	 installed;
+} AiCatalogApp;
+
+typedef struct {
+	const gchar	*application_name;
+	const gchar	*application_summary;
+	const gchar	*name_folded;
+} AiCatalogTranslation;
+
+/*
+ * AiCatalogSnapshot:
+ *
+ * An immutable copy of the database. Readers hold a reference while they
+ * use it, so a newer snapshot can be swapped in at any time.
+ */
+typedef struct {
+	volatile gint	 refcount;
+	GStringChunk	*strings;
+	GArray		*apps;		/* of AiCatalogApp, sorted by name */
+	GHashTable	*ids;		/* id to index + 1 */
+	GHashTable	*categories;	/* category to GArray of indexes */
+	GHashTable	*locales;	/* locale to GHashTable of id to AiCatalogTranslation */
+	time_t		 mtime;
+} AiCatalogSnapshot;
+
+/*
+ * AiCatalogPrivate:
+ *
+ * Private #AiCatalog data
+ */
+struct _AiCatalogPrivate
+{
+	gchar				*filename;
+	GMutex				*mutex;
+	AiCatalogSnapshot		*snapshot;
+	sqlite3				*db;
+	gint				 data_version;
+	guint				 watch_id;
+	gboolean			 rebuilding;
+};
+
+enum {
+	SIGNAL_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+G_DEFINE_TYPE (AiCatalog, ai_catalog, G_TYPE_OBJECT)
+
+/*
+ * ai_catalog_snapshot_unref:
+ */
+static void
+ai_catalog_snapshot_unref (AiCatalogSnapshot *snapshot)
+{
+	if (snapshot == NULL)
+		return;
+	if (!g_atomic_int_dec_and_test (&snapshot->refcount))
+		return;
+	g_hash_table_unref (snapshot->locales);
+	g_hash_table_unref (snapshot->categories);
+	g_hash_table_unref (snapshot->ids);
+	g_array_free (snapshot->apps, TRUE);
+	g_string_chunk_free (snapshot->strings);
+	g_free (snapshot);
+}
+
+/*
+ * ai_catalog_array_free:
+ */
+static void
+ai_catalog_array_free (GArray *array)
+{
+	g_array_free (array, TRUE);
+}
+
+/*
+ * ai_catalog_intern:
+ */
+static const gchar *
+ai_catalog_intern (AiCatalogSnapshot *snapshot, const guchar *value)
+{
+	if (value == NULL)
+		return NULL;
+	return g_string_chunk_insert_const (snapshot->strings, (const gchar *) value);
+}
+
+/*
+ * ai_catalog_fold:
+ */
+static const gchar *
+ai_catalog_fold (AiCatalogSnapshot *snapshot, const gchar *value)
+{
+	gchar *tmp;
+	const gchar *folded;
+
+	if (value == NULL)
+		return NULL;
+	tmp = g_utf8_casefold (value, -1);
+	folded = g_string_chunk_insert_const (snapshot->strings, tmp);
+	g_free (tmp);
+	return folded;
+}
+
+/*
+ * ai_catalog_snapshot_add_categories:
+ */
+static void
+ai_catalog_snapshot_add_categories (AiCatalogSnapshot *snapshot, const gchar *categories, guint idx)
+{
+	guint i;
+	gchar **split;
+	GArray *array;
+
+	if (categories == NULL)
+		return;
+	split = g_strsplit (categories, ";", -1);
+	for (i=0; split[i] != NULL; i++) {
+		if (split[i][0] == '\0')
+			continue;
+		array = g_hash_table_lookup (snapshot->categories, split[i]);
+		if (array == NULL) {
+			array = g_array_new (FALSE, FALSE, sizeof (guint));
+			g_hash_table_insert (snapshot->categories,
+					     (gpointer) ai_catalog_intern (snapshot, (const guchar *) split[i]),
+					     array);
+		}
+		g_array_append_val (array, idx);
+	}
+	g_strfreev (split);
+}
+
+/*
+ * ai_catalog_snapshot_new:
+ *
+ * Reads the whole database using its own connection, so this is safe to
+ * call from any thread.
+ */
+static AiCatalogSnapshot *
+ai_catalog_snapshot_new (const gchar *filename, GError **error)
+{
+	gint rc;
+	guint idx;
+	struct stat buf;
+	AiCatalogApp app;
+	AiCatalogTranslation *translation;
+	AiCatalogSnapshot *snapshot;
+	GHashTable *hash;
+	const gchar *locale;
+	sqlite3 *db = NULL;
+	sqlite3_stmt *stmt = NULL;
+
+	snapshot = g_new0 (AiCatalogSnapshot, 1);
+	snapshot->refcount = 1;
+	snapshot->strings = g_string_chunk_new (64 * 1024);
+	snapshot->apps = g_array_new (FALSE, FALSE, sizeof (AiCatalogApp));
+	snapshot->ids = g_hash_table_new (g_str_hash, g_str_equal);
+	snapshot->categories = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) ai_catalog_array_free);
+	snapshot->locales = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) g_hash_table_unref);
+
+	/* get the time before reading, so a write while we read makes us stale */
+	if (g_stat (filename, &buf) != 0) {
+		g_set_error (error, 1, 0, "cannot stat %s", filename);
+		goto failed;
+	}
+	snapshot->mtime = buf.st_mtime;
+
+	rc = sqlite3_open_v2 (filename, &db, SQLITE_OPEN_READONLY, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "Can't open database %s: %s", filename, sqlite3_errmsg (db));
+		goto failed;
+	}
+
+	/* the array is in name order, so every result list is too */
+	rc = sqlite3_prepare_v2 (db, "SELECT application_id, package_name, categories, "
+				 "repo_id, icon_name, application_name, application_summary, "
+				 "rating, screenshot_url, installed "
+				 "FROM applications ORDER BY application_name", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (db));
+		goto failed;
+	}
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		app.application_id = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 0));
+		if (app.application_id == NULL)
+			continue;
+		app.package_name = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 1));
+		app.categories = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 2));
+		app.repo_id = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 3));
+		app.icon_name = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 4));
+		app.application_name = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 5));
+		app.application_summary = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 6));
+		app.rating = sqlite3_column_int (stmt, 7);
+		app.screenshot_url = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 8));
+		app.installed = sqlite3_column_int (stmt, 9);
+		app.name_folded = ai_catalog_fold (snapshot, app.application_name);
+
+		idx = snapshot->apps->len;
+		g_array_append_val (snapshot->apps, app);
+		g_hash_table_insert (snapshot->ids, (gpointer) app.application_id, GUINT_TO_POINTER (idx + 1));
+		ai_catalog_snapshot_add_categories (snapshot, app.categories, idx);
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (db));
+		goto failed;
+	}
+	sqlite3_finalize (stmt);
+
+	/* translations, grouped by locale */
+	rc = sqlite3_prepare_v2 (db, "SELECT application_id, application_name, application_summary, locale "
+				 "FROM translations", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (db));
+		goto failed;
+	}
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		locale = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 3));
+		if (locale == NULL || sqlite3_column_text (stmt, 0) == NULL)
+			continue;
+		hash = g_hash_table_lookup (snapshot->locales, locale);
+		if (hash == NULL) {
+			hash = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+			g_hash_table_insert (snapshot->locales, (gpointer) locale, hash);
+		}
+		translation = g_new0 (AiCatalogTranslation, 1);
+		translation->application_name = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 1));
+		translation->application_summary = ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 2));
+		translation->name_folded = ai_catalog_fold (snapshot, translation->application_name);
+		g_hash_table_insert (hash, (gpointer) ai_catalog_intern (snapshot, sqlite3_column_text (stmt, 0)), translation);
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (db));
+		goto failed;
+	}
+	sqlite3_finalize (stmt);
+	sqlite3_close (db);
+	egg_debug ("loaded %i applications in %i locales", snapshot->apps->len,
+		   g_hash_table_size (snapshot->locales));
+	return snapshot;
+failed:
+	sqlite3_finalize (stmt);
+	if (db != NULL)
+		sqlite3_close (db);
+	ai_catalog_snapshot_unref (snapshot);
+	return NULL;
+}
+
+/*
+ * ai_catalog_get_data_version:
+ *
+ * The data version changes whenever another connection commits.
+ */
+static gint
+ai_catalog_get_data_version (sqlite3 *db)
+{
+	gint version = -1;
+	sqlite3_stmt *stmt = NULL;
+
+	if (db == NULL)
+		goto out;
+	if (sqlite3_prepare_v2 (db, "PRAGMA data_version", -1, &stmt, NULL) != SQLITE_OK)
+		goto out;
+	if (sqlite3_step (stmt) == SQLITE_ROW)
+		version = sqlite3_column_int (stmt, 0);
+out:
+	sqlite3_finalize (stmt);
+	return version;
+}
+
+/*
+ * ai_catalog_open_watch:
+ *
+ * (Re)opens the connection used to notice changes, which is needed again
+ * when the database file has been replaced.
+ */
+static void
+ai_catalog_open_watch (AiCatalog *catalog)
+{
+	AiCatalogPrivate *priv = catalog->priv;
+
+	if (priv->db != NULL)
+		sqlite3_close (priv->db);
+	priv->db = NULL;
+	if (sqlite3_open_v2 (priv->filename, &priv->db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+		egg_warning ("cannot watch %s: %s", priv->filename, sqlite3_errmsg (priv->db));
+		sqlite3_close (priv->db);
+		priv->db = NULL;
+	}
+	priv->data_version = ai_catalog_get_data_version (priv->db);
+}
+
+/*
+ * ai_catalog_swap:
+ *
+ * Publishes a new snapshot. Readers still using the old one keep it
+ * alive until they are done.
+ */
+static void
+ai_catalog_swap (AiCatalog *catalog, AiCatalogSnapshot *snapshot)
+{
+	AiCatalogSnapshot *old;
+	AiCatalogPrivate *priv = catalog->priv;
+
+	g_mutex_lock (priv->mutex);
+	old = priv->snapshot;
+	priv->snapshot = snapshot;
+	g_mutex_unlock (priv->mutex);
+	ai_catalog_snapshot_unref (old);
+}
+
+/*
+ * ai_catalog_get_snapshot:
+ *
+ * The lock only covers taking a reference, never a rebuild, so readers
+ * do not wait for the database to be read.
+ */
+static AiCatalogSnapshot *
+ai_catalog_get_snapshot (AiCatalog *catalog)
+{
+	AiCatalogSnapshot *snapshot;
+	AiCatalogPrivate *priv = catalog->priv;
+
+	g_mutex_lock (priv->mutex);
+	snapshot = priv->snapshot;
+	if (snapshot != NULL)
+		g_atomic_int_inc (&snapshot->refcount);
+	g_mutex_unlock (priv->mutex);
+	return snapshot;
+}
+
+/*
+ * ai_catalog_set_filename:
+ *
+ * The database filename, or %NULL for the default.
+ */
+gboolean
+ai_catalog_set_filename (AiCatalog *catalog, const gchar *filename, GError **error)
+{
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), FALSE);
+
+	g_free (catalog->priv->filename);
+	if (filename == NULL)
+		filename = AI_DEFAULT_DATABASE;
+	catalog->priv->filename = g_strdup (filename);
+	return TRUE;
+}
+
+/*
+ * ai_catalog_load:
+ *
+ * Reads the database into memory, replacing anything already loaded.
+ */
+gboolean
+ai_catalog_load (AiCatalog *catalog, GError **error)
+{
+	gboolean ret = FALSE;
+	AiCatalogSnapshot *snapshot;
+	AiCatalogPrivate *priv = catalog->priv;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), FALSE);
+
+	/* open first, so a commit while we read is noticed next time */
+	ai_catalog_open_watch (catalog);
+	snapshot = ai_catalog_snapshot_new (priv->filename, error);
+	if (snapshot == NULL)
+		goto out;
+	ai_catalog_swap (catalog, snapshot);
+	ret = TRUE;
+out:
+	return ret;
+}
+
+/*
+ * ai_catalog_get_is_stale:
+ *
+ * Return value: %TRUE if the database has changed since it was loaded
+ */
+gboolean
+ai_catalog_get_is_stale (AiCatalog *catalog)
+{
+	gboolean ret = TRUE;
+	struct stat buf;
+	AiCatalogSnapshot *snapshot;
+	AiCatalogPrivate *priv = catalog->priv;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), FALSE);
+
+	snapshot = ai_catalog_get_snapshot (catalog);
+	if (snapshot == NULL)
+		goto out;
+
+	/* a new file, or written by a tool that replaced it */
+	if (g_stat (priv->filename, &buf) != 0 || buf.st_mtime != snapshot->mtime)
+		goto out;
+
+	/* committed to in place */
+	if (ai_catalog_get_data_version (priv->db) != priv->data_version)
+		goto out;
+	ret = FALSE;
+out:
+	ai_catalog_snapshot_unref (snapshot);
+	return ret;
+}
+
+/*
+ * ai_catalog_rebuilt_cb:
+ *
+ * Back in the main context once the new snapshot is in place.
+ */
+static gboolean
+ai_catalog_rebuilt_cb (gpointer user_data)
+{
+	AiCatalog *catalog = AI_CATALOG (user_data);
+
+	catalog->priv->rebuilding = FALSE;
+	g_signal_emit (catalog, signals[SIGNAL_CHANGED], 0);
+	g_object_unref (catalog);
+	return FALSE;
+}
+
+/*
+ * AiCatalogRebuild:
+ *
+ * The thread gets its own copy of the filename, as it can be changed
+ * from the main context while the database is being read.
+ */
+typedef struct {
+	AiCatalog	*catalog;
+	gchar		*filename;
+} AiCatalogRebuild;
+
+/*
+ * ai_catalog_rebuild_thread:
+ */
+static gpointer
+ai_catalog_rebuild_thread (gpointer user_data)
+{
+	AiCatalogRebuild *rebuild = (AiCatalogRebuild *) user_data;
+	AiCatalogSnapshot *snapshot;
+	GError *error = NULL;
+
+	snapshot = ai_catalog_snapshot_new (rebuild->filename, &error);
+	if (snapshot == NULL) {
+		egg_warning ("failed to reload catalog: %s", error->message);
+		g_error_free (error);
+	} else {
+		ai_catalog_swap (rebuild->catalog, snapshot);
+	}
+	g_idle_add (ai_catalog_rebuilt_cb, rebuild->catalog);
+	g_free (rebuild->filename);
+	g_free (rebuild);
+	return NULL;
+}
+
+/*
+ * ai_catalog_watch_cb:
+ */
+static gboolean
+ai_catalog_watch_cb (gpointer user_data)
+{
+	AiCatalog *catalog = AI_CATALOG (user_data);
+	AiCatalogPrivate *priv = catalog->priv;
+	AiCatalogRebuild *rebuild;
+	GError *error = NULL;
+
+	if (priv->rebuilding || !ai_catalog_get_is_stale (catalog))
+		goto out;
+
+	/* reopen before reading, for the same reason as ai_catalog_load() */
+	egg_debug ("%s changed, reloading", priv->filename);
+	ai_catalog_open_watch (catalog);
+	priv->rebuilding = TRUE;
+	rebuild = g_new0 (AiCatalogRebuild, 1);
+	rebuild->catalog = g_object_ref (catalog);
+	rebuild->filename = g_strdup (priv->filename);
+	if (g_thread_create (ai_catalog_rebuild_thread, rebuild, FALSE, &error) == NULL) {
+		egg_warning ("failed to start reload: %s", error->message);
+		g_error_free (error);
+		priv->rebuilding = FALSE;
+		g_object_unref (rebuild->catalog);
+		g_free (rebuild->filename);
+		g_free (rebuild);
+	}
+out:
+	return TRUE;
+}
+
+/*
+ * ai_catalog_watch:
+ * @interval: how often to check the database, in seconds, or 0 to stop
+ *
+ * Checks the database from the default main context, and when it has
+ * changed reads it again in a thread. Queries carry on using the old
+ * data until the new data is swapped in, then ::changed is emitted.
+ * Threads have to be initialized.
+ */
+void
+ai_catalog_watch (AiCatalog *catalog, guint interval)
+{
+	AiCatalogPrivate *priv = catalog->priv;
+
+	g_return_if_fail (AI_IS_CATALOG (catalog));
+	g_return_if_fail (g_thread_supported ());
+
+	if (priv->watch_id != 0) {
+		g_source_remove (priv->watch_id);
+		priv->watch_id = 0;
+	}
+	if (interval > 0)
+		priv->watch_id = g_timeout_add_seconds (interval, ai_catalog_watch_cb, catalog);
+}
+
+/*
+ * ai_catalog_get_size:
+ *
+ * Return value: the number of applications
+ */
+guint
+ai_catalog_get_size (AiCatalog *catalog)
+{
+	guint size = 0;
+	AiCatalogSnapshot *snapshot;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), 0);
+
+	snapshot = ai_catalog_get_snapshot (catalog);
+	if (snapshot != NULL)
+		size = snapshot->apps->len;
+	ai_catalog_snapshot_unref (snapshot);
+	return size;
+}
+
+/*
+ * ai_catalog_get_locale_chain:
+ *
+ * Looks up the translations for each fallback of @locale once, so each
+ * application only needs a hash lookup per fallback.
+ *
+ * Return value: the translation hashes to try, best first
+ */
+static GPtrArray *
+ai_catalog_get_locale_chain (AiCatalogSnapshot *snapshot, const gchar *locale)
+{
+	GPtrArray *chain;
+	GHashTable *hash;
+	gchar **fallbacks;
+	guint i;
+
+	chain = g_ptr_array_new ();
+	fallbacks = ai_utils_get_locale_fallbacks (locale);
+	for (i=0; fallbacks[i] != NULL; i++) {
+		hash = g_hash_table_lookup (snapshot->locales, fallbacks[i]);
+		if (hash != NULL)
+			g_ptr_array_add (chain, hash);
+	}
+	g_strfreev (fallbacks);
+	return chain;
+}
+
+/*
+ * ai_catalog_get_translation:
+ */
+static const AiCatalogTranslation *
+ai_catalog_get_translation (GPtrArray *chain, const AiCatalogApp *app)
+{
+	const AiCatalogTranslation *translation;
+	guint i;
+
+	for (i=0; i<chain->len; i++) {
+		translation = g_hash_table_lookup (g_ptr_array_index (chain, i), app->application_id);
+		if (translation != NULL)
+			return translation;
+	}
+	return NULL;
+}
+
+/*
+ * ai_catalog_add_result:
+ *
+ * The same as a database search, untranslated values are used if there
+ * is no translation.
+ */
+static void
+ai_catalog_add_result (GPtrArray *array, GPtrArray *chain, const AiCatalogApp *app)
+{
+	const gchar *name = app->application_name;
+	const gchar *summary = app->application_summary;
+	const AiCatalogTranslation *translation;
+	AiResult *result;
+
+	translation = ai_catalog_get_translation (chain, app);
+	if (translation != NULL) {
+		if (translation->application_name != NULL)
+			name = translation->application_name;
+		if (translation->application_summary != NULL)
+			summary = translation->application_summary;
+	}
+	result = g_object_new (AI_TYPE_RESULT,
+			       "application-id", app->application_id,
+			       "package-name", app->package_name,
+			       "categories", app->categories,
+			       "repo-id", app->repo_id,
+			       "icon-name", app->icon_name,
+			       "application-name", name,
+			       "application-summary", summary,
+			       "rating", app->rating,
+			       "screenshot-url", app->screenshot_url,
+			       "installed", app->installed,
+			       NULL);
+	g_ptr_array_add (array, result);
+}
+
+/**
+ * ai_catalog_search_by_id:
+ * @locale: (allow-none): the locale for the name and summary, e.g. "pt_BR"
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications
+ */
+GPtrArray *
+ai_catalog_search_by_id (AiCatalog *catalog, const gchar *value, const gchar *locale)
+{
+	guint idx;
+	GPtrArray *array;
+	GPtrArray *chain = NULL;
+	AiCatalogSnapshot *snapshot;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), NULL);
+	g_return_val_if_fail (value != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	snapshot = ai_catalog_get_snapshot (catalog);
+	if (snapshot == NULL)
+		goto out;
+	chain = ai_catalog_get_locale_chain (snapshot, locale);
+	idx = GPOINTER_TO_UINT (g_hash_table_lookup (snapshot->ids, value));
+	if (idx > 0)
+		ai_catalog_add_result (array, chain, &g_array_index (snapshot->apps, AiCatalogApp, idx - 1));
+out:
+	if (chain != NULL)
+		g_ptr_array_unref (chain);
+	ai_catalog_snapshot_unref (snapshot);
+	return array;
+}
+
+/**
+ * ai_catalog_search_by_name:
+ * @locale: (allow-none): the locale for the name and summary, e.g. "pt_BR"
+ *
+ * Matches any part of the name, ignoring case. The translated name is
+ * searched as well as the untranslated one.
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, sorted by name
+ */
+GPtrArray *
+ai_catalog_search_by_name (AiCatalog *catalog, const gchar *value, const gchar *locale)
+{
+	guint i;
+	gchar *folded;
+	GPtrArray *array;
+	GPtrArray *chain = NULL;
+	const AiCatalogApp *app;
+	const AiCatalogTranslation *translation;
+	AiCatalogSnapshot *snapshot;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), NULL);
+	g_return_val_if_fail (value != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	folded = g_utf8_casefold (value, -1);
+	snapshot = ai_catalog_get_snapshot (catalog);
+	if (snapshot == NULL)
+		goto out;
+	chain = ai_catalog_get_locale_chain (snapshot, locale);
+	for (i=0; i<snapshot->apps->len; i++) {
+		app = &g_array_index (snapshot->apps, AiCatalogApp, i);
+		if (app->name_folded != NULL && strstr (app->name_folded, folded) != NULL) {
+			ai_catalog_add_result (array, chain, app);
+			continue;
+		}
+		translation = ai_catalog_get_translation (chain, app);
+		if (translation != NULL && translation->name_folded != NULL &&
+		    strstr (translation->name_folded, folded) != NULL)
+			ai_catalog_add_result (array, chain, app);
+	}
+out:
+	if (chain != NULL)
+		g_ptr_array_unref (chain);
+	ai_catalog_snapshot_unref (snapshot);
+	g_free (folded);
+	return array;
+}
+
+/**
+ * ai_catalog_search_by_category:
+ * @value: a single category, e.g. "Game"
+ * @locale: (allow-none): the locale for the name and summary, e.g. "pt_BR"
+ *
+ * Return value: (element-type AiResult) (transfer full): the applications
+ * in the category, sorted by name
+ */
+GPtrArray *
+ai_catalog_search_by_category (AiCatalog *catalog, const gchar *value, const gchar *locale)
+{
+	guint i;
+	GArray *indexes;
+	GPtrArray *array;
+	GPtrArray *chain = NULL;
+	AiCatalogSnapshot *snapshot;
+
+	g_return_val_if_fail (AI_IS_CATALOG (catalog), NULL);
+	g_return_val_if_fail (value != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	snapshot = ai_catalog_get_snapshot (catalog);
+	if (snapshot == NULL)
+		goto out;
+	indexes = g_hash_table_lookup (snapshot->categories, value);
+	if (indexes == NULL)
+		goto out;
+	chain = ai_catalog_get_locale_chain (snapshot, locale);
+	for (i=0; i<indexes->len; i++) {
+		ai_catalog_add_result (array, chain,
+				       &g_array_index (snapshot->apps, AiCatalogApp,
+						       g_array_index (indexes, guint, i)));
+	}
+out:
+	if (chain != NULL)
+		g_ptr_array_unref (chain);
+	ai_catalog_snapshot_unref (snapshot);
+	return array;
+}
+
+/*
+ * ai_catalog_class_init:
+ */
+static void
+ai_catalog_class_init (AiCatalogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_catalog_finalize;
+
+	/* emitted in the main context once a reload has been swapped in */
+	signals[SIGNAL_CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (AiCatalogClass, changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
+	g_type_class_add_private (klass, sizeof (AiCatalogPrivate));
+}
+
+/*
+ * ai_catalog_init:
+ */
+static void
+ai_catalog_init (AiCatalog *catalog)
+{
+	catalog->priv = AI_CATALOG_GET_PRIVATE (catalog);
+	catalog->priv->filename = g_strdup (AI_DEFAULT_DATABASE);
+	catalog->priv->mutex = g_mutex_new ();
+	catalog->priv->data_version = -1;
+}
+
+/*
+ * ai_catalog_finalize:
+ */
+static void
+ai_catalog_finalize (GObject *object)
+{
+	AiCatalog *catalog = AI_CATALOG (object);
+	AiCatalogPrivate *priv = catalog->priv;
+
+	if (priv->watch_id != 0)
+		g_source_remove (priv->watch_id);
+	if (priv->db != NULL)
+		sqlite3_close (priv->db);
+	ai_catalog_snapshot_unref (priv->snapshot);
+	g_mutex_free (priv->mutex);
+	g_free (priv->filename);
+
+	G_OBJECT_CLASS (ai_catalog_parent_class)->finalize (object);
+}
+
+/*
+ * ai_catalog_new:
+ *
+ * Return value: a new AiCatalog object.
+ */
+AiCatalog *
+ai_catalog_new (void)
+{
+	AiCatalog *catalog;
+	catalog = g_object_new (AI_TYPE_CATALOG, NULL);
+	return AI_CATALOG (catalog);
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_CATALOG_H
+#define __AI_CATALOG_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_CATALOG		(ai_catalog_get_type ())
+#define AI_CATALOG(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_CATALOG, AiCatalog))
+#define AI_CATALOG_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_CATALOG, AiCatalogClass))
+#define AI_IS_CATALOG(o)	(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_CATALOG))
+#define AI_IS_CATALOG_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_CATALOG))
+#define AI_CATALOG_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_CATALOG, AiCatalogClass))
+
+typedef struct _AiCatalogPrivate	AiCatalogPrivate;
+typedef struct _AiCatalog		AiCatalog;
+typedef struct _AiCatalogClass		AiCatalogClass;
+
+struct _AiCatalog
+{
+	 GObject		 parent;
+	 AiCatalogPrivate	*priv;
+};
+
+struct _AiCatalogClass
+{
+	GObjectClass		 parent_class;
+	void			(* changed)		(AiCatalog	*catalog);
+};
+
+GType		 ai_catalog_get_type		  	(void);
+AiCatalog	*ai_catalog_new				(void);
+gboolean	 ai_catalog_set_filename		(AiCatalog	*catalog,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 ai_catalog_load			(AiCatalog	*catalog,
+							 GError		**error);
+gboolean	 ai_catalog_get_is_stale		(AiCatalog	*catalog);
+void		 ai_catalog_watch			(AiCatalog	*catalog,
+							 guint		 interval);
+guint		 ai_catalog_get_size			(AiCatalog	*catalog);
+GPtrArray	*ai_catalog_search_by_id		(AiCatalog	*catalog,
+							 const gchar	*value,
+							 const gchar	*locale);
+GPtrArray	*ai_catalog_search_by_name		(AiCatalog	*catalog,
+							 const gchar	*value,
+							 const gchar	*locale);
+GPtrArray	*ai_catalog_search_by_category		(AiCatalog	*catalog,
+							 const gchar	*value,
+							 const gchar	*locale);
+
+G_END_DECLS
+
+#endif /* __AI_CATALOG_H */
+
@@ -24,5 +24,16 @@
 
 #define AI_DEFAULT_DATABASE		LOCALSTATEDIR "/lib/app-install/desktop.db"
 #define AI_DEFAULT_ICONDIR		DATADIR "/app-install/icons"
+#define AI_DEFAULT_CONFIG		SYSCONFDIR "/app-install/app-install.conf"
+
+#ifndef __FreeBSD__
+#define APPLICATIONS_DIR		"/usr/share/applications"
+#define ICONS_DIR			"/usr/share/icons"
+#define PIXMAPS_DIR			"/usr/share/pixmaps"
+#else
+#define APPLICATIONS_DIR		"/usr/local/share/applications"
+#define ICONS_DIR			"/usr/local/share/icons"
+#define PIXMAPS_DIR			"/usr/local/share/pixmaps"
+#endif
 
 #endif /* __PK_APP_INSTALL_COMMON_H */
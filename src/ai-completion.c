@@ -0,0 +1,555 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-completion.h"
+
+static void     ai_completion_finalize	(GObject     *object);
+
+#define AI_COMPLETION_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_COMPLETION, AiCompletionPrivate))
+
+/* prefixes up to this many characters match most of the catalog, so the
+ * items for each one are kept in rank order */
+#define AI_COMPLETION_RANKED_CHARS	3
+
+/*
+ * AiCompletionToken:
+ *
+ * One normalized word (or whole name) pointing back at the item it
+ * came from. An item usually owns several tokens.
+ */
+typedef struct {
+	const gchar	*token;
+	guint		 item;
+} AiCompletionToken;
+
+typedef struct {
+	const gchar	*name;
+	guint		 rating;
+} AiCompletionItem;
+
+/*
+ * AiCompletionPrivate:
+ *
+ * Private #AiCompletion data
+ */
+struct _AiCompletionPrivate
+{
+	GStringChunk			*chunk;
+	GArray				*tokens;
+	GArray				*items;
+	GArray				*ranks;
+	GHashTable			*names;
+	GHashTable			*buckets;
+	gboolean			 sorted;
+};
+
+G_DEFINE_TYPE (AiCompletion, ai_completion, G_TYPE_OBJECT)
+
+/*
+ * ai_completion_normalize:
+ *
+ * Decomposes, casefolds and drops accents so "Éditeur" and "editeur"
+ * compare equal. Anything that is not a letter or digit becomes a
+ * single space, which leaves a list of words separated by spaces.
+ *
+ * Return value: the normalized text, free with g_free()
+ */
+gchar *
+ai_completion_normalize (const gchar *text)
+{
+	gchar *decomposed;
+	gchar *folded = NULL;
+	const gchar *p;
+	gunichar c;
+	GString *string;
+
+	g_return_val_if_fail (text != NULL, NULL);
+
+	string = g_string_new ("");
+	decomposed = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+	if (decomposed == NULL) {
+		egg_debug ("ignoring invalid UTF-8: %s", text);
+		goto out;
+	}
+	folded = g_utf8_casefold (decomposed, -1);
+	for (p = folded; *p != '\0'; p = g_utf8_next_char (p)) {
+		c = g_utf8_get_char (p);
+		if (g_unichar_type (c) == G_UNICODE_NON_SPACING_MARK)
+			continue;
+		if (!g_unichar_isalnum (c)) {
+			if (string->len > 0 && string->str[string->len-1] != ' ')
+				g_string_append_c (string, ' ');
+			continue;
+		}
+		g_string_append_unichar (string, c);
+	}
+	if (string->len > 0 && string->str[string->len-1] == ' ')
+		g_string_truncate (string, string->len - 1);
+out:
+	g_free (decomposed);
+	g_free (folded);
+	return g_string_free (string, FALSE);
+}
+
+/*
+ * ai_completion_add_token:
+ */
+static void
+ai_completion_add_token (AiCompletion *completion, const gchar *text, guint item)
+{
+	AiCompletionToken token;
+	AiCompletionPrivate *priv = completion->priv;
+
+	token.token = g_string_chunk_insert_const (priv->chunk, text);
+	token.item = item;
+	g_array_append_val (priv->tokens, token);
+}
+
+/*
+ * ai_completion_add_text:
+ *
+ * Adds every word so "kit" finds "GNOME PackageKit", and the whole
+ * normalized text so "gnome pa" does too.
+ */
+static void
+ai_completion_add_text (AiCompletion *completion, const gchar *text, guint item)
+{
+	gchar *normalized;
+	gchar **words = NULL;
+	guint i;
+
+	normalized = ai_completion_normalize (text);
+	if (normalized[0] == '\0')
+		goto out;
+	ai_completion_add_token (completion, normalized, item);
+	if (strchr (normalized, ' ') == NULL)
+		goto out;
+	words = g_strsplit (normalized, " ", -1);
+	for (i=0; words[i] != NULL; i++)
+		ai_completion_add_token (completion, words[i], item);
+out:
+	g_strfreev (words);
+	g_free (normalized);
+}
+
+/*
+ * ai_completion_add:
+ * @name: the text to offer as a completion
+ * @keywords: other text that should also find @name, or %NULL
+ * @rating: higher ratings are offered first
+ *
+ * Adding a name more than once keeps the best rating.
+ */
+void
+ai_completion_add (AiCompletion *completion, const gchar *name, const gchar **keywords, guint rating)
+{
+	AiCompletionItem item;
+	AiCompletionItem *tmp;
+	AiCompletionPrivate *priv = completion->priv;
+	gpointer index;
+	guint i;
+
+	g_return_if_fail (AI_IS_COMPLETION (completion));
+	g_return_if_fail (name != NULL);
+
+	/* the names are unique, so a query never has to skip duplicates */
+	index = g_hash_table_lookup (priv->names, name);
+	if (index != NULL) {
+		tmp = &g_array_index (priv->items, AiCompletionItem, GPOINTER_TO_UINT (index) - 1);
+		tmp->rating = MAX (tmp->rating, rating);
+	} else {
+		item.name = g_string_chunk_insert_const (priv->chunk, name);
+		item.rating = rating;
+		g_array_append_val (priv->items, item);
+		index = GUINT_TO_POINTER (priv->items->len);
+		g_hash_table_insert (priv->names, (gpointer) item.name, index);
+		ai_completion_add_text (completion, name, GPOINTER_TO_UINT (index) - 1);
+	}
+	for (i=0; keywords != NULL && keywords[i] != NULL; i++)
+		ai_completion_add_text (completion, keywords[i], GPOINTER_TO_UINT (index) - 1);
+	priv->sorted = FALSE;
+}
+
+/*
+ * ai_completion_token_compare:
+ */
+static gint
+ai_completion_token_compare (gconstpointer a, gconstpointer b)
+{
+	const AiCompletionToken *token1 = (const AiCompletionToken *) a;
+	const AiCompletionToken *token2 = (const AiCompletionToken *) b;
+	gint retval;
+
+	retval = strcmp (token1->token, token2->token);
+	if (retval != 0)
+		return retval;
+	return (gint) token1->item - (gint) token2->item;
+}
+
+/*
+ * ai_completion_item_compare:
+ *
+ * Best rated first, then alphabetical so the order is stable.
+ */
+static gint
+ai_completion_item_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GArray *items = (GArray *) user_data;
+	const AiCompletionItem *item1 = &g_array_index (items, AiCompletionItem, *((const guint *) a));
+	const AiCompletionItem *item2 = &g_array_index (items, AiCompletionItem, *((const guint *) b));
+
+	if (item1->rating != item2->rating)
+		return item1->rating > item2->rating ? -1 : 1;
+	return strcmp (item1->name, item2->name);
+}
+
+/*
+ * ai_completion_rank_compare:
+ */
+static gint
+ai_completion_rank_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GArray *ranks = (GArray *) user_data;
+	guint rank1 = g_array_index (ranks, guint, *((const guint *) a));
+	guint rank2 = g_array_index (ranks, guint, *((const guint *) b));
+
+	if (rank1 == rank2)
+		return 0;
+	return rank1 < rank2 ? -1 : 1;
+}
+
+/*
+ * ai_completion_bucket_free:
+ */
+static void
+ai_completion_bucket_free (GArray *bucket)
+{
+	g_array_free (bucket, TRUE);
+}
+
+/*
+ * ai_completion_build:
+ *
+ * Sorts the tokens for the binary search, ranks the items, and fills a
+ * bucket of ranked items for every short prefix.
+ */
+static void
+ai_completion_build (AiCompletion *completion)
+{
+	GArray *order;
+	GArray *bucket;
+	GHashTableIter iter;
+	const AiCompletionToken *token;
+	const gchar *end;
+	gchar *prefix;
+	guint i, j;
+	guint item;
+	AiCompletionPrivate *priv = completion->priv;
+
+	g_array_sort (priv->tokens, ai_completion_token_compare);
+
+	/* the position of each item when sorted best first */
+	order = g_array_sized_new (FALSE, FALSE, sizeof (guint), priv->items->len);
+	for (i=0; i<priv->items->len; i++)
+		g_array_append_val (order, i);
+	g_array_sort_with_data (order, ai_completion_item_compare, priv->items);
+	g_array_set_size (priv->ranks, priv->items->len);
+	for (i=0; i<order->len; i++)
+		g_array_index (priv->ranks, guint, g_array_index (order, guint, i)) = i;
+	g_array_free (order, TRUE);
+
+	g_hash_table_remove_all (priv->buckets);
+	for (i=0; i<priv->tokens->len; i++) {
+		token = &g_array_index (priv->tokens, AiCompletionToken, i);
+		end = token->token;
+		for (j=0; j<AI_COMPLETION_RANKED_CHARS && *end != '\0'; j++) {
+			end = g_utf8_next_char (end);
+			prefix = g_strndup (token->token, end - token->token);
+			bucket = g_hash_table_lookup (priv->buckets, prefix);
+			if (bucket == NULL) {
+				bucket = g_array_new (FALSE, FALSE, sizeof (guint));
+				g_hash_table_insert (priv->buckets, prefix, bucket);
+			} else {
+				g_free (prefix);
+			}
+			g_array_append_val (bucket, token->item);
+		}
+	}
+
+	/* best first, and each item only once */
+	g_hash_table_iter_init (&iter, priv->buckets);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &bucket)) {
+		g_array_sort_with_data (bucket, ai_completion_rank_compare, priv->ranks);
+		for (i=0, j=0; i<bucket->len; i++) {
+			item = g_array_index (bucket, guint, i);
+			if (j > 0 && g_array_index (bucket, guint, j-1) == item)
+				continue;
+			g_array_index (bucket, guint, j++) = item;
+		}
+		g_array_set_size (bucket, j);
+	}
+	priv->sorted = TRUE;
+}
+
+/*
+ * ai_completion_lower_bound:
+ *
+ * Return value: the first token that sorts at or after @prefix
+ */
+static guint
+ai_completion_lower_bound (AiCompletion *completion, const gchar *prefix)
+{
+	GArray *tokens = completion->priv->tokens;
+	guint lo = 0;
+	guint hi = tokens->len;
+	guint mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp (g_array_index (tokens, AiCompletionToken, mid).token, prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * ai_completion_heap_sift_down:
+ *
+ * The heap holds the best @limit items found so far, worst at the top.
+ */
+static void
+ai_completion_heap_sift_down (GArray *heap, GArray *ranks, guint i)
+{
+	guint child;
+	guint tmp;
+
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= heap->len)
+			break;
+		if (child + 1 < heap->len &&
+		    ai_completion_rank_compare (&g_array_index (heap, guint, child + 1),
+						&g_array_index (heap, guint, child), ranks) > 0)
+			child++;
+		if (ai_completion_rank_compare (&g_array_index (heap, guint, child),
+						&g_array_index (heap, guint, i), ranks) <= 0)
+			break;
+		tmp = g_array_index (heap, guint, i);
+		g_array_index (heap, guint, i) = g_array_index (heap, guint, child);
+		g_array_index (heap, guint, child) = tmp;
+		i = child;
+	}
+}
+
+/*
+ * ai_completion_heap_add:
+ */
+static void
+ai_completion_heap_add (GArray *heap, GArray *ranks, guint limit, guint item)
+{
+	guint i;
+	guint parent;
+	guint tmp;
+
+	/* full, so it has to beat the worst one */
+	if (limit > 0 && heap->len >= limit) {
+		if (ai_completion_rank_compare (&item, &g_array_index (heap, guint, 0), ranks) >= 0)
+			return;
+		g_array_index (heap, guint, 0) = item;
+		ai_completion_heap_sift_down (heap, ranks, 0);
+		return;
+	}
+
+	g_array_append_val (heap, item);
+	for (i=heap->len-1; i>0; i=parent) {
+		parent = (i - 1) / 2;
+		if (ai_completion_rank_compare (&g_array_index (heap, guint, i),
+						&g_array_index (heap, guint, parent), ranks) <= 0)
+			break;
+		tmp = g_array_index (heap, guint, i);
+		g_array_index (heap, guint, i) = g_array_index (heap, guint, parent);
+		g_array_index (heap, guint, parent) = tmp;
+	}
+}
+
+/**
+ * ai_completion_complete:
+ * @prefix: what the user has typed so far
+ * @limit: the maximum number of completions, or 0 for no limit
+ *
+ * The index is built the first time this is called after adding. Short
+ * prefixes, which match most of the catalog, read the first @limit
+ * items of a ranked bucket. Longer ones only match a few tokens, which
+ * are found with a binary search and ranked with a heap of @limit items.
+ *
+ * Return value: (array zero-terminated=1) (transfer full): the unique
+ * completions, best rated first. Free with g_strfreev()
+ */
+gchar **
+ai_completion_complete (AiCompletion *completion, const gchar *prefix, guint limit)
+{
+	gchar *normalized;
+	gsize length;
+	guint i;
+	guint item;
+	GArray *matches = NULL;
+	GArray *bucket;
+	GPtrArray *array;
+	GHashTable *seen = NULL;
+	const AiCompletionToken *token;
+	AiCompletionPrivate *priv = completion->priv;
+
+	g_return_val_if_fail (AI_IS_COMPLETION (completion), NULL);
+	g_return_val_if_fail (prefix != NULL, NULL);
+
+	array = g_ptr_array_new ();
+
+	/* nothing typed means nothing to complete */
+	normalized = ai_completion_normalize (prefix);
+	length = strlen (normalized);
+	if (length == 0)
+		goto out;
+
+	if (!priv->sorted)
+		ai_completion_build (completion);
+
+	/* already in order */
+	if (g_utf8_strlen (normalized, -1) <= AI_COMPLETION_RANKED_CHARS) {
+		bucket = g_hash_table_lookup (priv->buckets, normalized);
+		for (i=0; bucket != NULL && i<bucket->len; i++) {
+			if (limit > 0 && i >= limit)
+				break;
+			item = g_array_index (bucket, guint, i);
+			g_ptr_array_add (array, g_strdup (g_array_index (priv->items, AiCompletionItem, item).name));
+		}
+		goto out;
+	}
+
+	/* the tokens that start with the prefix are contiguous, and an item
+	 * can have several of them */
+	matches = g_array_new (FALSE, FALSE, sizeof (guint));
+	seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	for (i=ai_completion_lower_bound (completion, normalized); i<priv->tokens->len; i++) {
+		token = &g_array_index (priv->tokens, AiCompletionToken, i);
+		if (strncmp (token->token, normalized, length) != 0)
+			break;
+		if (g_hash_table_lookup (seen, GUINT_TO_POINTER (token->item + 1)) != NULL)
+			continue;
+		g_hash_table_insert (seen, GUINT_TO_POINTER (token->item + 1), GUINT_TO_POINTER (1));
+		ai_completion_heap_add (matches, priv->ranks, limit, token->item);
+	}
+	g_array_sort_with_data (matches, ai_completion_rank_compare, priv->ranks);
+	for (i=0; i<matches->len; i++) {
+		item = g_array_index (matches, guint, i);
+		g_ptr_array_add (array, g_strdup (g_array_index (priv->items, AiCompletionItem, item).name));
+	}
+out:
+	g_ptr_array_add (array, NULL);
+	if (seen != NULL)
+		g_hash_table_unref (seen);
+	if (matches != NULL)
+		g_array_free (matches, TRUE);
+	g_free (normalized);
+	return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+/*
+ * ai_completion_get_size:
+ *
+ * Return value: the number of unique names that have been added
+ */
+guint
+ai_completion_get_size (AiCompletion *completion)
+{
+	g_return_val_if_fail (AI_IS_COMPLETION (completion), 0);
+	return completion->priv->items->len;
+}
+
+/*
+ * ai_completion_class_init:
+ */
+static void
+ai_completion_class_init (AiCompletionClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_completion_finalize;
+	g_type_class_add_private (klass, sizeof (AiCompletionPrivate));
+}
+
+/*
+ * ai_completion_init:
+ */
+static void
+ai_completion_init (AiCompletion *completion)
+{
+	completion->priv = AI_COMPLETION_GET_PRIVATE (completion);
+	completion->priv->chunk = g_string_chunk_new (4096);
+	completion->priv->tokens = g_array_new (FALSE, FALSE, sizeof (AiCompletionToken));
+	completion->priv->items = g_array_new (FALSE, FALSE, sizeof (AiCompletionItem));
+	completion->priv->ranks = g_array_new (FALSE, FALSE, sizeof (guint));
+	completion->priv->names = g_hash_table_new (g_str_hash, g_str_equal);
+	completion->priv->buckets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							   (GDestroyNotify) ai_completion_bucket_free);
+	completion->priv->sorted = TRUE;
+}
+
+/*
+ * ai_completion_finalize:
+ */
+static void
+ai_completion_finalize (GObject *object)
+{
+	AiCompletion *completion = AI_COMPLETION (object);
+	AiCompletionPrivate *priv = completion->priv;
+
+	g_string_chunk_free (priv->chunk);
+	g_array_free (priv->tokens, TRUE);
+	g_array_free (priv->items, TRUE);
+	g_array_free (priv->ranks, TRUE);
+	g_hash_table_unref (priv->names);
+	g_hash_table_unref (priv->buckets);
+
+	G_OBJECT_CLASS (ai_completion_parent_class)->finalize (object);
+}
+
+/*
+ * ai_completion_new:
+ *
+ * Return value: a new AiCompletion object.
+ */
+AiCompletion *
+ai_completion_new (void)
+{
+	AiCompletion *completion;
+	completion = g_object_new (AI_TYPE_COMPLETION, NULL);
+	return AI_COMPLETION (completion);
+}
+
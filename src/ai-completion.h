@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_COMPLETION_H
+#define __AI_COMPLETION_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_COMPLETION		(ai_completion_get_type ())
+#define AI_COMPLETION(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_COMPLETION, AiCompletion))
+#define AI_COMPLETION_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_COMPLETION, AiCompletionClass))
+#define AI_IS_COMPLETION(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_COMPLETION))
+#define AI_IS_COMPLETION_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_COMPLETION))
+#define AI_COMPLETION_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_COMPLETION, AiCompletionClass))
+
+typedef struct _AiCompletionPrivate	AiCompletionPrivate;
+typedef struct _AiCompletion		AiCompletion;
+typedef struct _AiCompletionClass	AiCompletionClass;
+
+struct _AiCompletion
+{
+	 GObject		 parent;
+	 AiCompletionPrivate	*priv;
+};
+
+struct _AiCompletionClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_completion_get_type		  	(void);
+AiCompletion	*ai_completion_new			(void);
+gchar		*ai_completion_normalize		(const gchar	*text);
+void		 ai_completion_add			(AiCompletion	*completion,
+							 const gchar	*name,
+							 const gchar	**keywords,
+							 guint		 rating);
+gchar		**ai_completion_complete		(AiCompletion	*completion,
+							 const gchar	*prefix,
+							 guint		 limit);
+guint		 ai_completion_get_size			(AiCompletion	*completion);
+
+G_END_DECLS
+
+#endif /* __AI_COMPLETION_H */
+
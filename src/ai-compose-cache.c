@@ -0,0 +1,628 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+#include <sqlite3.h>
+
+#include "egg-debug.h"
+
+#include "ai-compose-cache.h"
+
+static void     ai_compose_cache_finalize	(GObject     *object);
+
+#define AI_COMPOSE_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_COMPOSE_CACHE, AiComposeCachePrivate))
+
+/*
+ * AiComposeCachePrivate:
+ *
+ * Private #AiComposeCache data
+ */
+struct _AiComposeCachePrivate
+{
+	sqlite3				*db;
+	gchar				*settings;
+	GMutex				*mutex;
+	guint				 hits;
+};
+
+G_DEFINE_TYPE (AiComposeCache, ai_compose_cache, G_TYPE_OBJECT)
+
+/*
+ * ai_compose_app_new:
+ */
+AiComposeApp *
+ai_compose_app_new (const gchar *application_id, const gchar *desktop, gsize desktop_length)
+{
+	AiComposeApp *app;
+	app = g_new0 (AiComposeApp, 1);
+	app->application_id = g_strdup (application_id);
+	app->desktop = g_strndup (desktop, desktop_length);
+	app->desktop_length = desktop_length;
+	app->icons = g_ptr_array_new ();
+	return app;
+}
+
+/*
+ * ai_compose_app_free:
+ */
+void
+ai_compose_app_free (AiComposeApp *app)
+{
+	AiComposeIcon *icon;
+	guint i;
+
+	for (i=0; i<app->icons->len; i++) {
+		icon = g_ptr_array_index (app->icons, i);
+		g_free (icon->filename);
+		g_free (icon->data);
+		g_free (icon);
+	}
+	g_ptr_array_unref (app->icons);
+	g_free (app->application_id);
+	g_free (app->desktop);
+	g_free (app);
+}
+
+/*
+ * ai_compose_app_add_icon:
+ *
+ * Takes ownership of @data.
+ */
+void
+ai_compose_app_add_icon (AiComposeApp *app, const gchar *filename, gchar *data, gsize length)
+{
+	AiComposeIcon *icon;
+	icon = g_new0 (AiComposeIcon, 1);
+	icon->filename = g_strdup (filename);
+	icon->data = data;
+	icon->length = length;
+	g_ptr_array_add (app->icons, icon);
+}
+
+/*
+ * ai_compose_cache_get_checksum:
+ *
+ * Return value: the SHA1 of a package, which is mapped rather than read
+ */
+gchar *
+ai_compose_cache_get_checksum (const gchar *filename, GError **error)
+{
+	GMappedFile *mapped;
+	gchar *checksum = NULL;
+
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		goto out;
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+						(const guchar *) g_mapped_file_get_contents (mapped),
+						g_mapped_file_get_length (mapped));
+	g_mapped_file_unref (mapped);
+out:
+	return checksum;
+}
+
+/*
+ * ai_compose_cache_exec:
+ */
+static gboolean
+ai_compose_cache_exec (AiComposeCache *cache, const gchar *statement, GError **error)
+{
+	gint rc;
+	gchar *error_msg = NULL;
+
+	rc = sqlite3_exec (cache->priv->db, statement, NULL, NULL, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", error_msg);
+		sqlite3_free (error_msg);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * ai_compose_cache_prepare:
+ *
+ * Prepares a statement and binds the checksum and settings as the first
+ * two parameters, which every query here is keyed on.
+ */
+static sqlite3_stmt *
+ai_compose_cache_prepare (AiComposeCache *cache, const gchar *sql, const gchar *checksum, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	rc = sqlite3_prepare_v2 (priv->db, sql, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		return NULL;
+	}
+	sqlite3_bind_text (stmt, 1, checksum, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text (stmt, 2, priv->settings, -1, SQLITE_TRANSIENT);
+	return stmt;
+}
+
+/*
+ * ai_compose_cache_open:
+ * @settings: anything that changes the generated data, e.g. the icon sizes
+ *
+ * Opens the cache, creating it if required. Results stored with different
+ * settings are never returned.
+ */
+gboolean
+ai_compose_cache_open (AiComposeCache *cache, const gchar *filename, const gchar *settings, GError **error)
+{
+	gboolean ret = FALSE;
+	gint rc;
+	const gchar *statement;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (priv->db == NULL, FALSE);
+
+	rc = sqlite3_open (filename, &priv->db);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "Can't open compose cache %s: %s", filename, sqlite3_errmsg (priv->db));
+		sqlite3_close (priv->db);
+		priv->db = NULL;
+		goto out;
+	}
+	priv->settings = g_strdup (settings != NULL ? settings : "default");
+
+	/* a lost cache only costs us a full compose */
+	ret = ai_compose_cache_exec (cache, "PRAGMA synchronous=OFF", error);
+	if (!ret)
+		goto out;
+
+	statement = "CREATE TABLE IF NOT EXISTS packages ("
+		    "checksum TEXT, "
+		    "settings TEXT, "
+		    "filename TEXT, "
+		    "size INTEGER, "
+		    "mtime INTEGER, "
+		    "PRIMARY KEY (checksum, settings));"
+		    "CREATE INDEX IF NOT EXISTS packages_filename ON packages (filename);"
+		    "CREATE TABLE IF NOT EXISTS applications ("
+		    "checksum TEXT, "
+		    "settings TEXT, "
+		    "application_id TEXT, "
+		    "desktop BLOB);"
+		    "CREATE INDEX IF NOT EXISTS applications_checksum ON applications (checksum);"
+		    "CREATE TABLE IF NOT EXISTS icons ("
+		    "checksum TEXT, "
+		    "settings TEXT, "
+		    "application_id TEXT, "
+		    "filename TEXT, "
+		    "blob_id TEXT);"
+		    "CREATE INDEX IF NOT EXISTS icons_checksum ON icons (checksum);"
+		    "CREATE INDEX IF NOT EXISTS icons_blob_id ON icons (blob_id);"
+		    "CREATE TABLE IF NOT EXISTS blobs ("
+		    "blob_id TEXT PRIMARY KEY, "
+		    "data BLOB);"
+		    "CREATE TEMP TABLE stale_packages (checksum TEXT PRIMARY KEY);"
+		    "CREATE TEMP TABLE stale_blobs (blob_id TEXT PRIMARY KEY);"
+		    "CREATE TEMP TABLE seen_packages (filename TEXT PRIMARY KEY);";
+	ret = ai_compose_cache_exec (cache, statement, error);
+out:
+	return ret;
+}
+
+/*
+ * ai_compose_cache_lookup_stat:
+ *
+ * Finds the checksum of a package we have seen before without reading
+ * it, if the size and modification time have not changed.
+ *
+ * Return value: the checksum, or %NULL
+ */
+gchar *
+ai_compose_cache_lookup_stat (AiComposeCache *cache, const gchar *filename, guint64 size, guint64 mtime)
+{
+	gchar *checksum = NULL;
+	gint rc;
+	sqlite3_stmt *stmt;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), NULL);
+
+	g_mutex_lock (priv->mutex);
+	rc = sqlite3_prepare_v2 (priv->db, "SELECT checksum FROM packages WHERE filename = ? "
+				 "AND size = ? AND mtime = ? AND settings = ?", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		egg_warning ("SQL error: %s", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+	sqlite3_bind_text (stmt, 1, filename, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int64 (stmt, 2, size);
+	sqlite3_bind_int64 (stmt, 3, mtime);
+	sqlite3_bind_text (stmt, 4, priv->settings, -1, SQLITE_TRANSIENT);
+	if (sqlite3_step (stmt) == SQLITE_ROW)
+		checksum = g_strdup ((const gchar *) sqlite3_column_text (stmt, 0));
+	sqlite3_finalize (stmt);
+out:
+	g_mutex_unlock (priv->mutex);
+	return checksum;
+}
+
+/*
+ * ai_compose_cache_lookup:
+ *
+ * Return value: the cached applications of the package, which may be
+ * empty, or %NULL if the package has not been cached
+ */
+GPtrArray *
+ai_compose_cache_lookup (AiComposeCache *cache, const gchar *checksum)
+{
+	GPtrArray *apps = NULL;
+	GHashTable *hash = NULL;
+	AiComposeApp *app;
+	sqlite3_stmt *stmt = NULL;
+	GError *error = NULL;
+	const gchar *data;
+	gsize length;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), NULL);
+	g_return_val_if_fail (checksum != NULL, NULL);
+
+	g_mutex_lock (priv->mutex);
+
+	/* the package may legitimately have no applications */
+	stmt = ai_compose_cache_prepare (cache, "SELECT 1 FROM packages WHERE checksum = ? AND settings = ?", checksum, &error);
+	if (stmt == NULL)
+		goto out;
+	if (sqlite3_step (stmt) != SQLITE_ROW)
+		goto out;
+	sqlite3_finalize (stmt);
+
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_compose_app_free);
+	hash = g_hash_table_new (g_str_hash, g_str_equal);
+	stmt = ai_compose_cache_prepare (cache, "SELECT application_id, desktop FROM applications "
+					 "WHERE checksum = ? AND settings = ? ORDER BY rowid", checksum, &error);
+	if (stmt == NULL)
+		goto out;
+	while (sqlite3_step (stmt) == SQLITE_ROW) {
+		data = sqlite3_column_blob (stmt, 1);
+		length = sqlite3_column_bytes (stmt, 1);
+		app = ai_compose_app_new ((const gchar *) sqlite3_column_text (stmt, 0), data != NULL ? data : "", length);
+		g_ptr_array_add (apps, app);
+		g_hash_table_insert (hash, app->application_id, app);
+	}
+	sqlite3_finalize (stmt);
+
+	stmt = ai_compose_cache_prepare (cache, "SELECT icons.application_id, icons.filename, blobs.data "
+					 "FROM icons, blobs WHERE icons.checksum = ? AND icons.settings = ? "
+					 "AND icons.blob_id = blobs.blob_id ORDER BY icons.rowid", checksum, &error);
+	if (stmt == NULL)
+		goto out;
+	while (sqlite3_step (stmt) == SQLITE_ROW) {
+		app = g_hash_table_lookup (hash, sqlite3_column_text (stmt, 0));
+		if (app == NULL)
+			continue;
+		data = sqlite3_column_blob (stmt, 2);
+		length = sqlite3_column_bytes (stmt, 2);
+		ai_compose_app_add_icon (app, (const gchar *) sqlite3_column_text (stmt, 1), g_memdup (data, length), length);
+	}
+	priv->hits++;
+	egg_debug ("hit %s with %i applications", checksum, apps->len);
+out:
+	if (error != NULL) {
+		egg_warning ("failed to look up %s: %s", checksum, error->message);
+		g_error_free (error);
+		if (apps != NULL)
+			g_ptr_array_unref (apps);
+		apps = NULL;
+	}
+	if (stmt != NULL)
+		sqlite3_finalize (stmt);
+	if (hash != NULL)
+		g_hash_table_unref (hash);
+	g_mutex_unlock (priv->mutex);
+	return apps;
+}
+
+/*
+ * ai_compose_cache_store_apps:
+ */
+static gboolean
+ai_compose_cache_store_apps (AiComposeCache *cache, const gchar *checksum, GPtrArray *apps, GError **error)
+{
+	gboolean ret = FALSE;
+	AiComposeApp *app;
+	AiComposeIcon *icon;
+	sqlite3_stmt *stmt_app = NULL;
+	sqlite3_stmt *stmt_icon = NULL;
+	sqlite3_stmt *stmt_blob = NULL;
+	gchar *blob_id;
+	guint i, j;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	stmt_app = ai_compose_cache_prepare (cache, "INSERT INTO applications (checksum, settings, application_id, desktop) "
+					     "VALUES (?, ?, ?, ?)", checksum, error);
+	if (stmt_app == NULL)
+		goto out;
+	stmt_icon = ai_compose_cache_prepare (cache, "INSERT INTO icons (checksum, settings, application_id, filename, blob_id) "
+					      "VALUES (?, ?, ?, ?, ?)", checksum, error);
+	if (stmt_icon == NULL)
+		goto out;
+	if (sqlite3_prepare_v2 (priv->db, "INSERT OR IGNORE INTO blobs (blob_id, data) VALUES (?, ?)",
+				-1, &stmt_blob, NULL) != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+
+	for (i=0; i<apps->len; i++) {
+		app = g_ptr_array_index (apps, i);
+		sqlite3_bind_text (stmt_app, 3, app->application_id, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_blob (stmt_app, 4, app->desktop, app->desktop_length, SQLITE_TRANSIENT);
+		if (sqlite3_step (stmt_app) != SQLITE_DONE) {
+			g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+			goto out;
+		}
+		sqlite3_reset (stmt_app);
+
+		/* the same icon is often shipped by many versions of a package */
+		for (j=0; j<app->icons->len; j++) {
+			icon = g_ptr_array_index (app->icons, j);
+			blob_id = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) icon->data, icon->length);
+			sqlite3_bind_text (stmt_blob, 1, blob_id, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_blob (stmt_blob, 2, icon->data, icon->length, SQLITE_TRANSIENT);
+			sqlite3_bind_text (stmt_icon, 3, app->application_id, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (stmt_icon, 4, icon->filename, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (stmt_icon, 5, blob_id, -1, SQLITE_TRANSIENT);
+			g_free (blob_id);
+			if (sqlite3_step (stmt_blob) != SQLITE_DONE ||
+			    sqlite3_step (stmt_icon) != SQLITE_DONE) {
+				g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+				goto out;
+			}
+			sqlite3_reset (stmt_blob);
+			sqlite3_reset (stmt_icon);
+		}
+	}
+	ret = TRUE;
+out:
+	if (stmt_app != NULL)
+		sqlite3_finalize (stmt_app);
+	if (stmt_icon != NULL)
+		sqlite3_finalize (stmt_icon);
+	if (stmt_blob != NULL)
+		sqlite3_finalize (stmt_blob);
+	return ret;
+}
+
+/*
+ * ai_compose_cache_store:
+ *
+ * Replaces the cached applications of a package.
+ */
+gboolean
+ai_compose_cache_store (AiComposeCache *cache, const gchar *checksum, const gchar *filename,
+			guint64 size, guint64 mtime, GPtrArray *apps, GError **error)
+{
+	gboolean ret;
+	gchar *statement;
+	sqlite3_stmt *stmt = NULL;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), FALSE);
+	g_return_val_if_fail (checksum != NULL, FALSE);
+
+	g_mutex_lock (priv->mutex);
+	ret = ai_compose_cache_exec (cache, "BEGIN", error);
+	if (!ret)
+		goto out;
+
+	/* drop this package and any older build at the same path, then any
+	 * icon data that nothing refers to any more */
+	statement = sqlite3_mprintf ("DELETE FROM stale_packages;"
+				     "DELETE FROM stale_blobs;"
+				     "INSERT OR IGNORE INTO stale_packages SELECT checksum FROM packages "
+				     "WHERE filename = %Q AND settings = %Q;"
+				     "INSERT OR IGNORE INTO stale_packages (checksum) VALUES (%Q);"
+				     "INSERT OR IGNORE INTO stale_blobs SELECT blob_id FROM icons "
+				     "WHERE checksum IN stale_packages AND settings = %Q;"
+				     "DELETE FROM packages WHERE checksum IN stale_packages AND settings = %Q;"
+				     "DELETE FROM applications WHERE checksum IN stale_packages AND settings = %Q;"
+				     "DELETE FROM icons WHERE checksum IN stale_packages AND settings = %Q;"
+				     "DELETE FROM blobs WHERE blob_id IN stale_blobs AND NOT EXISTS "
+				     "(SELECT 1 FROM icons WHERE icons.blob_id = blobs.blob_id);",
+				     filename, priv->settings, checksum, priv->settings,
+				     priv->settings, priv->settings, priv->settings);
+	ret = ai_compose_cache_exec (cache, statement, error);
+	sqlite3_free (statement);
+	if (!ret)
+		goto rollback;
+
+	stmt = ai_compose_cache_prepare (cache, "INSERT INTO packages (checksum, settings, filename, size, mtime) "
+					 "VALUES (?, ?, ?, ?, ?)", checksum, error);
+	if (stmt == NULL) {
+		ret = FALSE;
+		goto rollback;
+	}
+	sqlite3_bind_text (stmt, 3, filename, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int64 (stmt, 4, size);
+	sqlite3_bind_int64 (stmt, 5, mtime);
+	if (sqlite3_step (stmt) != SQLITE_DONE) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+
+	ret = ai_compose_cache_store_apps (cache, checksum, apps, error);
+	if (!ret)
+		goto rollback;
+	ret = ai_compose_cache_exec (cache, "COMMIT", error);
+	goto out;
+rollback:
+	ai_compose_cache_exec (cache, "ROLLBACK", NULL);
+out:
+	if (stmt != NULL)
+		sqlite3_finalize (stmt);
+	g_mutex_unlock (priv->mutex);
+	return ret;
+}
+
+/*
+ * ai_compose_cache_prune:
+ * @directory: the package tree that was composed
+ * @filenames: every package found in @directory
+ *
+ * Drops the packages below @directory that are not in @filenames, which
+ * were deleted or replaced by a build with a new name, and then any
+ * applications, icons and icon data nothing refers to any more. Packages
+ * from other trees sharing the cache are kept.
+ */
+gboolean
+ai_compose_cache_prune (AiComposeCache *cache, const gchar *directory, GPtrArray *filenames, GError **error)
+{
+	gboolean ret;
+	guint i;
+	gchar *prefix;
+	gchar *statement;
+	sqlite3_stmt *stmt = NULL;
+	AiComposeCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), FALSE);
+	g_return_val_if_fail (directory != NULL, FALSE);
+	g_return_val_if_fail (filenames != NULL, FALSE);
+
+	g_mutex_lock (priv->mutex);
+	ret = ai_compose_cache_exec (cache, "BEGIN;DELETE FROM seen_packages", error);
+	if (!ret)
+		goto out;
+
+	if (sqlite3_prepare_v2 (priv->db, "INSERT OR IGNORE INTO seen_packages (filename) VALUES (?)",
+				-1, &stmt, NULL) != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	for (i=0; i<filenames->len; i++) {
+		sqlite3_bind_text (stmt, 1, g_ptr_array_index (filenames, i), -1, SQLITE_TRANSIENT);
+		if (sqlite3_step (stmt) != SQLITE_DONE) {
+			g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto rollback;
+		}
+		sqlite3_reset (stmt);
+	}
+
+	/* the filenames were built from the directory, so a prefix match is enough */
+	if (g_str_has_suffix (directory, "/"))
+		prefix = g_strdup (directory);
+	else
+		prefix = g_strconcat (directory, "/", NULL);
+	statement = sqlite3_mprintf ("DELETE FROM packages WHERE substr(filename, 1, length(%Q)) = %Q "
+				     "AND filename NOT IN seen_packages;"
+				     "DELETE FROM applications WHERE NOT EXISTS (SELECT 1 FROM packages p "
+				     "WHERE p.checksum = applications.checksum AND p.settings = applications.settings);"
+				     "DELETE FROM icons WHERE NOT EXISTS (SELECT 1 FROM packages p "
+				     "WHERE p.checksum = icons.checksum AND p.settings = icons.settings);"
+				     "DELETE FROM blobs WHERE NOT EXISTS "
+				     "(SELECT 1 FROM icons WHERE icons.blob_id = blobs.blob_id);"
+				     "DELETE FROM seen_packages;",
+				     prefix, prefix);
+	g_free (prefix);
+	ret = ai_compose_cache_exec (cache, statement, error);
+	sqlite3_free (statement);
+	if (!ret)
+		goto rollback;
+	ret = ai_compose_cache_exec (cache, "COMMIT", error);
+	goto out;
+rollback:
+	ai_compose_cache_exec (cache, "ROLLBACK", NULL);
+out:
+	if (stmt != NULL)
+		sqlite3_finalize (stmt);
+	g_mutex_unlock (priv->mutex);
+	return ret;
+}
+
+/*
+ * ai_compose_cache_get_hits:
+ */
+guint
+ai_compose_cache_get_hits (AiComposeCache *cache)
+{
+	guint hits;
+	g_return_val_if_fail (AI_IS_COMPOSE_CACHE (cache), 0);
+	g_mutex_lock (cache->priv->mutex);
+	hits = cache->priv->hits;
+	g_mutex_unlock (cache->priv->mutex);
+	return hits;
+}
+
+/*
+ * ai_compose_cache_class_init:
+ */
+static void
+ai_compose_cache_class_init (AiComposeCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_compose_cache_finalize;
+	g_type_class_add_private (klass, sizeof (AiComposeCachePrivate));
+}
+
+/*
+ * ai_compose_cache_init:
+ */
+static void
+ai_compose_cache_init (AiComposeCache *cache)
+{
+	cache->priv = AI_COMPOSE_CACHE_GET_PRIVATE (cache);
+	cache->priv->mutex = g_mutex_new ();
+}
+
+/*
+ * ai_compose_cache_finalize:
+ */
+static void
+ai_compose_cache_finalize (GObject *object)
+{
+	AiComposeCache *cache = AI_COMPOSE_CACHE (object);
+	AiComposeCachePrivate *priv = cache->priv;
+
+	if (priv->db != NULL)
+		sqlite3_close (priv->db);
+	g_mutex_free (priv->mutex);
+	g_free (priv->settings);
+
+	G_OBJECT_CLASS (ai_compose_cache_parent_class)->finalize (object);
+}
+
+/*
+ * ai_compose_cache_new:
+ *
+ * Return value: a new AiComposeCache object.
+ */
+AiComposeCache *
+ai_compose_cache_new (void)
+{
+	AiComposeCache *cache;
+	cache = g_object_new (AI_TYPE_COMPOSE_CACHE, NULL);
+	return AI_COMPOSE_CACHE (cache);
+}
@@ -0,0 +1,103 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_COMPOSE_CACHE_H
+#define __AI_COMPOSE_CACHE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_COMPOSE_CACHE		(ai_compose_cache_get_type ())
+#define AI_COMPOSE_CACHE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_COMPOSE_CACHE, AiComposeCache))
+#define AI_COMPOSE_CACHE_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_COMPOSE_CACHE, AiComposeCacheClass))
+#define AI_IS_COMPOSE_CACHE(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_COMPOSE_CACHE))
+#define AI_IS_COMPOSE_CACHE_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_COMPOSE_CACHE))
+#define AI_COMPOSE_CACHE_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_COMPOSE_CACHE, AiComposeCacheClass))
+
+typedef struct _AiComposeCachePrivate	AiComposeCachePrivate;
+typedef struct _AiComposeCache		AiComposeCache;
+typedef struct _AiComposeCacheClass	AiComposeCacheClass;
+
+struct _AiComposeCache
+{
+	 GObject		 parent;
+	 AiComposeCachePrivate	*priv;
+};
+
+struct _AiComposeCacheClass
+{
+	GObjectClass		 parent_class;
+};
+
+typedef struct {
+	gchar			*filename;	/* relative to the icon directory */
+	gchar			*data;
+	gsize			 length;
+} AiComposeIcon;
+
+typedef struct {
+	gchar			*application_id;
+	gchar			*desktop;	/* the desktop file contents */
+	gsize			 desktop_length;
+	GPtrArray		*icons;		/* of AiComposeIcon */
+} AiComposeApp;
+
+AiComposeApp	*ai_compose_app_new			(const gchar	*application_id,
+							 const gchar	*desktop,
+							 gsize		 desktop_length);
+void		 ai_compose_app_free			(AiComposeApp	*app);
+void		 ai_compose_app_add_icon		(AiComposeApp	*app,
+							 const gchar	*filename,
+							 gchar		*data,
+							 gsize		 length);
+
+GType		 ai_compose_cache_get_type	  	(void);
+AiComposeCache	*ai_compose_cache_new			(void);
+gboolean	 ai_compose_cache_open			(AiComposeCache	*cache,
+							 const gchar	*filename,
+							 const gchar	*settings,
+							 GError		**error);
+gchar		*ai_compose_cache_get_checksum		(const gchar	*filename,
+							 GError		**error);
+gchar		*ai_compose_cache_lookup_stat		(AiComposeCache	*cache,
+							 const gchar	*filename,
+							 guint64	 size,
+							 guint64	 mtime);
+GPtrArray	*ai_compose_cache_lookup		(AiComposeCache	*cache,
+							 const gchar	*checksum);
+gboolean	 ai_compose_cache_store			(AiComposeCache	*cache,
+							 const gchar	*checksum,
+							 const gchar	*filename,
+							 guint64	 size,
+							 guint64	 mtime,
+							 GPtrArray	*apps,
+							 GError		**error);
+gboolean	 ai_compose_cache_prune			(AiComposeCache	*cache,
+							 const gchar	*directory,
+							 GPtrArray	*filenames,
+							 GError		**error);
+guint		 ai_compose_cache_get_hits		(AiComposeCache	*cache);
+
+G_END_DECLS
+
+#endif /* __AI_COMPOSE_CACHE_H */
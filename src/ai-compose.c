@@ -0,0 +1,1023 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "ai-common.h"
+#include "ai-compose-cache.h"
+#include "ai-config.h"
+#include "ai-database.h"
+#include "ai-desktop.h"
+#include "ai-generator.h"
+#include "ai-icon-archive.h"
+#include "ai-icon-cache.h"
+#include "ai-icon-encoder.h"
+#include "ai-icon-index.h"
+#include "ai-icon-scale.h"
+#include "ai-root.h"
+#include "ai-utils.h"
+#include "ai-whitelist.h"
+
+#include "egg-debug.h"
+
+/*
+ * AiComposePackage:
+ *
+ * Everything a worker found in a package. It is only ever owned by one
+ * thread, and is handed to the writer through the queue when done.
+ */
+typedef struct {
+	guint		 position;
+	gchar		*filename;
+	gchar		*package;
+	gchar		*checksum;
+	guint64		 size;
+	guint64		 mtime;
+	gboolean	 cached;
+	gchar		*error;
+	GPtrArray	*apps;
+} AiComposePackage;
+
+/*
+ * AiComposeContext:
+ *
+ * Shared by all the workers, and only read once the pool is running.
+ */
+typedef struct {
+	AiConfig	*config;
+	AiIconCache	*cache;
+	AiComposeCache	*compose_cache;
+	AiIconEncoder	*encoder;
+	gchar		*settings;
+	GAsyncQueue	*queue;
+} AiComposeContext;
+
+/* the only files we look at, everything else is skipped in the archive */
+static const gchar *ai_compose_patterns[] = {
+	APPLICATIONS_DIR "/*.desktop",
+	ICONS_DIR "/*",
+	PIXMAPS_DIR "/*",
+	NULL };
+
+/*
+ * ai_compose_add_icon:
+ *
+ * Takes ownership of @data.
+ */
+static void
+ai_compose_add_icon (AiComposeApp *app, guint size, const gchar *basename, gchar *data, gsize length)
+{
+	gchar *filename;
+	gchar *size_dir;
+
+	size_dir = ai_config_icon_size_to_dir (size);
+	filename = g_build_filename (size_dir, basename, NULL);
+	ai_compose_app_add_icon (app, filename, data, length);
+	g_free (filename);
+	g_free (size_dir);
+}
+
+/*
+ * ai_compose_package_new:
+ */
+static AiComposePackage *
+ai_compose_package_new (guint position, const gchar *filename, const gchar *package)
+{
+	AiComposePackage *pkg;
+	pkg = g_new0 (AiComposePackage, 1);
+	pkg->position = position;
+	pkg->filename = g_strdup (filename);
+	pkg->package = g_strdup (package);
+	pkg->apps = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_compose_app_free);
+	return pkg;
+}
+
+/*
+ * ai_compose_package_free:
+ */
+static void
+ai_compose_package_free (AiComposePackage *pkg)
+{
+	g_free (pkg->filename);
+	g_free (pkg->package);
+	g_free (pkg->checksum);
+	g_free (pkg->error);
+	g_ptr_array_unref (pkg->apps);
+	g_free (pkg);
+}
+
+/*
+ * ai_compose_find_packages:
+ *
+ * Adds all the files ending in @suffix in @directory and below to @array,
+ * and counts the other files in @skipped. Source RPMs are never added.
+ */
+static void
+ai_compose_find_packages (const gchar *directory, const gchar *suffix, GPtrArray *array, guint *skipped)
+{
+	GDir *dir;
+	GError *error = NULL;
+	const gchar *filename;
+	gchar *path;
+
+	dir = g_dir_open (directory, 0, &error);
+	if (dir == NULL) {
+		egg_warning ("cannot open %s: %s", directory, error->message);
+		g_error_free (error);
+		return;
+	}
+	while ((filename = g_dir_read_name (dir)) != NULL) {
+		path = g_build_filename (directory, filename, NULL);
+		if (g_file_test (path, G_FILE_TEST_IS_DIR) &&
+		    !g_file_test (path, G_FILE_TEST_IS_SYMLINK)) {
+			ai_compose_find_packages (path, suffix, array, skipped);
+			g_free (path);
+			continue;
+		}
+		if (!g_str_has_suffix (filename, suffix) ||
+		    g_str_has_suffix (filename, ".src.rpm")) {
+			(*skipped)++;
+			g_free (path);
+			continue;
+		}
+		g_ptr_array_add (array, path);
+	}
+	g_dir_close (dir);
+}
+
+/*
+ * ai_compose_sort_filenames_cb:
+ */
+static gint
+ai_compose_sort_filenames_cb (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*((const gchar **) a), *((const gchar **) b));
+}
+
+/*
+ * ai_compose_find_icon:
+ *
+ * Return value: the path in @root of the best icon to scale, or %NULL
+ */
+static gchar *
+ai_compose_find_icon (AiIconIndex *icon_index, AiRoot *root, const gchar *icon_name, guint size)
+{
+	const AiIconIndexItem *item;
+
+	item = ai_icon_index_lookup (icon_index, icon_name, size);
+	if (item != NULL)
+		return g_strdup (item->path);
+
+	/* absolute path outside the icon directories */
+	if (icon_name[0] == '/' && ai_root_get_data (root, icon_name, NULL) != NULL)
+		return g_strdup (icon_name);
+	return NULL;
+}
+
+/*
+ * ai_compose_copy_icons:
+ *
+ * Reads the configured hicolor sizes the package ships.
+ *
+ * Return value: %TRUE if any icons were found
+ */
+static gboolean
+ai_compose_copy_icons (AiConfig *config, AiIconIndex *icon_index, AiRoot *root, AiComposeApp *app, const gchar *icon_name)
+{
+	gboolean found_any_icons = FALSE;
+	GArray *sizes;
+	const gchar *data;
+	gchar *basename;
+	gchar *tmp;
+	gsize length;
+	guint size;
+	guint i;
+	const AiIconIndexItem *item;
+
+	/* the same basename is used for every size */
+	tmp = g_strdup (icon_name);
+	g_strdelimit (tmp, ".", '\0');
+
+	sizes = ai_config_get_copy_icon_sizes (config);
+	for (i=0; i<sizes->len; i++) {
+		size = g_array_index (sizes, guint, i);
+		item = ai_icon_index_lookup_exact (icon_index, icon_name, "hicolor", size);
+		if (item == NULL)
+			continue;
+
+		data = ai_root_get_data (root, item->path, &length);
+		if (data == NULL) {
+			egg_warning ("cannot read %s", item->path);
+			continue;
+		}
+		basename = g_strdup_printf ("%s.%s", tmp, item->format);
+		ai_compose_add_icon (app, size, basename, g_memdup (data, length), length);
+		g_free (basename);
+		found_any_icons = TRUE;
+	}
+	g_free (tmp);
+	return found_any_icons;
+}
+
+/*
+ * ai_compose_scale_icons:
+ *
+ * Renders the sizes we have to ship but could not copy, using the cache
+ * where we can. The icons are encoded on this worker thread.
+ */
+static gboolean
+ai_compose_scale_icons (AiComposeContext *ctx, AiIconIndex *icon_index, AiRoot *root,
+			AiComposeApp *app, const gchar *icon_name, gboolean copied, GError **error)
+{
+	gboolean ret = TRUE;
+	GArray *sizes;
+	GdkPixbuf *pixbuf = NULL;
+	GPtrArray *scaled = NULL;
+	GError *error_local = NULL;
+	gchar *basename = NULL;
+	gchar *checksum = NULL;
+	const gchar *source = NULL;
+	gchar *data;
+	gchar *key;
+	gchar *path = NULL;
+	gsize source_length;
+	gsize length;
+	guint size_max;
+	guint size;
+	guint i;
+
+	sizes = ai_generator_get_missing_sizes (ctx->config, icon_index, icon_name);
+	if (sizes->len == 0)
+		goto out;
+	basename = g_strdup_printf ("%s.png", app->application_id);
+
+	/* find the best source icon in any theme or pixmaps */
+	size_max = ai_generator_get_max_size (sizes);
+	path = ai_compose_find_icon (icon_index, root, icon_name, size_max);
+	if (path != NULL)
+		source = ai_root_get_data (root, path, &source_length);
+	if (path == NULL || source == NULL) {
+		if (copied) {
+			egg_warning ("no icon to scale for %s, only copying", icon_name);
+			goto out;
+		}
+		g_set_error (error, 1, 0, "failed to find the icon '%s'", icon_name);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* use the sizes we have rendered from the same source before */
+	if (ctx->cache != NULL) {
+		checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) source, source_length);
+		i = 0;
+		while (i < sizes->len) {
+			size = g_array_index (sizes, guint, i);
+			key = ai_icon_cache_get_key (checksum, size, ctx->settings);
+			ret = ai_icon_cache_lookup (ctx->cache, key, &data, &length);
+			g_free (key);
+			if (!ret) {
+				i++;
+				continue;
+			}
+			ai_compose_add_icon (app, size, basename, data, length);
+			g_array_remove_index (sizes, i);
+		}
+		ret = TRUE;
+		if (sizes->len == 0)
+			goto out;
+	}
+
+	/* render vector icons at the largest size we need */
+	pixbuf = ai_generator_load_icon_from_data (path, source, source_length, size_max, error);
+	if (pixbuf == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	/* decode once, scale to every size */
+	scaled = ai_icon_scale_multi (pixbuf, (const guint *) sizes->data);
+	for (i=0; i<scaled->len; i++) {
+		size = g_array_index (sizes, guint, i);
+		ret = ai_icon_encoder_encode (ctx->encoder, g_ptr_array_index (scaled, i), &data, &length, error);
+		if (!ret)
+			goto out;
+
+		/* a failed store only costs us the next run */
+		if (checksum != NULL) {
+			key = ai_icon_cache_get_key (checksum, size, ctx->settings);
+			if (!ai_icon_cache_store (ctx->cache, key, data, length, &error_local)) {
+				egg_warning ("cannot cache %s: %s", key, error_local->message);
+				g_clear_error (&error_local);
+			}
+			g_free (key);
+		}
+		ai_compose_add_icon (app, size, basename, data, length);
+	}
+out:
+	g_free (basename);
+	if (pixbuf != NULL)
+		g_object_unref (pixbuf);
+	if (scaled != NULL)
+		g_ptr_array_unref (scaled);
+	g_array_free (sizes, TRUE);
+	g_free (checksum);
+	g_free (path);
+	return ret;
+}
+
+/*
+ * ai_compose_is_desktop_file:
+ */
+static gboolean
+ai_compose_is_desktop_file (const gchar *path)
+{
+	guint len = strlen (APPLICATIONS_DIR) - 1;
+
+	/* only the top level of the applications directory */
+	if (strncmp (path, APPLICATIONS_DIR + 1, len) != 0 || path[len] != '/')
+		return FALSE;
+	if (strchr (path + len + 1, '/') != NULL)
+		return FALSE;
+	return g_str_has_suffix (path, ".desktop");
+}
+
+/*
+ * ai_compose_process_root:
+ *
+ * Finds the applications in the in-memory package root.
+ */
+static void
+ai_compose_process_root (AiComposeContext *ctx, AiComposePackage *pkg, AiRoot *root)
+{
+	gboolean ret;
+	gboolean copied;
+	AiComposeApp *app;
+	AiDesktop *desktop;
+	AiIconIndex *icon_index = NULL;
+	GPtrArray *paths;
+	GError *error = NULL;
+	const gchar *contents;
+	const gchar *icon_name;
+	const gchar *path;
+	gchar *application_id;
+	gsize length;
+	guint i, j;
+
+	desktop = ai_desktop_new ();
+	paths = ai_root_get_paths (root);
+	for (i=0; i<paths->len; i++) {
+		path = g_ptr_array_index (paths, i);
+		if (!ai_compose_is_desktop_file (path))
+			continue;
+		contents = ai_root_get_data (root, path, &length);
+		if (contents == NULL) {
+			egg_warning ("%s in %s is a dangling link", path, pkg->package);
+			continue;
+		}
+		ret = ai_desktop_load_from_data (desktop, contents, length, &error);
+		if (!ret) {
+			egg_warning ("failed to load %s: %s", path, error->message);
+			g_clear_error (&error);
+			continue;
+		}
+		application_id = ai_generator_get_application_id (path);
+
+		/* we don't add applications without icons */
+		icon_name = ai_desktop_get_value (desktop, "Icon", NULL);
+		if (icon_name == NULL || icon_name[0] == '\0') {
+			egg_debug ("%s in %s does not reference an icon", application_id, pkg->package);
+			g_free (application_id);
+			continue;
+		}
+		app = ai_compose_app_new (application_id, contents, length);
+		g_free (application_id);
+
+		/* is this a whitelisted (icon-name-theme) icon */
+		if (ai_whitelist_contains (icon_name)) {
+			egg_debug ("%s is whitelisted, no need to copy icon", icon_name);
+			goto add;
+		}
+
+		/* index the icons of the package once for all the applications */
+		if (icon_index == NULL) {
+			icon_index = ai_icon_index_new ();
+			for (j=0; j<paths->len; j++)
+				ai_icon_index_add_path (icon_index, g_ptr_array_index (paths, j));
+		}
+		copied = ai_compose_copy_icons (ctx->config, icon_index, root, app, icon_name);
+		ret = ai_compose_scale_icons (ctx, icon_index, root, app, icon_name, copied, &error);
+		if (!ret) {
+			egg_warning ("skipping %s in %s: %s", app->application_id, pkg->package, error->message);
+			g_clear_error (&error);
+			ai_compose_app_free (app);
+			continue;
+		}
+add:
+		g_ptr_array_add (pkg->apps, app);
+	}
+	g_object_unref (desktop);
+	if (icon_index != NULL)
+		g_object_unref (icon_index);
+}
+
+/*
+ * ai_compose_process_package_cb:
+ *
+ * Runs on a worker thread. Exactly one result is pushed for every package,
+ * whether it worked or not.
+ */
+static void
+ai_compose_process_package_cb (gpointer data, gpointer user_data)
+{
+	gboolean ret;
+	AiRoot *root;
+	GError *error = NULL;
+	GPtrArray *apps;
+	AiComposePackage *pkg = (AiComposePackage *) data;
+	AiComposeContext *ctx = (AiComposeContext *) user_data;
+
+	/* unchanged packages are not even opened */
+	if (ctx->compose_cache != NULL) {
+		if (pkg->checksum == NULL) {
+			pkg->checksum = ai_compose_cache_get_checksum (pkg->filename, &error);
+			if (pkg->checksum == NULL) {
+				pkg->error = g_strdup (error->message);
+				g_error_free (error);
+				g_async_queue_push (ctx->queue, pkg);
+				return;
+			}
+		}
+		apps = ai_compose_cache_lookup (ctx->compose_cache, pkg->checksum);
+		if (apps != NULL) {
+			g_ptr_array_unref (pkg->apps);
+			pkg->apps = apps;
+			pkg->cached = TRUE;
+			g_async_queue_push (ctx->queue, pkg);
+			return;
+		}
+	}
+
+	/* the package is read into memory, never onto the disk */
+	root = ai_root_new ();
+	ret = ai_root_load_archive (root, pkg->filename, (gchar **) ai_compose_patterns, &error);
+	if (!ret) {
+		pkg->error = g_strdup (error->message);
+		g_error_free (error);
+		goto out;
+	}
+	ai_compose_process_root (ctx, pkg, root);
+out:
+	g_object_unref (root);
+	g_async_queue_push (ctx->queue, pkg);
+}
+
+/*
+ * ai_compose_get_cache_settings:
+ *
+ * Everything apart from the package itself that changes the results.
+ */
+static gchar *
+ai_compose_get_cache_settings (AiConfig *config, const gchar *encoder_settings, const gchar *whitelist)
+{
+	GArray *sizes;
+	GString *string;
+	gchar *checksum = NULL;
+	guint i;
+
+	string = g_string_new (encoder_settings);
+	g_string_append (string, "|copy");
+	sizes = ai_config_get_copy_icon_sizes (config);
+	for (i=0; i<sizes->len; i++)
+		g_string_append_printf (string, ",%i", g_array_index (sizes, guint, i));
+	g_string_append (string, "|ensure");
+	sizes = ai_config_get_ensure_icon_sizes (config);
+	for (i=0; i<sizes->len; i++)
+		g_string_append_printf (string, ",%i", g_array_index (sizes, guint, i));
+
+	/* the built-in whitelist can only change with the version */
+	if (whitelist != NULL)
+		checksum = ai_icon_cache_get_checksum (whitelist, NULL);
+	g_string_append_printf (string, "|whitelist-%s", checksum != NULL ? checksum : PACKAGE_VERSION);
+	g_free (checksum);
+	return g_string_free (string, FALSE);
+}
+
+/*
+ * ai_compose_create_parent:
+ */
+static gboolean
+ai_compose_create_parent (const gchar *filename, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar *dirname;
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, 1, 0, "cannot create %s", dirname);
+		ret = FALSE;
+	}
+	g_free (dirname);
+	return ret;
+}
+
+/*
+ * ai_compose_write_package:
+ *
+ * Only ever called from the main thread, so nothing here is locked. The
+ * icons go to @icondir, @icon_archive or both.
+ */
+static gboolean
+ai_compose_write_package (AiDatabase *db, const gchar *icondir, AiIconArchive *icon_archive,
+			  const gchar *repo, AiComposePackage *pkg, GError **error)
+{
+	gboolean ret = TRUE;
+	AiComposeApp *app;
+	AiComposeIcon *icon;
+	AiDesktop *desktop;
+	gchar *path;
+	guint i, j;
+
+	desktop = ai_desktop_new ();
+	for (i=0; i<pkg->apps->len; i++) {
+		app = g_ptr_array_index (pkg->apps, i);
+		for (j=0; j<app->icons->len; j++) {
+			icon = g_ptr_array_index (app->icons, j);
+			if (icon_archive != NULL) {
+				ret = ai_icon_archive_add (icon_archive, icon->filename, icon->data, icon->length, error);
+				if (!ret)
+					goto out;
+			}
+			if (icondir == NULL)
+				continue;
+			path = g_build_filename (icondir, icon->filename, NULL);
+			egg_debug ("saving icon to %s", path);
+			ret = g_file_set_contents (path, icon->data, icon->length, error);
+			g_free (path);
+			if (!ret)
+				goto out;
+		}
+		ret = ai_desktop_load_from_data (desktop, app->desktop, app->desktop_length, error);
+		if (!ret)
+			goto out;
+		ret = ai_generator_add_application (db, desktop, repo, pkg->package, app->application_id, error);
+		if (!ret)
+			goto out;
+		ret = ai_generator_add_translations (db, desktop, app->application_id, error);
+		if (!ret)
+			goto out;
+	}
+out:
+	g_object_unref (desktop);
+	return ret;
+}
+
+/*
+ * main:
+ */
+int
+main (int argc, char *argv[])
+{
+	gboolean verbose = FALSE;
+	GOptionContext *context;
+	gint retval = 0;
+	gboolean ret;
+	GError *error = NULL;
+	AiComposeContext ctx;
+	AiComposePackage *pkg;
+	AiDatabase *db = NULL;
+	GPtrArray *filenames = NULL;
+	GPtrArray *pending = NULL;
+	GThreadPool *pool = NULL;
+	AiIconArchive *icon_archive = NULL;
+	AiIconEncoderFilter filter;
+	gchar *database = NULL;
+	gchar *tree = NULL;
+	gchar *suffix = NULL;
+	gchar *repo = NULL;
+	gchar *icondir = NULL;
+	gchar *icon_archive_file = NULL;
+	gchar *config_file = NULL;
+	gchar *cache_dir = NULL;
+	gchar *compose_cache = NULL;
+	gchar *cache_settings;
+	gchar *whitelist = NULL;
+	gchar *png_filter = NULL;
+	gchar *package;
+	gboolean no_cache = FALSE;
+	gboolean optimize = FALSE;
+	gboolean exists;
+	gint compression = -1;
+	gint threads = 0;
+	gint block_size = 0;
+	glong processors;
+	guint applications = 0;
+	guint failed = 0;
+	guint skipped = 0;
+	struct stat stat_buf;
+	guint i;
+
+	const GOptionEntry options[] = {
+		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+		  _("Show extra debugging information"), NULL },
+		{ "database", 'd', 0, G_OPTION_ARG_STRING, &database,
+		  /* TRANSLATORS: the database is created if it does not exist */
+		  _("Database file to write"), NULL},
+		{ "tree", 't', 0, G_OPTION_ARG_STRING, &tree,
+		  /* TRANSLATORS: the directory of packages, e.g. a repo */
+		  _("Directory of packages to process"), NULL},
+		{ "suffix", '\0', 0, G_OPTION_ARG_STRING, &suffix,
+		  /* TRANSLATORS: the end of the package filenames, e.g. .rpm */
+		  _("Suffix of the packages in the tree, default .rpm"), NULL},
+		{ "repo", 'n', 0, G_OPTION_ARG_STRING, &repo,
+		  /* TRANSLATORS: the repo of the software root, e.g. fedora */
+		  _("Name of the remote repo"), NULL},
+		{ "icondir", 'i', 0, G_OPTION_ARG_STRING, &icondir,
+		  /* TRANSLATORS: the icon directory */
+		  _("Icon directory"), NULL},
+		{ "icon-archive", '\0', 0, G_OPTION_ARG_STRING, &icon_archive_file,
+		  /* TRANSLATORS: the icons are written straight into this, e.g. fedora-icons.tar.xz */
+		  _("Compressed tar archive to write the icons to"), NULL},
+		{ "whitelist", 'w', 0, G_OPTION_ARG_STRING, &whitelist,
+		  /* TRANSLATORS: the list of icon names supplied by the theme */
+		  _("Icon whitelist file to use instead of the built-in list"), NULL},
+		{ "config", 'c', 0, G_OPTION_ARG_STRING, &config_file,
+		  /* TRANSLATORS: the config file with the icon sizes */
+		  _("Config file to use (if not specified, default is used)"), NULL},
+		{ "compression", '\0', 0, G_OPTION_ARG_INT, &compression,
+		  /* TRANSLATORS: the zlib level used for scaled icons */
+		  _("PNG compression level from 0 to 9"), NULL},
+		{ "png-filter", '\0', 0, G_OPTION_ARG_STRING, &png_filter,
+		  /* TRANSLATORS: the PNG row filter, not translatable */
+		  _("PNG filter: none, sub, up, avg, paeth or all"), NULL},
+		{ "optimize", '\0', 0, G_OPTION_ARG_NONE, &optimize,
+		  /* TRANSLATORS: try all the lossless encodings */
+		  _("Find the smallest lossless encoding of each scaled icon"), NULL},
+		{ "cache-dir", '\0', 0, G_OPTION_ARG_STRING, &cache_dir,
+		  /* TRANSLATORS: where the scaled icons are kept between runs */
+		  _("Directory to cache scaled icons in"), NULL},
+		{ "compose-cache", '\0', 0, G_OPTION_ARG_STRING, &compose_cache,
+		  /* TRANSLATORS: the results of earlier runs, keyed by package */
+		  _("File to cache the results of each package in"), NULL},
+		{ "no-cache", '\0', 0, G_OPTION_ARG_NONE, &no_cache,
+		  /* TRANSLATORS: do not look up or store scaled icons */
+		  _("Do not use the scaled icon or compose caches"), NULL},
+		{ "block-size", '\0', 0, G_OPTION_ARG_INT, &block_size,
+		  /* TRANSLATORS: only used when the package cannot be mapped */
+		  _("Read size in bytes for packages that cannot be mapped"), NULL},
+		{ "threads", '\0', 0, G_OPTION_ARG_INT, &threads,
+		  /* TRANSLATORS: the number of packages processed at once */
+		  _("Number of packages to process at the same time"), NULL},
+		{ NULL}
+	};
+
+	memset (&ctx, 0, sizeof (AiComposeContext));
+
+	setlocale (LC_ALL, "");
+	bindtextdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	context = g_option_context_new (NULL);
+	/* TRANSLATORS: tool that generates the metadata for a whole repo */
+	g_option_context_set_summary (context, _("Application Database Composer"));
+	g_option_context_add_main_entries (context, options, NULL);
+	ret = g_option_context_parse (context, &argc, &argv, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to parse command line"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+	g_option_context_free (context);
+
+	if (! g_thread_supported ())
+		g_thread_init (NULL);
+	g_type_init ();
+	egg_debug_init (verbose);
+
+	/* things we require */
+	if (database == NULL) {
+		g_print ("A database is required\n");
+		retval = 1;
+		goto out;
+	}
+	if (tree == NULL) {
+		g_print ("A package tree is required\n");
+		retval = 1;
+		goto out;
+	}
+	if (repo == NULL) {
+		g_print ("A repo name is required\n");
+		retval = 1;
+		goto out;
+	}
+	if (icondir == NULL && icon_archive_file == NULL) {
+		g_print ("A icon directory or icon archive is required\n");
+		retval = 1;
+		goto out;
+	}
+	if (compression < -1 || compression > 9) {
+		g_print ("The compression level must be between 0 and 9\n");
+		retval = 1;
+		goto out;
+	}
+	filter = ai_icon_encoder_filter_from_string (png_filter);
+	if (filter == AI_ICON_ENCODER_FILTER_UNKNOWN) {
+		g_print ("The PNG filter '%s' is not known\n", png_filter);
+		retval = 1;
+		goto out;
+	}
+	if (block_size < 0) {
+		g_print ("The block size must be positive\n");
+		retval = 1;
+		goto out;
+	}
+	if (block_size > 0)
+		ai_utils_set_block_size (block_size);
+	if (threads <= 0) {
+		processors = sysconf (_SC_NPROCESSORS_ONLN);
+		threads = (processors > 0) ? processors : 1;
+	}
+
+	/* find the packages before we write anything */
+	if (!g_file_test (tree, G_FILE_TEST_IS_DIR)) {
+		g_print ("The package tree '%s' could not be found\n", tree);
+		retval = 1;
+		goto out;
+	}
+	if (suffix == NULL)
+		suffix = g_strdup (".rpm");
+	filenames = g_ptr_array_new_with_free_func (g_free);
+	ai_compose_find_packages (tree, suffix, filenames, &skipped);
+	if (filenames->len == 0) {
+		g_print ("No %s packages found in %s, %i other files were skipped\n", suffix, tree, skipped);
+		retval = 1;
+		goto out;
+	}
+	if (skipped > 0)
+		egg_debug ("skipped %i files not ending in %s", skipped, suffix);
+
+	/* the output does not depend on the order the directory is read in */
+	g_ptr_array_sort (filenames, ai_compose_sort_filenames_cb);
+
+	/* load the whitelist override once */
+	if (whitelist != NULL) {
+		ret = ai_whitelist_load_override (whitelist, &error);
+		if (!ret) {
+			g_print ("Failed to load whitelist: %s\n", error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* find out which icon sizes we ship */
+	ctx.config = ai_config_new ();
+	ret = ai_config_load (ctx.config, config_file, &error);
+	if (!ret) {
+		g_print ("Failed to load config: %s\n", error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+
+	/* open the database, creating it if required */
+	exists = g_file_test (database, G_FILE_TEST_EXISTS);
+	db = ai_database_new ();
+	ai_database_set_filename (db, database, NULL);
+	ai_database_set_config (db, ctx.config);
+	ret = ai_database_open (db, FALSE, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to open"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+	if (!exists) {
+		ret = ai_database_create (db, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to create"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* generate the sub directories in the icondir if they dont exist */
+	if (icondir != NULL) {
+		ret = ai_generator_create_icon_directories (ctx.config, icondir);
+		if (!ret) {
+			g_print ("Failed to create the icon directory %s\n", icondir);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* stream the icons into the archive rather than a tree on disk */
+	if (icon_archive_file != NULL) {
+		icon_archive = ai_icon_archive_new ();
+		ai_icon_archive_set_threads (icon_archive, threads);
+		ret = ai_icon_archive_open (icon_archive, icon_archive_file, &error);
+		if (!ret) {
+			g_print ("Failed to create the icon archive: %s\n", error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* the workers encode synchronously, the pool is the parallelism */
+	ctx.encoder = ai_icon_encoder_new ();
+	ai_icon_encoder_set_compression (ctx.encoder, compression);
+	ai_icon_encoder_set_filter (ctx.encoder, filter);
+	ai_icon_encoder_set_optimize (ctx.encoder, optimize);
+	ctx.settings = ai_icon_encoder_get_settings_id (ctx.encoder);
+
+	/* set up the scaled icon cache */
+	if (!no_cache) {
+		if (cache_dir == NULL)
+			cache_dir = g_build_filename (g_get_user_cache_dir (), "app-install", "icons", NULL);
+		ctx.cache = ai_icon_cache_new ();
+		ret = ai_icon_cache_set_directory (ctx.cache, cache_dir, &error);
+		if (!ret) {
+			g_print ("Failed to set up the icon cache: %s\n", error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* reuse the results for packages that have not changed */
+	if (!no_cache) {
+		if (compose_cache == NULL)
+			compose_cache = g_build_filename (g_get_user_cache_dir (), "app-install", "compose.db", NULL);
+		ret = ai_compose_create_parent (compose_cache, &error);
+		if (ret) {
+			cache_settings = ai_compose_get_cache_settings (ctx.config, ctx.settings, whitelist);
+			ctx.compose_cache = ai_compose_cache_new ();
+			ret = ai_compose_cache_open (ctx.compose_cache, compose_cache, cache_settings, &error);
+			g_free (cache_settings);
+		}
+		if (!ret) {
+			g_print ("Failed to open the compose cache: %s\n", error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* queue every package */
+	ctx.queue = g_async_queue_new ();
+	pool = g_thread_pool_new (ai_compose_process_package_cb, &ctx, threads, TRUE, &error);
+	if (pool == NULL) {
+		g_print ("Failed to create thread pool: %s\n", error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+	egg_debug ("processing %i packages with %i threads", filenames->len, threads);
+	for (i=0; i<filenames->len; i++) {
+		package = ai_generator_get_package_name (g_ptr_array_index (filenames, i));
+		if (package == NULL)
+			package = g_path_get_basename (g_ptr_array_index (filenames, i));
+		pkg = ai_compose_package_new (i, g_ptr_array_index (filenames, i), package);
+		if (ctx.compose_cache != NULL &&
+		    g_stat (pkg->filename, &stat_buf) == 0) {
+			pkg->size = stat_buf.st_size;
+			pkg->mtime = stat_buf.st_mtime;
+			pkg->checksum = ai_compose_cache_lookup_stat (ctx.compose_cache, pkg->filename, pkg->size, pkg->mtime);
+		}
+		g_thread_pool_push (pool, pkg, NULL);
+		g_free (package);
+	}
+
+	/* this thread is the only writer of the database and icons, and results
+	 * that arrive early are held back so the output is always in tree order */
+	pending = g_ptr_array_new ();
+	g_ptr_array_set_size (pending, filenames->len);
+	for (i=0; i<filenames->len; i++) {
+		while (g_ptr_array_index (pending, i) == NULL) {
+			pkg = g_async_queue_pop (ctx.queue);
+			g_ptr_array_index (pending, pkg->position) = pkg;
+		}
+		pkg = g_ptr_array_index (pending, i);
+		g_ptr_array_index (pending, i) = NULL;
+		if (pkg->error == NULL) {
+			ret = ai_compose_write_package (db, icondir, icon_archive, repo, pkg, &error);
+			if (!ret) {
+				pkg->error = g_strdup (error->message);
+				g_clear_error (&error);
+			}
+		}
+
+		/* a failed store only costs us the next run */
+		if (pkg->error == NULL && !pkg->cached && ctx.compose_cache != NULL) {
+			ret = ai_compose_cache_store (ctx.compose_cache, pkg->checksum, pkg->filename,
+						      pkg->size, pkg->mtime, pkg->apps, &error);
+			if (!ret) {
+				egg_warning ("cannot cache %s: %s", pkg->filename, error->message);
+				g_clear_error (&error);
+			}
+		}
+		if (pkg->error != NULL) {
+			g_print ("[%i/%i] Failed to process %s: %s\n", i + 1, filenames->len, pkg->filename, pkg->error);
+			failed++;
+		} else {
+			egg_debug ("[%i/%i] %s: %i applications", i + 1, filenames->len, pkg->package, pkg->apps->len);
+			applications += pkg->apps->len;
+		}
+		ai_compose_package_free (pkg);
+	}
+	g_print ("Added %i applications from %i packages, %i failed\n", applications, filenames->len, failed);
+	if (icon_archive != NULL) {
+		ret = ai_icon_archive_close (icon_archive, &error);
+		if (!ret) {
+			g_print ("Failed to write the icon archive: %s\n", error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+		g_print ("Wrote %i icons to %s\n", ai_icon_archive_get_count (icon_archive), icon_archive_file);
+	}
+	if (ctx.compose_cache != NULL) {
+		g_print ("%i packages were unchanged since the last run\n", ai_compose_cache_get_hits (ctx.compose_cache));
+
+		/* a failed prune only costs us space */
+		ret = ai_compose_cache_prune (ctx.compose_cache, tree, filenames, &error);
+		if (!ret) {
+			egg_warning ("cannot prune the compose cache: %s", error->message);
+			g_clear_error (&error);
+		}
+	}
+	if (failed > 0)
+		retval = 1;
+out:
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+	if (ctx.queue != NULL)
+		g_async_queue_unref (ctx.queue);
+	if (pending != NULL)
+		g_ptr_array_unref (pending);
+	if (icon_archive != NULL)
+		g_object_unref (icon_archive);
+	if (db != NULL) {
+		error = NULL;
+		ret = ai_database_close (db, FALSE, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to close"), error->message);
+			g_error_free (error);
+			retval = 1;
+		}
+		g_object_unref (db);
+	}
+	if (ctx.encoder != NULL)
+		g_object_unref (ctx.encoder);
+	if (ctx.cache != NULL)
+		g_object_unref (ctx.cache);
+	if (ctx.compose_cache != NULL)
+		g_object_unref (ctx.compose_cache);
+	if (ctx.config != NULL)
+		g_object_unref (ctx.config);
+	if (filenames != NULL)
+		g_ptr_array_unref (filenames);
+	g_free (ctx.settings);
+	g_free (database);
+	g_free (tree);
+	g_free (suffix);
+	g_free (repo);
+	g_free (icondir);
+	g_free (icon_archive_file);
+	g_free (config_file);
+	g_free (cache_dir);
+	g_free (compose_cache);
+	g_free (whitelist);
+	g_free (png_filter);
+	return retval;
+}
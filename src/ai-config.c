@@ -0,0 +1,334 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-config.h"
+#include "ai-common.h"
+
+static void     ai_config_finalize	(GObject     *object);
+
+#define AI_CONFIG_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_CONFIG, AiConfigPrivate))
+
+/* the same as the shipped app-install.conf */
+#define AI_CONFIG_DEFAULT_COPY_ICON_SIZES	"24,48,scalable"
+#define AI_CONFIG_DEFAULT_ENSURE_ICON_SIZES	"48"
+
+/*
+ * AiConfigPrivate:
+ *
+ * Private #AiConfig data
+ */
+struct _AiConfigPrivate
+{
+	GArray				*copy_icon_sizes;
+	GArray				*ensure_icon_sizes;
+	gchar				**icon_dirs;
+};
+
+G_DEFINE_TYPE (AiConfig, ai_config, G_TYPE_OBJECT)
+
+/*
+ * ai_config_icon_size_to_dir:
+ *
+ * Return value: the directory name for the size, e.g. "48x48"
+ */
+gchar *
+ai_config_icon_size_to_dir (guint size)
+{
+	if (size == AI_CONFIG_ICON_SIZE_SCALABLE)
+		return g_strdup ("scalable");
+	return g_strdup_printf ("%ix%i", size, size);
+}
+
+/*
+ * ai_config_array_contains:
+ */
+static gboolean
+ai_config_array_contains (GArray *array, guint size)
+{
+	guint i;
+	for (i=0; i<array->len; i++) {
+		if (g_array_index (array, guint, i) == size)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * ai_config_parse_icon_sizes:
+ *
+ * Parses a list like "24,48x48,scalable". A blank list is valid.
+ */
+static gboolean
+ai_config_parse_icon_sizes (const gchar *value, gboolean allow_scalable, GArray *array, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar **split;
+	gchar *token;
+	gchar *endptr;
+	guint64 value64;
+	guint size;
+	guint i;
+
+	g_array_set_size (array, 0);
+	split = g_strsplit (value, ",", -1);
+	for (i=0; split[i] != NULL; i++) {
+		token = g_strstrip (split[i]);
+		if (token[0] == '\0')
+			continue;
+
+		if (g_strcmp0 (token, "scalable") == 0) {
+			if (!allow_scalable) {
+				g_set_error (error, 1, 0, "scalable icons cannot be generated");
+				ret = FALSE;
+				goto out;
+			}
+			size = AI_CONFIG_ICON_SIZE_SCALABLE;
+		} else {
+			/* "48" or "48x48" */
+			value64 = g_ascii_strtoull (token, &endptr, 10);
+			if (endptr[0] == 'x' && g_ascii_strtoull (endptr + 1, &endptr, 10) != value64)
+				value64 = 0;
+			if (endptr[0] != '\0' || value64 == 0 || value64 > 1024) {
+				g_set_error (error, 1, 0, "invalid icon size '%s'", token);
+				ret = FALSE;
+				goto out;
+			}
+			size = value64;
+		}
+		if (!ai_config_array_contains (array, size))
+			g_array_append_val (array, size);
+	}
+out:
+	g_strfreev (split);
+	return ret;
+}
+
+/*
+ * ai_config_update_icon_dirs:
+ */
+static void
+ai_config_update_icon_dirs (AiConfig *config)
+{
+	GPtrArray *dirs;
+	GArray *sizes;
+	guint i;
+	AiConfigPrivate *priv = config->priv;
+
+	/* every size we copy, and any extra sizes we generate */
+	sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+	g_array_append_vals (sizes, priv->copy_icon_sizes->data, priv->copy_icon_sizes->len);
+	for (i=0; i<priv->ensure_icon_sizes->len; i++) {
+		if (!ai_config_array_contains (sizes, g_array_index (priv->ensure_icon_sizes, guint, i)))
+			g_array_append_val (sizes, g_array_index (priv->ensure_icon_sizes, guint, i));
+	}
+
+	dirs = g_ptr_array_new ();
+	for (i=0; i<sizes->len; i++)
+		g_ptr_array_add (dirs, ai_config_icon_size_to_dir (g_array_index (sizes, guint, i)));
+	g_ptr_array_add (dirs, NULL);
+
+	g_strfreev (priv->icon_dirs);
+	priv->icon_dirs = (gchar **) g_ptr_array_free (dirs, FALSE);
+	g_array_free (sizes, TRUE);
+}
+
+/*
+ * ai_config_load:
+ * @filename: the config file, or %NULL for the system default
+ *
+ * Loads the [Generator] settings. A missing system config file is not an
+ * error, and the built-in defaults are used instead.
+ */
+gboolean
+ai_config_load (AiConfig *config, const gchar *filename, GError **error)
+{
+	gboolean ret = TRUE;
+	GKeyFile *keyfile;
+	gchar *value = NULL;
+	GArray *copy_icon_sizes = NULL;
+	GArray *ensure_icon_sizes = NULL;
+	GError *error_local = NULL;
+	AiConfigPrivate *priv = config->priv;
+
+	g_return_val_if_fail (AI_IS_CONFIG (config), FALSE);
+
+	keyfile = g_key_file_new ();
+
+	/* use default */
+	if (filename == NULL) {
+		filename = AI_DEFAULT_CONFIG;
+		if (!g_file_test (filename, G_FILE_TEST_EXISTS)) {
+			egg_debug ("%s does not exist, using defaults", filename);
+			goto out;
+		}
+	}
+
+	ret = g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "cannot load %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	/* a missing key keeps the default, a blank one means none */
+	value = g_key_file_get_string (keyfile, "Generator", "CopyIconSizes", NULL);
+	if (value != NULL) {
+		copy_icon_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+		ret = ai_config_parse_icon_sizes (value, TRUE, copy_icon_sizes, &error_local);
+		if (!ret) {
+			g_set_error (error, 1, 0, "cannot parse CopyIconSizes in %s: %s", filename, error_local->message);
+			g_error_free (error_local);
+			goto out;
+		}
+		g_free (value);
+	}
+	value = g_key_file_get_string (keyfile, "Generator", "EnsureIconSizes", NULL);
+	if (value != NULL) {
+		ensure_icon_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+		ret = ai_config_parse_icon_sizes (value, FALSE, ensure_icon_sizes, &error_local);
+		if (!ret) {
+			g_set_error (error, 1, 0, "cannot parse EnsureIconSizes in %s: %s", filename, error_local->message);
+			g_error_free (error_local);
+			goto out;
+		}
+	}
+
+	/* only replace the sizes when the whole file parsed */
+	if (copy_icon_sizes != NULL) {
+		g_array_set_size (priv->copy_icon_sizes, 0);
+		g_array_append_vals (priv->copy_icon_sizes, copy_icon_sizes->data, copy_icon_sizes->len);
+	}
+	if (ensure_icon_sizes != NULL) {
+		g_array_set_size (priv->ensure_icon_sizes, 0);
+		g_array_append_vals (priv->ensure_icon_sizes, ensure_icon_sizes->data, ensure_icon_sizes->len);
+	}
+out:
+	ai_config_update_icon_dirs (config);
+	if (copy_icon_sizes != NULL)
+		g_array_free (copy_icon_sizes, TRUE);
+	if (ensure_icon_sizes != NULL)
+		g_array_free (ensure_icon_sizes, TRUE);
+	g_free (value);
+	g_key_file_free (keyfile);
+	return ret;
+}
+
+/**
+ * ai_config_get_copy_icon_sizes:
+ *
+ * Return value: (element-type guint) (transfer none): the icon sizes copied
+ * from the package, where %AI_CONFIG_ICON_SIZE_SCALABLE is the scalable
+ * icon. Do not free.
+ */
+GArray *
+ai_config_get_copy_icon_sizes (AiConfig *config)
+{
+	g_return_val_if_fail (AI_IS_CONFIG (config), NULL);
+	return config->priv->copy_icon_sizes;
+}
+
+/**
+ * ai_config_get_ensure_icon_sizes:
+ *
+ * Return value: (element-type guint) (transfer none): the icon sizes that
+ * are scaled if not copied. Do not free.
+ */
+GArray *
+ai_config_get_ensure_icon_sizes (AiConfig *config)
+{
+	g_return_val_if_fail (AI_IS_CONFIG (config), NULL);
+	return config->priv->ensure_icon_sizes;
+}
+
+/**
+ * ai_config_get_icon_dirs:
+ *
+ * Return value: (array zero-terminated=1) (transfer none): all the icon
+ * directories that can be populated, e.g. "48x48" and "scalable". Do not free.
+ */
+gchar **
+ai_config_get_icon_dirs (AiConfig *config)
+{
+	g_return_val_if_fail (AI_IS_CONFIG (config), NULL);
+	return config->priv->icon_dirs;
+}
+
+/*
+ * ai_config_class_init:
+ */
+static void
+ai_config_class_init (AiConfigClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_config_finalize;
+	g_type_class_add_private (klass, sizeof (AiConfigPrivate));
+}
+
+/*
+ * ai_config_init:
+ */
+static void
+ai_config_init (AiConfig *config)
+{
+	config->priv = AI_CONFIG_GET_PRIVATE (config);
+	config->priv->copy_icon_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+	config->priv->ensure_icon_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+	ai_config_parse_icon_sizes (AI_CONFIG_DEFAULT_COPY_ICON_SIZES, TRUE, config->priv->copy_icon_sizes, NULL);
+	ai_config_parse_icon_sizes (AI_CONFIG_DEFAULT_ENSURE_ICON_SIZES, FALSE, config->priv->ensure_icon_sizes, NULL);
+	ai_config_update_icon_dirs (config);
+}
+
+/*
+ * ai_config_finalize:
+ */
+static void
+ai_config_finalize (GObject *object)
+{
+	AiConfig *config = AI_CONFIG (object);
+	AiConfigPrivate *priv = config->priv;
+
+	g_array_free (priv->copy_icon_sizes, TRUE);
+	g_array_free (priv->ensure_icon_sizes, TRUE);
+	g_strfreev (priv->icon_dirs);
+
+	G_OBJECT_CLASS (ai_config_parent_class)->finalize (object);
+}
+
+/*
+ * ai_config_new:
+ *
+ * Return value: a new AiConfig object.
+ */
+AiConfig *
+ai_config_new (void)
+{
+	AiConfig *config;
+	config = g_object_new (AI_TYPE_CONFIG, NULL);
+	return AI_CONFIG (config);
+}
+
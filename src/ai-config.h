@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_CONFIG_H
+#define __AI_CONFIG_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_CONFIG		(ai_config_get_type ())
+#define AI_CONFIG(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_CONFIG, AiConfig))
+#define AI_CONFIG_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_CONFIG, AiConfigClass))
+#define AI_IS_CONFIG(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_CONFIG))
+#define AI_IS_CONFIG_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_CONFIG))
+#define AI_CONFIG_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_CONFIG, AiConfigClass))
+
+/* used in the icon size lists to mean the scalable directory */
+#define AI_CONFIG_ICON_SIZE_SCALABLE	0
+
+typedef struct _AiConfigPrivate		AiConfigPrivate;
+typedef struct _AiConfig		AiConfig;
+typedef struct _AiConfigClass		AiConfigClass;
+
+struct _AiConfig
+{
+	 GObject		 parent;
+	 AiConfigPrivate	*priv;
+};
+
+struct _AiConfigClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_config_get_type		  	(void);
+AiConfig	*ai_config_new				(void);
+gboolean	 ai_config_load				(AiConfig	*config,
+							 const gchar	*filename,
+							 GError		**error);
+GArray		*ai_config_get_copy_icon_sizes		(AiConfig	*config);
+GArray		*ai_config_get_ensure_icon_sizes	(AiConfig	*config);
+gchar		**ai_config_get_icon_dirs		(AiConfig	*config);
+gchar		*ai_config_icon_size_to_dir		(guint		 size);
+
+G_END_DECLS
+
+#endif /* __AI_CONFIG_H */
+
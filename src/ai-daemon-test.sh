@@ -0,0 +1,87 @@
+#!/bin/sh
+# Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+#
+# Runs app-install-daemon on a private session bus and checks the
+# interface with gdbus.
+#
+# Licensed under the GNU General Public License Version 2
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+
+# automake treats this as a skipped test
+for tool in dbus-run-session gdbus sqlite3; do
+	if ! which $tool > /dev/null 2>&1; then
+		echo "$tool not found, skipping"
+		exit 77
+	fi
+done
+
+# never talk to the bus of the user running make check
+if [ -z "$AI_DAEMON_TEST_PRIVATE" ]; then
+	AI_DAEMON_TEST_PRIVATE=1 exec dbus-run-session -- "$0" "$@"
+fi
+
+builddir=`pwd`
+tmpdir=`mktemp -d /tmp/ai-daemon-test.XXXXXX`
+daemon_pid=
+monitor_pid=
+
+cleanup () {
+	test -n "$monitor_pid" && kill $monitor_pid 2> /dev/null
+	test -n "$daemon_pid" && kill $daemon_pid 2> /dev/null
+	rm -rf $tmpdir
+}
+trap cleanup EXIT
+
+fail () {
+	echo "FAIL: $1"
+	exit 1
+}
+
+call () {
+	gdbus call --session --dest org.freedesktop.AppInstall \
+		   --object-path /org/freedesktop/AppInstall \
+		   --method org.freedesktop.AppInstall.$1 "$2" "$3" $4 $5
+}
+
+# a database with one application
+$builddir/app-install-admin --create --database=$tmpdir/test.db > /dev/null || fail "create"
+sqlite3 $tmpdir/test.db "INSERT INTO applications (application_id, package_name, categories, repo_id, \
+	icon_name, application_name, application_summary) VALUES ('gcalctool', 'gcalctool', \
+	'Utility;', 'fedora', 'accessories-calculator', 'Calculator', 'Add up numbers');" || fail "insert"
+
+$builddir/app-install-daemon --database=$tmpdir/test.db --interval=1 &
+daemon_pid=$!
+
+# wait for the name to appear
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	gdbus call --session --dest org.freedesktop.DBus --object-path /org/freedesktop/DBus \
+		   --method org.freedesktop.DBus.NameHasOwner org.freedesktop.AppInstall | grep -q true && break
+	sleep 1
+done
+
+# one page of results and the total
+output=`call SearchByName "'calc'" "''" 0 10` || fail "SearchByName"
+echo "$output" | grep -q "'gcalctool'" || fail "SearchByName returned $output"
+echo "$output" | grep -q "1)$" || fail "SearchByName total in $output"
+
+output=`call GetDetails "['gcalctool', 'missing']" "''"` || fail "GetDetails"
+echo "$output" | grep -q "'Add up numbers'" || fail "GetDetails returned $output"
+
+# a commit from another process is noticed and announced
+gdbus monitor --session --dest org.freedesktop.AppInstall > $tmpdir/monitor.log &
+monitor_pid=$!
+sleep 1
+sqlite3 $tmpdir/test.db "INSERT INTO applications (application_id, package_name, application_name) \
+	VALUES ('gnumeric', 'gnumeric', 'Gnumeric');" || fail "insert"
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	grep -q "org.freedesktop.AppInstall.Changed" $tmpdir/monitor.log && break
+	sleep 1
+done
+grep -q "org.freedesktop.AppInstall.Changed" $tmpdir/monitor.log || fail "no Changed signal"
+output=`call SearchByName "'gnumeric'" "''" 0 10` || fail "SearchByName"
+echo "$output" | grep -q "'gnumeric'" || fail "SearchByName after Changed returned $output"
+
+exit 0
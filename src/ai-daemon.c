@@ -0,0 +1,372 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <locale.h>
+#include <string.h>
+
+#include "ai-catalog.h"
+#include "ai-result.h"
+
+#include "egg-debug.h"
+
+#define AI_DAEMON_DBUS_NAME		"org.freedesktop.AppInstall"
+#define AI_DAEMON_DBUS_PATH		"/org/freedesktop/AppInstall"
+#define AI_DAEMON_DBUS_INTERFACE	"org.freedesktop.AppInstall"
+
+/* searches are cheap to repeat, so the cache is just emptied when full */
+#define AI_DAEMON_CACHE_MAX		256
+
+/* each result is (id, package, categories, repo, icon, name, summary, screenshot, rating, installed) */
+#define AI_DAEMON_RESULT_TYPE		"(ssssssssub)"
+
+static const gchar ai_daemon_introspection[] =
+	"<node>"
+	"  <interface name='" AI_DAEMON_DBUS_INTERFACE "'>"
+	"    <method name='SearchByName'>"
+	"      <arg type='s' name='value' direction='in'/>"
+	"      <arg type='s' name='locale' direction='in'/>"
+	"      <arg type='u' name='offset' direction='in'/>"
+	"      <arg type='u' name='limit' direction='in'/>"
+	"      <arg type='a" AI_DAEMON_RESULT_TYPE "' name='results' direction='out'/>"
+	"      <arg type='u' name='total' direction='out'/>"
+	"    </method>"
+	"    <method name='SearchByCategory'>"
+	"      <arg type='s' name='value' direction='in'/>"
+	"      <arg type='s' name='locale' direction='in'/>"
+	"      <arg type='u' name='offset' direction='in'/>"
+	"      <arg type='u' name='limit' direction='in'/>"
+	"      <arg type='a" AI_DAEMON_RESULT_TYPE "' name='results' direction='out'/>"
+	"      <arg type='u' name='total' direction='out'/>"
+	"    </method>"
+	"    <method name='GetDetails'>"
+	"      <arg type='as' name='ids' direction='in'/>"
+	"      <arg type='s' name='locale' direction='in'/>"
+	"      <arg type='a" AI_DAEMON_RESULT_TYPE "' name='results' direction='out'/>"
+	"    </method>"
+	"    <signal name='Changed'/>"
+	"  </interface>"
+	"</node>";
+
+typedef struct {
+	AiCatalog		*catalog;
+	GHashTable		*cache;
+	GDBusConnection		*connection;
+	GDBusNodeInfo		*introspection;
+	GMainLoop		*loop;
+} AiDaemon;
+
+/*
+ * ai_daemon_string:
+ *
+ * D-Bus strings cannot be NULL.
+ */
+static const gchar *
+ai_daemon_string (const gchar *value)
+{
+	return value != NULL ? value : "";
+}
+
+/*
+ * ai_daemon_locale:
+ *
+ * An empty locale over the bus means untranslated.
+ */
+static const gchar *
+ai_daemon_locale (const gchar *locale)
+{
+	if (locale == NULL || locale[0] == '\0')
+		return NULL;
+	return locale;
+}
+
+/*
+ * ai_daemon_add_result:
+ */
+static void
+ai_daemon_add_result (GVariantBuilder *builder, AiResult *result)
+{
+	g_variant_builder_add (builder, AI_DAEMON_RESULT_TYPE,
+			       ai_daemon_string (ai_result_get_application_id (result)),
+			       ai_daemon_string (ai_result_get_package_name (result)),
+			       ai_daemon_string (ai_result_get_categories (result)),
+			       ai_daemon_string (ai_result_get_repo_id (result)),
+			       ai_daemon_string (ai_result_get_icon_name (result)),
+			       ai_daemon_string (ai_result_get_application_name (result)),
+			       ai_daemon_string (ai_result_get_application_summary (result)),
+			       ai_daemon_string (ai_result_get_screenshot_url (result)),
+			       ai_result_get_rating (result),
+			       ai_result_get_installed (result));
+}
+
+/*
+ * ai_daemon_search:
+ *
+ * Every client shares the cache, so the second client to open the same
+ * category gets it without searching.
+ *
+ * Return value: (transfer none): the results, owned by the cache
+ */
+static GPtrArray *
+ai_daemon_search (AiDaemon *daemon, const gchar *method, const gchar *value, const gchar *locale)
+{
+	gchar *key;
+	GPtrArray *array;
+
+	key = g_strdup_printf ("%s\t%s\t%s", method, value, ai_daemon_string (locale));
+	array = g_hash_table_lookup (daemon->cache, key);
+	if (array != NULL) {
+		g_free (key);
+		goto out;
+	}
+
+	if (g_strcmp0 (method, "SearchByName") == 0)
+		array = ai_catalog_search_by_name (daemon->catalog, value, locale);
+	else
+		array = ai_catalog_search_by_category (daemon->catalog, value, locale);
+	if (g_hash_table_size (daemon->cache) >= AI_DAEMON_CACHE_MAX)
+		g_hash_table_remove_all (daemon->cache);
+	g_hash_table_insert (daemon->cache, key, array);
+out:
+	return array;
+}
+
+/*
+ * ai_daemon_method_call_cb:
+ */
+static void
+ai_daemon_method_call_cb (GDBusConnection *connection, const gchar *sender,
+			  const gchar *object_path, const gchar *interface_name,
+			  const gchar *method_name, GVariant *parameters,
+			  GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	AiDaemon *daemon = (AiDaemon *) user_data;
+	const gchar *value;
+	const gchar *locale;
+	const gchar **ids = NULL;
+	guint offset;
+	guint limit;
+	guint i;
+	GPtrArray *array;
+	GVariantBuilder builder;
+
+	/* one page of results, and how many there are in all */
+	if (g_strcmp0 (method_name, "SearchByName") == 0 ||
+	    g_strcmp0 (method_name, "SearchByCategory") == 0) {
+		g_variant_get (parameters, "(&s&suu)", &value, &locale, &offset, &limit);
+		array = ai_daemon_search (daemon, method_name, value, ai_daemon_locale (locale));
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" AI_DAEMON_RESULT_TYPE));
+		for (i=offset; i<array->len && i-offset<limit; i++)
+			ai_daemon_add_result (&builder, g_ptr_array_index (array, i));
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(a" AI_DAEMON_RESULT_TYPE "u)",
+								      &builder, array->len));
+		return;
+	}
+
+	/* any number of applications in one round trip */
+	if (g_strcmp0 (method_name, "GetDetails") == 0) {
+		g_variant_get (parameters, "(^a&s&s)", &ids, &locale);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" AI_DAEMON_RESULT_TYPE));
+		for (i=0; ids[i] != NULL; i++) {
+			array = ai_catalog_search_by_id (daemon->catalog, ids[i], ai_daemon_locale (locale));
+			if (array->len > 0)
+				ai_daemon_add_result (&builder, g_ptr_array_index (array, 0));
+			g_ptr_array_unref (array);
+		}
+		g_free (ids);
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(a" AI_DAEMON_RESULT_TYPE ")", &builder));
+		return;
+	}
+
+	g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+					       "no method %s", method_name);
+}
+
+static const GDBusInterfaceVTable ai_daemon_vtable = {
+	ai_daemon_method_call_cb,
+	NULL,
+	NULL
+};
+
+/*
+ * ai_daemon_catalog_changed_cb:
+ *
+ * app-install-add or app-install-remove changed the database.
+ */
+static void
+ai_daemon_catalog_changed_cb (AiCatalog *catalog, AiDaemon *daemon)
+{
+	GError *error = NULL;
+
+	egg_debug ("database changed, %i applications", ai_catalog_get_size (catalog));
+	g_hash_table_remove_all (daemon->cache);
+	if (daemon->connection == NULL)
+		return;
+	if (!g_dbus_connection_emit_signal (daemon->connection, NULL, AI_DAEMON_DBUS_PATH,
+					    AI_DAEMON_DBUS_INTERFACE, "Changed", NULL, &error)) {
+		egg_warning ("failed to emit Changed: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+/*
+ * ai_daemon_bus_acquired_cb:
+ */
+static void
+ai_daemon_bus_acquired_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	AiDaemon *daemon = (AiDaemon *) user_data;
+	guint id;
+	GError *error = NULL;
+
+	id = g_dbus_connection_register_object (connection, AI_DAEMON_DBUS_PATH,
+						daemon->introspection->interfaces[0],
+						&ai_daemon_vtable, daemon, NULL, &error);
+	if (id == 0) {
+		egg_warning ("failed to register object: %s", error->message);
+		g_error_free (error);
+		g_main_loop_quit (daemon->loop);
+		return;
+	}
+	daemon->connection = g_object_ref (connection);
+}
+
+/*
+ * ai_daemon_name_lost_cb:
+ *
+ * Another daemon already has the name, or we could not connect.
+ */
+static void
+ai_daemon_name_lost_cb (GDBusConnection *connection, const gchar *name, gpointer user_data)
+{
+	AiDaemon *daemon = (AiDaemon *) user_data;
+	egg_warning ("lost the name %s, exiting", name);
+	g_main_loop_quit (daemon->loop);
+}
+
+/**
+ * main:
+ **/
+int
+main (int argc, char *argv[])
+{
+	gboolean verbose = FALSE;
+	gboolean system_bus = FALSE;
+	gint interval = 2;
+	GOptionContext *context;
+	gint retval = 0;
+	gchar *database = NULL;
+	guint owner_id = 0;
+	gboolean ret;
+	GError *error = NULL;
+	AiDaemon daemon;
+
+	const GOptionEntry options[] = {
+		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+		  _("Show extra debugging information"), NULL },
+		{ "database", 'd', 0, G_OPTION_ARG_STRING, &database,
+		  /* TRANSLATORS: if we are specifing a out-of-tree database */
+		  _("Database file to use (if not specififed, default is used)"), NULL},
+		{ "system", '\0', 0, G_OPTION_ARG_NONE, &system_bus,
+		  /* TRANSLATORS: the default is the session bus */
+		  _("Use the system bus"), NULL},
+		{ "interval", '\0', 0, G_OPTION_ARG_INT, &interval,
+		  /* TRANSLATORS: how often we look for changes made by app-install-add and app-install-remove */
+		  _("Seconds between checking the database for changes"), NULL},
+		{ NULL}
+	};
+
+	setlocale (LC_ALL, "");
+	bindtextdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR);
+	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+	textdomain (GETTEXT_PACKAGE);
+
+	memset (&daemon, 0, sizeof (AiDaemon));
+
+	context = g_option_context_new (NULL);
+	/* TRANSLATORS: the service shared by all the software front ends */
+	g_option_context_set_summary (context, _("Application Database Query Service"));
+	g_option_context_add_main_entries (context, options, NULL);
+	ret = g_option_context_parse (context, &argc, &argv, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to parse command line"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+	g_option_context_free (context);
+
+	if (! g_thread_supported ())
+		g_thread_init (NULL);
+	g_type_init ();
+	egg_debug_init (verbose);
+
+	/* every client shares this copy */
+	daemon.catalog = ai_catalog_new ();
+	ai_catalog_set_filename (daemon.catalog, database, NULL);
+	ret = ai_catalog_load (daemon.catalog, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to open"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+	daemon.cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	g_signal_connect (daemon.catalog, "changed", G_CALLBACK (ai_daemon_catalog_changed_cb), &daemon);
+	if (interval > 0)
+		ai_catalog_watch (daemon.catalog, interval);
+
+	daemon.introspection = g_dbus_node_info_new_for_xml (ai_daemon_introspection, &error);
+	if (daemon.introspection == NULL) {
+		g_print ("%s: %s\n", _("Failed to parse interface"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+
+	daemon.loop = g_main_loop_new (NULL, FALSE);
+	owner_id = g_bus_own_name (system_bus ? G_BUS_TYPE_SYSTEM : G_BUS_TYPE_SESSION,
+				   AI_DAEMON_DBUS_NAME, G_BUS_NAME_OWNER_FLAGS_NONE,
+				   ai_daemon_bus_acquired_cb, NULL, ai_daemon_name_lost_cb,
+				   &daemon, NULL);
+	g_main_loop_run (daemon.loop);
+out:
+	if (owner_id != 0)
+		g_bus_unown_name (owner_id);
+	if (daemon.loop != NULL)
+		g_main_loop_unref (daemon.loop);
+	if (daemon.introspection != NULL)
+		g_dbus_node_info_unref (daemon.introspection);
+	if (daemon.connection != NULL)
+		g_object_unref (daemon.connection);
+	if (daemon.cache != NULL)
+		g_hash_table_unref (daemon.cache);
+	if (daemon.catalog != NULL)
+		g_object_unref (daemon.catalog);
+	g_free (database);
+	return retval;
+}
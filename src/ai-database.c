@@ -21,16 +21,122 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <gio/gio.h>
 #include <stdlib.h>
+#include <archive.h>
+#include <archive_entry.h>
 
 #include "egg-debug.h"
 
 #include "ai-database.h"
 #include "ai-result.h"
 #include "ai-common.h"
+#include "ai-config.h"
+#include "ai-completion.h"
+#include "ai-icon-archive.h"
+#include "ai-icon-atlas.h"
+#include "ai-icon-pack.h"
+#include "ai-trigram.h"
+#include "ai-utils-private.h"
+
+/* the newest schema, see ai_database_upgrade() */
+#define AI_DATABASE_VERSION		6
+
+/* the icon archives are indexed, not extracted, when imported lazily */
+#define AI_DATABASE_ICON_TABLES								\
+	"CREATE TABLE icon_archives ("							\
+	"archive_id INTEGER PRIMARY KEY,"						\
+	"repo_id TEXT,"									\
+	"filename TEXT);"								\
+	"CREATE TABLE icon_members ("							\
+	"archive_id INTEGER,"								\
+	"path TEXT,"									\
+	"offset INTEGER,"								\
+	"length INTEGER,"								\
+	"PRIMARY KEY (archive_id, path));"
+
+/* where each icon is drawn in the sheets written by ai_database_update_icon_atlases() */
+#define AI_DATABASE_ATLAS_TABLES							\
+	"CREATE TABLE icon_atlas ("							\
+	"icon_name TEXT,"								\
+	"size INTEGER,"									\
+	"sheet TEXT,"									\
+	"x INTEGER,"									\
+	"y INTEGER,"									\
+	"PRIMARY KEY (icon_name, size));"
+
+/* finds the translations of an application without scanning the table */
+#define AI_DATABASE_TRANSLATION_INDEX							\
+	"CREATE INDEX IF NOT EXISTS translations_id_locale "				\
+	"ON translations (application_id, locale);"
+
+/* picks the best translation using the ranks in the temporary
+ * locale_chain table, see ai_database_set_locale_chain() */
+#define AI_DATABASE_TRANSLATION_JOIN							\
+	"LEFT JOIN translations t ON t.rowid = ("					\
+	"SELECT tc.rowid FROM translations tc "						\
+	"JOIN locale_chain lc ON tc.locale = lc.locale "				\
+	"WHERE tc.application_id = a.application_id "					\
+	"ORDER BY lc.rank LIMIT 1) "
+
+/* any change to the source tables marks the rows of that application
+ * as stale, see ai_database_refresh_display() */
+#define AI_DATABASE_DISPLAY_TRIGGER(id)						\
+	"BEGIN INSERT OR IGNORE INTO display_stale (application_id) VALUES (" id "); END;"
+
+/* the localized names and summaries with the fallbacks already applied,
+ * see ai_database_update_display() */
+#define AI_DATABASE_DISPLAY_TABLES							\
+	"CREATE TABLE display ("							\
+	"application_id TEXT,"								\
+	"locale TEXT,"									\
+	"application_name TEXT,"							\
+	"application_summary TEXT,"							\
+	"sort_key TEXT,"								\
+	"PRIMARY KEY (locale, application_id));"					\
+	"CREATE INDEX display_sort_key ON display (locale, sort_key);"			\
+	"CREATE INDEX display_application_id ON display (application_id);"		\
+	"CREATE TABLE display_locales (locale TEXT PRIMARY KEY);"			\
+	"CREATE TABLE display_stale (application_id TEXT PRIMARY KEY);"		\
+	"CREATE TRIGGER display_applications_insert AFTER INSERT ON applications "	\
+	AI_DATABASE_DISPLAY_TRIGGER ("NEW.application_id")				\
+	"CREATE TRIGGER display_applications_delete AFTER DELETE ON applications "	\
+	AI_DATABASE_DISPLAY_TRIGGER ("OLD.application_id")				\
+	"CREATE TRIGGER display_applications_update AFTER UPDATE OF application_id, "	\
+	"application_name, application_summary ON applications "			\
+	"BEGIN INSERT OR IGNORE INTO display_stale (application_id) "			\
+	"VALUES (OLD.application_id), (NEW.application_id); END;"			\
+	"CREATE TRIGGER display_translations_insert AFTER INSERT ON translations "	\
+	AI_DATABASE_DISPLAY_TRIGGER ("NEW.application_id")				\
+	"CREATE TRIGGER display_translations_delete AFTER DELETE ON translations "	\
+	AI_DATABASE_DISPLAY_TRIGGER ("OLD.application_id")				\
+	"CREATE TRIGGER display_translations_update AFTER UPDATE ON translations "	\
+	"BEGIN INSERT OR IGNORE INTO display_stale (application_id) "			\
+	"VALUES (OLD.application_id), (NEW.application_id); END;"			\
+	"INSERT OR REPLACE INTO config (data, value) VALUES ('display', 0);"
+
+/* the name used to sort, which is the same with and without the table */
+#define AI_DATABASE_DISPLAY_SORT_KEY							\
+	"ai_casefold(COALESCE(t.application_name, a.application_name))"
+
+/* the best locale in the display table for the locale_chain, or "C" */
+#define AI_DATABASE_DISPLAY_LOCALE							\
+	"COALESCE((SELECT lc.locale FROM locale_chain lc "				\
+	"WHERE EXISTS (SELECT 1 FROM display x WHERE x.locale = lc.locale) "		\
+	"ORDER BY lc.rank LIMIT 1), '') "
+
+typedef enum {
+	AI_DATABASE_DISPLAY_UNKNOWN,
+	AI_DATABASE_DISPLAY_STALE,
+	AI_DATABASE_DISPLAY_CURRENT
+} AiDatabaseDisplay;
 
 static void     ai_database_finalize	(GObject     *object);
 
@@ -46,10 +152,30 @@ struct _AiDatabasePrivate
 	sqlite3				*db;
 	gchar				*filename;
 	gchar				*icon_path;
+	AiConfig			*config;
 	gboolean			 locked;
 	guint				 dbversion;
+	GHashTable			*completions;
+	GHashTable			*trigrams;
+	GHashTable			*cache;
+	GQueue				*cache_queue;
+	guint				 cache_size;
+	guint				 cache_hits;
+	guint				 cache_misses;
+	sqlite3_stmt			*data_version_stmt;
+	gint				 changes;
+	gint				 data_version;
+	gchar				*chain_locale;
+	gboolean			 chain_valid;
+	AiDatabaseDisplay		 display;
 };
 
+/* one cached search, the hash points at its link in the queue */
+typedef struct {
+	gchar				*key;
+	GPtrArray			*array;
+} AiDatabaseCacheItem;
+
 enum {
 	PROP_0,
 	PROP_LOCKED,
@@ -58,6 +184,251 @@ enum {
 
 G_DEFINE_TYPE (AiDatabase, ai_database, G_TYPE_OBJECT)
 
+/*
+ * ai_database_get_data_version:
+ *
+ * The data version changes whenever another connection commits. The
+ * statement is kept prepared as this is done for every cached search.
+ */
+static gint
+ai_database_get_data_version (AiDatabase *database)
+{
+	gint version = -1;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (priv->data_version_stmt == NULL &&
+	    sqlite3_prepare_v2 (priv->db, "PRAGMA data_version", -1, &priv->data_version_stmt, NULL) != SQLITE_OK)
+		goto out;
+	if (sqlite3_step (priv->data_version_stmt) == SQLITE_ROW)
+		version = sqlite3_column_int (priv->data_version_stmt, 0);
+	sqlite3_reset (priv->data_version_stmt);
+out:
+	return version;
+}
+
+/*
+ * ai_database_cache_item_free:
+ */
+static void
+ai_database_cache_item_free (AiDatabaseCacheItem *item)
+{
+	g_free (item->key);
+	g_ptr_array_unref (item->array);
+	g_free (item);
+}
+
+/*
+ * ai_database_cache_clear:
+ */
+static void
+ai_database_cache_clear (AiDatabase *database)
+{
+	AiDatabaseCacheItem *item;
+	AiDatabasePrivate *priv = database->priv;
+
+	g_hash_table_remove_all (priv->cache);
+	while ((item = g_queue_pop_head (priv->cache_queue)) != NULL)
+		ai_database_cache_item_free (item);
+}
+
+/*
+ * ai_database_check_changes:
+ *
+ * The in-memory indexes and the cached searches are thrown away when
+ * this or any other connection changes the database, which covers
+ * adding, removing and importing. Commits on this connection do not
+ * change the data version, so the total changes are checked too. If
+ * the data version cannot be read then nothing is kept, as commits by
+ * other processes would never be noticed.
+ */
+static void
+ai_database_check_changes (AiDatabase *database)
+{
+	gint changes;
+	gint data_version;
+	AiDatabasePrivate *priv = database->priv;
+
+	changes = sqlite3_total_changes (priv->db);
+	data_version = ai_database_get_data_version (database);
+	if (data_version >= 0 &&
+	    changes == priv->changes &&
+	    data_version == priv->data_version)
+		return;
+	g_hash_table_remove_all (priv->completions);
+	g_hash_table_remove_all (priv->trigrams);
+	ai_database_cache_clear (database);
+	priv->display = AI_DATABASE_DISPLAY_UNKNOWN;
+	priv->changes = changes;
+	priv->data_version = data_version;
+}
+
+/*
+ * ai_database_has_display:
+ *
+ * Return value: %TRUE if the display table matches the source tables
+ */
+static gboolean
+ai_database_has_display (AiDatabase *database)
+{
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = database->priv;
+
+	ai_database_check_changes (database);
+	if (priv->display != AI_DATABASE_DISPLAY_UNKNOWN)
+		goto out;
+	priv->display = AI_DATABASE_DISPLAY_STALE;
+	if (priv->dbversion < 6)
+		goto out;
+
+	/* built at least once, and no application changed since */
+	if (sqlite3_prepare_v2 (priv->db, "SELECT (SELECT value FROM config WHERE data = 'display') = 1 "
+				"AND NOT EXISTS (SELECT 1 FROM display_stale)", -1, &stmt, NULL) != SQLITE_OK)
+		goto out;
+	if (sqlite3_step (stmt) == SQLITE_ROW && sqlite3_column_int (stmt, 0) == 1)
+		priv->display = AI_DATABASE_DISPLAY_CURRENT;
+out:
+	sqlite3_finalize (stmt);
+	return priv->display == AI_DATABASE_DISPLAY_CURRENT;
+}
+
+/*
+ * ai_database_casefold_func:
+ *
+ * ai_casefold() for SQL, as lower() only folds ASCII.
+ */
+static void
+ai_database_casefold_func (sqlite3_context *context, gint argc, sqlite3_value **argv)
+{
+	const gchar *text;
+
+	text = (const gchar *) sqlite3_value_text (argv[0]);
+	if (text == NULL) {
+		sqlite3_result_null (context);
+		return;
+	}
+	sqlite3_result_text (context, g_utf8_casefold (text, -1), -1, g_free);
+}
+
+/*
+ * ai_database_cache_lookup:
+ *
+ * Return value: the cached results with a new reference, or %NULL
+ */
+static GPtrArray *
+ai_database_cache_lookup (AiDatabase *database, const gchar *kind, const gchar *value, const gchar *locale)
+{
+	gchar *key;
+	GList *link;
+	GPtrArray *array = NULL;
+	AiDatabaseCacheItem *item;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (priv->cache_size == 0)
+		return NULL;
+
+	ai_database_check_changes (database);
+	key = g_strdup_printf ("%s\t%s\t%s", kind, value, locale != NULL ? locale : "");
+	link = g_hash_table_lookup (priv->cache, key);
+	if (link == NULL) {
+		priv->cache_misses++;
+		goto out;
+	}
+	priv->cache_hits++;
+
+	/* now the most recently used */
+	g_queue_unlink (priv->cache_queue, link);
+	g_queue_push_head_link (priv->cache_queue, link);
+	item = (AiDatabaseCacheItem *) link->data;
+	array = g_ptr_array_ref (item->array);
+out:
+	g_free (key);
+	return array;
+}
+
+/*
+ * ai_database_cache_insert:
+ */
+static void
+ai_database_cache_insert (AiDatabase *database, const gchar *kind, const gchar *value, const gchar *locale, GPtrArray *array)
+{
+	AiDatabaseCacheItem *item;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (priv->cache_size == 0)
+		return;
+
+	item = g_new0 (AiDatabaseCacheItem, 1);
+	item->key = g_strdup_printf ("%s\t%s\t%s", kind, value, locale != NULL ? locale : "");
+	item->array = g_ptr_array_ref (array);
+	if (g_hash_table_lookup (priv->cache, item->key) != NULL) {
+		ai_database_cache_item_free (item);
+		return;
+	}
+	g_queue_push_head (priv->cache_queue, item);
+	g_hash_table_insert (priv->cache, item->key, priv->cache_queue->head);
+
+	/* drop the least recently used */
+	while (g_queue_get_length (priv->cache_queue) > priv->cache_size) {
+		item = g_queue_pop_tail (priv->cache_queue);
+		g_hash_table_remove (priv->cache, item->key);
+		ai_database_cache_item_free (item);
+	}
+}
+
+/*
+ * ai_database_set_locale_chain:
+ *
+ * Fills the temporary locale_chain table with the fallbacks for @locale,
+ * best first, so a search resolves the translation of every result in
+ * the same query. It is only refilled when the locale changes.
+ */
+static gboolean
+ai_database_set_locale_chain (AiDatabase *database, const gchar *locale, GError **error)
+{
+	gboolean ret = TRUE;
+	gboolean in_sync;
+	gchar **fallbacks = NULL;
+	gchar *statement;
+	guint i;
+	gint rc;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (priv->chain_valid && g_strcmp0 (locale, priv->chain_locale) == 0)
+		goto out;
+
+	/* writing the temporary table does not change the data */
+	in_sync = (sqlite3_total_changes (priv->db) == priv->changes);
+	rc = sqlite3_exec (priv->db, "CREATE TEMP TABLE IF NOT EXISTS locale_chain ("
+			   "locale TEXT PRIMARY KEY,"
+			   "rank INTEGER);"
+			   "DELETE FROM locale_chain;", NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't create locale chain: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	fallbacks = ai_utils_get_locale_fallbacks (locale);
+	for (i=0; fallbacks[i] != NULL; i++) {
+		statement = sqlite3_mprintf ("INSERT OR IGNORE INTO locale_chain (locale, rank) VALUES (%Q, %i);", fallbacks[i], i);
+		rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		sqlite3_free (statement);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't add to locale chain: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+	}
+	if (in_sync)
+		priv->changes = sqlite3_total_changes (priv->db);
+
+	g_free (priv->chain_locale);
+	priv->chain_locale = g_strdup (locale);
+	priv->chain_valid = TRUE;
+out:
+	g_strfreev (fallbacks);
+	return ret;
+}
+
 /*
  * ai_database_set_filename:
  *
@@ -132,6 +503,24 @@ out:
 	return ret;
 }
 
+/*
+ * ai_database_set_config:
+ *
+ * The config used to decide which icon sizes are installed, otherwise
+ * the system config file is used.
+ */
+void
+ai_database_set_config (AiDatabase *database, AiConfig *config)
+{
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_if_fail (AI_IS_DATABASE (database));
+	g_return_if_fail (AI_IS_CONFIG (config));
+
+	g_object_unref (priv->config);
+	priv->config = g_object_ref (config);
+}
+
 
 /**
  * ai_database_get_dbversion_sqlite_cb:
@@ -195,6 +584,10 @@ ai_database_open (AiDatabase *database, gboolean synchronous, GError **error)
 		priv->dbversion = 1;
 	egg_debug ("operating on database version %i", priv->dbversion);
 
+	/* used to build the display table */
+	sqlite3_create_function (priv->db, "ai_casefold", 1, SQLITE_UTF8, NULL,
+				 ai_database_casefold_func, NULL, NULL);
+
 	/* okay for business */
 	priv->locked = TRUE;
 out:
@@ -242,9 +635,16 @@ ai_database_close (AiDatabase *database, gboolean vaccuum, GError **error)
 		}
 	}
 
+	sqlite3_finalize (priv->data_version_stmt);
+	priv->data_version_stmt = NULL;
 	sqlite3_close (priv->db);
 	priv->locked = FALSE;
 	priv->dbversion = 0;
+	priv->chain_valid = FALSE;
+	priv->display = AI_DATABASE_DISPLAY_UNKNOWN;
+	g_hash_table_remove_all (priv->completions);
+	g_hash_table_remove_all (priv->trigrams);
+	ai_database_cache_clear (database);
 out:
 	return ret;
 }
@@ -311,13 +711,46 @@ ai_database_create (AiDatabase *database, GError **error)
 		ret = FALSE;
 		goto out;
 	}
-	statement = "INSERT INTO config (data, value) VALUES ('dbversion', 2);";
+	statement = "INSERT INTO config (data, value) VALUES ('dbversion', " G_STRINGIFY (AI_DATABASE_VERSION) ");";
 	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
 	if (rc) {
 		g_set_error (error, 1, 0, "Can't insert dbver: %s\n", sqlite3_errmsg (priv->db));
 		ret = FALSE;
 		goto out;
 	}
+
+	/* create icon archive index */
+	rc = sqlite3_exec (priv->db, AI_DATABASE_ICON_TABLES, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't create icon tables: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* create icon atlas offsets */
+	rc = sqlite3_exec (priv->db, AI_DATABASE_ATLAS_TABLES, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't create atlas table: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* create translation index */
+	rc = sqlite3_exec (priv->db, AI_DATABASE_TRANSLATION_INDEX, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't create translation index: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* create display table */
+	rc = sqlite3_exec (priv->db, AI_DATABASE_DISPLAY_TABLES, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't create display table: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	priv->dbversion = AI_DATABASE_VERSION;
 out:
 	return ret;
 }
@@ -369,9 +802,57 @@ ai_database_upgrade (AiDatabase *database, GError **error)
 		done_upgrade = TRUE;
 	}
 
+	/* upgrade from version 2 */
+	if (priv->dbversion == 2) {
+		rc = sqlite3_exec (priv->db, AI_DATABASE_ICON_TABLES, NULL, NULL, NULL);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't create icon tables: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+		priv->dbversion = 3;
+		done_upgrade = TRUE;
+	}
+
+	/* upgrade from version 3 */
+	if (priv->dbversion == 3) {
+		rc = sqlite3_exec (priv->db, AI_DATABASE_ATLAS_TABLES, NULL, NULL, NULL);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't create atlas table: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+		priv->dbversion = 4;
+		done_upgrade = TRUE;
+	}
+
+	/* upgrade from version 4 */
+	if (priv->dbversion == 4) {
+		rc = sqlite3_exec (priv->db, AI_DATABASE_TRANSLATION_INDEX, NULL, NULL, NULL);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't create translation index: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+		priv->dbversion = 5;
+		done_upgrade = TRUE;
+	}
+
+	/* upgrade from version 5, the table is empty until it is updated */
+	if (priv->dbversion == 5) {
+		rc = sqlite3_exec (priv->db, AI_DATABASE_DISPLAY_TABLES, NULL, NULL, NULL);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't create display table: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+		priv->dbversion = 6;
+		done_upgrade = TRUE;
+	}
+
 	/* set the new database version */
 	if (done_upgrade) {
-		statement = "INSERT INTO config (data, value) VALUES ('dbversion', 2);";
+		statement = "INSERT OR REPLACE INTO config (data, value) VALUES ('dbversion', " G_STRINGIFY (AI_DATABASE_VERSION) ");";
 		rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
 		if (rc) {
 			g_set_error (error, 1, 0, "Can't change dbver: %s\n", sqlite3_errmsg (priv->db));
@@ -386,8 +867,6 @@ out:
 
 }
 
-static const gchar *icon_sizes[] = { "22x22", "24x24", "32x32", "48x48", "scalable", NULL };
-
 /**
  * ai_database_remove_icons_sqlite_cb:
  **/
@@ -400,7 +879,8 @@ ai_database_remove_icons_sqlite_cb (void *data, gint argc, gchar **argv, gchar *
 	const gchar *application_id = NULL;
 	const gchar *icon_name = NULL;
 	gchar *path;
-	const gchar *icondir = (const gchar *) data;
+	gchar **icon_dirs;
+	AiDatabasePrivate *priv = (AiDatabasePrivate *) data;
 	GFile *file;
 	gboolean ret;
 	GError *error = NULL;
@@ -419,8 +899,9 @@ ai_database_remove_icons_sqlite_cb (void *data, gint argc, gchar **argv, gchar *
 	egg_debug ("removing icons for application: %s", application_id);
 
 	/* delete all icon sizes */
-	for (i=0; icon_sizes[i] != NULL; i++) {
-		path = g_build_filename (icondir, icon_sizes[i], icon_name, NULL);
+	icon_dirs = ai_config_get_icon_dirs (priv->config);
+	for (i=0; icon_dirs[i] != NULL; i++) {
+		path = g_build_filename (priv->icon_path, icon_dirs[i], icon_name, NULL);
 		ret = g_file_test (path, G_FILE_TEST_EXISTS);
 		if (ret) {
 			egg_debug ("removing file %s", path);
@@ -462,7 +943,7 @@ ai_database_remove_by_repo (AiDatabase *database, const gchar *repo, GError **er
 	/* remove icons */
 	if (priv->icon_path != NULL) {
 		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE repo_id = '%s'", repo);
-		rc = sqlite3_exec (priv->db, statement, ai_database_remove_icons_sqlite_cb, (void*) priv->icon_path, &error_msg);
+		rc = sqlite3_exec (priv->db, statement, ai_database_remove_icons_sqlite_cb, (void*) priv, &error_msg);
 		g_free (statement);
 		if (rc != SQLITE_OK) {
 			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
@@ -495,6 +976,20 @@ ai_database_remove_by_repo (AiDatabase *database, const gchar *repo, GError **er
 		goto out;
 	}
 	egg_debug ("%i removals from applications", sqlite3_changes (priv->db));
+
+	/* forget the icon archive, the icons already written are removed above */
+	if (priv->dbversion >= 3) {
+		statement = sqlite3_mprintf ("DELETE FROM icon_members WHERE archive_id IN ("
+					     "SELECT archive_id FROM icon_archives WHERE repo_id = %Q);"
+					     "DELETE FROM icon_archives WHERE repo_id = %Q", repo, repo);
+		rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		sqlite3_free (statement);
+		if (rc) {
+			g_set_error (error, 1, 0, "Can't remove icon archive: %s\n", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+	}
 out:
 	return ret;
 }
@@ -523,7 +1018,7 @@ ai_database_remove_by_name (AiDatabase *database, const gchar *name, GError **er
 	/* remove icons */
 	if (priv->icon_path != NULL) {
 		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE package_name = '%s'", name);
-		rc = sqlite3_exec (priv->db, statement, ai_database_remove_icons_sqlite_cb, (void*) priv->icon_path, &error_msg);
+		rc = sqlite3_exec (priv->db, statement, ai_database_remove_icons_sqlite_cb, (void*) priv, &error_msg);
 		g_free (statement);
 		if (rc != SQLITE_OK) {
 			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
@@ -712,8 +1207,11 @@ ai_database_search_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_n
 	return 0;
 }
 
-/*
+/**
  * ai_database_search_by_id:
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, or %NULL on error
  */
 GPtrArray *
 ai_database_search_by_id (AiDatabase *database, const gchar *value, GError **error)
@@ -734,6 +1232,11 @@ ai_database_search_by_id (AiDatabase *database, const gchar *value, GError **err
 		goto out;
 	}
 
+	/* repeated searches are answered from the cache */
+	array = ai_database_cache_lookup (database, "id", value, NULL);
+	if (array != NULL)
+		goto out;
+
 	/* create array */
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
@@ -751,14 +1254,19 @@ ai_database_search_by_id (AiDatabase *database, const gchar *value, GError **err
 
 	/* success */
 	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, "id", value, NULL, array);
 out:
-	g_ptr_array_unref (array_tmp);
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
 	g_free (statement);
 	return array;
 }
 
-/*
+/**
  * ai_database_search_by_name:
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, or %NULL on error
  */
 GPtrArray *
 ai_database_search_by_name (AiDatabase *database, const gchar *value, GError **error)
@@ -779,6 +1287,11 @@ ai_database_search_by_name (AiDatabase *database, const gchar *value, GError **e
 		goto out;
 	}
 
+	/* repeated searches are answered from the cache */
+	array = ai_database_cache_lookup (database, "name", value, NULL);
+	if (array != NULL)
+		goto out;
+
 	/* create array */
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
@@ -796,15 +1309,20 @@ ai_database_search_by_name (AiDatabase *database, const gchar *value, GError **e
 
 	/* success */
 	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, "name", value, NULL, array);
 out:
-	g_ptr_array_unref (array_tmp);
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
 	g_free (statement);
 	return array;
 }
 
 
-/*
+/**
  * ai_database_search_by_id_locale:
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, or %NULL on error
  */
 GPtrArray *
 ai_database_search_by_id_locale (AiDatabase *database, const gchar *value, const gchar *locale, GError **error)
@@ -825,17 +1343,36 @@ ai_database_search_by_id_locale (AiDatabase *database, const gchar *value, const
 		goto out;
 	}
 
+	/* repeated searches are answered from the cache */
+	array = ai_database_cache_lookup (database, "id", value, locale);
+	if (array != NULL)
+		goto out;
+
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
 	/* create array */
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
 	/* check that there are no existing entries from this repo */
-	statement = g_strdup_printf ("SELECT a.application_id, a.package_name, a.categories, "
-				     "a.repo_id, a.icon_name, "
-				     "a.rating, a.screenshot_url, a.installed, "
-				     "COALESCE(t.application_name, a.application_name), "
-				     "COALESCE(t.application_summary, a.application_summary) "
-				     "FROM applications a LEFT JOIN translations t ON a.application_id = t.application_id AND t.locale = 'pt_BR' "
-				     "WHERE a.application_id = '%s'", value);
+	if (ai_database_has_display (database)) {
+		statement = sqlite3_mprintf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "d.application_name, d.application_summary "
+					     "FROM display d JOIN applications a ON a.application_id = d.application_id "
+					     "WHERE d.locale = " AI_DATABASE_DISPLAY_LOCALE
+					     "AND d.application_id = %Q", value);
+	} else {
+		statement = sqlite3_mprintf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "COALESCE(t.application_name, a.application_name), "
+					     "COALESCE(t.application_summary, a.application_summary) "
+					     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN
+					     "WHERE a.application_id = %Q", value);
+	}
 	rc = sqlite3_exec (priv->db, statement, ai_database_search_sqlite_cb, (void*) array_tmp, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
@@ -845,14 +1382,19 @@ ai_database_search_by_id_locale (AiDatabase *database, const gchar *value, const
 
 	/* success */
 	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, "id", value, locale, array);
 out:
-	g_ptr_array_unref (array_tmp);
-	g_free (statement);
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
+	sqlite3_free (statement);
 	return array;
 }
 
-/*
+/**
  * ai_database_search_by_name_locale:
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, or %NULL on error
  */
 GPtrArray *
 ai_database_search_by_name_locale (AiDatabase *database, const gchar *value, const gchar *locale, GError **error)
@@ -873,17 +1415,40 @@ ai_database_search_by_name_locale (AiDatabase *database, const gchar *value, con
 		goto out;
 	}
 
+	/* repeated searches are answered from the cache */
+	array = ai_database_cache_lookup (database, "name", value, locale);
+	if (array != NULL)
+		goto out;
+
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
 	/* create array */
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
 	/* check that there are no existing entries from this repo */
-	statement = g_strdup_printf ("SELECT a.application_id, a.package_name, a.categories, "
-				     "a.repo_id, a.icon_name, "
-				     "a.rating, a.screenshot_url, a.installed, "
-				     "COALESCE(t.application_name, a.application_name), "
-				     "COALESCE(t.application_summary, a.application_summary) "
-				     "FROM applications a LEFT JOIN translations t ON a.application_id = t.application_id AND t.locale = '%s' "
-				     "WHERE a.application_name LIKE '%%%s%%'", locale, value);
+	if (ai_database_has_display (database)) {
+		statement = sqlite3_mprintf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "d.application_name, d.application_summary "
+					     "FROM display d JOIN applications a ON a.application_id = d.application_id "
+					     "WHERE d.locale = " AI_DATABASE_DISPLAY_LOCALE
+					     "AND (d.application_name LIKE '%%' || %Q || '%%' "
+					     "OR a.application_name LIKE '%%' || %Q || '%%') "
+					     "ORDER BY d.sort_key, d.application_id", value, value);
+	} else {
+		statement = sqlite3_mprintf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "COALESCE(t.application_name, a.application_name), "
+					     "COALESCE(t.application_summary, a.application_summary) "
+					     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN
+					     "WHERE a.application_name LIKE '%%' || %Q || '%%' "
+					     "OR t.application_name LIKE '%%' || %Q || '%%' "
+					     "ORDER BY " AI_DATABASE_DISPLAY_SORT_KEY ", a.application_id", value, value);
+	}
 	rc = sqlite3_exec (priv->db, statement, ai_database_search_sqlite_cb, (void*) array_tmp, &error_msg);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
@@ -893,126 +1458,1287 @@ ai_database_search_by_name_locale (AiDatabase *database, const gchar *value, con
 
 	/* success */
 	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, "name", value, locale, array);
 out:
-	g_ptr_array_unref (array_tmp);
-	g_free (statement);
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
+	sqlite3_free (statement);
 	return array;
 }
 
+/**
+ * ai_database_set_cache_size:
+ * @cache_size: the number of searches to remember, or 0 to turn off
+ *
+ * Remembers the results of the most recent searches so repeating one
+ * is a hash lookup until the database changes. The cache is off by
+ * default. When it is on, the same array is returned for each repeat,
+ * so the results must not be modified.
+ */
+void
+ai_database_set_cache_size (AiDatabase *database, guint cache_size)
+{
+	g_return_if_fail (AI_IS_DATABASE (database));
+	database->priv->cache_size = cache_size;
+	ai_database_cache_clear (database);
+}
+
+/**
+ * ai_database_get_cache_stats:
+ * @hits: (out) (allow-none): the searches answered from the cache
+ * @misses: (out) (allow-none): the searches that were not
+ */
+void
+ai_database_get_cache_stats (AiDatabase *database, guint *hits, guint *misses)
+{
+	g_return_if_fail (AI_IS_DATABASE (database));
+	if (hits != NULL)
+		*hits = database->priv->cache_hits;
+	if (misses != NULL)
+		*misses = database->priv->cache_misses;
+}
+
 /*
- * ai_database_import:
+ * ai_database_get_completion:
  */
-gboolean
-ai_database_import (AiDatabase *database, const gchar *filename, guint *value, GError **error)
+static AiCompletion *
+ai_database_get_completion (AiDatabase *database, const gchar *locale, GError **error)
 {
-	gboolean ret = TRUE;
-	gchar *contents = NULL;
 	gint rc;
-	gchar *error_msg;
-	gchar **lines = NULL;
-	guint i;
-	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+	const gchar *keywords[3];
+	gchar *statement = NULL;
+	sqlite3_stmt *stmt = NULL;
+	AiCompletion *completion = NULL;
+	AiCompletion *completion_tmp = NULL;
+	AiDatabasePrivate *priv = database->priv;
 
-	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+	ai_database_check_changes (database);
+	completion = g_hash_table_lookup (priv->completions, locale != NULL ? locale : "");
+	if (completion != NULL)
+		goto out;
 
-	/* check database is in correct state */
-	if (!priv->locked) {
-		g_set_error (error, 1, 0, "database is not open");
-		ret = FALSE;
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
+	/* the rating column is only present from version 2 */
+	statement = g_strdup_printf ("SELECT COALESCE(t.application_name, a.application_name), "
+				     "a.application_name, a.package_name, %s "
+				     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN,
+				     priv->dbversion >= 2 ? "a.rating" : "0");
+	rc = sqlite3_prepare_v2 (priv->db, statement, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
 		goto out;
 	}
 
-	/* get all the sql from the source file */
-	ret = g_file_get_contents (filename, &contents, NULL, error);
-	if (!ret)
+	/* untranslated and package names should still find the application */
+	completion_tmp = ai_completion_new ();
+	keywords[2] = NULL;
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		keywords[0] = (const gchar *) sqlite3_column_text (stmt, 1);
+		keywords[1] = (const gchar *) sqlite3_column_text (stmt, 2);
+		ai_completion_add (completion_tmp, (const gchar *) sqlite3_column_text (stmt, 0),
+				   keywords, MAX (sqlite3_column_int (stmt, 3), 0));
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
 		goto out;
+	}
+	egg_debug ("built completions for '%s' with %i applications",
+		   locale != NULL ? locale : "", ai_completion_get_size (completion_tmp));
 
-	/* split into lines, so we can do the query in smaller lumps */
+	/* the hash owns the index */
+	completion = completion_tmp;
+	g_hash_table_insert (priv->completions, g_strdup (locale != NULL ? locale : ""), completion_tmp);
+	completion_tmp = NULL;
+out:
+	if (completion_tmp != NULL)
+		g_object_unref (completion_tmp);
+	sqlite3_finalize (stmt);
+	g_free (statement);
+	return completion;
+}
+
+/**
+ * ai_database_complete:
+ * @prefix: what the user has typed so far
+ * @locale: the locale to complete translated names in, or %NULL
+ * @limit: the maximum number of completions, or 0 for no limit
+ *
+ * Completes application names for search-as-you-type. Every word of the
+ * translated and untranslated names, and the package name, is matched
+ * against the prefix ignoring case and accents.
+ *
+ * Return value: (array zero-terminated=1) (transfer full): the
+ * completions, best rated first, or %NULL on error
+ */
+gchar **
+ai_database_complete (AiDatabase *database, const gchar *prefix, const gchar *locale, guint limit, GError **error)
+{
+	gchar **completions = NULL;
+	AiCompletion *completion;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), NULL);
+	g_return_val_if_fail (prefix != NULL, NULL);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		goto out;
+	}
+
+	completion = ai_database_get_completion (database, locale, error);
+	if (completion == NULL)
+		goto out;
+	completions = ai_completion_complete (completion, prefix, limit);
+out:
+	return completions;
+}
+
+/*
+ * ai_database_get_trigram:
+ */
+static AiTrigram *
+ai_database_get_trigram (AiDatabase *database, const gchar *locale, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	AiTrigram *trigram = NULL;
+	AiTrigram *trigram_tmp = NULL;
+	AiDatabasePrivate *priv = database->priv;
+
+	ai_database_check_changes (database);
+	trigram = g_hash_table_lookup (priv->trigrams, locale != NULL ? locale : "");
+	if (trigram != NULL)
+		goto out;
+
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
+	rc = sqlite3_prepare_v2 (priv->db, "SELECT a.application_id, "
+				 "COALESCE(t.application_name, a.application_name), "
+				 "COALESCE(t.application_summary, a.application_summary) "
+				 "FROM applications a " AI_DATABASE_TRANSLATION_JOIN,
+				 -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+
+	trigram_tmp = ai_trigram_new ();
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		ai_trigram_add (trigram_tmp,
+				(const gchar *) sqlite3_column_text (stmt, 0),
+				(const gchar *) sqlite3_column_text (stmt, 1),
+				(const gchar *) sqlite3_column_text (stmt, 2));
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+	egg_debug ("built trigrams for '%s' with %i applications",
+		   locale != NULL ? locale : "", ai_trigram_get_size (trigram_tmp));
+
+	/* the hash owns the index */
+	trigram = trigram_tmp;
+	g_hash_table_insert (priv->trigrams, g_strdup (locale != NULL ? locale : ""), trigram_tmp);
+	trigram_tmp = NULL;
+out:
+	if (trigram_tmp != NULL)
+		g_object_unref (trigram_tmp);
+	sqlite3_finalize (stmt);
+	return trigram;
+}
+
+/*
+ * ai_database_rank_compare:
+ */
+static gint
+ai_database_rank_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GHashTable *ranks = (GHashTable *) user_data;
+	AiResult *result1 = *((AiResult **) a);
+	AiResult *result2 = *((AiResult **) b);
+	guint rank1;
+	guint rank2;
+
+	rank1 = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, ai_result_get_application_id (result1)));
+	rank2 = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, ai_result_get_application_id (result2)));
+	return (gint) rank1 - (gint) rank2;
+}
+
+/**
+ * ai_database_search_by_name_fuzzy:
+ * @value: the possibly misspelled name to look for
+ * @locale: the locale of the names and summaries to match, or %NULL
+ * @limit: the maximum number of results, or 0 for no limit
+ *
+ * Finds applications even when the name is misspelled, ranked by
+ * trigram similarity and edit distance. Results scoring below
+ * %AI_TRIGRAM_CUTOFF are not returned.
+ *
+ * Return value: (element-type AiResult) (transfer full): the matching
+ * applications, best first, or %NULL on error
+ */
+GPtrArray *
+ai_database_search_by_name_fuzzy (AiDatabase *database, const gchar *value, const gchar *locale, guint limit, GError **error)
+{
+	gchar *statement = NULL;
+	gchar *kind = NULL;
+	gchar *tmp;
+	gint rc;
+	guint i;
+	gchar *error_msg;
+	GString *ids = NULL;
+	GPtrArray *matches = NULL;
+	GPtrArray *array = NULL;
+	GPtrArray *array_tmp = NULL;
+	GHashTable *ranks = NULL;
+	AiTrigram *trigram;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), NULL);
+	g_return_val_if_fail (value != NULL, NULL);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		goto out;
+	}
+
+	/* repeated searches are answered from the cache */
+	kind = g_strdup_printf ("fuzzy:%i", limit);
+	array = ai_database_cache_lookup (database, kind, value, locale);
+	if (array != NULL)
+		goto out;
+
+	trigram = ai_database_get_trigram (database, locale, error);
+	if (trigram == NULL)
+		goto out;
+	matches = ai_trigram_search (trigram, value, limit);
+
+	/* create array */
+	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (matches->len == 0)
+		goto success;
+
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
+	/* get all the matches in one go */
+	ids = g_string_new ("");
+	ranks = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i=0; i<matches->len; i++) {
+		tmp = sqlite3_mprintf ("%s%Q", i > 0 ? "," : "", g_ptr_array_index (matches, i));
+		g_string_append (ids, tmp);
+		sqlite3_free (tmp);
+		g_hash_table_insert (ranks, g_ptr_array_index (matches, i), GUINT_TO_POINTER (i));
+	}
+	statement = sqlite3_mprintf ("SELECT a.application_id, a.package_name, a.categories, "
+				     "a.repo_id, a.icon_name, "
+				     "a.rating, a.screenshot_url, a.installed, "
+				     "COALESCE(t.application_name, a.application_name), "
+				     "COALESCE(t.application_summary, a.application_summary) "
+				     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN
+				     "WHERE a.application_id IN (%s)", ids->str);
+	rc = sqlite3_exec (priv->db, statement, ai_database_search_sqlite_cb, (void*) array_tmp, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
+		sqlite3_free (error_msg);
+		goto out;
+	}
+
+	/* back into the order they were ranked in */
+	g_ptr_array_sort_with_data (array_tmp, ai_database_rank_compare, ranks);
+success:
+	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, kind, value, locale, array);
+out:
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
+	if (matches != NULL)
+		g_ptr_array_unref (matches);
+	if (ranks != NULL)
+		g_hash_table_unref (ranks);
+	if (ids != NULL)
+		g_string_free (ids, TRUE);
+	sqlite3_free (statement);
+	g_free (kind);
+	return array;
+}
+
+/**
+ * ai_database_list_by_name_locale:
+ * @locale: the locale of the names and summaries, or %NULL
+ * @offset: the number of applications to skip
+ * @limit: the maximum number of results, or 0 for no limit
+ *
+ * Return value: (element-type AiResult) (transfer full): a page of all
+ * the applications sorted by localized name, or %NULL on error
+ */
+GPtrArray *
+ai_database_list_by_name_locale (AiDatabase *database, const gchar *locale, guint offset, guint limit, GError **error)
+{
+	gchar *statement = NULL;
+	gchar *kind;
+	gint rc;
+	gchar *error_msg;
+	GPtrArray *array = NULL;
+	GPtrArray *array_tmp = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), NULL);
+
+	/* the page is part of the key */
+	kind = g_strdup_printf ("list:%i:%i", offset, limit);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		goto out;
+	}
+
+	/* repeated searches are answered from the cache */
+	array = ai_database_cache_lookup (database, kind, "", locale);
+	if (array != NULL)
+		goto out;
+
+	/* the translations to use */
+	if (!ai_database_set_locale_chain (database, locale, error))
+		goto out;
+
+	/* create array */
+	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* a single scan of the sort key index when the display table is current */
+	if (ai_database_has_display (database)) {
+		statement = g_strdup_printf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "d.application_name, d.application_summary "
+					     "FROM display d JOIN applications a ON a.application_id = d.application_id "
+					     "WHERE d.locale = " AI_DATABASE_DISPLAY_LOCALE
+					     "ORDER BY d.sort_key, d.application_id LIMIT %i OFFSET %i",
+					     limit > 0 ? (gint) limit : -1, offset);
+	} else {
+		statement = g_strdup_printf ("SELECT a.application_id, a.package_name, a.categories, "
+					     "a.repo_id, a.icon_name, "
+					     "a.rating, a.screenshot_url, a.installed, "
+					     "COALESCE(t.application_name, a.application_name), "
+					     "COALESCE(t.application_summary, a.application_summary) "
+					     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN
+					     "ORDER BY " AI_DATABASE_DISPLAY_SORT_KEY ", a.application_id "
+					     "LIMIT %i OFFSET %i",
+					     limit > 0 ? (gint) limit : -1, offset);
+	}
+	rc = sqlite3_exec (priv->db, statement, ai_database_search_sqlite_cb, (void*) array_tmp, &error_msg);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", sqlite3_errmsg (priv->db));
+		sqlite3_free (error_msg);
+		goto out;
+	}
+
+	/* success */
+	array = g_ptr_array_ref (array_tmp);
+	ai_database_cache_insert (database, kind, "", locale, array);
+out:
+	if (array_tmp != NULL)
+		g_ptr_array_unref (array_tmp);
+	g_free (statement);
+	g_free (kind);
+	return array;
+}
+
+/*
+ * ai_database_get_strings:
+ *
+ * Return value: the first column of every row, or %NULL on error
+ */
+static GPtrArray *
+ai_database_get_strings (AiDatabase *database, const gchar *statement, GError **error)
+{
+	GPtrArray *array = NULL;
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (sqlite3_prepare_v2 (priv->db, statement, -1, &stmt, NULL) != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+	array = g_ptr_array_new_with_free_func (g_free);
+	while (sqlite3_step (stmt) == SQLITE_ROW)
+		g_ptr_array_add (array, g_strdup ((const gchar *) sqlite3_column_text (stmt, 0)));
+out:
+	sqlite3_finalize (stmt);
+	return array;
+}
+
+/*
+ * ai_database_fill_display:
+ * @stale_only: only redo the applications that changed since the last fill
+ *
+ * Writes the display rows for "C" and each of @locales. This has to be
+ * called in a transaction.
+ */
+static gboolean
+ai_database_fill_display (AiDatabase *database, GPtrArray *locales, gboolean stale_only, GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	guint i;
+	gchar *statement;
+	const gchar *where;
+	AiDatabasePrivate *priv = database->priv;
+
+	if (stale_only) {
+		where = "WHERE a.application_id IN display_stale";
+		rc = sqlite3_exec (priv->db, "DELETE FROM display WHERE application_id IN display_stale", NULL, NULL, NULL);
+	} else {
+		where = "";
+		rc = sqlite3_exec (priv->db, "DELETE FROM display; DELETE FROM display_locales", NULL, NULL, NULL);
+	}
+	if (rc != SQLITE_OK)
+		goto out;
+
+	statement = sqlite3_mprintf ("INSERT INTO display (application_id, locale, application_name, application_summary, sort_key) "
+				     "SELECT a.application_id, '', a.application_name, a.application_summary, "
+				     "ai_casefold(a.application_name) FROM applications a %s", where);
+	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	sqlite3_free (statement);
+	if (rc != SQLITE_OK)
+		goto out;
+
+	for (i=0; i<locales->len; i++) {
+		ret = ai_database_set_locale_chain (database, g_ptr_array_index (locales, i), error);
+		if (!ret)
+			goto out;
+		statement = sqlite3_mprintf ("INSERT INTO display (application_id, locale, application_name, application_summary, sort_key) "
+					     "SELECT a.application_id, %Q, "
+					     "COALESCE(t.application_name, a.application_name), "
+					     "COALESCE(t.application_summary, a.application_summary), "
+					     AI_DATABASE_DISPLAY_SORT_KEY " "
+					     "FROM applications a " AI_DATABASE_TRANSLATION_JOIN "%s;"
+					     "INSERT OR IGNORE INTO display_locales (locale) VALUES (%Q)",
+					     g_ptr_array_index (locales, i), where,
+					     g_ptr_array_index (locales, i));
+		rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+		sqlite3_free (statement);
+		if (rc != SQLITE_OK)
+			goto out;
+	}
+
+	rc = sqlite3_exec (priv->db, "DELETE FROM display_stale;"
+			   "INSERT OR REPLACE INTO config (data, value) VALUES ('display', 1)", NULL, NULL, NULL);
+out:
+	if (ret && rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+	}
+	return ret;
+}
+
+/**
+ * ai_database_update_display:
+ *
+ * Rebuilds the display table, which has the name and summary of every
+ * application in each locale that has translations, plus "C", with the
+ * fallbacks already applied. Localized searches and listings use it
+ * while nothing has changed since, and join the translations otherwise.
+ *
+ * This reads every application in every locale, so tools that change a
+ * few applications should use ai_database_refresh_display() instead.
+ */
+gboolean
+ai_database_update_display (AiDatabase *database, GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	GPtrArray *locales = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* nothing to do until the database has been upgraded */
+	if (priv->dbversion < 6) {
+		egg_debug ("no display table in version %i", priv->dbversion);
+		goto out;
+	}
+
+	/* every locale that has a translation */
+	locales = ai_database_get_strings (database, "SELECT DISTINCT locale FROM translations "
+					   "WHERE locale IS NOT NULL", error);
+	if (locales == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	/* one transaction, so readers never see it half built */
+	rc = sqlite3_exec (priv->db, "BEGIN", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	ret = ai_database_fill_display (database, locales, FALSE, error);
+	if (!ret)
+		goto rollback;
+	rc = sqlite3_exec (priv->db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	egg_debug ("display table has %i locales", locales->len + 1);
+	goto out;
+rollback:
+	sqlite3_exec (priv->db, "ROLLBACK", NULL, NULL, NULL);
+out:
+	if (locales != NULL)
+		g_ptr_array_unref (locales);
+	return ret;
+}
+
+/**
+ * ai_database_refresh_display:
+ *
+ * Brings the display table up to date after adding or removing a few
+ * packages, by only redoing the applications that have changed since it
+ * was last written. The whole table is rebuilt if it never was, or if
+ * a translation adds a locale it does not have yet.
+ */
+gboolean
+ai_database_refresh_display (AiDatabase *database, GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	GPtrArray *locales = NULL;
+	GPtrArray *array = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* nothing to do until the database has been upgraded */
+	if (priv->dbversion < 6)
+		goto out;
+
+	/* nothing changed, or the table has to be built from scratch */
+	array = ai_database_get_strings (database, "SELECT value FROM config WHERE data = 'display' "
+					 "UNION ALL SELECT application_id FROM display_stale LIMIT 2", error);
+	if (array == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+	if (array->len == 0 || g_strcmp0 (g_ptr_array_index (array, 0), "1") != 0) {
+		ret = ai_database_update_display (database, error);
+		goto out;
+	}
+	if (array->len == 1)
+		goto out;
+	g_ptr_array_unref (array);
+
+	/* the other applications would need rows for a new locale too */
+	array = ai_database_get_strings (database, "SELECT t.locale FROM translations t "
+					 "JOIN display_stale s ON t.application_id = s.application_id "
+					 "WHERE t.locale IS NOT NULL "
+					 "AND t.locale NOT IN (SELECT locale FROM display_locales) LIMIT 1", error);
+	if (array == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+	if (array->len > 0) {
+		egg_debug ("new locale %s, rebuilding", (const gchar *) g_ptr_array_index (array, 0));
+		ret = ai_database_update_display (database, error);
+		goto out;
+	}
+
+	locales = ai_database_get_strings (database, "SELECT locale FROM display_locales", error);
+	if (locales == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+	rc = sqlite3_exec (priv->db, "BEGIN", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	ret = ai_database_fill_display (database, locales, TRUE, error);
+	if (!ret)
+		goto rollback;
+	rc = sqlite3_exec (priv->db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	goto out;
+rollback:
+	sqlite3_exec (priv->db, "ROLLBACK", NULL, NULL, NULL);
+out:
+	if (array != NULL)
+		g_ptr_array_unref (array);
+	if (locales != NULL)
+		g_ptr_array_unref (locales);
+	return ret;
+}
+
+/*
+ * ai_database_import:
+ */
+gboolean
+ai_database_import (AiDatabase *database, const gchar *filename, guint *value, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar *contents = NULL;
+	gint rc;
+	gchar *error_msg;
+	gchar **lines = NULL;
+	guint i;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* get all the sql from the source file */
+	ret = g_file_get_contents (filename, &contents, NULL, error);
+	if (!ret)
+		goto out;
+
+	/* split into lines, so we can do the query in smaller lumps */
 	lines = g_strsplit (contents, "\n", -1);
 	for (i=0; lines[i] != NULL; i++) {
 
-		/* copy all the applications and translations into remote db */
-		rc = sqlite3_exec (priv->db, lines[i], NULL, NULL, &error_msg);
-		if (rc == SQLITE_OK) {
-			/* success */
-			if (value != NULL)
-				(*value)++;
-		} else {
-			g_set_error (error, 1, 0, "SQL error: %s, '%s'\n", error_msg, lines[i]);
+		/* copy all the applications and translations into remote db */
+		rc = sqlite3_exec (priv->db, lines[i], NULL, NULL, &error_msg);
+		if (rc == SQLITE_OK) {
+			/* success */
+			if (value != NULL)
+				(*value)++;
+		} else {
+			g_set_error (error, 1, 0, "SQL error: %s, '%s'\n", error_msg, lines[i]);
+			sqlite3_free (error_msg);
+			ret = FALSE;
+			goto out;
+		}
+	}
+out:
+	g_free (contents);
+	g_strfreev (lines);
+	return ret;
+}
+
+/*
+ * ai_database_add_translation:
+ */
+gboolean
+ai_database_add_translation (AiDatabase *database,
+			     const gchar *application_id,
+			     const gchar *name,
+			     const gchar *summary,
+			     const gchar *locale,
+			     GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	gchar *statement = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* generate SQL */
+	statement = sqlite3_mprintf ("INSERT INTO translations (application_id, application_name, application_summary, locale) "
+				     "VALUES (%Q, %Q, %Q, %Q);", application_id, name, summary, locale);
+	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't add translation: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+out:
+	sqlite3_free (statement);
+	return ret;
+}
+
+/*
+ * ai_database_add_application:
+ */
+gboolean
+ai_database_add_application (AiDatabase *database,
+			     const gchar *application_id,
+			     const gchar *package,
+			     const gchar *categories,
+			     const gchar *repo,
+			     const gchar *icon,
+			     const gchar *name,
+			     const gchar *summary,
+			     GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	gchar *statement = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+	g_return_val_if_fail (application_id != NULL, FALSE);
+	g_return_val_if_fail (package != NULL, FALSE);
+	g_return_val_if_fail (repo != NULL, FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* generate SQL */
+	statement = sqlite3_mprintf ("INSERT INTO applications (application_id, package_name, categories, "
+				     "repo_id, icon_name, application_name, application_summary) "
+				     "VALUES (%Q, %Q, %Q, %Q, %Q, %Q, %Q);",
+				     application_id, package, categories, repo, icon, name, summary);
+	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't add application: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+out:
+	sqlite3_free (statement);
+	return ret;
+}
+
+typedef struct {
+	const gchar	*icondir;
+	AiDatabase	*database;
+} AiDatabaseTemp;
+
+/**
+ * ai_database_add_applications_sqlite_cb:
+ **/
+static gint
+ai_database_add_applications_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+{
+	guint i;
+	gchar *col;
+	gchar *value;
+	const gchar *application_id = NULL;
+	const gchar *package = NULL;
+	const gchar *categories = NULL;
+	const gchar *repo = NULL;
+	const gchar *icon = NULL;
+	const gchar *name = NULL;
+	const gchar *summary = NULL;
+	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
+	gboolean ret;
+	gint retval = 0;
+	GError *error = NULL;
+
+	for (i=0; i<(guint)argc; i++) {
+		col = col_name[i];
+		value = argv[i];
+		if (g_strcmp0 (col, "application_id") == 0)
+			application_id = value;
+		else if (g_strcmp0 (col, "package_name") == 0)
+			package = value;
+		else if (g_strcmp0 (col, "categories") == 0)
+			categories = value;
+		else if (g_strcmp0 (col, "repo_id") == 0)
+			repo = value;
+		else if (g_strcmp0 (col, "icon_name") == 0)
+			icon = value;
+		else if (g_strcmp0 (col, "application_name") == 0)
+			name = value;
+		else if (g_strcmp0 (col, "application_summary") == 0)
+			summary = value;
+	}
+
+	/* add to the target database */
+	egg_debug ("adding %s", application_id);
+	ret = ai_database_add_application (temp->database, application_id, package, categories, repo, icon, name, summary, &error);
+	if (!ret) {
+		egg_warning ("failed to add: %s", error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+out:
+	return retval;
+}
+
+/**
+ * ai_database_add_translations_sqlite_cb:
+ **/
+static gint
+ai_database_add_translations_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+{
+	guint i;
+	gchar *col;
+	gchar *value;
+	const gchar *application_id = NULL;
+	const gchar *name = NULL;
+	const gchar *summary = NULL;
+	const gchar *locale = NULL;
+	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
+	gboolean ret;
+	gint retval = 0;
+	GError *error = NULL;
+
+	for (i=0; i<(guint)argc; i++) {
+		col = col_name[i];
+		value = argv[i];
+		if (g_strcmp0 (col, "application_id") == 0)
+			application_id = value;
+		else if (g_strcmp0 (col, "locale") == 0)
+			locale = value;
+		else if (g_strcmp0 (col, "application_name") == 0)
+			name = value;
+		else if (g_strcmp0 (col, "application_summary") == 0)
+			summary = value;
+	}
+
+	/* add to the target database */
+	ret = ai_database_add_translation (temp->database, application_id, name, summary, locale, &error);
+	if (!ret) {
+		egg_warning ("failed to add: %s", error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+out:
+	return retval;
+}
+
+/**
+ * ai_database_copy_icons_sqlite_cb:
+ **/
+static gint
+ai_database_copy_icons_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+{
+	guint i;
+	gchar *col;
+	gchar *value;
+	const gchar *application_id = NULL;
+	const gchar *icon_name = NULL;
+	gchar *path;
+	gchar *dest;
+	GFile *file;
+	GFile *remote;
+	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
+	gboolean ret;
+	gchar *icon_name_full;
+	gchar **icon_dirs;
+	GError *error = NULL;
+
+	for (i=0; i<(guint)argc; i++) {
+		col = col_name[i];
+		value = argv[i];
+		if (g_strcmp0 (col, "application_id") == 0)
+			application_id = value;
+		else if (g_strcmp0 (col, "icon_name") == 0)
+			icon_name = value;
+	}
+	if (application_id == NULL || icon_name == NULL)
+		goto out;
+
+	egg_debug ("copying icon %s for application: %s", icon_name, application_id);
+	icon_name_full = g_strdup_printf ("%s.png", icon_name);
+
+	/* copy all the configured icon sizes if they exist */
+	icon_dirs = ai_config_get_icon_dirs (temp->database->priv->config);
+	for (i=0; icon_dirs[i] != NULL; i++) {
+		path = g_build_filename (temp->icondir, icon_dirs[i], icon_name_full, NULL);
+		ret = g_file_test (path, G_FILE_TEST_EXISTS);
+		if (ret) {
+			dest = g_build_filename (temp->database->priv->icon_path, icon_dirs[i], icon_name_full, NULL);
+			egg_debug ("copying file %s to %s", path, dest);
+			file = g_file_new_for_path (path);
+			remote = g_file_new_for_path (dest);
+			ret = g_file_copy (file, remote, G_FILE_COPY_TARGET_DEFAULT_PERMS, NULL, NULL, NULL, &error);
+			if (!ret) {
+				egg_warning ("cannot copy %s: %s", path, error->message);
+				g_clear_error (&error);
+			}
+			g_object_unref (file);
+			g_object_unref (remote);
+			g_free (dest);
+		} else {
+			egg_debug ("failed to find icon %s", path);
+		}
+		g_free (path);
+	}
+	g_free (icon_name_full);
+out:
+	return 0;
+}
+
+/*
+ * ai_database_import_by_name:
+ */
+gboolean
+ai_database_import_by_name (AiDatabase *database,
+			    const gchar *filename,
+			    const gchar *icondir,
+			    const gchar *name,
+			    guint *value,
+			    GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	gchar *statement = NULL;
+	gchar *error_msg;
+	sqlite3	*foreign_db = NULL;
+	AiDatabaseTemp *temp = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (name != NULL, FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* open database */
+	rc = sqlite3_open (filename, &foreign_db);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't open database: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* use a temp object as we can only pass one pointer */
+	temp = g_new0 (AiDatabaseTemp, 1);
+	temp->icondir = icondir;
+	temp->database = database;
+
+	/* select all the application data for these packages */
+	statement = g_strdup_printf ("SELECT application_id, package_name, categories, repo_id, icon_name, application_name, application_summary "
+				     "FROM applications WHERE package_name = '%s'", name);
+	rc = sqlite3_exec (foreign_db, statement, ai_database_add_applications_sqlite_cb, (void*) temp, &error_msg);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
+		sqlite3_free (error_msg);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* select all the translation data for these packages */
+	statement = g_strdup_printf ("SELECT application_id, application_name, application_summary, locale FROM translations WHERE EXISTS ( "
+				     "SELECT applications.application_id FROM applications WHERE "
+				     "applications.application_id = applications.application_id AND applications.package_name = '%s')", name);
+	rc = sqlite3_exec (foreign_db, statement, ai_database_add_translations_sqlite_cb, (void*) temp, &error_msg);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
+		sqlite3_free (error_msg);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* copy all the icons */
+	if (icondir != NULL) {
+		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE package_name = '%s'", name);
+		rc = sqlite3_exec (foreign_db, statement, ai_database_copy_icons_sqlite_cb, (void*) temp, &error_msg);
+		g_free (statement);
+		if (rc != SQLITE_OK) {
+			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
+			sqlite3_free (error_msg);
+			ret = FALSE;
+			goto out;
+		}
+	}
+
+	/* get additions */
+	if (value != NULL)
+		*value = 1;
+out:
+	g_free (temp);
+	if (foreign_db != NULL)
+		sqlite3_close (foreign_db);
+	return ret;
+}
+
+/*
+ * ai_database_import_by_repo:
+ */
+gboolean
+ai_database_import_by_repo (AiDatabase *database,
+			    const gchar *filename,
+			    const gchar *icondir,
+			    const gchar *repo,
+			    guint *value,
+			    GError **error)
+{
+	gboolean ret = TRUE;
+	gint rc;
+	gchar *statement = NULL;
+	gchar *error_msg;
+	sqlite3	*foreign_db = NULL;
+	AiDatabaseTemp *temp = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (repo != NULL, FALSE);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* database does not exist */
+	if (!g_file_test (filename, G_FILE_TEST_EXISTS)) {
+		g_set_error (error, 1, 0, "The source filename '%s' could not be found", filename);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* icondir do not exist */
+	if (icondir != NULL && !g_file_test (icondir, G_FILE_TEST_IS_DIR)) {
+		g_set_error (error, 1, 0, "The icon directory '%s' could not be found", icondir);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* open database */
+	rc = sqlite3_open (filename, &foreign_db);
+	if (rc) {
+		g_set_error (error, 1, 0, "Can't open database: %s\n", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* use a temp object as we can only pass one pointer */
+	temp = g_new0 (AiDatabaseTemp, 1);
+	temp->icondir = icondir;
+	temp->database = database;
+
+	/* select all the application data for these packages */
+	statement = g_strdup_printf ("SELECT application_id, package_name, categories, repo_id, icon_name, application_name, application_summary "
+				     "FROM applications WHERE repo_id = '%s'", repo);
+	rc = sqlite3_exec (foreign_db, statement, ai_database_add_applications_sqlite_cb, (void*) temp, &error_msg);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
+		sqlite3_free (error_msg);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* select all the translation data for these packages */
+	statement = g_strdup_printf ("SELECT application_id, application_name, application_summary, locale FROM translations WHERE EXISTS ( "
+				     "SELECT applications.application_id FROM applications WHERE "
+				     "applications.application_id = applications.application_id AND applications.repo_id = '%s')", repo);
+	rc = sqlite3_exec (foreign_db, statement, ai_database_add_translations_sqlite_cb, (void*) temp, &error_msg);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
+		sqlite3_free (error_msg);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* copy all the icons */
+	if (icondir != NULL) {
+		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE repo_id = '%s'", repo);
+		rc = sqlite3_exec (foreign_db, statement, ai_database_copy_icons_sqlite_cb, (void*) temp, &error_msg);
+		g_free (statement);
+		if (rc != SQLITE_OK) {
+			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
 			sqlite3_free (error_msg);
 			ret = FALSE;
 			goto out;
 		}
 	}
+
+	/* get additions */
+	if (value != NULL)
+		*value = 1;
 out:
-	g_free (contents);
-	g_strfreev (lines);
+	g_free (temp);
+	if (foreign_db != NULL)
+		sqlite3_close (foreign_db);
 	return ret;
 }
 
 /*
- * ai_database_add_translation:
+ * ai_database_get_member_name:
+ *
+ * Return value: the path of an archive entry relative to the icon
+ * directory, e.g. "48x48/gpm.png", or %NULL if it is not an icon.
  */
-gboolean
-ai_database_add_translation (AiDatabase *database,
-			     const gchar *application_id,
-			     const gchar *name,
-			     const gchar *summary,
-			     const gchar *locale,
-			     GError **error)
+static const gchar *
+ai_database_get_member_name (const gchar *pathname)
+{
+	const gchar *path;
+
+	path = ai_utils_strip_root (pathname);
+	if (!g_str_has_prefix (path, AI_ICON_ARCHIVE_PREFIX "/"))
+		return NULL;
+	path += strlen (AI_ICON_ARCHIVE_PREFIX "/");
+	if (path[0] == '\0')
+		return NULL;
+	return path;
+}
+
+/*
+ * ai_database_index_icon_archive:
+ *
+ * Adds a row for every icon in the archive. When the archive is mapped and
+ * not compressed, libarchive hands back pointers into the mapping, so we
+ * can record where the data lives and read it directly later.
+ */
+static gboolean
+ai_database_index_icon_archive (AiDatabase *database, const gchar *filename, gint64 archive_id, guint *value, GError **error)
 {
 	gboolean ret = TRUE;
+	gint r;
 	gint rc;
-	gchar *statement = NULL;
-	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
-
-	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+	const gchar *path;
+	const gchar *base = NULL;
+	const void *buffer;
+	gsize base_length = 0;
+	size_t size;
+	gint64 offset;
+	gint64 length;
+	off_t block_offset;
+	struct archive *arch;
+	struct archive_entry *entry;
+	GMappedFile *mapped = NULL;
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = database->priv;
 
-	/* check database is in correct state */
-	if (!priv->locked) {
-		g_set_error (error, 1, 0, "database is not open");
+	arch = ai_utils_archive_open (filename, &mapped, error);
+	if (arch == NULL) {
 		ret = FALSE;
 		goto out;
 	}
+	if (mapped != NULL) {
+		base = g_mapped_file_get_contents (mapped);
+		base_length = g_mapped_file_get_length (mapped);
+	}
 
-	/* generate SQL */
-	statement = sqlite3_mprintf ("INSERT INTO translations (application_id, application_name, application_summary, locale) "
-				     "VALUES (%Q, %Q, %Q, %Q);", application_id, name, summary, locale);
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
-	if (rc) {
-		g_set_error (error, 1, 0, "Can't add translation: %s\n", sqlite3_errmsg (priv->db));
+	rc = sqlite3_prepare_v2 (priv->db, "INSERT OR REPLACE INTO icon_members (archive_id, path, offset, length) "
+				 "VALUES (?, ?, ?, ?)", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
 		ret = FALSE;
 		goto out;
 	}
+
+	while (TRUE) {
+		r = archive_read_next_header (arch, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot read header: %s", archive_error_string (arch));
+			ret = FALSE;
+			goto out;
+		}
+		if (archive_entry_filetype (entry) != AE_IFREG)
+			continue;
+		path = ai_database_get_member_name (archive_entry_pathname (entry));
+		if (path == NULL)
+			continue;
+
+		/* it is written below the icon directory later */
+		if (!ai_utils_path_is_safe (path)) {
+			egg_warning ("ignoring unsafe icon %s in %s", path, filename);
+			continue;
+		}
+
+		/* only a single block in the mapping can be read in place */
+		offset = -1;
+		length = archive_entry_size (entry);
+		if (base != NULL && length > 0) {
+			r = archive_read_data_block (arch, &buffer, &size, &block_offset);
+			if (r == ARCHIVE_OK && block_offset == 0 && (gint64) size == length &&
+			    (const gchar *) buffer >= base &&
+			    (const gchar *) buffer + size <= base + base_length)
+				offset = (const gchar *) buffer - base;
+		}
+
+		sqlite3_bind_int64 (stmt, 1, archive_id);
+		sqlite3_bind_text (stmt, 2, path, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64 (stmt, 3, offset);
+		sqlite3_bind_int64 (stmt, 4, length);
+		rc = sqlite3_step (stmt);
+		sqlite3_reset (stmt);
+		if (rc != SQLITE_DONE) {
+			g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto out;
+		}
+		if (value != NULL)
+			(*value)++;
+	}
 out:
-	sqlite3_free (statement);
+	if (stmt != NULL)
+		sqlite3_finalize (stmt);
+	if (arch != NULL)
+		ai_utils_archive_close (arch, mapped);
 	return ret;
 }
 
 /*
- * ai_database_add_application:
+ * ai_database_import_icon_archive:
+ *
+ * Records the icons in @filename for @repo without extracting any of them,
+ * so they can be written out on demand by ai_database_get_icon_path().
+ * The archive has to stay where it is. An uncompressed tar is best, as
+ * each icon can then be read directly rather than found by decompressing.
  */
 gboolean
-ai_database_add_application (AiDatabase *database,
-			     const gchar *application_id,
-			     const gchar *package,
-			     const gchar *categories,
-			     const gchar *repo,
-			     const gchar *icon,
-			     const gchar *name,
-			     const gchar *summary,
-			     GError **error)
+ai_database_import_icon_archive (AiDatabase *database, const gchar *filename, const gchar *repo, guint *value, GError **error)
 {
 	gboolean ret = TRUE;
 	gint rc;
-	gchar *statement = NULL;
+	gchar *path = NULL;
+	gchar *cwd;
+	gchar *statement;
+	gint64 archive_id;
 	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
 
 	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
-	g_return_val_if_fail (application_id != NULL, FALSE);
-	g_return_val_if_fail (package != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
 	g_return_val_if_fail (repo != NULL, FALSE);
-	g_return_val_if_fail (name != NULL, FALSE);
 
 	/* check database is in correct state */
 	if (!priv->locked) {
@@ -1020,207 +2746,301 @@ ai_database_add_application (AiDatabase *database,
 		ret = FALSE;
 		goto out;
 	}
+	if (priv->dbversion < 3) {
+		g_set_error (error, 1, 0, "database version %i has to be upgraded", priv->dbversion);
+		ret = FALSE;
+		goto out;
+	}
 
-	/* generate SQL */
-	statement = sqlite3_mprintf ("INSERT INTO applications (application_id, package_name, categories, "
-				     "repo_id, icon_name, application_name, application_summary) "
-				     "VALUES (%Q, %Q, %Q, %Q, %Q, %Q, %Q);",
-				     application_id, package, categories, repo, icon, name, summary);
-	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
-	if (rc) {
-		g_set_error (error, 1, 0, "Can't add application: %s\n", sqlite3_errmsg (priv->db));
+	/* the path is used long after we return */
+	if (g_path_is_absolute (filename)) {
+		path = g_strdup (filename);
+	} else {
+		cwd = g_get_current_dir ();
+		path = g_build_filename (cwd, filename, NULL);
+		g_free (cwd);
+	}
+	if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		g_set_error (error, 1, 0, "The icon archive '%s' could not be found", path);
 		ret = FALSE;
 		goto out;
 	}
-out:
+
+	/* one transaction, so a failure leaves the old index in place */
+	rc = sqlite3_exec (priv->db, "BEGIN", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto out;
+	}
+	statement = sqlite3_mprintf ("DELETE FROM icon_members WHERE archive_id IN ("
+				     "SELECT archive_id FROM icon_archives WHERE repo_id = %Q);"
+				     "DELETE FROM icon_archives WHERE repo_id = %Q;"
+				     "INSERT INTO icon_archives (repo_id, filename) VALUES (%Q, %Q);",
+				     repo, repo, repo, path);
+	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
 	sqlite3_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	archive_id = sqlite3_last_insert_rowid (priv->db);
+	ret = ai_database_index_icon_archive (database, path, archive_id, value, error);
+	if (!ret)
+		goto rollback;
+	rc = sqlite3_exec (priv->db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	goto out;
+rollback:
+	sqlite3_exec (priv->db, "ROLLBACK", NULL, NULL, NULL);
+out:
+	g_free (path);
 	return ret;
 }
 
-typedef struct {
-	const gchar	*icondir;
-	AiDatabase	*database;
-} AiDatabaseTemp;
-
-/**
- * ai_database_add_applications_sqlite_cb:
- **/
-static gint
-ai_database_add_applications_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+/*
+ * ai_database_read_member:
+ *
+ * Return value: the data of the icon, found by reading at @offset when it
+ * is known, or else by reading through the archive.
+ */
+static gchar *
+ai_database_read_member (const gchar *filename, const gchar *path, gint64 offset, gint64 length, GError **error)
 {
-	guint i;
-	gchar *col;
-	gchar *value;
-	const gchar *application_id = NULL;
-	const gchar *package = NULL;
-	const gchar *categories = NULL;
-	const gchar *repo = NULL;
-	const gchar *icon = NULL;
-	const gchar *name = NULL;
-	const gchar *summary = NULL;
-	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
-	gboolean ret;
-	gint retval = 0;
-	GError *error = NULL;
-
-	for (i=0; i<(guint)argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "application_id") == 0)
-			application_id = value;
-		else if (g_strcmp0 (col, "package_name") == 0)
-			package = value;
-		else if (g_strcmp0 (col, "categories") == 0)
-			categories = value;
-		else if (g_strcmp0 (col, "repo_id") == 0)
-			repo = value;
-		else if (g_strcmp0 (col, "icon_name") == 0)
-			icon = value;
-		else if (g_strcmp0 (col, "application_name") == 0)
-			name = value;
-		else if (g_strcmp0 (col, "application_summary") == 0)
-			summary = value;
+	gchar *data = NULL;
+	gint r = ARCHIVE_OK;
+	const gchar *name;
+	FILE *file;
+	struct archive *arch;
+	struct archive_entry *entry;
+	GMappedFile *mapped = NULL;
+
+	/* the fast path, a single read */
+	if (offset >= 0) {
+		file = fopen (filename, "rb");
+		if (file == NULL) {
+			g_set_error (error, 1, 0, "cannot open %s", filename);
+			goto out;
+		}
+		data = g_malloc (length + 1);
+		if (fseeko (file, offset, SEEK_SET) != 0 ||
+		    fread (data, 1, length, file) != (size_t) length) {
+			g_set_error (error, 1, 0, "cannot read %s from %s", path, filename);
+			g_free (data);
+			data = NULL;
+		}
+		fclose (file);
+		goto out;
 	}
 
-	/* add to the target database */
-	egg_debug ("adding %s", application_id);
-	ret = ai_database_add_application (temp->database, application_id, package, categories, repo, icon, name, summary, &error);
-	if (!ret) {
-		egg_warning ("failed to add: %s", error->message);
-		g_error_free (error);
-		retval = 1;
+	/* compressed, so we have to look for it */
+	arch = ai_utils_archive_open (filename, &mapped, error);
+	if (arch == NULL)
 		goto out;
+	while (TRUE) {
+		r = archive_read_next_header (arch, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot read header: %s", archive_error_string (arch));
+			break;
+		}
+		name = ai_database_get_member_name (archive_entry_pathname (entry));
+		if (g_strcmp0 (name, path) != 0)
+			continue;
+		data = g_malloc (length + 1);
+		if (archive_read_data (arch, data, length) != length) {
+			g_set_error (error, 1, 0, "cannot read %s: %s", path, archive_error_string (arch));
+			g_free (data);
+			data = NULL;
+		}
+		break;
 	}
+	if (data == NULL && r == ARCHIVE_EOF)
+		g_set_error (error, 1, 0, "%s is not in %s", path, filename);
+	ai_utils_archive_close (arch, mapped);
 out:
-	return retval;
+	return data;
 }
 
-/**
- * ai_database_add_translations_sqlite_cb:
- **/
-static gint
-ai_database_add_translations_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+/*
+ * ai_database_update_icon_packs:
+ *
+ * Writes an icon pack next to each icon size directory, so clients can
+ * load the whole size with one mmap rather than opening every icon. If
+ * @create is %FALSE only the packs that already exist are rebuilt, which
+ * keeps them in step with the directories after an add or remove.
+ */
+gboolean
+ai_database_update_icon_packs (AiDatabase *database, gboolean create, GError **error)
 {
+	gboolean ret = TRUE;
 	guint i;
-	gchar *col;
-	gchar *value;
-	const gchar *application_id = NULL;
-	const gchar *name = NULL;
-	const gchar *summary = NULL;
-	const gchar *locale = NULL;
-	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
-	gboolean ret;
-	gint retval = 0;
-	GError *error = NULL;
+	guint count;
+	gchar *directory;
+	gchar *filename;
+	gchar *basename;
+	gchar **icon_dirs;
+	AiDatabasePrivate *priv = database->priv;
 
-	for (i=0; i<(guint)argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "application_id") == 0)
-			application_id = value;
-		else if (g_strcmp0 (col, "locale") == 0)
-			locale = value;
-		else if (g_strcmp0 (col, "application_name") == 0)
-			name = value;
-		else if (g_strcmp0 (col, "application_summary") == 0)
-			summary = value;
+	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
+
+	if (priv->icon_path == NULL) {
+		g_set_error_literal (error, 1, 0, "no icon directory set");
+		ret = FALSE;
+		goto out;
+	}
+
+	icon_dirs = ai_config_get_icon_dirs (priv->config);
+	for (i=0; icon_dirs[i] != NULL; i++) {
+		directory = g_build_filename (priv->icon_path, icon_dirs[i], NULL);
+		basename = g_strconcat (icon_dirs[i], AI_ICON_PACK_SUFFIX, NULL);
+		filename = g_build_filename (priv->icon_path, basename, NULL);
+		g_free (basename);
+
+		/* nothing to pack, or nobody wants it packed */
+		if (!g_file_test (directory, G_FILE_TEST_IS_DIR) ||
+		    (!create && !g_file_test (filename, G_FILE_TEST_EXISTS))) {
+			g_free (directory);
+			g_free (filename);
+			continue;
+		}
+		ret = ai_icon_pack_build (directory, filename, &count, error);
+		if (ret)
+			egg_debug ("packed %i icons into %s", count, filename);
+		g_free (directory);
+		g_free (filename);
+		if (!ret)
+			goto out;
 	}
+out:
+	return ret;
+}
+
+/*
+ * ai_database_has_icon_atlas:
+ */
+static gboolean
+ai_database_has_icon_atlas (AiDatabase *database, guint size)
+{
+	gboolean ret = FALSE;
+	gint rc;
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = database->priv;
 
-	/* add to the target database */
-	ret = ai_database_add_translation (temp->database, application_id, name, summary, locale, &error);
-	if (!ret) {
-		egg_warning ("failed to add: %s", error->message);
-		g_error_free (error);
-		retval = 1;
+	rc = sqlite3_prepare_v2 (priv->db, "SELECT 1 FROM icon_atlas WHERE size = ?1 LIMIT 1", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		egg_warning ("SQL error: %s", sqlite3_errmsg (priv->db));
 		goto out;
 	}
+	sqlite3_bind_int (stmt, 1, size);
+	ret = (sqlite3_step (stmt) == SQLITE_ROW);
 out:
-	return retval;
+	sqlite3_finalize (stmt);
+	return ret;
 }
 
-/**
- * ai_database_copy_icons_sqlite_cb:
- **/
-static gint
-ai_database_copy_icons_sqlite_cb (void *data, gint argc, gchar **argv, gchar **col_name)
+/*
+ * ai_database_add_icon_atlas:
+ *
+ * Replaces the offsets for one size with the ones from @atlas.
+ */
+static gboolean
+ai_database_add_icon_atlas (AiDatabase *database, AiIconAtlas *atlas, guint size, const gchar *icon_dir, GError **error)
 {
+	gboolean ret = TRUE;
+	gint rc;
 	guint i;
-	gchar *col;
-	gchar *value;
-	const gchar *application_id = NULL;
-	const gchar *icon_name = NULL;
-	gchar *path;
-	gchar *dest;
-	GFile *file;
-	GFile *remote;
-	AiDatabaseTemp *temp = (AiDatabaseTemp *) data;
-	gboolean ret;
-	gchar *icon_name_full;
-	GError *error = NULL;
+	gchar *statement;
+	gchar *sheet;
+	GPtrArray *entries;
+	AiIconAtlasEntry *entry;
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = database->priv;
 
-	for (i=0; i<(guint)argc; i++) {
-		col = col_name[i];
-		value = argv[i];
-		if (g_strcmp0 (col, "application_id") == 0)
-			application_id = value;
-		else if (g_strcmp0 (col, "icon_name") == 0)
-			icon_name = value;
-	}
-	if (application_id == NULL || icon_name == NULL)
+	rc = sqlite3_exec (priv->db, "BEGIN", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
 		goto out;
-
-	egg_debug ("copying icon %s for application: %s", icon_name, application_id);
-	icon_name_full = g_strdup_printf ("%s.png", icon_name);
-
-	/* copy all icon sizes if they exist */
-	for (i=0; icon_sizes[i] != NULL; i++) {
-		path = g_build_filename (temp->icondir, icon_sizes[i], icon_name_full, NULL);
-		ret = g_file_test (path, G_FILE_TEST_EXISTS);
-		if (ret) {
-			dest = g_build_filename (temp->database->priv->icon_path, icon_sizes[i], icon_name_full, NULL);
-			egg_debug ("copying file %s to %s", path, dest);
-			file = g_file_new_for_path (path);
-			remote = g_file_new_for_path (dest);
-			ret = g_file_copy (file, remote, G_FILE_COPY_TARGET_DEFAULT_PERMS, NULL, NULL, NULL, &error);
-			if (!ret) {
-				egg_warning ("cannot copy %s: %s", path, error->message);
-				g_clear_error (&error);
-			}
-			g_object_unref (file);
-			g_object_unref (remote);
-			g_free (dest);
-		} else {
-			egg_debug ("failed to find icon %s", path);
+	}
+	statement = g_strdup_printf ("DELETE FROM icon_atlas WHERE size = %i", size);
+	rc = sqlite3_exec (priv->db, statement, NULL, NULL, NULL);
+	g_free (statement);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	rc = sqlite3_prepare_v2 (priv->db, "INSERT INTO icon_atlas (icon_name, size, sheet, x, y) "
+				 "VALUES (?1, ?2, ?3, ?4, ?5)", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+
+	/* the sheet is relative to the icon directory, so the tree can be moved */
+	entries = ai_icon_atlas_get_entries (atlas);
+	for (i=0; i<entries->len; i++) {
+		entry = g_ptr_array_index (entries, i);
+		sheet = ai_icon_atlas_get_sheet_filename (icon_dir, entry->sheet);
+		sqlite3_bind_text (stmt, 1, entry->name, -1, SQLITE_STATIC);
+		sqlite3_bind_int (stmt, 2, size);
+		sqlite3_bind_text (stmt, 3, sheet, -1, g_free);
+		sqlite3_bind_int (stmt, 4, entry->x);
+		sqlite3_bind_int (stmt, 5, entry->y);
+		rc = sqlite3_step (stmt);
+		sqlite3_reset (stmt);
+		if (rc != SQLITE_DONE) {
+			g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+			ret = FALSE;
+			goto rollback;
 		}
-		g_free (path);
 	}
-	g_free (icon_name_full);
+	sqlite3_finalize (stmt);
+	stmt = NULL;
+	rc = sqlite3_exec (priv->db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		ret = FALSE;
+		goto rollback;
+	}
+	goto out;
+rollback:
+	sqlite3_finalize (stmt);
+	sqlite3_exec (priv->db, "ROLLBACK", NULL, NULL, NULL);
 out:
-	return 0;
+	return ret;
 }
 
 /*
- * ai_database_import_by_name:
+ * ai_database_update_icon_atlases:
+ *
+ * Draws the icons of each fixed size into sheets next to the icon size
+ * directory, e.g. 24x24-0.png, and records where each icon is so list
+ * views can decode one image rather than one per icon. If @create is
+ * %FALSE only the sizes that already have an atlas are redrawn.
  */
 gboolean
-ai_database_import_by_name (AiDatabase *database,
-			    const gchar *filename,
-			    const gchar *icondir,
-			    const gchar *name,
-			    guint *value,
-			    GError **error)
+ai_database_update_icon_atlases (AiDatabase *database, gboolean create, GError **error)
 {
 	gboolean ret = TRUE;
-	gint rc;
-	gchar *statement = NULL;
-	gchar *error_msg;
-	sqlite3	*foreign_db = NULL;
-	AiDatabaseTemp *temp = NULL;
+	guint i;
+	guint size;
+	guint sheet;
+	gchar *directory;
+	gchar *filename;
+	gchar **icon_dirs;
+	AiIconAtlas *atlas;
 	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
 
 	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
-	g_return_val_if_fail (name != NULL, FALSE);
 
 	/* check database is in correct state */
 	if (!priv->locked) {
@@ -1228,171 +3048,247 @@ ai_database_import_by_name (AiDatabase *database,
 		ret = FALSE;
 		goto out;
 	}
+	if (priv->dbversion < 4) {
 
-	/* open database */
-	rc = sqlite3_open (filename, &foreign_db);
-	if (rc) {
-		g_set_error (error, 1, 0, "Can't open database: %s\n", sqlite3_errmsg (priv->db));
+		/* an old database cannot have an atlas to refresh */
+		if (!create)
+			goto out;
+		g_set_error (error, 1, 0, "database version %i has to be upgraded", priv->dbversion);
 		ret = FALSE;
 		goto out;
 	}
-
-	/* use a temp object as we can only pass one pointer */
-	temp = g_new0 (AiDatabaseTemp, 1);
-	temp->icondir = icondir;
-	temp->database = database;
-
-	/* select all the application data for these packages */
-	statement = g_strdup_printf ("SELECT application_id, package_name, categories, repo_id, icon_name, application_name, application_summary "
-				     "FROM applications WHERE package_name = '%s'", name);
-	rc = sqlite3_exec (foreign_db, statement, ai_database_add_applications_sqlite_cb, (void*) temp, &error_msg);
-	g_free (statement);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-		sqlite3_free (error_msg);
+	if (priv->icon_path == NULL) {
+		g_set_error_literal (error, 1, 0, "no icon directory set");
 		ret = FALSE;
 		goto out;
 	}
 
-	/* select all the translation data for these packages */
-	statement = g_strdup_printf ("SELECT application_id, application_name, application_summary, locale FROM translations WHERE EXISTS ( "
-				     "SELECT applications.application_id FROM applications WHERE "
-				     "applications.application_id = applications.application_id AND applications.package_name = '%s')", name);
-	rc = sqlite3_exec (foreign_db, statement, ai_database_add_translations_sqlite_cb, (void*) temp, &error_msg);
-	g_free (statement);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-		sqlite3_free (error_msg);
-		ret = FALSE;
-		goto out;
-	}
+	atlas = ai_icon_atlas_new ();
+	icon_dirs = ai_config_get_icon_dirs (priv->config);
+	for (i=0; icon_dirs[i] != NULL; i++) {
 
-	/* copy all the icons */
-	if (icondir != NULL) {
-		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE package_name = '%s'", name);
-		rc = sqlite3_exec (foreign_db, statement, ai_database_copy_icons_sqlite_cb, (void*) temp, &error_msg);
-		g_free (statement);
-		if (rc != SQLITE_OK) {
-			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-			sqlite3_free (error_msg);
-			ret = FALSE;
-			goto out;
+		/* a sheet needs a fixed cell size */
+		size = atoi (icon_dirs[i]);
+		if (size == 0)
+			continue;
+		directory = g_build_filename (priv->icon_path, icon_dirs[i], NULL);
+		if (!g_file_test (directory, G_FILE_TEST_IS_DIR) ||
+		    (!create && !ai_database_has_icon_atlas (database, size))) {
+			g_free (directory);
+			continue;
 		}
-	}
 
-	/* get additions */
-	if (value != NULL)
-		*value = 1;
+		/* the sheets go next to the directory, e.g. "24x24-0.png" */
+		ret = ai_icon_atlas_build (atlas, directory, size, directory, error);
+		if (ret)
+			ret = ai_database_add_icon_atlas (database, atlas, size, icon_dirs[i], error);
+
+		/* the atlas may have shrunk */
+		for (sheet = ai_icon_atlas_get_sheets (atlas); ret; sheet++) {
+			filename = ai_icon_atlas_get_sheet_filename (directory, sheet);
+			if (g_unlink (filename) != 0) {
+				g_free (filename);
+				break;
+			}
+			egg_debug ("removed stale sheet %s", filename);
+			g_free (filename);
+		}
+		g_free (directory);
+		if (!ret)
+			break;
+		egg_debug ("%i icons in the %s atlas", ai_icon_atlas_get_entries (atlas)->len, icon_dirs[i]);
+	}
+	g_object_unref (atlas);
 out:
-	g_free (temp);
-	if (foreign_db != NULL)
-		sqlite3_close (foreign_db);
 	return ret;
 }
 
 /*
- * ai_database_import_by_repo:
+ * ai_database_get_icon_atlas:
+ * @x: (out): the left of the icon in the sheet
+ * @y: (out): the top of the icon in the sheet
+ *
+ * Finds the icon in the atlas for @size, the icon is @size pixels square.
+ *
+ * Return value: the filename of the sheet, or %NULL if the icon is not in an atlas
  */
-gboolean
-ai_database_import_by_repo (AiDatabase *database,
-			    const gchar *filename,
-			    const gchar *icondir,
-			    const gchar *repo,
-			    guint *value,
-			    GError **error)
+gchar *
+ai_database_get_icon_atlas (AiDatabase *database, const gchar *icon_name, guint size, guint *x, guint *y, GError **error)
 {
-	gboolean ret = TRUE;
 	gint rc;
-	gchar *statement = NULL;
-	gchar *error_msg;
-	sqlite3	*foreign_db = NULL;
-	AiDatabaseTemp *temp = NULL;
+	gchar *filename = NULL;
+	sqlite3_stmt *stmt = NULL;
 	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
 
-	g_return_val_if_fail (AI_IS_DATABASE (database), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
-	g_return_val_if_fail (repo != NULL, FALSE);
+	g_return_val_if_fail (AI_IS_DATABASE (database), NULL);
+	g_return_val_if_fail (icon_name != NULL, NULL);
 
 	/* check database is in correct state */
 	if (!priv->locked) {
 		g_set_error (error, 1, 0, "database is not open");
-		ret = FALSE;
 		goto out;
 	}
-
-	/* database does not exist */
-	if (!g_file_test (filename, G_FILE_TEST_EXISTS)) {
-		g_set_error (error, 1, 0, "The source filename '%s' could not be found", filename);
-		ret = FALSE;
+	if (priv->dbversion < 4) {
+		g_set_error (error, 1, 0, "database version %i has no icon atlas", priv->dbversion);
 		goto out;
 	}
-
-	/* icondir do not exist */
-	if (icondir != NULL && !g_file_test (icondir, G_FILE_TEST_IS_DIR)) {
-		g_set_error (error, 1, 0, "The icon directory '%s' could not be found", icondir);
-		ret = FALSE;
+	if (priv->icon_path == NULL) {
+		g_set_error_literal (error, 1, 0, "no icon directory set");
 		goto out;
 	}
 
-	/* open database */
-	rc = sqlite3_open (filename, &foreign_db);
-	if (rc) {
-		g_set_error (error, 1, 0, "Can't open database: %s\n", sqlite3_errmsg (priv->db));
-		ret = FALSE;
+	rc = sqlite3_prepare_v2 (priv->db, "SELECT sheet, x, y FROM icon_atlas "
+				 "WHERE icon_name = ?1 AND size = ?2", -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
 		goto out;
 	}
+	sqlite3_bind_text (stmt, 1, icon_name, -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt, 2, size);
+	rc = sqlite3_step (stmt);
+	if (rc != SQLITE_ROW) {
+		g_set_error (error, 1, 0, "no %i pixel atlas icon for %s", size, icon_name);
+		goto out;
+	}
+	filename = g_build_filename (priv->icon_path, (const gchar *) sqlite3_column_text (stmt, 0), NULL);
+	if (x != NULL)
+		*x = sqlite3_column_int (stmt, 1);
+	if (y != NULL)
+		*y = sqlite3_column_int (stmt, 2);
+out:
+	sqlite3_finalize (stmt);
+	return filename;
+}
 
-	/* use a temp object as we can only pass one pointer */
-	temp = g_new0 (AiDatabaseTemp, 1);
-	temp->icondir = icondir;
-	temp->database = database;
+/*
+ * ai_database_icon_is_current:
+ *
+ * Return value: %TRUE if @filename exists and is not older than @archive,
+ * so it was not written from an archive that has since been replaced
+ */
+static gboolean
+ai_database_icon_is_current (const gchar *filename, const gchar *archive)
+{
+	struct stat icon_buf;
+	struct stat archive_buf;
+
+	if (g_stat (filename, &icon_buf) != 0)
+		return FALSE;
+	if (g_stat (archive, &archive_buf) != 0)
+		return TRUE;
+	return icon_buf.st_mtime >= archive_buf.st_mtime;
+}
 
-	/* select all the application data for these packages */
-	statement = g_strdup_printf ("SELECT application_id, package_name, categories, repo_id, icon_name, application_name, application_summary "
-				     "FROM applications WHERE repo_id = '%s'", repo);
-	rc = sqlite3_exec (foreign_db, statement, ai_database_add_applications_sqlite_cb, (void*) temp, &error_msg);
-	g_free (statement);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-		sqlite3_free (error_msg);
-		ret = FALSE;
+/*
+ * ai_database_get_icon_path:
+ *
+ * Gets the icon for an application, writing it out of the icon archive the
+ * first time it is asked for. The icon directory is used if we can write
+ * to it, otherwise the icon is cached for this user.
+ *
+ * Return value: the filename of the icon, or %NULL if there is none
+ */
+gchar *
+ai_database_get_icon_path (AiDatabase *database, const gchar *application_id, guint size, GError **error)
+{
+	gboolean ret;
+	gint rc;
+	gchar *filename = NULL;
+	gchar *size_dir = NULL;
+	gchar *member = NULL;
+	gchar *archive = NULL;
+	gchar *cache_dir = NULL;
+	gchar *data = NULL;
+	gchar *tmp;
+	gint64 offset = -1;
+	gint64 length = 0;
+	sqlite3_stmt *stmt = NULL;
+	AiDatabasePrivate *priv = AI_DATABASE (database)->priv;
+
+	g_return_val_if_fail (AI_IS_DATABASE (database), NULL);
+	g_return_val_if_fail (application_id != NULL, NULL);
+
+	/* check database is in correct state */
+	if (!priv->locked) {
+		g_set_error (error, 1, 0, "database is not open");
+		goto out;
+	}
+	if (priv->dbversion < 3) {
+		g_set_error (error, 1, 0, "database version %i has no icon archives", priv->dbversion);
 		goto out;
 	}
 
-	/* select all the translation data for these packages */
-	statement = g_strdup_printf ("SELECT application_id, application_name, application_summary, locale FROM translations WHERE EXISTS ( "
-				     "SELECT applications.application_id FROM applications WHERE "
-				     "applications.application_id = applications.application_id AND applications.repo_id = '%s')", repo);
-	rc = sqlite3_exec (foreign_db, statement, ai_database_add_translations_sqlite_cb, (void*) temp, &error_msg);
-	g_free (statement);
+	/* any extension will do, so search the range "48x48/name." to "48x48/name/" */
+	size_dir = ai_config_icon_size_to_dir (size);
+	rc = sqlite3_prepare_v2 (priv->db, "SELECT m.path, m.offset, m.length, a.filename "
+				 "FROM applications p, icon_archives a, icon_members m "
+				 "WHERE p.application_id = ?1 AND a.repo_id = p.repo_id AND m.archive_id = a.archive_id "
+				 "AND m.path >= ?2 || '/' || p.icon_name || '.' "
+				 "AND m.path < ?2 || '/' || p.icon_name || '/' "
+				 "ORDER BY m.path LIMIT 1", -1, &stmt, NULL);
 	if (rc != SQLITE_OK) {
-		g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-		sqlite3_free (error_msg);
-		ret = FALSE;
+		g_set_error (error, 1, 0, "SQL error: %s", sqlite3_errmsg (priv->db));
+		goto out;
+	}
+	sqlite3_bind_text (stmt, 1, application_id, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 2, size_dir, -1, SQLITE_STATIC);
+	rc = sqlite3_step (stmt);
+	if (rc != SQLITE_ROW) {
+		g_set_error (error, 1, 0, "no %s icon for %s", size_dir, application_id);
 		goto out;
 	}
+	member = g_strdup ((const gchar *) sqlite3_column_text (stmt, 0));
+	offset = sqlite3_column_int64 (stmt, 1);
+	length = sqlite3_column_int64 (stmt, 2);
+	archive = g_strdup ((const gchar *) sqlite3_column_text (stmt, 3));
 
-	/* copy all the icons */
-	if (icondir != NULL) {
-		statement = g_strdup_printf ("SELECT application_id, icon_name FROM applications WHERE repo_id = '%s'", repo);
-		rc = sqlite3_exec (foreign_db, statement, ai_database_copy_icons_sqlite_cb, (void*) temp, &error_msg);
-		g_free (statement);
-		if (rc != SQLITE_OK) {
-			g_set_error (error, 1, 0, "SQL error: %s\n", error_msg);
-			sqlite3_free (error_msg);
-			ret = FALSE;
+	/* an index from an older version may still have one */
+	if (!ai_utils_path_is_safe (member)) {
+		g_set_error (error, 1, 0, "unsafe icon path %s in %s", member, archive);
+		goto out;
+	}
+
+	/* already written out, by us or an earlier full import */
+	if (priv->icon_path != NULL) {
+		filename = g_build_filename (priv->icon_path, member, NULL);
+		if (ai_database_icon_is_current (filename, archive))
 			goto out;
+		if (g_access (priv->icon_path, W_OK) != 0) {
+			g_free (filename);
+			filename = NULL;
 		}
 	}
+	if (filename == NULL) {
+		cache_dir = g_build_filename (g_get_user_cache_dir (), "app-install", "icons", NULL);
+		filename = g_build_filename (cache_dir, member, NULL);
+		if (ai_database_icon_is_current (filename, archive))
+			goto out;
+	}
 
-	/* get additions */
-	if (value != NULL)
-		*value = 1;
+	/* write it out for next time */
+	egg_debug ("writing %s from %s", member, archive);
+	data = ai_database_read_member (archive, member, offset, length, error);
+	if (data == NULL)
+		goto failed;
+	tmp = g_path_get_dirname (filename);
+	g_mkdir_with_parents (tmp, 0755);
+	g_free (tmp);
+	ret = g_file_set_contents (filename, data, length, error);
+	if (!ret)
+		goto failed;
+	goto out;
+failed:
+	g_free (filename);
+	filename = NULL;
 out:
-	g_free (temp);
-	if (foreign_db != NULL)
-		sqlite3_close (foreign_db);
-	return ret;
+	if (stmt != NULL)
+		sqlite3_finalize (stmt);
+	g_free (size_dir);
+	g_free (member);
+	g_free (archive);
+	g_free (cache_dir);
+	g_free (data);
+	return filename;
 }
 
 /*
@@ -1508,9 +3404,22 @@ ai_database_class_init (AiDatabaseClass *klass)
 static void
 ai_database_init (AiDatabase *database)
 {
+	GError *error = NULL;
+
 	database->priv = AI_DATABASE_GET_PRIVATE (database);
 	database->priv->filename = NULL;
 	database->priv->icon_path = NULL;
+	database->priv->completions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
+	database->priv->trigrams = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_object_unref);
+	database->priv->cache = g_hash_table_new (g_str_hash, g_str_equal);
+	database->priv->cache_queue = g_queue_new ();
+
+	/* the defaults are still usable if this fails */
+	database->priv->config = ai_config_new ();
+	if (!ai_config_load (database->priv->config, NULL, &error)) {
+		egg_warning ("failed to load config: %s", error->message);
+		g_error_free (error);
+	}
 }
 
 /*
@@ -1524,8 +3433,16 @@ ai_database_finalize (GObject *object)
 
 	g_free (priv->filename);
 	g_free (priv->icon_path);
+	g_free (priv->chain_locale);
+	g_object_unref (priv->config);
+	g_hash_table_unref (priv->completions);
+	g_hash_table_unref (priv->trigrams);
+	ai_database_cache_clear (database);
+	g_hash_table_unref (priv->cache);
+	g_queue_free (priv->cache_queue);
 	if (priv->locked) {
 		egg_warning ("YOU HAVE TO MANUALLY CALL ai_database_close()!!!");
+		sqlite3_finalize (priv->data_version_stmt);
 		sqlite3_close (priv->db);
 	}
 
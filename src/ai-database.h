@@ -24,6 +24,8 @@
 
 #include <glib-object.h>
 
+#include "ai-config.h"
+
 G_BEGIN_DECLS
 
 #define AI_TYPE_DATABASE		(ai_database_get_type ())
@@ -56,6 +58,13 @@ gboolean	 ai_database_set_filename		(AiDatabase	*database,
 gboolean	 ai_database_set_icon_path		(AiDatabase	*database,
 							 const gchar	*icon_path,
 							 GError		**error);
+void		 ai_database_set_config			(AiDatabase	*database,
+							 AiConfig	*config);
+void		 ai_database_set_cache_size		(AiDatabase	*database,
+							 guint		 cache_size);
+void		 ai_database_get_cache_stats		(AiDatabase	*database,
+							 guint		*hits,
+							 guint		*misses);
 gboolean	 ai_database_open			(AiDatabase	*database,
 							 gboolean	 synchronous,
 							 GError		**error);
@@ -94,6 +103,25 @@ GPtrArray	*ai_database_search_by_name_locale	(AiDatabase	*database,
 							 const gchar	*value,
 							 const gchar	*locale,
 							 GError		**error);
+GPtrArray	*ai_database_list_by_name_locale	(AiDatabase	*database,
+							 const gchar	*locale,
+							 guint		 offset,
+							 guint		 limit,
+							 GError		**error);
+GPtrArray	*ai_database_search_by_name_fuzzy	(AiDatabase	*database,
+							 const gchar	*value,
+							 const gchar	*locale,
+							 guint		 limit,
+							 GError		**error);
+gchar		**ai_database_complete			(AiDatabase	*database,
+							 const gchar	*prefix,
+							 const gchar	*locale,
+							 guint		 limit,
+							 GError		**error);
+gboolean	 ai_database_update_display		(AiDatabase	*database,
+							 GError		**error);
+gboolean	 ai_database_refresh_display		(AiDatabase	*database,
+							 GError		**error);
 gboolean	 ai_database_import			(AiDatabase	*database,
 							 const gchar	*filename,
 							 guint		*value,
@@ -125,6 +153,27 @@ gboolean	 ai_database_import_by_repo		(AiDatabase	*database,
 							 const gchar	*repo,
 							 guint		*value,
 							 GError		**error);
+gboolean	 ai_database_import_icon_archive	(AiDatabase	*database,
+							 const gchar	*filename,
+							 const gchar	*repo,
+							 guint		*value,
+							 GError		**error);
+gboolean	 ai_database_update_icon_packs		(AiDatabase	*database,
+							 gboolean	 create,
+							 GError		**error);
+gboolean	 ai_database_update_icon_atlases	(AiDatabase	*database,
+							 gboolean	 create,
+							 GError		**error);
+gchar		*ai_database_get_icon_atlas		(AiDatabase	*database,
+							 const gchar	*icon_name,
+							 guint		 size,
+							 guint		*x,
+							 guint		*y,
+							 GError		**error);
+gchar		*ai_database_get_icon_path		(AiDatabase	*database,
+							 const gchar	*application_id,
+							 guint		 size,
+							 GError		**error);
 gboolean	 ai_database_set_installed_by_id	(AiDatabase	*database,
 							 const gchar	*application_id,
 							 gboolean	 value,
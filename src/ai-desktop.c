@@ -0,0 +1,359 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-desktop.h"
+
+static void     ai_desktop_finalize	(GObject     *object);
+
+#define AI_DESKTOP_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_DESKTOP, AiDesktopPrivate))
+
+/*
+ * AiDesktopEntry:
+ *
+ * All the strings point into the parsed buffer, which is NUL-terminated
+ * in place so nothing is copied per key.
+ */
+typedef struct {
+	const gchar	*key;
+	const gchar	*locale;
+	const gchar	*value;
+} AiDesktopEntry;
+
+/*
+ * AiDesktopPrivate:
+ *
+ * Private #AiDesktop data
+ */
+struct _AiDesktopPrivate
+{
+	gchar				*contents;
+	GArray				*entries;
+	GHashTable			*index;
+	GHashTable			*locales_seen;
+	GPtrArray			*locales;
+};
+
+G_DEFINE_TYPE (AiDesktop, ai_desktop, G_TYPE_OBJECT)
+
+/*
+ * ai_desktop_entry_hash:
+ */
+static guint
+ai_desktop_entry_hash (gconstpointer data)
+{
+	const AiDesktopEntry *entry = (const AiDesktopEntry *) data;
+	guint hash;
+
+	hash = g_str_hash (entry->key);
+	if (entry->locale != NULL)
+		hash = (hash * 31) + g_str_hash (entry->locale);
+	return hash;
+}
+
+/*
+ * ai_desktop_entry_equal:
+ */
+static gboolean
+ai_desktop_entry_equal (gconstpointer a, gconstpointer b)
+{
+	const AiDesktopEntry *entry1 = (const AiDesktopEntry *) a;
+	const AiDesktopEntry *entry2 = (const AiDesktopEntry *) b;
+
+	if (strcmp (entry1->key, entry2->key) != 0)
+		return FALSE;
+	return g_strcmp0 (entry1->locale, entry2->locale) == 0;
+}
+
+/*
+ * ai_desktop_reset:
+ */
+static void
+ai_desktop_reset (AiDesktop *desktop)
+{
+	AiDesktopPrivate *priv = desktop->priv;
+
+	g_hash_table_remove_all (priv->index);
+	g_hash_table_remove_all (priv->locales_seen);
+	g_ptr_array_set_size (priv->locales, 0);
+	g_array_set_size (priv->entries, 0);
+	g_free (priv->contents);
+	priv->contents = NULL;
+}
+
+/*
+ * ai_desktop_strip:
+ *
+ * Removes leading and trailing whitespace without copying.
+ */
+static gchar *
+ai_desktop_strip (gchar *start, gchar *end)
+{
+	while (start < end && g_ascii_isspace (*start))
+		start++;
+	while (end > start && g_ascii_isspace (end[-1]))
+		end--;
+	*end = '\0';
+	return start;
+}
+
+/*
+ * ai_desktop_parse:
+ *
+ * Parses @data in a single pass. The buffer has to be writable and must
+ * be followed by at least one byte we can turn into a NUL.
+ */
+static gboolean
+ai_desktop_parse (AiDesktop *desktop, gchar *data, gsize length, GError **error)
+{
+	gboolean ret = TRUE;
+	gboolean in_group = FALSE;
+	gboolean found_group = FALSE;
+	gchar *line;
+	gchar *eol;
+	gchar *end = data + length;
+	gchar *p = data;
+	gchar *equals;
+	gchar *bracket;
+	gchar *key;
+	guint i;
+	AiDesktopEntry entry;
+	AiDesktopEntry *tmp;
+	AiDesktopPrivate *priv = desktop->priv;
+
+	while (p < end) {
+		line = p;
+		eol = memchr (p, '\n', end - p);
+		if (eol == NULL)
+			eol = end;
+		p = eol + 1;
+		line = ai_desktop_strip (line, eol);
+
+		/* blank or comment */
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+
+		/* only keys in the main group are interesting */
+		if (line[0] == '[') {
+			in_group = (strcmp (line, "[Desktop Entry]") == 0);
+			if (in_group)
+				found_group = TRUE;
+			continue;
+		}
+		if (!in_group)
+			continue;
+
+		/* values may contain '=' and '[', so only split on the first '=' */
+		equals = strchr (line, '=');
+		if (equals == NULL)
+			continue;
+		entry.value = ai_desktop_strip (equals + 1, equals + 1 + strlen (equals + 1));
+		key = ai_desktop_strip (line, equals);
+		entry.locale = NULL;
+
+		/* Key[locale] */
+		bracket = strchr (key, '[');
+		if (bracket != NULL) {
+			i = strlen (bracket);
+			if (bracket[i-1] != ']') {
+				egg_debug ("ignoring malformed key %s", key);
+				continue;
+			}
+			bracket[i-1] = '\0';
+			*bracket = '\0';
+			entry.locale = bracket + 1;
+			ai_desktop_strip (key, bracket);
+
+			/* keep an ordered list of unique locales */
+			if (g_hash_table_lookup (priv->locales_seen, entry.locale) == NULL) {
+				g_hash_table_insert (priv->locales_seen, (gpointer) entry.locale, (gpointer) entry.locale);
+				g_ptr_array_add (priv->locales, (gpointer) entry.locale);
+			}
+		}
+		entry.key = key;
+		g_array_append_val (priv->entries, entry);
+	}
+
+	if (!found_group) {
+		g_set_error_literal (error, 1, 0, "no [Desktop Entry] group");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* the array does not grow any more, so it is safe to index into it */
+	for (i=0; i<priv->entries->len; i++) {
+		tmp = &g_array_index (priv->entries, AiDesktopEntry, i);
+		g_hash_table_insert (priv->index, tmp, tmp);
+	}
+out:
+	return ret;
+}
+
+/*
+ * ai_desktop_load_from_file:
+ *
+ * Loads a desktop file. The parser splits the contents in place, so they
+ * are read into memory rather than mapped, which would need the file to
+ * be writable.
+ */
+gboolean
+ai_desktop_load_from_file (AiDesktop *desktop, const gchar *filename, GError **error)
+{
+	gboolean ret = FALSE;
+	gsize length;
+	GError *error_local = NULL;
+	AiDesktopPrivate *priv = desktop->priv;
+
+	g_return_val_if_fail (AI_IS_DESKTOP (desktop), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	ai_desktop_reset (desktop);
+
+	/* the contents are always NUL terminated */
+	ret = g_file_get_contents (filename, &priv->contents, &length, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "cannot read %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	ret = ai_desktop_parse (desktop, priv->contents, length, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "cannot parse %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+out:
+	return ret;
+}
+
+/*
+ * ai_desktop_load_from_data:
+ */
+gboolean
+ai_desktop_load_from_data (AiDesktop *desktop, const gchar *data, gsize length, GError **error)
+{
+	AiDesktopPrivate *priv = desktop->priv;
+
+	g_return_val_if_fail (AI_IS_DESKTOP (desktop), FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	ai_desktop_reset (desktop);
+	priv->contents = g_strndup (data, length);
+	return ai_desktop_parse (desktop, priv->contents, strlen (priv->contents), error);
+}
+
+/*
+ * ai_desktop_get_value:
+ *
+ * Return value: the value for the key, or %NULL. Do not free.
+ */
+const gchar *
+ai_desktop_get_value (AiDesktop *desktop, const gchar *key, const gchar *locale)
+{
+	AiDesktopEntry tmp;
+	const AiDesktopEntry *entry;
+
+	g_return_val_if_fail (AI_IS_DESKTOP (desktop), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	tmp.key = key;
+	tmp.locale = locale;
+	entry = g_hash_table_lookup (desktop->priv->index, &tmp);
+	if (entry == NULL)
+		return NULL;
+	return entry->value;
+}
+
+/**
+ * ai_desktop_get_locales:
+ *
+ * Return value: (element-type utf8) (transfer none): the unique locales
+ * in file order. Do not free.
+ */
+GPtrArray *
+ai_desktop_get_locales (AiDesktop *desktop)
+{
+	g_return_val_if_fail (AI_IS_DESKTOP (desktop), NULL);
+	return desktop->priv->locales;
+}
+
+/*
+ * ai_desktop_class_init:
+ */
+static void
+ai_desktop_class_init (AiDesktopClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_desktop_finalize;
+	g_type_class_add_private (klass, sizeof (AiDesktopPrivate));
+}
+
+/*
+ * ai_desktop_init:
+ */
+static void
+ai_desktop_init (AiDesktop *desktop)
+{
+	desktop->priv = AI_DESKTOP_GET_PRIVATE (desktop);
+	desktop->priv->entries = g_array_new (FALSE, FALSE, sizeof (AiDesktopEntry));
+	desktop->priv->index = g_hash_table_new (ai_desktop_entry_hash, ai_desktop_entry_equal);
+	desktop->priv->locales_seen = g_hash_table_new (g_str_hash, g_str_equal);
+	desktop->priv->locales = g_ptr_array_new ();
+}
+
+/*
+ * ai_desktop_finalize:
+ */
+static void
+ai_desktop_finalize (GObject *object)
+{
+	AiDesktop *desktop = AI_DESKTOP (object);
+	AiDesktopPrivate *priv = desktop->priv;
+
+	ai_desktop_reset (desktop);
+	g_hash_table_unref (priv->index);
+	g_hash_table_unref (priv->locales_seen);
+	g_ptr_array_unref (priv->locales);
+	g_array_free (priv->entries, TRUE);
+
+	G_OBJECT_CLASS (ai_desktop_parent_class)->finalize (object);
+}
+
+/*
+ * ai_desktop_new:
+ *
+ * Return value: a new AiDesktop object.
+ */
+AiDesktop *
+ai_desktop_new (void)
+{
+	AiDesktop *desktop;
+	desktop = g_object_new (AI_TYPE_DESKTOP, NULL);
+	return AI_DESKTOP (desktop);
+}
+
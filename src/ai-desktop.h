@@ -0,0 +1,68 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_DESKTOP_H
+#define __AI_DESKTOP_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_DESKTOP		(ai_desktop_get_type ())
+#define AI_DESKTOP(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_DESKTOP, AiDesktop))
+#define AI_DESKTOP_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_DESKTOP, AiDesktopClass))
+#define AI_IS_DESKTOP(o)	(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_DESKTOP))
+#define AI_IS_DESKTOP_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_DESKTOP))
+#define AI_DESKTOP_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_DESKTOP, AiDesktopClass))
+
+typedef struct _AiDesktopPrivate	AiDesktopPrivate;
+typedef struct _AiDesktop		AiDesktop;
+typedef struct _AiDesktopClass		AiDesktopClass;
+
+struct _AiDesktop
+{
+	 GObject		 parent;
+	 AiDesktopPrivate	*priv;
+};
+
+struct _AiDesktopClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_desktop_get_type		  	(void);
+AiDesktop	*ai_desktop_new				(void);
+gboolean	 ai_desktop_load_from_file		(AiDesktop	*desktop,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 ai_desktop_load_from_data		(AiDesktop	*desktop,
+							 const gchar	*data,
+							 gsize		 length,
+							 GError		**error);
+const gchar	*ai_desktop_get_value			(AiDesktop	*desktop,
+							 const gchar	*key,
+							 const gchar	*locale);
+GPtrArray	*ai_desktop_get_locales			(AiDesktop	*desktop);
+
+G_END_DECLS
+
+#endif /* __AI_DESKTOP_H */
+
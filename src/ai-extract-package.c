@@ -37,6 +37,8 @@ main (int argc, char *argv[])
 	GOptionContext *context;
 	gchar *package = NULL;
 	gchar *directory = NULL;
+	gchar **includes = NULL;
+	gint block_size = 0;
 	GError *error = NULL;
 
 	const GOptionEntry options[] = {
@@ -46,6 +48,12 @@ main (int argc, char *argv[])
 		{ "directory", 'd', 0, G_OPTION_ARG_STRING, &directory,
 		  /* TRANSLATORS: the icon directory */
 		  "Directory to decompress to", NULL},
+		{ "include", 'i', 0, G_OPTION_ARG_STRING_ARRAY, &includes,
+		  /* TRANSLATORS: only extract some files */
+		  "Only decompress files matching this pattern, e.g. 'usr/share/icons/*'", NULL},
+		{ "block-size", 'b', 0, G_OPTION_ARG_INT, &block_size,
+		  /* TRANSLATORS: only used when the package cannot be mapped */
+		  "Read size in bytes for packages that cannot be mapped", NULL},
 		{ NULL}
 	};
 
@@ -67,8 +75,16 @@ main (int argc, char *argv[])
 		goto out;
 	}
 
+	if (block_size < 0) {
+		g_print ("%s\n", "the block size must be positive");
+		retval = 1;
+		goto out;
+	}
+	if (block_size > 0)
+		ai_utils_set_block_size (block_size);
+
 	/* extract it */
-	ret = ai_utils_extract_archive (package, directory, &error);
+	ret = ai_utils_extract_archive_filtered (package, directory, includes, &error);
 	if (!ret) {
 		g_print ("%s: %s\n", "failed to decompress", error->message);
 		retval = 1;
@@ -77,6 +93,7 @@ main (int argc, char *argv[])
 out:
 	g_free (package);
 	g_free (directory);
+	g_strfreev (includes);
 	return retval;
 }
 
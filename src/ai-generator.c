@@ -0,0 +1,695 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "egg-debug.h"
+
+#include "ai-common.h"
+#include "ai-generator.h"
+#include "ai-icon-scale.h"
+#include "ai-whitelist.h"
+
+/*
+ * ai_generator_create_icon_directories:
+ */
+gboolean
+ai_generator_create_icon_directories (AiConfig *config, const gchar *directory)
+{
+	gboolean ret;
+	GError *error = NULL;
+	GFile *file;
+	gchar *path;
+	gchar **icon_dirs;
+	guint i;
+
+	/* create main directory */
+	ret = g_file_test (directory, G_FILE_TEST_IS_DIR);
+	if (!ret) {
+		file = g_file_new_for_path (directory);
+		ret = g_file_make_directory (file, NULL, &error);
+		g_object_unref (file);
+		if (!ret) {
+			egg_warning ("cannot create %s: %s", directory, error->message);
+			g_error_free (error);
+			goto out;
+		}
+	}
+
+	/* make sub directories */
+	icon_dirs = ai_config_get_icon_dirs (config);
+	for (i=0; icon_dirs[i] != NULL; i++) {
+		path = g_build_filename (directory, icon_dirs[i], NULL);
+		ret = g_file_test (path, G_FILE_TEST_IS_DIR);
+		if (!ret) {
+			egg_debug ("creating %s", path);
+			file = g_file_new_for_path (path);
+			ret = g_file_make_directory (file, NULL, &error);
+			if (!ret) {
+				egg_warning ("cannot create %s: %s", path, error->message);
+				g_clear_error (&error);
+			}
+			g_object_unref (file);
+		}
+		g_free (path);
+	}
+out:
+	return ret;
+}
+
+/*
+ * ai_generator_get_application_id:
+ */
+gchar *
+ai_generator_get_application_id (const gchar *filename)
+{
+	gchar *find;
+	gchar *application_id;
+
+	find = g_strrstr (filename, "/");
+	application_id = g_strdup (find+1);
+	find = g_strrstr (application_id, ".");
+	*find = '\0';
+	return application_id;
+}
+
+/*
+ * ai_generator_get_package_name:
+ *
+ * Gets the package name from a filename like "gnome-packagekit-2.29.1-1.fc13.i686.rpm".
+ *
+ * Return value: the package name, or %NULL if the filename is not in NEVRA form
+ */
+gchar *
+ai_generator_get_package_name (const gchar *filename)
+{
+	gchar *basename;
+	gchar *find;
+	gchar *name = NULL;
+	guint i;
+
+	basename = g_path_get_basename (filename);
+	if (!g_str_has_suffix (basename, ".rpm"))
+		goto out;
+	basename[strlen (basename) - 4] = '\0';
+
+	/* remove the arch */
+	find = g_strrstr (basename, ".");
+	if (find == NULL)
+		goto out;
+	*find = '\0';
+
+	/* remove the version and release */
+	for (i=0; i<2; i++) {
+		find = g_strrstr (basename, "-");
+		if (find == NULL || find == basename)
+			goto out;
+		*find = '\0';
+	}
+	name = g_strdup (basename);
+out:
+	g_free (basename);
+	return name;
+}
+
+/*
+ * ai_generator_add_application:
+ */
+gboolean
+ai_generator_add_application (AiDatabase *db, AiDesktop *desktop, const gchar *repo, const gchar *package, const gchar *application_id, GError **error)
+{
+	const gchar *name;
+	const gchar *comment;
+	const gchar *icon_name;
+	const gchar *categories;
+	gboolean ret;
+
+	name = ai_desktop_get_value (desktop, "Name", NULL);
+	icon_name = ai_desktop_get_value (desktop, "Icon", NULL);
+	comment = ai_desktop_get_value (desktop, "Comment", NULL);
+	categories = ai_desktop_get_value (desktop, "Categories", NULL);
+
+	/* remove invalid icons */
+	if (icon_name != NULL &&
+	    (g_str_has_prefix (icon_name, "/") ||
+	     g_str_has_suffix (icon_name, ".png")))
+		icon_name = NULL;
+
+	egg_debug ("application_id=%s, name=%s, comment=%s, icon=%s, categories=%s", application_id, name, comment, icon_name, categories);
+	ret = ai_database_add_application (db, application_id, package, categories, repo, icon_name, name, comment, error);
+	return ret;
+}
+
+/*
+ * ai_generator_add_translations:
+ */
+gboolean
+ai_generator_add_translations (AiDatabase *db, AiDesktop *desktop, const gchar *application_id, GError **error)
+{
+	const gchar *name;
+	const gchar *comment;
+	const gchar *locale;
+	GPtrArray *locales;
+	guint i;
+	gboolean ret = TRUE;
+
+	/* get list of locales in this file */
+	locales = ai_desktop_get_locales (desktop);
+	for (i=0; i<locales->len; i++) {
+		locale = g_ptr_array_index (locales, i);
+		name = ai_desktop_get_value (desktop, "Name", locale);
+		comment = ai_desktop_get_value (desktop, "Comment", locale);
+
+		/* append the application data to the sql string if either not null */
+		if (name != NULL || comment != NULL) {
+			ret = ai_database_add_translation (db, application_id, name, comment, locale, error);
+			if (!ret)
+				goto out;
+		}
+	}
+out:
+	return ret;
+}
+
+/*
+ * ai_generator_get_missing_sizes:
+ *
+ * Return value: the sizes we have to ship but could not copy, zero terminated
+ */
+GArray *
+ai_generator_get_missing_sizes (AiConfig *config, AiIconIndex *icon_index, const gchar *icon_name)
+{
+	GArray *missing;
+	GArray *copy_sizes;
+	GArray *ensure_sizes;
+	guint size;
+	guint i, j;
+	gboolean copied;
+
+	missing = g_array_new (TRUE, TRUE, sizeof (guint));
+	copy_sizes = ai_config_get_copy_icon_sizes (config);
+	ensure_sizes = ai_config_get_ensure_icon_sizes (config);
+	for (i=0; i<ensure_sizes->len; i++) {
+		size = g_array_index (ensure_sizes, guint, i);
+
+		/* was this size copied from hicolor */
+		copied = FALSE;
+		for (j=0; j<copy_sizes->len; j++) {
+			if (g_array_index (copy_sizes, guint, j) == size) {
+				copied = (ai_icon_index_lookup_exact (icon_index, icon_name, "hicolor", size) != NULL);
+				break;
+			}
+		}
+		if (!copied)
+			g_array_append_val (missing, size);
+	}
+	return missing;
+}
+
+/*
+ * ai_generator_find_icon:
+ *
+ * Return value: the full path of the best icon to scale, or %NULL
+ */
+gchar *
+ai_generator_find_icon (AiIconIndex *icon_index, const gchar *root, const gchar *icon_name, guint size)
+{
+	gchar *path = NULL;
+	const AiIconIndexItem *item;
+
+	item = ai_icon_index_lookup (icon_index, icon_name, size);
+	if (item != NULL) {
+		path = g_build_filename (root, item->path, NULL);
+		goto out;
+	}
+
+	/* absolute path outside the icon directories */
+	if (icon_name[0] == '/') {
+		path = g_build_filename (root, icon_name, NULL);
+		if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+			g_free (path);
+			path = NULL;
+		}
+	}
+out:
+	return path;
+}
+
+/*
+ * ai_generator_get_max_size:
+ *
+ * Return value: the largest size in a list of sizes
+ */
+guint
+ai_generator_get_max_size (GArray *sizes)
+{
+	guint size_max = 0;
+	guint i;
+
+	for (i=0; i<sizes->len; i++)
+		size_max = MAX (size_max, g_array_index (sizes, guint, i));
+	return size_max;
+}
+
+/*
+ * ai_generator_load_icon:
+ *
+ * Loads an icon to be scaled, rendering vector icons at @size.
+ *
+ * Return value: a new #GdkPixbuf, or %NULL
+ */
+GdkPixbuf *
+ai_generator_load_icon (const gchar *filename, guint size, GError **error)
+{
+	if (g_str_has_suffix (filename, ".svg") || g_str_has_suffix (filename, ".svgz"))
+		return gdk_pixbuf_new_from_file_at_size (filename, size, size, error);
+	return gdk_pixbuf_new_from_file (filename, error);
+}
+
+/*
+ * ai_generator_size_prepared_cb:
+ */
+static void
+ai_generator_size_prepared_cb (GdkPixbufLoader *loader, gint width, gint height, gpointer user_data)
+{
+	guint size = GPOINTER_TO_UINT (user_data);
+
+	/* keep the aspect ratio, like gdk_pixbuf_new_from_file_at_size() */
+	if (width <= 0 || height <= 0)
+		return;
+	if (width > height)
+		gdk_pixbuf_loader_set_size (loader, size, MAX (1, height * size / width));
+	else
+		gdk_pixbuf_loader_set_size (loader, MAX (1, width * size / height), size);
+}
+
+/*
+ * ai_generator_load_icon_from_data:
+ *
+ * Loads an icon to be scaled from memory, rendering vector icons at @size.
+ * @filename is only used to find out the format.
+ *
+ * Return value: a new #GdkPixbuf, or %NULL
+ */
+GdkPixbuf *
+ai_generator_load_icon_from_data (const gchar *filename, const gchar *data, gsize length, guint size, GError **error)
+{
+	gboolean ret;
+	GdkPixbuf *pixbuf = NULL;
+	GdkPixbufLoader *loader;
+
+	loader = gdk_pixbuf_loader_new ();
+	if (g_str_has_suffix (filename, ".svg") || g_str_has_suffix (filename, ".svgz"))
+		g_signal_connect (loader, "size-prepared", G_CALLBACK (ai_generator_size_prepared_cb), GUINT_TO_POINTER (size));
+	ret = gdk_pixbuf_loader_write (loader, (const guchar *) data, length, error);
+	if (!ret) {
+		gdk_pixbuf_loader_close (loader, NULL);
+		goto out;
+	}
+	ret = gdk_pixbuf_loader_close (loader, error);
+	if (!ret)
+		goto out;
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+	if (pixbuf == NULL) {
+		g_set_error (error, 1, 0, "no image data in %s", filename);
+		goto out;
+	}
+	g_object_ref (pixbuf);
+out:
+	g_object_unref (loader);
+	return pixbuf;
+}
+
+/*
+ * ai_generator_copy_icons:
+ *
+ * Return value: %TRUE if any icon was found, which is all that is done
+ * when @dry_run is set
+ */
+static gboolean
+ai_generator_copy_icons (AiConfig *config, AiIconIndex *icon_index, const gchar *root, const gchar *directory,
+			 const gchar *icon_name, gboolean dry_run)
+{
+	gboolean ret;
+	GError *error = NULL;
+	GFile *file;
+	GFile *remote;
+	GArray *sizes;
+	gchar *dest;
+	gchar *iconpath;
+	gchar *icon_name_full;
+	gchar *size_dir;
+	gchar *tmp;
+	guint i;
+	gboolean found_any_icons = FALSE;
+	const AiIconIndexItem *item;
+
+	egg_debug ("looking for %s", icon_name);
+
+	/* the same basename is used for every size */
+	tmp = g_strdup (icon_name);
+	g_strdelimit (tmp, ".", '\0');
+
+	/* copy all the configured icon sizes if they exist */
+	sizes = ai_config_get_copy_icon_sizes (config);
+	for (i=0; i<sizes->len; i++) {
+		size_dir = ai_config_icon_size_to_dir (g_array_index (sizes, guint, i));
+
+		/* find in the index rather than probing the disk */
+		item = ai_icon_index_lookup_exact (icon_index, icon_name, "hicolor", g_array_index (sizes, guint, i));
+		if (item == NULL) {
+			egg_debug ("no %s hicolor icon for %s, so not copying", size_dir, icon_name);
+			g_free (size_dir);
+			continue;
+		}
+		found_any_icons = TRUE;
+		if (dry_run) {
+			g_free (size_dir);
+			continue;
+		}
+
+		/* copy the file */
+		icon_name_full = g_strdup_printf ("%s.%s", tmp, item->format);
+		iconpath = g_build_filename (root, item->path, NULL);
+		dest = g_build_filename (directory, size_dir, icon_name_full, NULL);
+		egg_debug ("copying file %s to %s", iconpath, dest);
+		file = g_file_new_for_path (iconpath);
+		remote = g_file_new_for_path (dest);
+		ret = g_file_copy (file, remote, G_FILE_COPY_TARGET_DEFAULT_PERMS | G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, &error);
+		if (!ret) {
+			egg_warning ("cannot copy %s: %s", dest, error->message);
+			g_clear_error (&error);
+		}
+		g_object_unref (file);
+		g_object_unref (remote);
+		g_free (dest);
+		g_free (iconpath);
+		g_free (icon_name_full);
+		g_free (size_dir);
+	}
+	g_free (tmp);
+
+	return found_any_icons;
+}
+
+/*
+ * ai_generator_app_icons_from_cache:
+ *
+ * Writes the sizes we have rendered before, and removes them from @sizes.
+ */
+static gboolean
+ai_generator_app_icons_from_cache (AiIconCache *cache, const gchar *checksum, const gchar *settings, GArray *sizes,
+				   const gchar *application_id, const gchar *icondir, gboolean dry_run,
+				   guint64 *cached_size, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar *data;
+	gchar *key;
+	gchar *path;
+	gsize length;
+	guint size;
+	guint i = 0;
+
+	while (i < sizes->len) {
+		size = g_array_index (sizes, guint, i);
+		key = ai_icon_cache_get_key (checksum, size, settings);
+		ret = ai_icon_cache_lookup (cache, key, &data, &length);
+		g_free (key);
+		if (!ret) {
+			i++;
+			continue;
+		}
+
+		/* no need to decode or scale this size */
+		if (!dry_run) {
+			path = g_strdup_printf ("%s/%ix%i/%s.png", icondir, size, size, application_id);
+			egg_debug ("saving cached icon to %s", path);
+			ret = g_file_set_contents (path, data, length, error);
+			g_free (path);
+		}
+		g_free (data);
+		if (!ret)
+			goto out;
+		*cached_size += length;
+		g_array_remove_index (sizes, i);
+	}
+	ret = TRUE;
+out:
+	return ret;
+}
+
+/*
+ * ai_generator_app_icons_for_pixbuf:
+ */
+static gboolean
+ai_generator_app_icons_for_pixbuf (AiIconEncoder *encoder, GdkPixbuf *pixbuf, GArray *sizes,
+				   const gchar *checksum, const gchar *settings,
+				   const gchar *application_id, const gchar *icondir, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar *path;
+	gchar *key = NULL;
+	GPtrArray *scaled;
+	guint size;
+	guint i;
+
+	/* decode once, scale to every size */
+	scaled = ai_icon_scale_multi (pixbuf, (const guint *) sizes->data);
+
+	/* encode all the sizes in parallel */
+	for (i=0; i<scaled->len; i++) {
+		size = g_array_index (sizes, guint, i);
+		path = g_strdup_printf ("%s/%ix%i/%s.png", icondir, size, size, application_id);
+		if (checksum != NULL)
+			key = ai_icon_cache_get_key (checksum, size, settings);
+		ret = ai_icon_encoder_add_cached (encoder, g_ptr_array_index (scaled, i), path, key, error);
+		g_free (key);
+		g_free (path);
+		if (!ret)
+			break;
+	}
+
+	/* always wait, even if we failed to queue some */
+	if (!ret) {
+		ai_icon_encoder_wait (encoder, NULL);
+		goto out;
+	}
+	ret = ai_icon_encoder_wait (encoder, error);
+out:
+	g_ptr_array_unref (scaled);
+	return ret;
+}
+
+/**
+ * ai_generator_add_desktop_file:
+ * @db: an open #AiDatabase
+ * @config: the loaded #AiConfig
+ * @encoder: the #AiIconEncoder used for scaled icons
+ * @cache: (allow-none): the scaled icon cache, or %NULL
+ * @root: the root directory of the package data
+ * @desktopfile: the desktop file, relative to the applications directory or @root
+ * @repo: the name of the remote repo
+ * @package: the name of the package
+ * @icondir: the icon output directory
+ * @cached_size: (out) (allow-none): the number of bytes taken from @cache
+ * @error: a #GError, or %NULL
+ *
+ * Copies and scales the icons of one desktop file and adds the application
+ * to the database. This is what app-install-generate does, so drivers can
+ * call it in-process for each desktop file. If @encoder is set to a dry
+ * run, the icons are only measured and nothing is written anywhere.
+ *
+ * Return value: %TRUE for success
+ */
+gboolean
+ai_generator_add_desktop_file (AiDatabase *db, AiConfig *config, AiIconEncoder *encoder, AiIconCache *cache,
+			       const gchar *root, const gchar *desktopfile, const gchar *repo, const gchar *package,
+			       const gchar *icondir, guint64 *cached_size, GError **error)
+{
+	gboolean ret = FALSE;
+	gboolean copied;
+	gboolean dry_run;
+	GError *error_local = NULL;
+	AiDesktop *desktop = NULL;
+	AiIconIndex *icon_index = NULL;
+	GArray *sizes = NULL;
+	GdkPixbuf *pixbuf;
+	gchar *application_id = NULL;
+	gchar *checksum = NULL;
+	gchar *settings = NULL;
+	gchar *filename;
+	gchar *icon_name = NULL;
+	gchar *path = NULL;
+	guint64 cached_size_local = 0;
+	guint size_max;
+
+	g_return_val_if_fail (AI_IS_DATABASE (db), FALSE);
+	g_return_val_if_fail (AI_IS_CONFIG (config), FALSE);
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), FALSE);
+	g_return_val_if_fail (root != NULL, FALSE);
+	g_return_val_if_fail (desktopfile != NULL, FALSE);
+
+	dry_run = ai_icon_encoder_get_dry_run (encoder);
+	if (desktopfile[0] != '/')
+		filename = g_build_filename (root, APPLICATIONS_DIR, desktopfile, NULL);
+	else
+		filename = g_build_filename (root, desktopfile, NULL);
+	egg_debug ("filename: %s", filename);
+
+	/* get app-id */
+	application_id = ai_generator_get_application_id (filename);
+
+	/* extract data */
+	desktop = ai_desktop_new ();
+	ret = ai_desktop_load_from_file (desktop, filename, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "failed to get desktop data: %s", error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	/* we don't add applications without icons */
+	icon_name = g_strdup (ai_desktop_get_value (desktop, "Icon", NULL));
+	if (icon_name == NULL || icon_name[0] == '\0') {
+		g_set_error (error, 1, 0, "package %s does not reference an icon", package);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* is this a whitelisted (icon-name-theme) icon */
+	if (ai_whitelist_contains (icon_name)) {
+		egg_debug ("%s is whitelisted, no need to copy icon", icon_name);
+		goto skip_copy;
+	}
+
+	/* walk the icon trees of the package once */
+	icon_index = ai_icon_index_new ();
+	ai_icon_index_add_root (icon_index, root);
+
+	/* fist assume the application is well behaved and installed icons to hicolor */
+	copied = ai_generator_copy_icons (config, icon_index, root, icondir, icon_name, dry_run);
+
+	/* scale the sizes we have to ship but could not copy */
+	sizes = ai_generator_get_missing_sizes (config, icon_index, icon_name);
+	if (sizes->len == 0)
+		goto skip_copy;
+	size_max = ai_generator_get_max_size (sizes);
+
+	/* find the best source icon in any theme or pixmaps */
+	path = ai_generator_find_icon (icon_index, root, icon_name, size_max);
+	if (path == NULL && copied) {
+		egg_warning ("no icon to scale for %s, only copying", icon_name);
+		goto skip_copy;
+	}
+	if (path == NULL) {
+		g_set_error (error, 1, 0, "failed to load the icon '%s' for %s", icon_name, package);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* use the sizes we have rendered from the same source before */
+	if (cache != NULL) {
+		ai_icon_encoder_set_cache (encoder, cache);
+		checksum = ai_icon_cache_get_checksum (path, &error_local);
+		if (checksum == NULL) {
+			g_set_error (error, 1, 0, "failed to read image '%s' for %s: %s", icon_name, package, error_local->message);
+			g_error_free (error_local);
+			ret = FALSE;
+			goto out;
+		}
+		settings = ai_icon_encoder_get_settings_id (encoder);
+		ret = ai_generator_app_icons_from_cache (cache, checksum, settings, sizes, application_id,
+							 icondir, dry_run, &cached_size_local, &error_local);
+		if (!ret) {
+			g_set_error (error, 1, 0, "failed to save a cached icon for %s in %s: %s", icon_name, package, error_local->message);
+			g_error_free (error_local);
+			goto out;
+		}
+	}
+	if (sizes->len == 0) {
+		egg_debug ("all sizes of %s were cached", icon_name);
+		goto skip_copy;
+	}
+	egg_debug ("scaling %s", path);
+
+	/* render vector icons at the largest size we need */
+	pixbuf = ai_generator_load_icon (path, size_max, &error_local);
+	if (pixbuf == NULL) {
+		g_set_error (error, 1, 0, "failed to open image '%s' for %s: %s", icon_name, package, error_local->message);
+		g_error_free (error_local);
+		ret = FALSE;
+		goto out;
+	}
+
+	/* save each icon size */
+	ret = ai_generator_app_icons_for_pixbuf (encoder, pixbuf, sizes, checksum, settings, application_id, icondir, &error_local);
+	g_object_unref (pixbuf);
+	if (!ret) {
+		g_set_error (error, 1, 0, "failed to save a scaled icon for %s in %s: %s", icon_name, package, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+skip_copy:
+	/* only the icon sizes are reported */
+	if (dry_run) {
+		egg_debug ("dry run, not adding %s", application_id);
+		goto out;
+	}
+
+	/* form application SQL */
+	ret = ai_generator_add_application (db, desktop, repo, package, application_id, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "failed to generate application data for %s: %s", package, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	/* form translations SQL */
+	ret = ai_generator_add_translations (db, desktop, application_id, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "failed to generate translation data for %s: %s", package, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+out:
+	if (cached_size != NULL)
+		*cached_size = cached_size_local;
+	if (desktop != NULL)
+		g_object_unref (desktop);
+	if (icon_index != NULL)
+		g_object_unref (icon_index);
+	if (sizes != NULL)
+		g_array_free (sizes, TRUE);
+	g_free (application_id);
+	g_free (checksum);
+	g_free (settings);
+	g_free (filename);
+	g_free (icon_name);
+	g_free (path);
+	return ret;
+}
+
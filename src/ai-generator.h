@@ -0,0 +1,82 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_GENERATOR_H
+#define __AI_GENERATOR_H
+
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "ai-config.h"
+#include "ai-database.h"
+#include "ai-desktop.h"
+#include "ai-icon-cache.h"
+#include "ai-icon-encoder.h"
+#include "ai-icon-index.h"
+
+G_BEGIN_DECLS
+
+gboolean	 ai_generator_create_icon_directories	(AiConfig	*config,
+							 const gchar	*directory);
+gchar		*ai_generator_get_application_id	(const gchar	*filename);
+gchar		*ai_generator_get_package_name		(const gchar	*filename);
+gboolean	 ai_generator_add_application		(AiDatabase	*db,
+							 AiDesktop	*desktop,
+							 const gchar	*repo,
+							 const gchar	*package,
+							 const gchar	*application_id,
+							 GError		**error);
+gboolean	 ai_generator_add_translations		(AiDatabase	*db,
+							 AiDesktop	*desktop,
+							 const gchar	*application_id,
+							 GError		**error);
+GArray		*ai_generator_get_missing_sizes		(AiConfig	*config,
+							 AiIconIndex	*icon_index,
+							 const gchar	*icon_name);
+gchar		*ai_generator_find_icon			(AiIconIndex	*icon_index,
+							 const gchar	*root,
+							 const gchar	*icon_name,
+							 guint		 size);
+guint		 ai_generator_get_max_size		(GArray		*sizes);
+GdkPixbuf	*ai_generator_load_icon			(const gchar	*filename,
+							 guint		 size,
+							 GError		**error);
+GdkPixbuf	*ai_generator_load_icon_from_data	(const gchar	*filename,
+							 const gchar	*data,
+							 gsize		 length,
+							 guint		 size,
+							 GError		**error);
+gboolean	 ai_generator_add_desktop_file		(AiDatabase	*db,
+							 AiConfig	*config,
+							 AiIconEncoder	*encoder,
+							 AiIconCache	*cache,
+							 const gchar	*root,
+							 const gchar	*desktopfile,
+							 const gchar	*repo,
+							 const gchar	*package,
+							 const gchar	*icondir,
+							 guint64	*cached_size,
+							 GError		**error);
+
+G_END_DECLS
+
+#endif /* __AI_GENERATOR_H */
+
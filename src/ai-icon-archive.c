@@ -0,0 +1,365 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "egg-debug.h"
+
+#include "ai-icon-archive.h"
+
+static void     ai_icon_archive_finalize	(GObject     *object);
+
+#define AI_ICON_ARCHIVE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_ARCHIVE, AiIconArchivePrivate))
+
+/* every entry gets the same owner and time, so the output only depends on the icons */
+#define AI_ICON_ARCHIVE_MTIME		0
+#define AI_ICON_ARCHIVE_OWNER		"root"
+
+/*
+ * AiIconArchivePrivate:
+ *
+ * Private #AiIconArchive data
+ */
+struct _AiIconArchivePrivate
+{
+	struct archive			*arch;
+	GHashTable			*dirs;
+	guint				 threads;
+	guint				 count;
+};
+
+G_DEFINE_TYPE (AiIconArchive, ai_icon_archive, G_TYPE_OBJECT)
+
+/*
+ * ai_icon_archive_set_threads:
+ *
+ * Sets the number of compression threads, which only xz and zstd use.
+ * This has to be set before the archive is opened.
+ */
+void
+ai_icon_archive_set_threads (AiIconArchive *archive, guint threads)
+{
+	g_return_if_fail (AI_IS_ICON_ARCHIVE (archive));
+	archive->priv->threads = threads;
+}
+
+/*
+ * ai_icon_archive_add_filter:
+ *
+ * Chooses the compression from the suffix of @filename.
+ */
+static gboolean
+ai_icon_archive_add_filter (struct archive *arch, const gchar *filename, GError **error)
+{
+	gint r;
+
+	if (g_str_has_suffix (filename, ".tar")) {
+		r = ARCHIVE_OK;
+	} else if (g_str_has_suffix (filename, ".tar.gz") || g_str_has_suffix (filename, ".tgz")) {
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+		r = archive_write_add_filter_gzip (arch);
+#else
+		r = archive_write_set_compression_gzip (arch);
+#endif
+	} else if (g_str_has_suffix (filename, ".tar.bz2")) {
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+		r = archive_write_add_filter_bzip2 (arch);
+#else
+		r = archive_write_set_compression_bzip2 (arch);
+#endif
+	} else if (g_str_has_suffix (filename, ".tar.xz")) {
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+		r = archive_write_add_filter_xz (arch);
+#else
+		r = archive_write_set_compression_xz (arch);
+#endif
+#if ARCHIVE_VERSION_NUMBER >= 3003003
+	} else if (g_str_has_suffix (filename, ".tar.zst")) {
+		r = archive_write_add_filter_zstd (arch);
+#endif
+	} else {
+		g_set_error (error, 1, 0, "cannot work out the compression of %s", filename);
+		return FALSE;
+	}
+	if (r != ARCHIVE_OK) {
+		g_set_error (error, 1, 0, "cannot compress %s: %s", filename, archive_error_string (arch));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * ai_icon_archive_open:
+ *
+ * Opens @filename for writing, e.g. "fedora-icons.tar.xz". The entries are
+ * written in the order they are added, with a fixed owner and time.
+ */
+gboolean
+ai_icon_archive_open (AiIconArchive *archive, const gchar *filename, GError **error)
+{
+	gboolean ret = FALSE;
+	gint r;
+	AiIconArchivePrivate *priv = archive->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (priv->arch == NULL, FALSE);
+
+	priv->arch = archive_write_new ();
+	archive_write_set_format_ustar (priv->arch);
+	ret = ai_icon_archive_add_filter (priv->arch, filename, error);
+	if (!ret)
+		goto out;
+
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+	/* not every version knows these, and they are only tuning */
+	archive_write_set_filter_option (priv->arch, "gzip", "timestamp", NULL);
+	if (priv->threads > 1) {
+		gchar *threads;
+		threads = g_strdup_printf ("%i", priv->threads);
+		archive_write_set_filter_option (priv->arch, NULL, "threads", threads);
+		g_free (threads);
+	}
+#endif
+
+	r = archive_write_open_filename (priv->arch, filename);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error, 1, 0, "cannot open %s: %s", filename, archive_error_string (priv->arch));
+		ret = FALSE;
+		goto out;
+	}
+	egg_debug ("writing icons to %s", filename);
+out:
+	if (!ret) {
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+		archive_write_free (priv->arch);
+#else
+		archive_write_finish (priv->arch);
+#endif
+		priv->arch = NULL;
+	}
+	return ret;
+}
+
+/*
+ * ai_icon_archive_write_header:
+ */
+static gboolean
+ai_icon_archive_write_header (AiIconArchive *archive, const gchar *path, mode_t type, gsize length, GError **error)
+{
+	gboolean ret = TRUE;
+	gint r;
+	struct archive_entry *entry;
+	AiIconArchivePrivate *priv = archive->priv;
+
+	entry = archive_entry_new ();
+	archive_entry_set_pathname (entry, path);
+	archive_entry_set_filetype (entry, type);
+	archive_entry_set_perm (entry, type == AE_IFDIR ? 0755 : 0644);
+	archive_entry_set_size (entry, length);
+	archive_entry_set_mtime (entry, AI_ICON_ARCHIVE_MTIME, 0);
+	archive_entry_set_uid (entry, 0);
+	archive_entry_set_gid (entry, 0);
+	archive_entry_set_uname (entry, AI_ICON_ARCHIVE_OWNER);
+	archive_entry_set_gname (entry, AI_ICON_ARCHIVE_OWNER);
+	r = archive_write_header (priv->arch, entry);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error, 1, 0, "cannot add %s: %s", path, archive_error_string (priv->arch));
+		ret = FALSE;
+	}
+	archive_entry_free (entry);
+	return ret;
+}
+
+/*
+ * ai_icon_archive_add_dirs:
+ *
+ * Adds the parent directories of @path the first time they are seen, as
+ * tar does for a tree on disk.
+ */
+static gboolean
+ai_icon_archive_add_dirs (AiIconArchive *archive, const gchar *path, GError **error)
+{
+	gboolean ret = TRUE;
+	const gchar *p;
+	gchar *dir;
+	AiIconArchivePrivate *priv = archive->priv;
+
+	for (p = strchr (path, '/'); p != NULL; p = strchr (p + 1, '/')) {
+		dir = g_strndup (path, p - path + 1);
+		if (g_hash_table_lookup (priv->dirs, dir) != NULL) {
+			g_free (dir);
+			continue;
+		}
+		ret = ai_icon_archive_write_header (archive, dir, AE_IFDIR, 0, error);
+		if (!ret) {
+			g_free (dir);
+			break;
+		}
+		g_hash_table_insert (priv->dirs, dir, GINT_TO_POINTER (1));
+	}
+	return ret;
+}
+
+/*
+ * ai_icon_archive_add:
+ *
+ * Adds an icon, where @filename is relative to the icon directory, e.g.
+ * "48x48/gnome-power-manager.png".
+ */
+gboolean
+ai_icon_archive_add (AiIconArchive *archive, const gchar *filename, const gchar *data, gsize length, GError **error)
+{
+	gboolean ret;
+	gchar *path;
+	gssize wrote;
+	AiIconArchivePrivate *priv = archive->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (priv->arch != NULL, FALSE);
+
+	path = g_build_filename (AI_ICON_ARCHIVE_PREFIX, filename, NULL);
+	ret = ai_icon_archive_add_dirs (archive, path, error);
+	if (!ret)
+		goto out;
+	ret = ai_icon_archive_write_header (archive, path, AE_IFREG, length, error);
+	if (!ret)
+		goto out;
+	wrote = archive_write_data (priv->arch, data, length);
+	if (wrote < 0 || (gsize) wrote != length) {
+		g_set_error (error, 1, 0, "cannot write %s: %s", path, archive_error_string (priv->arch));
+		ret = FALSE;
+		goto out;
+	}
+	priv->count++;
+out:
+	g_free (path);
+	return ret;
+}
+
+/*
+ * ai_icon_archive_close:
+ *
+ * Flushes the compressor and closes the file. Nothing is complete on disk
+ * until this succeeds.
+ */
+gboolean
+ai_icon_archive_close (AiIconArchive *archive, GError **error)
+{
+	gboolean ret = TRUE;
+	gint r;
+	AiIconArchivePrivate *priv = archive->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ARCHIVE (archive), FALSE);
+
+	if (priv->arch == NULL)
+		goto out;
+	r = archive_write_close (priv->arch);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error, 1, 0, "cannot close: %s", archive_error_string (priv->arch));
+		ret = FALSE;
+	}
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+	archive_write_free (priv->arch);
+#else
+	archive_write_finish (priv->arch);
+#endif
+	priv->arch = NULL;
+	g_hash_table_remove_all (priv->dirs);
+out:
+	return ret;
+}
+
+/*
+ * ai_icon_archive_get_count:
+ *
+ * Return value: the number of icons written, not counting directories
+ */
+guint
+ai_icon_archive_get_count (AiIconArchive *archive)
+{
+	g_return_val_if_fail (AI_IS_ICON_ARCHIVE (archive), 0);
+	return archive->priv->count;
+}
+
+/*
+ * ai_icon_archive_class_init:
+ */
+static void
+ai_icon_archive_class_init (AiIconArchiveClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_archive_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconArchivePrivate));
+}
+
+/*
+ * ai_icon_archive_init:
+ */
+static void
+ai_icon_archive_init (AiIconArchive *archive)
+{
+	archive->priv = AI_ICON_ARCHIVE_GET_PRIVATE (archive);
+	archive->priv->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+/*
+ * ai_icon_archive_finalize:
+ */
+static void
+ai_icon_archive_finalize (GObject *object)
+{
+	AiIconArchive *archive = AI_ICON_ARCHIVE (object);
+	AiIconArchivePrivate *priv = archive->priv;
+
+	/* an archive that was never closed is truncated, not completed */
+	if (priv->arch != NULL) {
+		egg_warning ("icon archive was not closed");
+#if ARCHIVE_VERSION_NUMBER >= 3000000
+		archive_write_free (priv->arch);
+#else
+		archive_write_finish (priv->arch);
+#endif
+	}
+	g_hash_table_unref (priv->dirs);
+
+	G_OBJECT_CLASS (ai_icon_archive_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_archive_new:
+ *
+ * Return value: a new AiIconArchive object.
+ */
+AiIconArchive *
+ai_icon_archive_new (void)
+{
+	AiIconArchive *archive;
+	archive = g_object_new (AI_TYPE_ICON_ARCHIVE, NULL);
+	return AI_ICON_ARCHIVE (archive);
+}
+
@@ -0,0 +1,74 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_ICON_ARCHIVE_H
+#define __AI_ICON_ARCHIVE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_ARCHIVE		(ai_icon_archive_get_type ())
+#define AI_ICON_ARCHIVE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_ARCHIVE, AiIconArchive))
+#define AI_ICON_ARCHIVE_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_ARCHIVE, AiIconArchiveClass))
+#define AI_IS_ICON_ARCHIVE(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_ARCHIVE))
+#define AI_IS_ICON_ARCHIVE_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_ARCHIVE))
+#define AI_ICON_ARCHIVE_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_ARCHIVE, AiIconArchiveClass))
+
+/* the top level directory, the same as the drivers used to tar up */
+#define AI_ICON_ARCHIVE_PREFIX		"icons"
+
+typedef struct _AiIconArchivePrivate	AiIconArchivePrivate;
+typedef struct _AiIconArchive		AiIconArchive;
+typedef struct _AiIconArchiveClass	AiIconArchiveClass;
+
+struct _AiIconArchive
+{
+	 GObject		 parent;
+	 AiIconArchivePrivate	*priv;
+};
+
+struct _AiIconArchiveClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_icon_archive_get_type	  	(void);
+AiIconArchive	*ai_icon_archive_new			(void);
+void		 ai_icon_archive_set_threads		(AiIconArchive	*archive,
+							 guint		 threads);
+gboolean	 ai_icon_archive_open			(AiIconArchive	*archive,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 ai_icon_archive_add			(AiIconArchive	*archive,
+							 const gchar	*filename,
+							 const gchar	*data,
+							 gsize		 length,
+							 GError		**error);
+gboolean	 ai_icon_archive_close			(AiIconArchive	*archive,
+							 GError		**error);
+guint		 ai_icon_archive_get_count		(AiIconArchive	*archive);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_ARCHIVE_H */
+
@@ -0,0 +1,335 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "egg-debug.h"
+
+#include "ai-icon-atlas.h"
+#include "ai-icon-encoder.h"
+#include "ai-icon-scale.h"
+#include "ai-utils-private.h"
+
+static void     ai_icon_atlas_finalize	(GObject     *object);
+
+#define AI_ICON_ATLAS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_ATLAS, AiIconAtlasPrivate))
+
+/*
+ * AiIconAtlasPrivate:
+ *
+ * Private #AiIconAtlas data
+ */
+struct _AiIconAtlasPrivate
+{
+	AiIconEncoder			*encoder;
+	GPtrArray			*entries;
+	guint				 columns;
+	guint				 sheets;
+};
+
+G_DEFINE_TYPE (AiIconAtlas, ai_icon_atlas, G_TYPE_OBJECT)
+
+/*
+ * ai_icon_atlas_entry_free:
+ */
+static void
+ai_icon_atlas_entry_free (AiIconAtlasEntry *entry)
+{
+	g_free (entry->name);
+	g_free (entry);
+}
+
+/*
+ * ai_icon_atlas_set_columns:
+ *
+ * Sets how many icons go across a sheet, and also down it, so a full
+ * sheet holds @columns * @columns icons.
+ */
+void
+ai_icon_atlas_set_columns (AiIconAtlas *atlas, guint columns)
+{
+	g_return_if_fail (AI_IS_ICON_ATLAS (atlas));
+	g_return_if_fail (columns > 0);
+	atlas->priv->columns = columns;
+}
+
+/*
+ * ai_icon_atlas_set_encoder:
+ *
+ * Sets the encoder used for the sheets, otherwise the defaults are used.
+ */
+void
+ai_icon_atlas_set_encoder (AiIconAtlas *atlas, AiIconEncoder *encoder)
+{
+	g_return_if_fail (AI_IS_ICON_ATLAS (atlas));
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+
+	if (atlas->priv->encoder != NULL)
+		g_object_unref (atlas->priv->encoder);
+	atlas->priv->encoder = g_object_ref (encoder);
+}
+
+/*
+ * ai_icon_atlas_get_sheet_filename:
+ *
+ * Return value: the filename of a sheet, e.g. "/usr/share/app-install/icons/24x24-0.png"
+ */
+gchar *
+ai_icon_atlas_get_sheet_filename (const gchar *prefix, guint sheet)
+{
+	return g_strdup_printf ("%s-%i.png", prefix, sheet);
+}
+
+/*
+ * ai_icon_atlas_load_icon:
+ *
+ * Return value: a pixbuf of exactly @size x @size with an alpha channel,
+ * or %NULL if the icon cannot be loaded.
+ */
+static GdkPixbuf *
+ai_icon_atlas_load_icon (const gchar *filename, guint size)
+{
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *tmp;
+	GError *error = NULL;
+
+	pixbuf = gdk_pixbuf_new_from_file (filename, &error);
+	if (pixbuf == NULL) {
+		egg_warning ("cannot load %s: %s", filename, error->message);
+		g_error_free (error);
+		goto out;
+	}
+	if ((guint) gdk_pixbuf_get_width (pixbuf) != size ||
+	    (guint) gdk_pixbuf_get_height (pixbuf) != size) {
+		tmp = ai_icon_scale (pixbuf, size);
+		g_object_unref (pixbuf);
+		pixbuf = tmp;
+	}
+	if (!gdk_pixbuf_get_has_alpha (pixbuf)) {
+		tmp = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+		g_object_unref (pixbuf);
+		pixbuf = tmp;
+	}
+out:
+	return pixbuf;
+}
+
+/*
+ * ai_icon_atlas_write_sheet:
+ */
+static gboolean
+ai_icon_atlas_write_sheet (AiIconAtlas *atlas, GdkPixbuf *sheet, const gchar *prefix, guint number, GError **error)
+{
+	gboolean ret;
+	gchar *filename;
+	gchar *buffer = NULL;
+	gsize buffer_size;
+	GError *error_local = NULL;
+
+	filename = ai_icon_atlas_get_sheet_filename (prefix, number);
+	ret = ai_icon_encoder_encode (atlas->priv->encoder, sheet, &buffer, &buffer_size, error);
+	if (!ret)
+		goto out;
+	ret = g_file_set_contents (filename, buffer, buffer_size, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "cannot write %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+	egg_debug ("wrote sheet %s", filename);
+out:
+	g_free (buffer);
+	g_free (filename);
+	return ret;
+}
+
+/*
+ * ai_icon_atlas_build:
+ * @directory: the icons of one size, e.g. "/usr/share/app-install/icons/24x24"
+ * @size: the size of each cell in pixels
+ * @prefix: the start of the sheet filenames, see ai_icon_atlas_get_sheet_filename()
+ *
+ * Draws every icon in @directory into as few sheets as possible, so a
+ * front end can decode one image and copy the icons out of it. Icons of
+ * the wrong size are scaled, and icons that cannot be loaded leave an
+ * empty cell and no entry.
+ */
+gboolean
+ai_icon_atlas_build (AiIconAtlas *atlas, const gchar *directory, guint size, const gchar *prefix, GError **error)
+{
+	gboolean ret = TRUE;
+	guint i;
+	guint cell;
+	guint cells;
+	guint remaining;
+	guint width;
+	guint height;
+	gchar *path;
+	gchar *dot;
+	const gchar *filename;
+	GPtrArray *filenames;
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *sheet = NULL;
+	AiIconAtlasEntry *entry;
+	AiIconAtlasPrivate *priv = atlas->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ATLAS (atlas), FALSE);
+	g_return_val_if_fail (directory != NULL, FALSE);
+	g_return_val_if_fail (size > 0, FALSE);
+	g_return_val_if_fail (prefix != NULL, FALSE);
+
+	g_ptr_array_set_size (priv->entries, 0);
+	priv->sheets = 0;
+
+	filenames = ai_utils_get_icon_files (directory, error);
+	if (filenames == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	cells = priv->columns * priv->columns;
+	for (i=0; i<filenames->len; i++) {
+		cell = i % cells;
+
+		/* start a new sheet, the last one is only as big as it needs to be */
+		if (cell == 0) {
+			remaining = MIN (filenames->len - i, cells);
+			width = MIN (remaining, priv->columns) * size;
+			height = ((remaining + priv->columns - 1) / priv->columns) * size;
+			sheet = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+			gdk_pixbuf_fill (sheet, 0x00000000);
+		}
+
+		filename = g_ptr_array_index (filenames, i);
+		path = g_build_filename (directory, filename, NULL);
+		pixbuf = ai_icon_atlas_load_icon (path, size);
+		g_free (path);
+		if (pixbuf != NULL) {
+			entry = g_new0 (AiIconAtlasEntry, 1);
+			entry->name = g_strdup (filename);
+			dot = strrchr (entry->name, '.');
+			if (dot != NULL)
+				*dot = '\0';
+			entry->sheet = priv->sheets;
+			entry->x = (cell % priv->columns) * size;
+			entry->y = (cell / priv->columns) * size;
+			gdk_pixbuf_copy_area (pixbuf, 0, 0, size, size, sheet, entry->x, entry->y);
+			g_ptr_array_add (priv->entries, entry);
+			g_object_unref (pixbuf);
+		}
+
+		/* sheet is full, or there are no more icons */
+		if (cell == cells - 1 || i == filenames->len - 1) {
+			ret = ai_icon_atlas_write_sheet (atlas, sheet, prefix, priv->sheets, error);
+			g_object_unref (sheet);
+			sheet = NULL;
+			if (!ret)
+				goto out;
+			priv->sheets++;
+		}
+	}
+	egg_debug ("%i icons in %i sheets", priv->entries->len, priv->sheets);
+out:
+	if (filenames != NULL)
+		g_ptr_array_unref (filenames);
+	return ret;
+}
+
+/**
+ * ai_icon_atlas_get_entries:
+ *
+ * Return value: (transfer none): the #AiIconAtlasEntry for each icon
+ * written by the last ai_icon_atlas_build(). Do not free.
+ */
+GPtrArray *
+ai_icon_atlas_get_entries (AiIconAtlas *atlas)
+{
+	g_return_val_if_fail (AI_IS_ICON_ATLAS (atlas), NULL);
+	return atlas->priv->entries;
+}
+
+/*
+ * ai_icon_atlas_get_sheets:
+ *
+ * Return value: the number of sheets written by the last ai_icon_atlas_build()
+ */
+guint
+ai_icon_atlas_get_sheets (AiIconAtlas *atlas)
+{
+	g_return_val_if_fail (AI_IS_ICON_ATLAS (atlas), 0);
+	return atlas->priv->sheets;
+}
+
+/*
+ * ai_icon_atlas_class_init:
+ */
+static void
+ai_icon_atlas_class_init (AiIconAtlasClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_atlas_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconAtlasPrivate));
+}
+
+/*
+ * ai_icon_atlas_init:
+ */
+static void
+ai_icon_atlas_init (AiIconAtlas *atlas)
+{
+	atlas->priv = AI_ICON_ATLAS_GET_PRIVATE (atlas);
+	atlas->priv->encoder = ai_icon_encoder_new ();
+	atlas->priv->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_icon_atlas_entry_free);
+	atlas->priv->columns = AI_ICON_ATLAS_DEFAULT_COLUMNS;
+}
+
+/*
+ * ai_icon_atlas_finalize:
+ */
+static void
+ai_icon_atlas_finalize (GObject *object)
+{
+	AiIconAtlas *atlas = AI_ICON_ATLAS (object);
+	AiIconAtlasPrivate *priv = atlas->priv;
+
+	g_object_unref (priv->encoder);
+	g_ptr_array_unref (priv->entries);
+
+	G_OBJECT_CLASS (ai_icon_atlas_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_atlas_new:
+ *
+ * Return value: a new AiIconAtlas object.
+ */
+AiIconAtlas *
+ai_icon_atlas_new (void)
+{
+	AiIconAtlas *atlas;
+	atlas = g_object_new (AI_TYPE_ICON_ATLAS, NULL);
+	return AI_ICON_ATLAS (atlas);
+}
@@ -0,0 +1,84 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_ICON_ATLAS_H
+#define __AI_ICON_ATLAS_H
+
+#include <glib-object.h>
+
+#include "ai-icon-encoder.h"
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_ATLAS		(ai_icon_atlas_get_type ())
+#define AI_ICON_ATLAS(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_ATLAS, AiIconAtlas))
+#define AI_ICON_ATLAS_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_ATLAS, AiIconAtlasClass))
+#define AI_IS_ICON_ATLAS(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_ATLAS))
+#define AI_IS_ICON_ATLAS_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_ATLAS))
+#define AI_ICON_ATLAS_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_ATLAS, AiIconAtlasClass))
+
+/* the number of icons across and down a full sheet */
+#define AI_ICON_ATLAS_DEFAULT_COLUMNS	16
+
+typedef struct _AiIconAtlasPrivate	AiIconAtlasPrivate;
+typedef struct _AiIconAtlas		AiIconAtlas;
+typedef struct _AiIconAtlasClass	AiIconAtlasClass;
+
+struct _AiIconAtlas
+{
+	 GObject		 parent;
+	 AiIconAtlasPrivate	*priv;
+};
+
+struct _AiIconAtlasClass
+{
+	GObjectClass		 parent_class;
+};
+
+/* where an icon ended up, the position is in pixels */
+typedef struct {
+	gchar			*name;
+	guint			 sheet;
+	guint			 x;
+	guint			 y;
+} AiIconAtlasEntry;
+
+GType		 ai_icon_atlas_get_type		  	(void);
+AiIconAtlas	*ai_icon_atlas_new			(void);
+void		 ai_icon_atlas_set_columns		(AiIconAtlas	*atlas,
+							 guint		 columns);
+void		 ai_icon_atlas_set_encoder		(AiIconAtlas	*atlas,
+							 AiIconEncoder	*encoder);
+gboolean	 ai_icon_atlas_build			(AiIconAtlas	*atlas,
+							 const gchar	*directory,
+							 guint		 size,
+							 const gchar	*prefix,
+							 GError		**error);
+GPtrArray	*ai_icon_atlas_get_entries		(AiIconAtlas	*atlas);
+guint		 ai_icon_atlas_get_sheets		(AiIconAtlas	*atlas);
+gchar		*ai_icon_atlas_get_sheet_filename	(const gchar	*prefix,
+							 guint		 sheet);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_ATLAS_H */
+
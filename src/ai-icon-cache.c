@@ -0,0 +1,264 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+
+#include "egg-debug.h"
+
+#include "ai-icon-cache.h"
+
+static void     ai_icon_cache_finalize	(GObject     *object);
+
+#define AI_ICON_CACHE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_CACHE, AiIconCachePrivate))
+
+/* bump this when the scaled output changes for the same settings */
+#define AI_ICON_CACHE_VERSION		1
+
+/*
+ * AiIconCachePrivate:
+ *
+ * Private #AiIconCache data
+ */
+struct _AiIconCachePrivate
+{
+	gchar				*directory;
+	guint				 hits;
+	guint				 misses;
+};
+
+G_DEFINE_TYPE (AiIconCache, ai_icon_cache, G_TYPE_OBJECT)
+
+/*
+ * ai_icon_cache_set_directory:
+ *
+ * Sets the cache directory, which is created if it does not exist. The
+ * directory can be shared between runs and repos.
+ */
+gboolean
+ai_icon_cache_set_directory (AiIconCache *cache, const gchar *directory, GError **error)
+{
+	gboolean ret = TRUE;
+	AiIconCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_CACHE (cache), FALSE);
+	g_return_val_if_fail (directory != NULL, FALSE);
+
+	if (g_mkdir_with_parents (directory, 0755) != 0) {
+		g_set_error (error, 1, 0, "cannot create %s", directory);
+		ret = FALSE;
+		goto out;
+	}
+	g_free (priv->directory);
+	priv->directory = g_strdup (directory);
+out:
+	return ret;
+}
+
+/*
+ * ai_icon_cache_get_checksum:
+ *
+ * Return value: the SHA1 of the file contents, or %NULL
+ */
+gchar *
+ai_icon_cache_get_checksum (const gchar *filename, GError **error)
+{
+	gboolean ret;
+	gchar *data = NULL;
+	gsize length;
+	gchar *checksum = NULL;
+
+	ret = g_file_get_contents (filename, &data, &length, error);
+	if (!ret)
+		goto out;
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, (const guchar *) data, length);
+out:
+	g_free (data);
+	return checksum;
+}
+
+/*
+ * ai_icon_cache_get_key:
+ * @checksum: the checksum of the source image
+ * @size: the target pixel size
+ * @settings: anything else that changes the output, e.g. the encoder settings
+ *
+ * Return value: the cache key
+ */
+gchar *
+ai_icon_cache_get_key (const gchar *checksum, guint size, const gchar *settings)
+{
+	g_return_val_if_fail (checksum != NULL, NULL);
+	return g_strdup_printf ("%s-%i-%s-v%i", checksum, size,
+				settings != NULL ? settings : "default", AI_ICON_CACHE_VERSION);
+}
+
+/*
+ * ai_icon_cache_get_filename:
+ *
+ * The entries are split by the first two characters so that no
+ * single directory gets too large.
+ */
+static gchar *
+ai_icon_cache_get_filename (AiIconCache *cache, const gchar *key)
+{
+	gchar *filename;
+	gchar *basename;
+	gchar prefix[3];
+
+	g_strlcpy (prefix, key, sizeof (prefix));
+	basename = g_strdup_printf ("%s.png", key);
+	filename = g_build_filename (cache->priv->directory, prefix, basename, NULL);
+	g_free (basename);
+	return filename;
+}
+
+/*
+ * ai_icon_cache_lookup:
+ *
+ * Return value: %TRUE if the key was found, and @data is set
+ */
+gboolean
+ai_icon_cache_lookup (AiIconCache *cache, const gchar *key, gchar **data, gsize *length)
+{
+	gboolean ret = FALSE;
+	gchar *filename = NULL;
+	AiIconCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_CACHE (cache), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+
+	if (priv->directory == NULL)
+		goto out;
+	filename = ai_icon_cache_get_filename (cache, key);
+	ret = g_file_get_contents (filename, data, length, NULL);
+out:
+	/* lookups happen from the compose worker threads */
+	if (ret)
+		g_atomic_int_inc ((gint *) &priv->hits);
+	else
+		g_atomic_int_inc ((gint *) &priv->misses);
+	egg_debug ("%s %s", ret ? "hit" : "miss", key);
+	g_free (filename);
+	return ret;
+}
+
+/*
+ * ai_icon_cache_store:
+ *
+ * Adds an entry. This is safe to call from any thread, and from more
+ * than one process, as the file is written atomically.
+ */
+gboolean
+ai_icon_cache_store (AiIconCache *cache, const gchar *key, const gchar *data, gsize length, GError **error)
+{
+	gboolean ret = TRUE;
+	gchar *filename = NULL;
+	gchar *dirname = NULL;
+	AiIconCachePrivate *priv = cache->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_CACHE (cache), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+
+	if (priv->directory == NULL)
+		goto out;
+	filename = ai_icon_cache_get_filename (cache, key);
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, 1, 0, "cannot create %s", dirname);
+		ret = FALSE;
+		goto out;
+	}
+	ret = g_file_set_contents (filename, data, length, error);
+out:
+	g_free (dirname);
+	g_free (filename);
+	return ret;
+}
+
+/*
+ * ai_icon_cache_get_hits:
+ */
+guint
+ai_icon_cache_get_hits (AiIconCache *cache)
+{
+	g_return_val_if_fail (AI_IS_ICON_CACHE (cache), 0);
+	return cache->priv->hits;
+}
+
+/*
+ * ai_icon_cache_get_misses:
+ */
+guint
+ai_icon_cache_get_misses (AiIconCache *cache)
+{
+	g_return_val_if_fail (AI_IS_ICON_CACHE (cache), 0);
+	return cache->priv->misses;
+}
+
+/*
+ * ai_icon_cache_class_init:
+ */
+static void
+ai_icon_cache_class_init (AiIconCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_cache_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconCachePrivate));
+}
+
+/*
+ * ai_icon_cache_init:
+ */
+static void
+ai_icon_cache_init (AiIconCache *cache)
+{
+	cache->priv = AI_ICON_CACHE_GET_PRIVATE (cache);
+}
+
+/*
+ * ai_icon_cache_finalize:
+ */
+static void
+ai_icon_cache_finalize (GObject *object)
+{
+	AiIconCache *cache = AI_ICON_CACHE (object);
+
+	g_free (cache->priv->directory);
+
+	G_OBJECT_CLASS (ai_icon_cache_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_cache_new:
+ *
+ * Return value: a new AiIconCache object.
+ */
+AiIconCache *
+ai_icon_cache_new (void)
+{
+	AiIconCache *cache;
+	cache = g_object_new (AI_TYPE_ICON_CACHE, NULL);
+	return AI_ICON_CACHE (cache);
+}
+
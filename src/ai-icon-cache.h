@@ -0,0 +1,76 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_ICON_CACHE_H
+#define __AI_ICON_CACHE_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_CACHE		(ai_icon_cache_get_type ())
+#define AI_ICON_CACHE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_CACHE, AiIconCache))
+#define AI_ICON_CACHE_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_CACHE, AiIconCacheClass))
+#define AI_IS_ICON_CACHE(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_CACHE))
+#define AI_IS_ICON_CACHE_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_CACHE))
+#define AI_ICON_CACHE_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_CACHE, AiIconCacheClass))
+
+typedef struct _AiIconCachePrivate	AiIconCachePrivate;
+typedef struct _AiIconCache		AiIconCache;
+typedef struct _AiIconCacheClass	AiIconCacheClass;
+
+struct _AiIconCache
+{
+	 GObject		 parent;
+	 AiIconCachePrivate	*priv;
+};
+
+struct _AiIconCacheClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_icon_cache_get_type		  	(void);
+AiIconCache	*ai_icon_cache_new			(void);
+gboolean	 ai_icon_cache_set_directory		(AiIconCache	*cache,
+							 const gchar	*directory,
+							 GError		**error);
+gchar		*ai_icon_cache_get_checksum		(const gchar	*filename,
+							 GError		**error);
+gchar		*ai_icon_cache_get_key			(const gchar	*checksum,
+							 guint		 size,
+							 const gchar	*settings);
+gboolean	 ai_icon_cache_lookup			(AiIconCache	*cache,
+							 const gchar	*key,
+							 gchar		**data,
+							 gsize		*length);
+gboolean	 ai_icon_cache_store			(AiIconCache	*cache,
+							 const gchar	*key,
+							 const gchar	*data,
+							 gsize		 length,
+							 GError		**error);
+guint		 ai_icon_cache_get_hits			(AiIconCache	*cache);
+guint		 ai_icon_cache_get_misses		(AiIconCache	*cache);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_CACHE_H */
+
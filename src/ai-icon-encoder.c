@@ -0,0 +1,621 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <glib-object.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#include <zlib.h>
+#endif
+
+#include "egg-debug.h"
+
+#include "ai-icon-encoder.h"
+
+static void     ai_icon_encoder_finalize	(GObject     *object);
+
+#ifdef HAVE_LIBPNG
+#define AI_ICON_ENCODER_BACKEND		"libpng"
+#else
+#define AI_ICON_ENCODER_BACKEND		"gdk"
+#endif
+
+#define AI_ICON_ENCODER_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_ENCODER, AiIconEncoderPrivate))
+
+/*
+ * AiIconEncoderPrivate:
+ *
+ * Private #AiIconEncoder data
+ */
+struct _AiIconEncoderPrivate
+{
+	gint				 compression;
+	AiIconEncoderFilter		 filter;
+	gboolean			 optimize;
+	gboolean			 dry_run;
+	guint				 threads;
+	AiIconCache			*cache;
+	GThreadPool			*pool;
+	GMutex				*mutex;
+	GError				*error;
+	guint				 count;
+	guint64				 size;
+};
+
+/*
+ * AiIconEncoderJob:
+ */
+typedef struct {
+	GdkPixbuf			*pixbuf;
+	gchar				*filename;
+	gchar				*key;
+} AiIconEncoderJob;
+
+G_DEFINE_TYPE (AiIconEncoder, ai_icon_encoder, G_TYPE_OBJECT)
+
+/*
+ * ai_icon_encoder_filter_from_string:
+ */
+AiIconEncoderFilter
+ai_icon_encoder_filter_from_string (const gchar *filter)
+{
+	if (filter == NULL || g_strcmp0 (filter, "default") == 0)
+		return AI_ICON_ENCODER_FILTER_DEFAULT;
+	if (g_strcmp0 (filter, "none") == 0)
+		return AI_ICON_ENCODER_FILTER_NONE;
+	if (g_strcmp0 (filter, "sub") == 0)
+		return AI_ICON_ENCODER_FILTER_SUB;
+	if (g_strcmp0 (filter, "up") == 0)
+		return AI_ICON_ENCODER_FILTER_UP;
+	if (g_strcmp0 (filter, "avg") == 0)
+		return AI_ICON_ENCODER_FILTER_AVG;
+	if (g_strcmp0 (filter, "paeth") == 0)
+		return AI_ICON_ENCODER_FILTER_PAETH;
+	if (g_strcmp0 (filter, "all") == 0)
+		return AI_ICON_ENCODER_FILTER_ALL;
+	return AI_ICON_ENCODER_FILTER_UNKNOWN;
+}
+
+#ifdef HAVE_LIBPNG
+/*
+ * ai_icon_encoder_png_write_cb:
+ */
+static void
+ai_icon_encoder_png_write_cb (png_structp png, png_bytep data, png_size_t length)
+{
+	GByteArray *array = (GByteArray *) png_get_io_ptr (png);
+	g_byte_array_append (array, data, length);
+}
+
+/*
+ * ai_icon_encoder_png_flush_cb:
+ */
+static void
+ai_icon_encoder_png_flush_cb (png_structp png)
+{
+}
+
+/*
+ * ai_icon_encoder_png_filter:
+ */
+static gint
+ai_icon_encoder_png_filter (AiIconEncoderFilter filter)
+{
+	if (filter == AI_ICON_ENCODER_FILTER_NONE)
+		return PNG_FILTER_NONE;
+	if (filter == AI_ICON_ENCODER_FILTER_SUB)
+		return PNG_FILTER_SUB;
+	if (filter == AI_ICON_ENCODER_FILTER_UP)
+		return PNG_FILTER_UP;
+	if (filter == AI_ICON_ENCODER_FILTER_AVG)
+		return PNG_FILTER_AVG;
+	if (filter == AI_ICON_ENCODER_FILTER_PAETH)
+		return PNG_FILTER_PAETH;
+	return PNG_ALL_FILTERS;
+}
+
+/*
+ * ai_icon_encoder_is_opaque:
+ */
+static gboolean
+ai_icon_encoder_is_opaque (GdkPixbuf *pixbuf)
+{
+	const guint8 *row;
+	guint rowstride;
+	guint width;
+	guint height;
+	guint x, y;
+
+	if (!gdk_pixbuf_get_has_alpha (pixbuf))
+		return TRUE;
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	for (y=0; y<height; y++) {
+		row = gdk_pixbuf_get_pixels (pixbuf) + y * rowstride;
+		for (x=0; x<width; x++) {
+			if (row[x*4+3] != 0xff)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * ai_icon_encoder_encode_png:
+ *
+ * Encodes to @array with the given zlib settings. Only the error path
+ * jumps back here, so nothing needs to survive the longjmp.
+ */
+static gboolean
+ai_icon_encoder_encode_png (GdkPixbuf *pixbuf, gint level, gint filter, gint strategy,
+			    gboolean opaque, GByteArray *array)
+{
+	png_structp png;
+	png_infop info;
+	const guint8 *pixels;
+	guint rowstride;
+	guint height;
+	guint y;
+
+	png = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png == NULL)
+		return FALSE;
+	info = png_create_info_struct (png);
+	if (info == NULL || setjmp (png_jmpbuf (png))) {
+		png_destroy_write_struct (&png, &info);
+		return FALSE;
+	}
+
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+
+	png_set_write_fn (png, array, ai_icon_encoder_png_write_cb, ai_icon_encoder_png_flush_cb);
+	if (level >= 0)
+		png_set_compression_level (png, level);
+	png_set_compression_strategy (png, strategy);
+	png_set_filter (png, PNG_FILTER_TYPE_BASE, filter);
+	png_set_IHDR (png, info, gdk_pixbuf_get_width (pixbuf), height, 8,
+		      opaque ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_RGB_ALPHA,
+		      PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	png_write_info (png, info);
+
+	/* drop the alpha byte of each pixel when it carries nothing */
+	if (opaque && gdk_pixbuf_get_has_alpha (pixbuf))
+		png_set_filler (png, 0, PNG_FILLER_AFTER);
+
+	for (y=0; y<height; y++)
+		png_write_row (png, (png_bytep) (pixels + y * rowstride));
+	png_write_end (png, info);
+	png_destroy_write_struct (&png, &info);
+	return TRUE;
+}
+#endif
+
+/*
+ * ai_icon_encoder_encode:
+ *
+ * Encodes a pixbuf as PNG using the current settings. This is safe to
+ * call from any thread.
+ */
+gboolean
+ai_icon_encoder_encode (AiIconEncoder *encoder, GdkPixbuf *pixbuf, gchar **buffer, gsize *buffer_size, GError **error)
+{
+	gboolean ret = FALSE;
+	AiIconEncoderPrivate *priv = encoder->priv;
+#ifdef HAVE_LIBPNG
+	GByteArray *array;
+	GByteArray *best = NULL;
+	gboolean opaque;
+	guint i, j;
+	const gint filters[] = { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP,
+				 PNG_FILTER_AVG, PNG_FILTER_PAETH, PNG_ALL_FILTERS };
+	const gint strategies[] = { Z_DEFAULT_STRATEGY, Z_FILTERED };
+#else
+	gchar *compression;
+#endif
+
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), FALSE);
+	g_return_val_if_fail (pixbuf != NULL, FALSE);
+
+#ifdef HAVE_LIBPNG
+	opaque = ai_icon_encoder_is_opaque (pixbuf);
+
+	/* just use the settings we were given */
+	if (!priv->optimize) {
+		best = g_byte_array_new ();
+		ret = ai_icon_encoder_encode_png (pixbuf, priv->compression,
+						  ai_icon_encoder_png_filter (priv->filter),
+						  Z_DEFAULT_STRATEGY, opaque, best);
+		goto out;
+	}
+
+	/* try every filter and strategy at the highest level, keeping the smallest */
+	for (i=0; i<G_N_ELEMENTS (filters); i++) {
+		for (j=0; j<G_N_ELEMENTS (strategies); j++) {
+			array = g_byte_array_new ();
+			ret = ai_icon_encoder_encode_png (pixbuf, 9, filters[i], strategies[j], opaque, array);
+			if (!ret || (best != NULL && array->len >= best->len)) {
+				g_byte_array_free (array, TRUE);
+				continue;
+			}
+			if (best != NULL)
+				g_byte_array_free (best, TRUE);
+			best = array;
+		}
+	}
+	ret = (best != NULL);
+out:
+	if (!ret) {
+		g_set_error_literal (error, 1, 0, "failed to encode PNG");
+		if (best != NULL)
+			g_byte_array_free (best, TRUE);
+		return FALSE;
+	}
+	*buffer_size = best->len;
+	*buffer = (gchar *) g_byte_array_free (best, FALSE);
+#else
+	/* gdk-pixbuf cannot choose the filter, so only the level is used */
+	if (priv->optimize)
+		compression = g_strdup ("9");
+	else if (priv->compression >= 0)
+		compression = g_strdup_printf ("%i", priv->compression);
+	else
+		compression = NULL;
+	ret = gdk_pixbuf_save_to_buffer (pixbuf, buffer, buffer_size, "png", error,
+					 compression != NULL ? "compression" : NULL, compression, NULL);
+	g_free (compression);
+#endif
+	return ret;
+}
+
+/*
+ * ai_icon_encoder_process_cb:
+ */
+static void
+ai_icon_encoder_process_cb (gpointer data, gpointer user_data)
+{
+	gboolean ret;
+	gchar *buffer = NULL;
+	gsize buffer_size = 0;
+	GError *error = NULL;
+	AiIconEncoderJob *job = (AiIconEncoderJob *) data;
+	AiIconEncoder *encoder = AI_ICON_ENCODER (user_data);
+	AiIconEncoderPrivate *priv = encoder->priv;
+
+	ret = ai_icon_encoder_encode (encoder, job->pixbuf, &buffer, &buffer_size, &error);
+
+	/* the cache is only an optimisation, so failing is not fatal */
+	if (ret && job->key != NULL && priv->cache != NULL) {
+		if (!ai_icon_cache_store (priv->cache, job->key, buffer, buffer_size, &error)) {
+			egg_warning ("failed to cache %s: %s", job->key, error->message);
+			g_clear_error (&error);
+		}
+	}
+	if (ret && !priv->dry_run) {
+		egg_debug ("saving to %s", job->filename);
+		ret = g_file_set_contents (job->filename, buffer, buffer_size, &error);
+	}
+
+	/* only the first error is kept */
+	g_mutex_lock (priv->mutex);
+	if (ret) {
+		priv->count++;
+		priv->size += buffer_size;
+	} else if (priv->error == NULL) {
+		g_set_error (&priv->error, 1, 0, "cannot save %s: %s", job->filename, error->message);
+	}
+	g_mutex_unlock (priv->mutex);
+
+	if (error != NULL)
+		g_error_free (error);
+	g_free (buffer);
+	g_object_unref (job->pixbuf);
+	g_free (job->filename);
+	g_free (job->key);
+	g_slice_free (AiIconEncoderJob, job);
+}
+
+/*
+ * ai_icon_encoder_add_cached:
+ * @key: the cache key, or %NULL
+ *
+ * Queues a pixbuf to be encoded and saved to @filename. If a cache has
+ * been set the encoded data is also stored with @key. Call
+ * ai_icon_encoder_wait() to find out if it succeeded.
+ */
+gboolean
+ai_icon_encoder_add_cached (AiIconEncoder *encoder, GdkPixbuf *pixbuf, const gchar *filename, const gchar *key, GError **error)
+{
+	gboolean ret = TRUE;
+	AiIconEncoderJob *job;
+	AiIconEncoderPrivate *priv = encoder->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), FALSE);
+	g_return_val_if_fail (pixbuf != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* started on demand so the settings can be changed until now */
+	if (priv->pool == NULL) {
+		priv->pool = g_thread_pool_new (ai_icon_encoder_process_cb, encoder, priv->threads, TRUE, error);
+		if (priv->pool == NULL) {
+			ret = FALSE;
+			goto out;
+		}
+	}
+
+	job = g_slice_new (AiIconEncoderJob);
+	job->pixbuf = g_object_ref (pixbuf);
+	job->filename = g_strdup (filename);
+	job->key = g_strdup (key);
+	g_thread_pool_push (priv->pool, job, NULL);
+out:
+	return ret;
+}
+
+/*
+ * ai_icon_encoder_add:
+ *
+ * Queues a pixbuf to be encoded and saved to @filename.
+ */
+gboolean
+ai_icon_encoder_add (AiIconEncoder *encoder, GdkPixbuf *pixbuf, const gchar *filename, GError **error)
+{
+	return ai_icon_encoder_add_cached (encoder, pixbuf, filename, NULL, error);
+}
+
+/*
+ * ai_icon_encoder_wait:
+ *
+ * Waits for all the queued icons to be written.
+ *
+ * Return value: %FALSE if any of the icons could not be encoded or saved
+ */
+gboolean
+ai_icon_encoder_wait (AiIconEncoder *encoder, GError **error)
+{
+	AiIconEncoderPrivate *priv = encoder->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), FALSE);
+
+	if (priv->pool != NULL) {
+		g_thread_pool_free (priv->pool, FALSE, TRUE);
+		priv->pool = NULL;
+	}
+	if (priv->error != NULL) {
+		g_propagate_error (error, priv->error);
+		priv->error = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * ai_icon_encoder_set_compression:
+ *
+ * Sets the zlib level from 0 to 9, or -1 for the default.
+ */
+void
+ai_icon_encoder_set_compression (AiIconEncoder *encoder, gint compression)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	g_return_if_fail (compression >= -1 && compression <= 9);
+	encoder->priv->compression = compression;
+}
+
+/*
+ * ai_icon_encoder_set_filter:
+ */
+void
+ai_icon_encoder_set_filter (AiIconEncoder *encoder, AiIconEncoderFilter filter)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	g_return_if_fail (filter != AI_ICON_ENCODER_FILTER_UNKNOWN);
+#ifndef HAVE_LIBPNG
+	if (filter != AI_ICON_ENCODER_FILTER_DEFAULT)
+		egg_warning ("not built with libpng, so the filter cannot be set");
+#endif
+	encoder->priv->filter = filter;
+}
+
+/*
+ * ai_icon_encoder_set_optimize:
+ *
+ * Tries all the lossless encodings of each icon and keeps the smallest.
+ */
+void
+ai_icon_encoder_set_optimize (AiIconEncoder *encoder, gboolean optimize)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	encoder->priv->optimize = optimize;
+}
+
+/*
+ * ai_icon_encoder_set_dry_run:
+ *
+ * Encodes the icons to find the size, but does not write them.
+ */
+void
+ai_icon_encoder_set_dry_run (AiIconEncoder *encoder, gboolean dry_run)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	encoder->priv->dry_run = dry_run;
+}
+
+/*
+ * ai_icon_encoder_get_dry_run:
+ */
+gboolean
+ai_icon_encoder_get_dry_run (AiIconEncoder *encoder)
+{
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), FALSE);
+	return encoder->priv->dry_run;
+}
+
+/*
+ * ai_icon_encoder_set_threads:
+ *
+ * Sets the number of threads, which takes effect for the next batch.
+ */
+void
+ai_icon_encoder_set_threads (AiIconEncoder *encoder, guint threads)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	g_return_if_fail (threads > 0);
+	encoder->priv->threads = threads;
+}
+
+/*
+ * ai_icon_encoder_set_cache:
+ *
+ * Stores everything encoded with a key in @cache.
+ */
+void
+ai_icon_encoder_set_cache (AiIconEncoder *encoder, AiIconCache *cache)
+{
+	g_return_if_fail (AI_IS_ICON_ENCODER (encoder));
+	g_return_if_fail (AI_IS_ICON_CACHE (cache));
+
+	if (encoder->priv->cache != NULL)
+		g_object_unref (encoder->priv->cache);
+	encoder->priv->cache = g_object_ref (cache);
+}
+
+/*
+ * ai_icon_encoder_get_settings_id:
+ *
+ * Return value: a string that changes when the settings change the
+ * encoded output, for use in cache keys
+ */
+gchar *
+ai_icon_encoder_get_settings_id (AiIconEncoder *encoder)
+{
+	AiIconEncoderPrivate *priv = encoder->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), NULL);
+
+	/* optimizing ignores the level and the filter */
+	if (priv->optimize)
+		return g_strdup_printf ("%s-optimize", AI_ICON_ENCODER_BACKEND);
+	return g_strdup_printf ("%s-c%i-f%i", AI_ICON_ENCODER_BACKEND, priv->compression, priv->filter);
+}
+
+/*
+ * ai_icon_encoder_get_count:
+ *
+ * Return value: the number of icons encoded so far
+ */
+guint
+ai_icon_encoder_get_count (AiIconEncoder *encoder)
+{
+	guint count;
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), 0);
+	g_mutex_lock (encoder->priv->mutex);
+	count = encoder->priv->count;
+	g_mutex_unlock (encoder->priv->mutex);
+	return count;
+}
+
+/*
+ * ai_icon_encoder_get_size:
+ *
+ * Return value: the total size in bytes of the icons encoded so far
+ */
+guint64
+ai_icon_encoder_get_size (AiIconEncoder *encoder)
+{
+	guint64 size;
+	g_return_val_if_fail (AI_IS_ICON_ENCODER (encoder), 0);
+	g_mutex_lock (encoder->priv->mutex);
+	size = encoder->priv->size;
+	g_mutex_unlock (encoder->priv->mutex);
+	return size;
+}
+
+/*
+ * ai_icon_encoder_class_init:
+ */
+static void
+ai_icon_encoder_class_init (AiIconEncoderClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_encoder_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconEncoderPrivate));
+}
+
+/*
+ * ai_icon_encoder_init:
+ */
+static void
+ai_icon_encoder_init (AiIconEncoder *encoder)
+{
+	glong processors;
+
+	encoder->priv = AI_ICON_ENCODER_GET_PRIVATE (encoder);
+	encoder->priv->compression = -1;
+	encoder->priv->filter = AI_ICON_ENCODER_FILTER_DEFAULT;
+	encoder->priv->mutex = g_mutex_new ();
+
+	/* one thread per processor */
+	processors = sysconf (_SC_NPROCESSORS_ONLN);
+	encoder->priv->threads = (processors > 0) ? processors : 1;
+}
+
+/*
+ * ai_icon_encoder_finalize:
+ */
+static void
+ai_icon_encoder_finalize (GObject *object)
+{
+	AiIconEncoder *encoder = AI_ICON_ENCODER (object);
+	AiIconEncoderPrivate *priv = encoder->priv;
+
+	/* never leave threads writing behind us */
+	if (priv->pool != NULL)
+		g_thread_pool_free (priv->pool, FALSE, TRUE);
+	if (priv->error != NULL)
+		g_error_free (priv->error);
+	if (priv->cache != NULL)
+		g_object_unref (priv->cache);
+	g_mutex_free (priv->mutex);
+
+	G_OBJECT_CLASS (ai_icon_encoder_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_encoder_new:
+ *
+ * Return value: a new AiIconEncoder object.
+ */
+AiIconEncoder *
+ai_icon_encoder_new (void)
+{
+	AiIconEncoder *encoder;
+	encoder = g_object_new (AI_TYPE_ICON_ENCODER, NULL);
+	return AI_ICON_ENCODER (encoder);
+}
+
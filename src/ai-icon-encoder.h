@@ -0,0 +1,104 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_ICON_ENCODER_H
+#define __AI_ICON_ENCODER_H
+
+#include <glib-object.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "ai-icon-cache.h"
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_ENCODER		(ai_icon_encoder_get_type ())
+#define AI_ICON_ENCODER(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_ENCODER, AiIconEncoder))
+#define AI_ICON_ENCODER_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_ENCODER, AiIconEncoderClass))
+#define AI_IS_ICON_ENCODER(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_ENCODER))
+#define AI_IS_ICON_ENCODER_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_ENCODER))
+#define AI_ICON_ENCODER_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_ENCODER, AiIconEncoderClass))
+
+typedef struct _AiIconEncoderPrivate	AiIconEncoderPrivate;
+typedef struct _AiIconEncoder		AiIconEncoder;
+typedef struct _AiIconEncoderClass	AiIconEncoderClass;
+
+struct _AiIconEncoder
+{
+	 GObject			 parent;
+	 AiIconEncoderPrivate		*priv;
+};
+
+struct _AiIconEncoderClass
+{
+	GObjectClass			 parent_class;
+};
+
+typedef enum {
+	AI_ICON_ENCODER_FILTER_DEFAULT,
+	AI_ICON_ENCODER_FILTER_NONE,
+	AI_ICON_ENCODER_FILTER_SUB,
+	AI_ICON_ENCODER_FILTER_UP,
+	AI_ICON_ENCODER_FILTER_AVG,
+	AI_ICON_ENCODER_FILTER_PAETH,
+	AI_ICON_ENCODER_FILTER_ALL,
+	AI_ICON_ENCODER_FILTER_UNKNOWN
+} AiIconEncoderFilter;
+
+GType		 ai_icon_encoder_get_type		(void);
+AiIconEncoder	*ai_icon_encoder_new			(void);
+AiIconEncoderFilter ai_icon_encoder_filter_from_string	(const gchar	*filter);
+void		 ai_icon_encoder_set_compression	(AiIconEncoder	*encoder,
+							 gint		 compression);
+void		 ai_icon_encoder_set_filter		(AiIconEncoder	*encoder,
+							 AiIconEncoderFilter filter);
+void		 ai_icon_encoder_set_optimize		(AiIconEncoder	*encoder,
+							 gboolean	 optimize);
+void		 ai_icon_encoder_set_dry_run		(AiIconEncoder	*encoder,
+							 gboolean	 dry_run);
+gboolean	 ai_icon_encoder_get_dry_run		(AiIconEncoder	*encoder);
+void		 ai_icon_encoder_set_threads		(AiIconEncoder	*encoder,
+							 guint		 threads);
+void		 ai_icon_encoder_set_cache		(AiIconEncoder	*encoder,
+							 AiIconCache	*cache);
+gchar		*ai_icon_encoder_get_settings_id	(AiIconEncoder	*encoder);
+gboolean	 ai_icon_encoder_encode			(AiIconEncoder	*encoder,
+							 GdkPixbuf	*pixbuf,
+							 gchar		**buffer,
+							 gsize		*buffer_size,
+							 GError		**error);
+gboolean	 ai_icon_encoder_add			(AiIconEncoder	*encoder,
+							 GdkPixbuf	*pixbuf,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 ai_icon_encoder_add_cached		(AiIconEncoder	*encoder,
+							 GdkPixbuf	*pixbuf,
+							 const gchar	*filename,
+							 const gchar	*key,
+							 GError		**error);
+gboolean	 ai_icon_encoder_wait			(AiIconEncoder	*encoder,
+							 GError		**error);
+guint		 ai_icon_encoder_get_count		(AiIconEncoder	*encoder);
+guint64		 ai_icon_encoder_get_size		(AiIconEncoder	*encoder);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_ENCODER_H */
+
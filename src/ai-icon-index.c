@@ -0,0 +1,505 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-common.h"
+#include "ai-icon-index.h"
+
+static void     ai_icon_index_finalize	(GObject     *object);
+
+#define AI_ICON_INDEX_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_INDEX, AiIconIndexPrivate))
+
+/*
+ * AiIconIndexPrivate:
+ *
+ * Private #AiIconIndex data
+ */
+struct _AiIconIndexPrivate
+{
+	GPtrArray			*items;
+	GHashTable			*names;
+	GHashTable			*paths;
+};
+
+G_DEFINE_TYPE (AiIconIndex, ai_icon_index, G_TYPE_OBJECT)
+
+/* in order of preference */
+static const gchar *ai_icon_index_formats[] = { "png", "svg", "svgz", "xpm", NULL };
+
+/*
+ * ai_icon_index_item_free:
+ */
+static void
+ai_icon_index_item_free (AiIconIndexItem *item)
+{
+	g_free (item->path);
+	g_free (item->theme);
+	g_slice_free (AiIconIndexItem, item);
+}
+
+/*
+ * ai_icon_index_get_format:
+ *
+ * Return value: the static format string for a filename, or %NULL if
+ * it is not an icon we can use.
+ */
+static const gchar *
+ai_icon_index_get_format (const gchar *filename)
+{
+	const gchar *ext;
+	guint i;
+
+	ext = strrchr (filename, '.');
+	if (ext == NULL)
+		return NULL;
+	for (i=0; ai_icon_index_formats[i] != NULL; i++) {
+		if (g_ascii_strcasecmp (ext + 1, ai_icon_index_formats[i]) == 0)
+			return ai_icon_index_formats[i];
+	}
+	return NULL;
+}
+
+/*
+ * ai_icon_index_get_format_rank:
+ */
+static guint
+ai_icon_index_get_format_rank (const gchar *format)
+{
+	guint i;
+	for (i=0; ai_icon_index_formats[i] != NULL; i++) {
+		if (ai_icon_index_formats[i] == format)
+			break;
+	}
+	return i;
+}
+
+/*
+ * ai_icon_index_parse_size:
+ *
+ * Parses a theme directory name such as "48x48" or "48x48@2".
+ */
+static gboolean
+ai_icon_index_parse_size (const gchar *component, guint *size)
+{
+	gchar *end;
+	guint64 width;
+	guint64 height;
+	guint64 scale = 1;
+
+	width = g_ascii_strtoull (component, &end, 10);
+	if (end == component || *end != 'x')
+		return FALSE;
+	component = end + 1;
+	height = g_ascii_strtoull (component, &end, 10);
+	if (end == component || width != height)
+		return FALSE;
+	if (*end == '@') {
+		component = end + 1;
+		scale = g_ascii_strtoull (component, &end, 10);
+		if (end == component || scale == 0)
+			return FALSE;
+	}
+	if (*end != '\0')
+		return FALSE;
+	*size = width * scale;
+	return TRUE;
+}
+
+/*
+ * ai_icon_index_add_path:
+ *
+ * Adds a file, relative to the package root, to the index. Files that
+ * are not in an icon or pixmap directory are ignored.
+ */
+void
+ai_icon_index_add_path (AiIconIndex *icon_index, const gchar *path)
+{
+	const gchar *format;
+	const gchar *rest;
+	const gchar *basename;
+	gchar **split = NULL;
+	gchar *name = NULL;
+	guint len;
+	guint i;
+	AiIconIndexItem *item;
+	GPtrArray *array;
+	AiIconIndexPrivate *priv = icon_index->priv;
+
+	g_return_if_fail (AI_IS_ICON_INDEX (icon_index));
+	g_return_if_fail (path != NULL);
+
+	/* normalise */
+	while (path[0] == '/')
+		path++;
+	if (g_str_has_prefix (path, "./"))
+		path += 2;
+
+	/* only interested in images */
+	basename = strrchr (path, '/');
+	basename = (basename != NULL) ? basename + 1 : path;
+	format = ai_icon_index_get_format (basename);
+	if (format == NULL)
+		goto out;
+
+	item = g_slice_new0 (AiIconIndexItem);
+	item->format = format;
+
+	/* ICONS_DIR/[theme/.../]name.ext */
+	len = strlen (ICONS_DIR) - 1;
+	if (strncmp (path, ICONS_DIR + 1, len) == 0 && path[len] == '/') {
+		rest = path + len + 1;
+		split = g_strsplit (rest, "/", -1);
+		len = g_strv_length (split);
+		if (len == 1) {
+			item->kind = AI_ICON_INDEX_KIND_UNTHEMED;
+		} else {
+			item->kind = AI_ICON_INDEX_KIND_THEME;
+			item->theme = g_strdup (split[0]);
+
+			/* size and context can be in either order */
+			for (i=1; i<len-1; i++) {
+				if (g_strcmp0 (split[i], "scalable") == 0) {
+					item->scalable = TRUE;
+					break;
+				}
+				if (ai_icon_index_parse_size (split[i], &item->size))
+					break;
+			}
+		}
+		name = g_strndup (basename, strlen (basename) - strlen (format) - 1);
+		goto add;
+	}
+
+	/* PIXMAPS_DIR/[subdir/]name.ext, subdirectories are part of the name */
+	len = strlen (PIXMAPS_DIR) - 1;
+	if (strncmp (path, PIXMAPS_DIR + 1, len) == 0 && path[len] == '/') {
+		rest = path + len + 1;
+		item->kind = AI_ICON_INDEX_KIND_PIXMAPS;
+		name = g_strndup (rest, strlen (rest) - strlen (format) - 1);
+		goto add;
+	}
+
+	/* not an icon location */
+	ai_icon_index_item_free (item);
+	goto out;
+add:
+	item->path = g_strdup (path);
+	g_ptr_array_add (priv->items, item);
+	g_hash_table_insert (priv->paths, item->path, item);
+	array = g_hash_table_lookup (priv->names, name);
+	if (array == NULL) {
+		array = g_ptr_array_new ();
+		g_hash_table_insert (priv->names, name, array);
+		name = NULL;
+	}
+	g_ptr_array_add (array, item);
+out:
+	g_free (name);
+	g_strfreev (split);
+}
+
+/*
+ * ai_icon_index_add_directory:
+ */
+static void
+ai_icon_index_add_directory (AiIconIndex *icon_index, const gchar *root, const gchar *relative)
+{
+	GDir *dir;
+	const gchar *filename;
+	gchar *path;
+	gchar *tmp;
+
+	/* a symlink loop in a package would otherwise recurse forever */
+	path = g_build_filename (root, relative, NULL);
+	if (g_file_test (path, G_FILE_TEST_IS_SYMLINK))
+		goto out;
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		goto out;
+
+	while ((filename = g_dir_read_name (dir))) {
+		tmp = g_build_filename (relative, filename, NULL);
+
+		/* images are never directories, so save a stat */
+		if (ai_icon_index_get_format (filename) != NULL)
+			ai_icon_index_add_path (icon_index, tmp);
+		else
+			ai_icon_index_add_directory (icon_index, root, tmp);
+		g_free (tmp);
+	}
+	g_dir_close (dir);
+out:
+	g_free (path);
+}
+
+/*
+ * ai_icon_index_add_root:
+ *
+ * Walks the icon and pixmap trees of a package root once.
+ */
+void
+ai_icon_index_add_root (AiIconIndex *icon_index, const gchar *root)
+{
+	g_return_if_fail (AI_IS_ICON_INDEX (icon_index));
+	g_return_if_fail (root != NULL);
+
+	ai_icon_index_add_directory (icon_index, root, ICONS_DIR);
+	ai_icon_index_add_directory (icon_index, root, PIXMAPS_DIR);
+	egg_debug ("indexed %i icons in %s", icon_index->priv->items->len, root);
+}
+
+/*
+ * ai_icon_index_get_lookup_name:
+ */
+static gchar *
+ai_icon_index_get_lookup_name (const gchar *icon_name)
+{
+	const gchar *format;
+
+	/* Icon=foo.png is common, even though it is not allowed */
+	format = ai_icon_index_get_format (icon_name);
+	if (format == NULL)
+		return g_strdup (icon_name);
+	return g_strndup (icon_name, strlen (icon_name) - strlen (format) - 1);
+}
+
+/*
+ * ai_icon_index_get_size_rank:
+ *
+ * Lower is better. Exact sizes are preferred to scalable icons, which
+ * are preferred to the closest larger size and only then the closest
+ * smaller size, as scaling up looks much worse than scaling down.
+ */
+static guint
+ai_icon_index_get_size_rank (const AiIconIndexItem *item, guint size)
+{
+	/* looking for a scalable icon */
+	if (size == 0) {
+		if (item->scalable)
+			return 0;
+		size = 512;
+	}
+	if (!item->scalable && item->size == size)
+		return 0;
+	if (item->scalable)
+		return 1;
+
+	/* pixmaps and some themes do not tell us the size */
+	if (item->size == 0)
+		return G_MAXUINT;
+	if (item->size > size)
+		return 2 + item->size - size;
+	return G_MAXUINT16 + size - item->size;
+}
+
+/*
+ * ai_icon_index_compare:
+ *
+ * This follows the icon theme lookup rules: every directory of a theme
+ * is tried before the next theme, and unthemed icons and pixmaps are
+ * only used as a fallback. We have no user theme at generation time,
+ * so hicolor goes first and any other themes follow in name order.
+ */
+static gint
+ai_icon_index_compare (const AiIconIndexItem *item1, const AiIconIndexItem *item2, guint size)
+{
+	guint rank1;
+	guint rank2;
+	gint retval;
+
+	/* themes, then unthemed, then pixmaps */
+	if (item1->kind != item2->kind)
+		return item1->kind < item2->kind ? -1 : 1;
+
+	/* hicolor, then other themes */
+	if (item1->kind == AI_ICON_INDEX_KIND_THEME) {
+		rank1 = g_strcmp0 (item1->theme, "hicolor") == 0 ? 0 : 1;
+		rank2 = g_strcmp0 (item2->theme, "hicolor") == 0 ? 0 : 1;
+		if (rank1 != rank2)
+			return rank1 < rank2 ? -1 : 1;
+		retval = g_strcmp0 (item1->theme, item2->theme);
+		if (retval != 0)
+			return retval;
+	}
+
+	/* closest size */
+	rank1 = ai_icon_index_get_size_rank (item1, size);
+	rank2 = ai_icon_index_get_size_rank (item2, size);
+	if (rank1 != rank2)
+		return rank1 < rank2 ? -1 : 1;
+
+	/* best format */
+	rank1 = ai_icon_index_get_format_rank (item1->format);
+	rank2 = ai_icon_index_get_format_rank (item2->format);
+	if (rank1 != rank2)
+		return rank1 < rank2 ? -1 : 1;
+	return 0;
+}
+
+/*
+ * ai_icon_index_lookup:
+ *
+ * Finds the best icon for a given pixel size, where a size of 0 means
+ * a scalable icon is wanted. Absolute paths are looked up directly.
+ *
+ * Return value: the icon, or %NULL. Do not free.
+ */
+const AiIconIndexItem *
+ai_icon_index_lookup (AiIconIndex *icon_index, const gchar *icon_name, guint size)
+{
+	const AiIconIndexItem *best = NULL;
+	const AiIconIndexItem *item;
+	GPtrArray *array;
+	gchar *name;
+	guint i;
+
+	g_return_val_if_fail (AI_IS_ICON_INDEX (icon_index), NULL);
+	g_return_val_if_fail (icon_name != NULL, NULL);
+
+	/* Icon=/usr/share/pixmaps/foo.png */
+	if (icon_name[0] == '/')
+		return g_hash_table_lookup (icon_index->priv->paths, icon_name + 1);
+
+	name = ai_icon_index_get_lookup_name (icon_name);
+	array = g_hash_table_lookup (icon_index->priv->names, name);
+	if (array == NULL)
+		goto out;
+	for (i=0; i<array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		if (best == NULL || ai_icon_index_compare (item, best, size) < 0)
+			best = item;
+	}
+out:
+	g_free (name);
+	return best;
+}
+
+/*
+ * ai_icon_index_lookup_exact:
+ *
+ * Finds an icon of exactly the given size in a theme, where a size of 0
+ * means the scalable version.
+ *
+ * Return value: the icon, or %NULL. Do not free.
+ */
+const AiIconIndexItem *
+ai_icon_index_lookup_exact (AiIconIndex *icon_index, const gchar *icon_name, const gchar *theme, guint size)
+{
+	const AiIconIndexItem *best = NULL;
+	const AiIconIndexItem *item;
+	GPtrArray *array;
+	gchar *name;
+	guint i;
+
+	g_return_val_if_fail (AI_IS_ICON_INDEX (icon_index), NULL);
+	g_return_val_if_fail (icon_name != NULL, NULL);
+	g_return_val_if_fail (theme != NULL, NULL);
+
+	name = ai_icon_index_get_lookup_name (icon_name);
+	array = g_hash_table_lookup (icon_index->priv->names, name);
+	if (array == NULL)
+		goto out;
+	for (i=0; i<array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		if (item->kind != AI_ICON_INDEX_KIND_THEME ||
+		    g_strcmp0 (item->theme, theme) != 0)
+			continue;
+		if (size == 0 && !item->scalable)
+			continue;
+		if (size != 0 && (item->scalable || item->size != size))
+			continue;
+		if (best == NULL ||
+		    ai_icon_index_get_format_rank (item->format) < ai_icon_index_get_format_rank (best->format))
+			best = item;
+	}
+out:
+	g_free (name);
+	return best;
+}
+
+/*
+ * ai_icon_index_get_length:
+ */
+guint
+ai_icon_index_get_length (AiIconIndex *icon_index)
+{
+	g_return_val_if_fail (AI_IS_ICON_INDEX (icon_index), 0);
+	return icon_index->priv->items->len;
+}
+
+/*
+ * ai_icon_index_class_init:
+ */
+static void
+ai_icon_index_class_init (AiIconIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_index_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconIndexPrivate));
+}
+
+/*
+ * ai_icon_index_init:
+ */
+static void
+ai_icon_index_init (AiIconIndex *icon_index)
+{
+	icon_index->priv = AI_ICON_INDEX_GET_PRIVATE (icon_index);
+	icon_index->priv->items = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_icon_index_item_free);
+	icon_index->priv->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	icon_index->priv->paths = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+/*
+ * ai_icon_index_finalize:
+ */
+static void
+ai_icon_index_finalize (GObject *object)
+{
+	AiIconIndex *icon_index = AI_ICON_INDEX (object);
+	AiIconIndexPrivate *priv = icon_index->priv;
+
+	g_hash_table_unref (priv->paths);
+	g_hash_table_unref (priv->names);
+	g_ptr_array_unref (priv->items);
+
+	G_OBJECT_CLASS (ai_icon_index_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_index_new:
+ *
+ * Return value: a new AiIconIndex object.
+ */
+AiIconIndex *
+ai_icon_index_new (void)
+{
+	AiIconIndex *icon_index;
+	icon_index = g_object_new (AI_TYPE_ICON_INDEX, NULL);
+	return AI_ICON_INDEX (icon_index);
+}
+
@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AI_ICON_INDEX_H
+#define __AI_ICON_INDEX_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_INDEX		(ai_icon_index_get_type ())
+#define AI_ICON_INDEX(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_INDEX, AiIconIndex))
+#define AI_ICON_INDEX_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_INDEX, AiIconIndexClass))
+#define AI_IS_ICON_INDEX(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_INDEX))
+#define AI_IS_ICON_INDEX_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_INDEX))
+#define AI_ICON_INDEX_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_INDEX, AiIconIndexClass))
+
+typedef struct _AiIconIndexPrivate	AiIconIndexPrivate;
+typedef struct _AiIconIndex		AiIconIndex;
+typedef struct _AiIconIndexClass	AiIconIndexClass;
+
+struct _AiIconIndex
+{
+	 GObject		 parent;
+	 AiIconIndexPrivate	*priv;
+};
+
+struct _AiIconIndexClass
+{
+	GObjectClass		 parent_class;
+};
+
+typedef enum {
+	AI_ICON_INDEX_KIND_THEME,
+	AI_ICON_INDEX_KIND_UNTHEMED,
+	AI_ICON_INDEX_KIND_PIXMAPS
+} AiIconIndexKind;
+
+typedef struct {
+	gchar			*path;		/* relative to the package root */
+	gchar			*theme;		/* only set for AI_ICON_INDEX_KIND_THEME */
+	AiIconIndexKind		 kind;
+	guint			 size;		/* in pixels, 0 if not known */
+	gboolean		 scalable;
+	const gchar		*format;	/* "png", "svg", "svgz" or "xpm" */
+} AiIconIndexItem;
+
+GType			 ai_icon_index_get_type		(void);
+AiIconIndex		*ai_icon_index_new		(void);
+void			 ai_icon_index_add_path		(AiIconIndex	*icon_index,
+							 const gchar	*path);
+void			 ai_icon_index_add_root		(AiIconIndex	*icon_index,
+							 const gchar	*root);
+const AiIconIndexItem	*ai_icon_index_lookup		(AiIconIndex	*icon_index,
+							 const gchar	*icon_name,
+							 guint		 size);
+const AiIconIndexItem	*ai_icon_index_lookup_exact	(AiIconIndex	*icon_index,
+							 const gchar	*icon_name,
+							 const gchar	*theme,
+							 guint		 size);
+guint			 ai_icon_index_get_length	(AiIconIndex	*icon_index);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_INDEX_H */
@@ -0,0 +1,483 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-icon-pack.h"
+#include "ai-utils-private.h"
+
+static void     ai_icon_pack_finalize	(GObject     *object);
+
+#define AI_ICON_PACK_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ICON_PACK, AiIconPackPrivate))
+
+/*
+ * The file is laid out as:
+ *
+ *  header:	"AIPK", version, count, reserved
+ *  index:	count * { hash, name offset, data offset, data length }
+ *  names:	NUL-terminated icon names
+ *  data:	the icon files, concatenated
+ *
+ * All the fields are little-endian guint32s and the offsets are from the
+ * start of the file. The index is sorted by hash and then name, so a
+ * lookup is a binary search that hardly ever has to compare a string.
+ */
+#define AI_ICON_PACK_MAGIC		"AIPK"
+#define AI_ICON_PACK_VERSION		1
+#define AI_ICON_PACK_HEADER_SIZE	16
+#define AI_ICON_PACK_ENTRY_SIZE		16
+
+/*
+ * AiIconPackPrivate:
+ *
+ * Private #AiIconPack data
+ */
+struct _AiIconPackPrivate
+{
+	GMappedFile			*mapped;
+	const gchar			*data;
+	gsize				 length;
+	guint				 count;
+};
+
+/*
+ * AiIconPackItem:
+ *
+ * An icon waiting to be written by ai_icon_pack_build().
+ */
+typedef struct {
+	gchar		*name;
+	gchar		*data;
+	gsize		 length;
+	guint32		 hash;
+} AiIconPackItem;
+
+G_DEFINE_TYPE (AiIconPack, ai_icon_pack, G_TYPE_OBJECT)
+
+/*
+ * ai_icon_pack_hash:
+ *
+ * FNV-1a, as the hash is stored on disk it cannot be g_str_hash().
+ */
+static guint32
+ai_icon_pack_hash (const gchar *name)
+{
+	guint32 hash = 2166136261u;
+	const guchar *p;
+
+	for (p = (const guchar *) name; *p != '\0'; p++) {
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*
+ * ai_icon_pack_read_uint32:
+ *
+ * The mapping is only guaranteed to be aligned for the header.
+ */
+static guint32
+ai_icon_pack_read_uint32 (const gchar *data)
+{
+	guint32 value;
+	memcpy (&value, data, sizeof (value));
+	return GUINT32_FROM_LE (value);
+}
+
+/*
+ * ai_icon_pack_write_uint32:
+ */
+static void
+ai_icon_pack_write_uint32 (GString *string, guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	g_string_append_len (string, (const gchar *) &value, sizeof (value));
+}
+
+/*
+ * ai_icon_pack_reset:
+ */
+static void
+ai_icon_pack_reset (AiIconPack *pack)
+{
+	AiIconPackPrivate *priv = pack->priv;
+
+	if (priv->mapped != NULL) {
+		g_mapped_file_unref (priv->mapped);
+		priv->mapped = NULL;
+	}
+	priv->data = NULL;
+	priv->length = 0;
+	priv->count = 0;
+}
+
+/*
+ * ai_icon_pack_check:
+ *
+ * Checks every offset once, so lookups never have to.
+ */
+static gboolean
+ai_icon_pack_check (const gchar *data, gsize length, guint count, GError **error)
+{
+	gboolean ret = FALSE;
+	guint i;
+	guint64 name_offset;
+	guint64 data_offset;
+	guint64 data_length;
+	const gchar *entry;
+
+	if ((guint64) AI_ICON_PACK_HEADER_SIZE + (guint64) count * AI_ICON_PACK_ENTRY_SIZE > length) {
+		g_set_error (error, 1, 0, "index for %i icons is truncated", count);
+		goto out;
+	}
+	for (i=0; i<count; i++) {
+		entry = data + AI_ICON_PACK_HEADER_SIZE + i * AI_ICON_PACK_ENTRY_SIZE;
+		name_offset = ai_icon_pack_read_uint32 (entry + 4);
+		data_offset = ai_icon_pack_read_uint32 (entry + 8);
+		data_length = ai_icon_pack_read_uint32 (entry + 12);
+		if (name_offset >= length ||
+		    memchr (data + name_offset, '\0', length - name_offset) == NULL) {
+			g_set_error (error, 1, 0, "name of icon %i is out of range", i);
+			goto out;
+		}
+		if (data_offset + data_length > length) {
+			g_set_error (error, 1, 0, "data of icon %i is out of range", i);
+			goto out;
+		}
+	}
+	ret = TRUE;
+out:
+	return ret;
+}
+
+/*
+ * ai_icon_pack_load:
+ *
+ * Maps the pack, which is shared between every process using it. Any
+ * previously loaded pack is released, and with it all the data pointers
+ * returned by ai_icon_pack_lookup().
+ */
+gboolean
+ai_icon_pack_load (AiIconPack *pack, const gchar *filename, GError **error)
+{
+	gboolean ret = FALSE;
+	const gchar *data;
+	gsize length;
+	guint count;
+	GError *error_local = NULL;
+	AiIconPackPrivate *priv = pack->priv;
+
+	g_return_val_if_fail (AI_IS_ICON_PACK (pack), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	ai_icon_pack_reset (pack);
+
+	priv->mapped = g_mapped_file_new (filename, FALSE, &error_local);
+	if (priv->mapped == NULL) {
+		g_set_error (error, 1, 0, "cannot read %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+	data = g_mapped_file_get_contents (priv->mapped);
+	length = g_mapped_file_get_length (priv->mapped);
+
+	/* check header */
+	if (length < AI_ICON_PACK_HEADER_SIZE ||
+	    memcmp (data, AI_ICON_PACK_MAGIC, 4) != 0) {
+		g_set_error (error, 1, 0, "%s is not an icon pack", filename);
+		goto out;
+	}
+	if (ai_icon_pack_read_uint32 (data + 4) != AI_ICON_PACK_VERSION) {
+		g_set_error (error, 1, 0, "%s has unsupported version %i",
+			     filename, ai_icon_pack_read_uint32 (data + 4));
+		goto out;
+	}
+	count = ai_icon_pack_read_uint32 (data + 8);
+	ret = ai_icon_pack_check (data, length, count, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "%s is corrupt: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	priv->data = data;
+	priv->length = length;
+	priv->count = count;
+	egg_debug ("loaded %i icons from %s", count, filename);
+out:
+	if (!ret)
+		ai_icon_pack_reset (pack);
+	return ret;
+}
+
+/**
+ * ai_icon_pack_lookup:
+ * @pack: a #AiIconPack
+ * @name: the icon name without the extension, e.g. "gpm"
+ * @length: (out): the length of the icon data
+ *
+ * Return value: (array length=length) (element-type guint8) (transfer none):
+ * the icon data, which points into the mapped pack and is valid until the
+ * pack is reloaded or unreferenced, or %NULL if not found. Do not free.
+ */
+const gchar *
+ai_icon_pack_lookup (AiIconPack *pack, const gchar *name, gsize *length)
+{
+	guint32 hash;
+	guint32 tmp;
+	guint low = 0;
+	guint high;
+	guint mid;
+	gint cmp;
+	const gchar *entry;
+	AiIconPackPrivate *priv;
+
+	g_return_val_if_fail (AI_IS_ICON_PACK (pack), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	priv = pack->priv;
+	hash = ai_icon_pack_hash (name);
+	high = priv->count;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		entry = priv->data + AI_ICON_PACK_HEADER_SIZE + mid * AI_ICON_PACK_ENTRY_SIZE;
+
+		/* only compare the names when the hashes collide */
+		tmp = ai_icon_pack_read_uint32 (entry);
+		if (tmp != hash)
+			cmp = (hash < tmp) ? -1 : 1;
+		else
+			cmp = strcmp (name, priv->data + ai_icon_pack_read_uint32 (entry + 4));
+		if (cmp == 0) {
+			if (length != NULL)
+				*length = ai_icon_pack_read_uint32 (entry + 12);
+			return priv->data + ai_icon_pack_read_uint32 (entry + 8);
+		}
+		if (cmp < 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return NULL;
+}
+
+/*
+ * ai_icon_pack_get_count:
+ */
+guint
+ai_icon_pack_get_count (AiIconPack *pack)
+{
+	g_return_val_if_fail (AI_IS_ICON_PACK (pack), 0);
+	return pack->priv->count;
+}
+
+/*
+ * ai_icon_pack_item_free:
+ */
+static void
+ai_icon_pack_item_free (AiIconPackItem *item, gpointer user_data)
+{
+	g_free (item->name);
+	g_free (item->data);
+	g_free (item);
+}
+
+/*
+ * ai_icon_pack_item_sort_cb:
+ */
+static gint
+ai_icon_pack_item_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const AiIconPackItem *item1 = *((const AiIconPackItem **) a);
+	const AiIconPackItem *item2 = *((const AiIconPackItem **) b);
+
+	if (item1->hash != item2->hash)
+		return (item1->hash < item2->hash) ? -1 : 1;
+	return strcmp (item1->name, item2->name);
+}
+
+/*
+ * ai_icon_pack_build:
+ *
+ * Writes every icon in @directory into a single pack. The icons are keyed
+ * on the name without the extension, and when there is more than one
+ * format the first one in filename order wins, so "png" beats "svg".
+ * The pack is replaced atomically, so processes that have the old one
+ * mapped carry on using it.
+ */
+gboolean
+ai_icon_pack_build (const gchar *directory, const gchar *filename, guint *count, GError **error)
+{
+	gboolean ret = FALSE;
+	const gchar *tmp;
+	gchar *path;
+	gchar *dot;
+	guint i;
+	guint64 names_offset;
+	guint64 data_offset;
+	GPtrArray *filenames;
+	GPtrArray *items;
+	GString *string = NULL;
+	AiIconPackItem *item;
+	GError *error_local = NULL;
+
+	g_return_val_if_fail (directory != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	items = g_ptr_array_new ();
+	filenames = ai_utils_get_icon_files (directory, error);
+	if (filenames == NULL)
+		goto out;
+
+	for (i=0; i<filenames->len; i++) {
+		tmp = g_ptr_array_index (filenames, i);
+		item = g_new0 (AiIconPackItem, 1);
+		item->name = g_strdup (tmp);
+		dot = strrchr (item->name, '.');
+		if (dot != NULL)
+			*dot = '\0';
+		path = g_build_filename (directory, tmp, NULL);
+		ret = g_file_get_contents (path, &item->data, &item->length, &error_local);
+		g_free (path);
+		if (!ret) {
+			g_set_error (error, 1, 0, "cannot read %s: %s", tmp, error_local->message);
+			g_error_free (error_local);
+			ai_icon_pack_item_free (item, NULL);
+			goto out;
+		}
+		item->hash = ai_icon_pack_hash (item->name);
+		g_ptr_array_add (items, item);
+	}
+	g_ptr_array_sort (items, ai_icon_pack_item_sort_cb);
+
+	/* header */
+	string = g_string_new (AI_ICON_PACK_MAGIC);
+	ai_icon_pack_write_uint32 (string, AI_ICON_PACK_VERSION);
+	ai_icon_pack_write_uint32 (string, items->len);
+	ai_icon_pack_write_uint32 (string, 0);
+
+	/* the names follow the index and the data follows the names */
+	names_offset = AI_ICON_PACK_HEADER_SIZE + (guint64) items->len * AI_ICON_PACK_ENTRY_SIZE;
+	data_offset = names_offset;
+	for (i=0; i<items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		data_offset += strlen (item->name) + 1;
+	}
+
+	/* index */
+	for (i=0; i<items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		if (data_offset + item->length > G_MAXUINT32) {
+			g_set_error (error, 1, 0, "%s is too large for an icon pack", directory);
+			ret = FALSE;
+			goto out;
+		}
+		ai_icon_pack_write_uint32 (string, item->hash);
+		ai_icon_pack_write_uint32 (string, names_offset);
+		ai_icon_pack_write_uint32 (string, data_offset);
+		ai_icon_pack_write_uint32 (string, item->length);
+		names_offset += strlen (item->name) + 1;
+		data_offset += item->length;
+	}
+
+	/* names */
+	for (i=0; i<items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		g_string_append_len (string, item->name, strlen (item->name) + 1);
+	}
+
+	/* data */
+	for (i=0; i<items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		g_string_append_len (string, item->data, item->length);
+	}
+
+	ret = g_file_set_contents (filename, string->str, string->len, &error_local);
+	if (!ret) {
+		g_set_error (error, 1, 0, "cannot write %s: %s", filename, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+	egg_debug ("wrote %i icons to %s", items->len, filename);
+	if (count != NULL)
+		*count = items->len;
+out:
+	if (string != NULL)
+		g_string_free (string, TRUE);
+	if (filenames != NULL)
+		g_ptr_array_unref (filenames);
+	g_ptr_array_foreach (items, (GFunc) ai_icon_pack_item_free, NULL);
+	g_ptr_array_free (items, TRUE);
+	return ret;
+}
+
+/*
+ * ai_icon_pack_class_init:
+ */
+static void
+ai_icon_pack_class_init (AiIconPackClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_icon_pack_finalize;
+	g_type_class_add_private (klass, sizeof (AiIconPackPrivate));
+}
+
+/*
+ * ai_icon_pack_init:
+ */
+static void
+ai_icon_pack_init (AiIconPack *pack)
+{
+	pack->priv = AI_ICON_PACK_GET_PRIVATE (pack);
+}
+
+/*
+ * ai_icon_pack_finalize:
+ */
+static void
+ai_icon_pack_finalize (GObject *object)
+{
+	AiIconPack *pack = AI_ICON_PACK (object);
+
+	ai_icon_pack_reset (pack);
+
+	G_OBJECT_CLASS (ai_icon_pack_parent_class)->finalize (object);
+}
+
+/*
+ * ai_icon_pack_new:
+ *
+ * Return value: a new AiIconPack object.
+ */
+AiIconPack *
+ai_icon_pack_new (void)
+{
+	AiIconPack *pack;
+	pack = g_object_new (AI_TYPE_ICON_PACK, NULL);
+	return AI_ICON_PACK (pack);
+}
@@ -0,0 +1,72 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_ICON_PACK_H
+#define __AI_ICON_PACK_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ICON_PACK		(ai_icon_pack_get_type ())
+#define AI_ICON_PACK(o)			(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ICON_PACK, AiIconPack))
+#define AI_ICON_PACK_CLASS(k)		(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ICON_PACK, AiIconPackClass))
+#define AI_IS_ICON_PACK(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ICON_PACK))
+#define AI_IS_ICON_PACK_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ICON_PACK))
+#define AI_ICON_PACK_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ICON_PACK, AiIconPackClass))
+
+/* the pack for a size lives next to the directory, e.g. "48x48.pack" */
+#define AI_ICON_PACK_SUFFIX		".pack"
+
+typedef struct _AiIconPackPrivate	AiIconPackPrivate;
+typedef struct _AiIconPack		AiIconPack;
+typedef struct _AiIconPackClass		AiIconPackClass;
+
+struct _AiIconPack
+{
+	 GObject		 parent;
+	 AiIconPackPrivate	*priv;
+};
+
+struct _AiIconPackClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_icon_pack_get_type		  	(void);
+AiIconPack	*ai_icon_pack_new			(void);
+gboolean	 ai_icon_pack_load			(AiIconPack	*pack,
+							 const gchar	*filename,
+							 GError		**error);
+const gchar	*ai_icon_pack_lookup			(AiIconPack	*pack,
+							 const gchar	*name,
+							 gsize		*length);
+guint		 ai_icon_pack_get_count			(AiIconPack	*pack);
+gboolean	 ai_icon_pack_build			(const gchar	*directory,
+							 const gchar	*filename,
+							 guint		*count,
+							 GError		**error);
+
+G_END_DECLS
+
+#endif /* __AI_ICON_PACK_H */
+
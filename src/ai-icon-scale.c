@@ -0,0 +1,303 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "egg-debug.h"
+
+#include "ai-icon-scale.h"
+
+/*
+ * AiIconScaleLevel:
+ *
+ * One step of the cascade, stored as packed premultiplied RGBA so that
+ * transparent pixels do not bleed their color into the edges.
+ */
+typedef struct {
+	guint8		*data;
+	guint		 width;
+	guint		 height;
+} AiIconScaleLevel;
+
+/*
+ * ai_icon_scale_level_free:
+ */
+static void
+ai_icon_scale_level_free (AiIconScaleLevel *level)
+{
+	g_free (level->data);
+	g_slice_free (AiIconScaleLevel, level);
+}
+
+/*
+ * ai_icon_scale_level_new_from_pixbuf:
+ */
+static AiIconScaleLevel *
+ai_icon_scale_level_new_from_pixbuf (GdkPixbuf *pixbuf)
+{
+	AiIconScaleLevel *level;
+	GdkPixbuf *rgba;
+	const guint8 *src;
+	guint8 *dest;
+	guint rowstride;
+	guint alpha;
+	guint x, y;
+
+	/* we always work in RGBA */
+	rgba = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+
+	level = g_slice_new (AiIconScaleLevel);
+	level->width = gdk_pixbuf_get_width (rgba);
+	level->height = gdk_pixbuf_get_height (rgba);
+	level->data = g_new (guint8, level->width * level->height * 4);
+	rowstride = gdk_pixbuf_get_rowstride (rgba);
+
+	for (y=0; y<level->height; y++) {
+		src = gdk_pixbuf_get_pixels (rgba) + y * rowstride;
+		dest = level->data + y * level->width * 4;
+		for (x=0; x<level->width * 4; x+=4) {
+			alpha = src[x+3];
+			dest[x+0] = (src[x+0] * alpha + 127) / 255;
+			dest[x+1] = (src[x+1] * alpha + 127) / 255;
+			dest[x+2] = (src[x+2] * alpha + 127) / 255;
+			dest[x+3] = alpha;
+		}
+	}
+	g_object_unref (rgba);
+	return level;
+}
+
+/*
+ * ai_icon_scale_level_to_pixbuf:
+ */
+static GdkPixbuf *
+ai_icon_scale_level_to_pixbuf (const AiIconScaleLevel *level)
+{
+	GdkPixbuf *pixbuf;
+	const guint8 *src;
+	guint8 *dest;
+	guint rowstride;
+	guint alpha;
+	guint x, y;
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, level->width, level->height);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	for (y=0; y<level->height; y++) {
+		src = level->data + y * level->width * 4;
+		dest = gdk_pixbuf_get_pixels (pixbuf) + y * rowstride;
+		for (x=0; x<level->width * 4; x+=4) {
+			alpha = src[x+3];
+			if (alpha == 0) {
+				memset (dest + x, 0, 4);
+				continue;
+			}
+			dest[x+0] = MIN ((src[x+0] * 255 + alpha / 2) / alpha, 255);
+			dest[x+1] = MIN ((src[x+1] * 255 + alpha / 2) / alpha, 255);
+			dest[x+2] = MIN ((src[x+2] * 255 + alpha / 2) / alpha, 255);
+			dest[x+3] = alpha;
+		}
+	}
+	return pixbuf;
+}
+
+/*
+ * ai_icon_scale_halve_row_scalar:
+ *
+ * Averages 2x2 blocks of two source rows into @width destination pixels.
+ */
+static void
+ai_icon_scale_halve_row_scalar (const guint8 *row0, const guint8 *row1, guint8 *dest, guint width)
+{
+	guint x;
+	guint i;
+
+	for (x=0; x<width; x++) {
+		for (i=0; i<4; i++) {
+			dest[x*4+i] = (row0[x*8+i] + row0[x*8+4+i] +
+				       row1[x*8+i] + row1[x*8+4+i] + 2) >> 2;
+		}
+	}
+}
+
+#ifdef __SSE2__
+/*
+ * ai_icon_scale_halve_row_sse2:
+ *
+ * Same as the scalar version, but two destination pixels at a time. The
+ * channels are widened to 16 bits so the rounding matches exactly.
+ */
+static void
+ai_icon_scale_halve_row_sse2 (const guint8 *row0, const guint8 *row1, guint8 *dest, guint width)
+{
+	__m128i zero = _mm_setzero_si128 ();
+	__m128i bias = _mm_set1_epi16 (2);
+	__m128i a, b, lo, hi, sum;
+	guint x;
+
+	for (x=0; x+2<=width; x+=2) {
+		a = _mm_loadu_si128 ((const __m128i *) (row0 + x * 8));
+		b = _mm_loadu_si128 ((const __m128i *) (row1 + x * 8));
+
+		/* vertical sums of the four source pixels */
+		lo = _mm_add_epi16 (_mm_unpacklo_epi8 (a, zero), _mm_unpacklo_epi8 (b, zero));
+		hi = _mm_add_epi16 (_mm_unpackhi_epi8 (a, zero), _mm_unpackhi_epi8 (b, zero));
+
+		/* horizontal sums of each pair */
+		lo = _mm_add_epi16 (lo, _mm_srli_si128 (lo, 8));
+		hi = _mm_add_epi16 (hi, _mm_srli_si128 (hi, 8));
+
+		sum = _mm_unpacklo_epi64 (lo, hi);
+		sum = _mm_srli_epi16 (_mm_add_epi16 (sum, bias), 2);
+		_mm_storel_epi64 ((__m128i *) (dest + x * 4), _mm_packus_epi16 (sum, zero));
+	}
+
+	/* odd pixel at the end */
+	if (x < width)
+		ai_icon_scale_halve_row_scalar (row0 + x * 8, row1 + x * 8, dest + x * 4, width - x);
+}
+#endif
+
+/*
+ * ai_icon_scale_level_halve:
+ *
+ * Returns a 2x box-filtered copy. An odd last row or column is dropped,
+ * which is fine as the final bilinear pass is never more than 2x.
+ */
+static AiIconScaleLevel *
+ai_icon_scale_level_halve (const AiIconScaleLevel *src)
+{
+	AiIconScaleLevel *level;
+	const guint8 *row0;
+	guint y;
+
+	level = g_slice_new (AiIconScaleLevel);
+	level->width = src->width / 2;
+	level->height = src->height / 2;
+	level->data = g_new (guint8, level->width * level->height * 4);
+
+	for (y=0; y<level->height; y++) {
+		row0 = src->data + (y * 2) * src->width * 4;
+#ifdef __SSE2__
+		ai_icon_scale_halve_row_sse2 (row0, row0 + src->width * 4,
+					      level->data + y * level->width * 4, level->width);
+#else
+		ai_icon_scale_halve_row_scalar (row0, row0 + src->width * 4,
+						level->data + y * level->width * 4, level->width);
+#endif
+	}
+	return level;
+}
+
+/*
+ * ai_icon_scale_multi:
+ * @pixbuf: the decoded source icon
+ * @sizes: a zero terminated list of pixel sizes
+ *
+ * Scales one decoded icon to all the requested sizes. Large sources are
+ * first reduced by repeated 2x box filtering, which is shared between
+ * all the sizes, and only the last step of less than 2x uses bilinear
+ * filtering. Scaling directly from a large source with bilinear
+ * filtering only samples a few source pixels and aliases badly.
+ *
+ * Return value: an array of #GdkPixbuf in the same order as @sizes
+ */
+GPtrArray *
+ai_icon_scale_multi (GdkPixbuf *pixbuf, const guint *sizes)
+{
+	GPtrArray *array;
+	GPtrArray *levels;
+	AiIconScaleLevel *level;
+	AiIconScaleLevel *best;
+	GdkPixbuf *tmp;
+	GdkPixbuf *scaled;
+	guint smallest = G_MAXUINT;
+	guint i, j;
+
+	g_return_val_if_fail (pixbuf != NULL, NULL);
+	g_return_val_if_fail (sizes != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i=0; sizes[i] != 0; i++)
+		smallest = MIN (smallest, sizes[i]);
+	if (smallest == G_MAXUINT)
+		goto out;
+
+	/* build the cascade down to the smallest size we need */
+	levels = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_icon_scale_level_free);
+	level = ai_icon_scale_level_new_from_pixbuf (pixbuf);
+	g_ptr_array_add (levels, level);
+	while (level->width >= smallest * 2 && level->height >= smallest * 2) {
+		level = ai_icon_scale_level_halve (level);
+		g_ptr_array_add (levels, level);
+	}
+
+	/* finish each size from the smallest level that is still large enough */
+	for (i=0; sizes[i] != 0; i++) {
+		best = g_ptr_array_index (levels, 0);
+		for (j=1; j<levels->len; j++) {
+			level = g_ptr_array_index (levels, j);
+			if (level->width < sizes[i] || level->height < sizes[i])
+				break;
+			best = level;
+		}
+		egg_debug ("scaling %ix%i to %i", best->width, best->height, sizes[i]);
+		tmp = ai_icon_scale_level_to_pixbuf (best);
+		if (best->width == sizes[i] && best->height == sizes[i]) {
+			g_ptr_array_add (array, tmp);
+			continue;
+		}
+		scaled = gdk_pixbuf_scale_simple (tmp, sizes[i], sizes[i], GDK_INTERP_BILINEAR);
+		g_object_unref (tmp);
+		g_ptr_array_add (array, scaled);
+	}
+	g_ptr_array_unref (levels);
+out:
+	return array;
+}
+
+/*
+ * ai_icon_scale:
+ *
+ * Return value: a new #GdkPixbuf of @size x @size
+ */
+GdkPixbuf *
+ai_icon_scale (GdkPixbuf *pixbuf, guint size)
+{
+	GPtrArray *array;
+	GdkPixbuf *scaled;
+	guint sizes[] = { size, 0 };
+
+	g_return_val_if_fail (size > 0, NULL);
+
+	array = ai_icon_scale_multi (pixbuf, sizes);
+	scaled = g_object_ref (g_ptr_array_index (array, 0));
+	g_ptr_array_unref (array);
+	return scaled;
+}
+
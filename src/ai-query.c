@@ -39,11 +39,15 @@ main (int argc, char *argv[])
 	gboolean verbose = FALSE;
 	GOptionContext *context;
 	gchar *database = NULL;
+	gchar *icondir = NULL;
+	gchar *icon_path;
+	gint icon_size = 0;
 	gint retval = 0;
 	AiDatabase *db = NULL;
 	gboolean ret;
 	GError *error = NULL;
 	GPtrArray *array = NULL;
+	gchar **completions = NULL;
 	guint i;
 	AiResult *result;
 	const gchar *locale;
@@ -54,6 +58,12 @@ main (int argc, char *argv[])
 		{ "database", 'd', 0, G_OPTION_ARG_STRING, &database,
 		  /* TRANSLATORS: if we are specifing a out-of-tree database */
 		  _("Database file to use (if not specififed, default is used)"), NULL},
+		{ "icondir", 'i', 0, G_OPTION_ARG_STRING, &icondir,
+		  /* TRANSLATORS: the icon directory */
+		  _("Icon directory"), NULL},
+		{ "icon-size", '\0', 0, G_OPTION_ARG_INT, &icon_size,
+		  /* TRANSLATORS: the icon is written out of the icon archive if needed */
+		  _("Show the icon of this size for each result"), NULL},
 		{ NULL}
 	};
 
@@ -80,7 +90,7 @@ main (int argc, char *argv[])
 
 	/* enough arguments */
 	if (argc != 3) {
-		g_print ("Arguments have to be app-install-query [id|name] search-term\n");
+		g_print ("Arguments have to be app-install-query [id|name|fuzzy|complete] search-term\n");
 		retval = 1;
 		goto out;
 	}
@@ -88,6 +98,7 @@ main (int argc, char *argv[])
 	/* open database */
 	db = ai_database_new ();
 	ai_database_set_filename (db, database, NULL);
+	ai_database_set_icon_path (db, icondir, NULL);
 	ret = ai_database_open (db, FALSE, &error);
 	if (!ret) {
 		g_print ("%s: %s\n", _("Failed to open"), error->message);
@@ -97,7 +108,7 @@ main (int argc, char *argv[])
 	}
 
 	/* get locale */
-	locale = setlocale (LC_ALL, NULL);
+	locale = setlocale (LC_MESSAGES, NULL);
 
 	/* mode */
 	if (g_strcmp0 (argv[1], "id") == 0) {
@@ -116,6 +127,22 @@ main (int argc, char *argv[])
 			retval = 1;
 			goto out;
 		}
+	} else if (g_strcmp0 (argv[1], "fuzzy") == 0) {
+		array = ai_database_search_by_name_fuzzy (db, argv[2], locale, 10, &error);
+		if (array == NULL) {
+			g_print ("%s: %s\n", _("Failed to search"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	} else if (g_strcmp0 (argv[1], "complete") == 0) {
+		completions = ai_database_complete (db, argv[2], locale, 10, &error);
+		if (completions == NULL) {
+			g_print ("%s: %s\n", _("Failed to search"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
 	} else {
 		g_print ("%s\n", ("Incorrect search term"));
 		retval = 1;
@@ -123,7 +150,12 @@ main (int argc, char *argv[])
 	}
 
 	/* no results */
-	if (array->len == 0) {
+	if (completions != NULL) {
+		if (completions[0] == NULL)
+			g_print ("No results found\n");
+		for (i=0; completions[i] != NULL; i++)
+			g_print ("%s\n", completions[i]);
+	} else if (array->len == 0) {
 		g_print ("No results found\n");
 	} else {
 		g_print ("Results for '%s':\n", argv[2]);
@@ -140,6 +172,16 @@ main (int argc, char *argv[])
 			g_print ("      %s: %i\n", _("Rating"), ai_result_get_rating (result));
 			g_print ("      %s: %s\n", _("Screenshot"), ai_result_get_screenshot_url (result));
 			g_print ("      %s: %s\n", _("Installed"), ai_result_get_installed (result) ? "TRUE" : "FALSE");
+			if (icon_size <= 0)
+				continue;
+			icon_path = ai_database_get_icon_path (db, ai_result_get_application_id (result), icon_size, &error);
+			if (icon_path == NULL) {
+				egg_debug ("no icon: %s", error->message);
+				g_clear_error (&error);
+				continue;
+			}
+			g_print ("      %s: %s\n", _("Icon"), icon_path);
+			g_free (icon_path);
 		}
 	}
 
@@ -154,9 +196,11 @@ main (int argc, char *argv[])
 out:
 	if (array != NULL)
 		g_ptr_array_unref (array);
+	g_strfreev (completions);
 	if (db != NULL)
 		g_object_unref (db);
 	g_free (database);
+	g_free (icondir);
 	return retval;
 }
 
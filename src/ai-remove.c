@@ -126,6 +126,33 @@ main (int argc, char *argv[])
 		}
 	}
 
+	/* keep any icon packs and atlases in step with the icon directories */
+	if (icondir != NULL) {
+		ret = ai_database_update_icon_packs (db, FALSE, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to update icon packs"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+		ret = ai_database_update_icon_atlases (db, FALSE, &error);
+		if (!ret) {
+			g_print ("%s: %s\n", _("Failed to update icon atlases"), error->message);
+			g_error_free (error);
+			retval = 1;
+			goto out;
+		}
+	}
+
+	/* only the localized names of the changed applications */
+	ret = ai_database_refresh_display (db, &error);
+	if (!ret) {
+		g_print ("%s: %s\n", _("Failed to update display table"), error->message);
+		g_error_free (error);
+		retval = 1;
+		goto out;
+	}
+
 	/* close it */
 	ret = ai_database_close (db, TRUE, &error);
 	if (!ret) {
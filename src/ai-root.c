@@ -0,0 +1,436 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include "egg-debug.h"
+
+#include "ai-root.h"
+#include "ai-utils-private.h"
+
+#define AI_ROOT_MAX_LINKS	8
+
+/* far bigger than any desktop file or icon we would want to read */
+#define AI_ROOT_MAX_FILE_SIZE	(16 * 1024 * 1024)
+
+static void     ai_root_finalize	(GObject     *object);
+
+#define AI_ROOT_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_ROOT, AiRootPrivate))
+
+/*
+ * AiRootFile:
+ *
+ * Either the contents of a regular file, or the target of a link.
+ */
+typedef struct {
+	gchar		*path;
+	gchar		*data;
+	gsize		 length;
+	gchar		*target;
+} AiRootFile;
+
+/*
+ * AiRootPrivate:
+ *
+ * Private #AiRoot data
+ */
+struct _AiRootPrivate
+{
+	GHashTable			*files;
+	GPtrArray			*paths;
+	guint64				 size;
+};
+
+G_DEFINE_TYPE (AiRoot, ai_root, G_TYPE_OBJECT)
+
+/*
+ * ai_root_file_free:
+ */
+static void
+ai_root_file_free (AiRootFile *file)
+{
+	g_free (file->path);
+	g_free (file->data);
+	g_free (file->target);
+	g_slice_free (AiRootFile, file);
+}
+
+/*
+ * ai_root_add_file:
+ *
+ * Takes ownership of @file, replacing any earlier file at the same path.
+ */
+static void
+ai_root_add_file (AiRoot *root, AiRootFile *file)
+{
+	AiRootFile *old;
+	AiRootPrivate *priv = root->priv;
+
+	/* the old path is freed with the old file */
+	old = g_hash_table_lookup (priv->files, file->path);
+	if (old != NULL) {
+		g_ptr_array_remove (priv->paths, old->path);
+		priv->size -= old->length;
+	}
+	g_ptr_array_add (priv->paths, file->path);
+	g_hash_table_replace (priv->files, file->path, file);
+	priv->size += file->length;
+}
+
+/*
+ * ai_root_add_data:
+ *
+ * Adds a regular file to the root. @data is copied.
+ */
+void
+ai_root_add_data (AiRoot *root, const gchar *path, const gchar *data, gsize length)
+{
+	AiRootFile *file;
+
+	g_return_if_fail (AI_IS_ROOT (root));
+	g_return_if_fail (path != NULL);
+
+	file = g_slice_new0 (AiRootFile);
+	file->path = g_strdup (ai_utils_strip_root (path));
+	file->data = g_malloc (length + 1);
+	memcpy (file->data, data, length);
+	file->data[length] = '\0';
+	file->length = length;
+	ai_root_add_file (root, file);
+}
+
+/*
+ * ai_root_add_link:
+ *
+ * Adds a symlink to the root. Relative targets are resolved against the
+ * directory of @path, and absolute targets against the root itself.
+ */
+void
+ai_root_add_link (AiRoot *root, const gchar *path, const gchar *target)
+{
+	AiRootFile *file;
+
+	g_return_if_fail (AI_IS_ROOT (root));
+	g_return_if_fail (path != NULL);
+	g_return_if_fail (target != NULL);
+
+	file = g_slice_new0 (AiRootFile);
+	file->path = g_strdup (ai_utils_strip_root (path));
+	file->target = g_strdup (target);
+	ai_root_add_file (root, file);
+}
+
+/*
+ * ai_root_resolve_link:
+ *
+ * Return value: the normalised path the link points to
+ */
+static gchar *
+ai_root_resolve_link (const gchar *path, const gchar *target)
+{
+	GPtrArray *components;
+	gchar **split;
+	gchar *dirname;
+	gchar *joined;
+	gchar *resolved;
+	guint i;
+
+	if (target[0] == '/') {
+		joined = g_strdup (target);
+	} else {
+		dirname = g_path_get_dirname (path);
+		joined = g_build_filename (dirname, target, NULL);
+		g_free (dirname);
+	}
+
+	/* collapse "." and ".." without ever leaving the root */
+	components = g_ptr_array_new ();
+	split = g_strsplit (joined, "/", -1);
+	for (i=0; split[i] != NULL; i++) {
+		if (split[i][0] == '\0' || strcmp (split[i], ".") == 0)
+			continue;
+		if (strcmp (split[i], "..") == 0) {
+			if (components->len > 0)
+				g_ptr_array_remove_index (components, components->len - 1);
+			continue;
+		}
+		g_ptr_array_add (components, split[i]);
+	}
+	g_ptr_array_add (components, NULL);
+	resolved = g_strjoinv ("/", (gchar **) components->pdata);
+
+	g_ptr_array_free (components, TRUE);
+	g_strfreev (split);
+	g_free (joined);
+	return resolved;
+}
+
+/*
+ * ai_root_get_data:
+ *
+ * Gets the contents of a file, following links. The data is always
+ * followed by a NUL byte that is not included in @length.
+ *
+ * Return value: the file contents, or %NULL if not found. Do not free.
+ */
+const gchar *
+ai_root_get_data (AiRoot *root, const gchar *path, gsize *length)
+{
+	AiRootFile *file;
+	gchar *resolved = NULL;
+	const gchar *data = NULL;
+	guint i;
+
+	g_return_val_if_fail (AI_IS_ROOT (root), NULL);
+	g_return_val_if_fail (path != NULL, NULL);
+
+	file = g_hash_table_lookup (root->priv->files, ai_utils_strip_root (path));
+	for (i=0; file != NULL && file->target != NULL; i++) {
+		if (i == AI_ROOT_MAX_LINKS) {
+			egg_warning ("too many levels of links for %s", path);
+			goto out;
+		}
+		g_free (resolved);
+		resolved = ai_root_resolve_link (file->path, file->target);
+		file = g_hash_table_lookup (root->priv->files, resolved);
+	}
+	if (file == NULL)
+		goto out;
+	if (length != NULL)
+		*length = file->length;
+	data = file->data;
+out:
+	g_free (resolved);
+	return data;
+}
+
+/*
+ * ai_root_get_paths:
+ *
+ * Return value: all the files and links in the root, in archive order. Do not free.
+ */
+GPtrArray *
+ai_root_get_paths (AiRoot *root)
+{
+	g_return_val_if_fail (AI_IS_ROOT (root), NULL);
+	return root->priv->paths;
+}
+
+/*
+ * ai_root_get_size:
+ *
+ * Return value: the number of bytes held in memory
+ */
+guint64
+ai_root_get_size (AiRoot *root)
+{
+	g_return_val_if_fail (AI_IS_ROOT (root), 0);
+	return root->priv->size;
+}
+
+/*
+ * ai_root_read_entry:
+ */
+static gboolean
+ai_root_read_entry (struct archive *arch, struct archive_entry *entry, AiRootFile *file, GError **error)
+{
+	gboolean ret = TRUE;
+	gssize r;
+	gsize offset = 0;
+
+	file->length = archive_entry_size (entry);
+	file->data = g_malloc (file->length + 1);
+	while (offset < file->length) {
+		r = archive_read_data (arch, file->data + offset, file->length - offset);
+		if (r < 0) {
+			g_set_error (error, 1, 0, "cannot read %s: %s", file->path, archive_error_string (arch));
+			ret = FALSE;
+			goto out;
+		}
+		if (r == 0)
+			break;
+		offset += r;
+	}
+	file->length = offset;
+	file->data[offset] = '\0';
+out:
+	return ret;
+}
+
+/*
+ * ai_root_load_archive:
+ *
+ * Reads the entries of a package matching one of @patterns, or all of
+ * them if @patterns is %NULL, into memory. Nothing is written to disk.
+ */
+gboolean
+ai_root_load_archive (AiRoot *root, const gchar *filename, gchar **patterns, GError **error)
+{
+	gboolean ret = FALSE;
+	struct archive *arch = NULL;
+	struct archive_entry *entry;
+	AiRootFile *file;
+	GMappedFile *mapped = NULL;
+	GPtrArray *specs = NULL;
+	const gchar *path;
+	const gchar *target;
+	int r;
+
+	g_return_val_if_fail (AI_IS_ROOT (root), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	specs = ai_utils_compile_patterns (patterns);
+	arch = ai_utils_archive_open (filename, &mapped, error);
+	if (arch == NULL)
+		goto out;
+
+	for (;;) {
+		r = archive_read_next_header (arch, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot read header: %s", archive_error_string (arch));
+			goto out;
+		}
+		path = archive_entry_pathname (entry);
+
+		/* directories are implied by the paths */
+		if (archive_entry_filetype (entry) == AE_IFDIR ||
+		    (specs != NULL && !ai_utils_path_matches (specs, path))) {
+			r = archive_read_data_skip (arch);
+			if (r != ARCHIVE_OK) {
+				g_set_error (error, 1, 0, "cannot skip: %s", archive_error_string (arch));
+				goto out;
+			}
+			continue;
+		}
+
+		/* hardlinks are relative to the archive root */
+		target = archive_entry_hardlink (entry);
+		if (target != NULL) {
+			file = g_slice_new0 (AiRootFile);
+			file->path = g_strdup (ai_utils_strip_root (path));
+			file->target = g_strconcat ("/", ai_utils_strip_root (target), NULL);
+			ai_root_add_file (root, file);
+			continue;
+		}
+		target = archive_entry_symlink (entry);
+		if (target != NULL) {
+			ai_root_add_link (root, path, target);
+			continue;
+		}
+		if (archive_entry_filetype (entry) != AE_IFREG)
+			continue;
+
+		/* the size comes from the header, so do not trust it */
+		if (archive_entry_size (entry) < 0 ||
+		    archive_entry_size (entry) > AI_ROOT_MAX_FILE_SIZE) {
+			egg_warning ("ignoring %s of %" G_GINT64_FORMAT " bytes in %s",
+				     path, (gint64) archive_entry_size (entry), filename);
+			r = archive_read_data_skip (arch);
+			if (r != ARCHIVE_OK) {
+				g_set_error (error, 1, 0, "cannot skip: %s", archive_error_string (arch));
+				goto out;
+			}
+			continue;
+		}
+
+		file = g_slice_new0 (AiRootFile);
+		file->path = g_strdup (ai_utils_strip_root (path));
+		ret = ai_root_read_entry (arch, entry, file, error);
+		if (!ret) {
+			ai_root_file_free (file);
+			goto out;
+		}
+		ai_root_add_file (root, file);
+
+		/* a later error must not return success */
+		ret = FALSE;
+	}
+	egg_debug ("read %i files, %" G_GUINT64_FORMAT " bytes from %s",
+		   root->priv->paths->len, root->priv->size, filename);
+
+	/* completed all okay */
+	ret = TRUE;
+out:
+	if (arch != NULL)
+		ai_utils_archive_close (arch, mapped);
+	if (specs != NULL)
+		g_ptr_array_unref (specs);
+	return ret;
+}
+
+/*
+ * ai_root_class_init:
+ */
+static void
+ai_root_class_init (AiRootClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_root_finalize;
+	g_type_class_add_private (klass, sizeof (AiRootPrivate));
+}
+
+/*
+ * ai_root_init:
+ */
+static void
+ai_root_init (AiRoot *root)
+{
+	root->priv = AI_ROOT_GET_PRIVATE (root);
+	root->priv->files = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) ai_root_file_free);
+	root->priv->paths = g_ptr_array_new ();
+}
+
+/*
+ * ai_root_finalize:
+ */
+static void
+ai_root_finalize (GObject *object)
+{
+	AiRoot *root = AI_ROOT (object);
+	AiRootPrivate *priv = root->priv;
+
+	g_ptr_array_unref (priv->paths);
+	g_hash_table_unref (priv->files);
+
+	G_OBJECT_CLASS (ai_root_parent_class)->finalize (object);
+}
+
+/*
+ * ai_root_new:
+ *
+ * Return value: a new AiRoot object.
+ */
+AiRoot *
+ai_root_new (void)
+{
+	AiRoot *root;
+	root = g_object_new (AI_TYPE_ROOT, NULL);
+	return AI_ROOT (root);
+}
@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_ROOT_H
+#define __AI_ROOT_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_ROOT		(ai_root_get_type ())
+#define AI_ROOT(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_ROOT, AiRoot))
+#define AI_ROOT_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_ROOT, AiRootClass))
+#define AI_IS_ROOT(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_ROOT))
+#define AI_IS_ROOT_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_ROOT))
+#define AI_ROOT_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_ROOT, AiRootClass))
+
+typedef struct _AiRootPrivate	AiRootPrivate;
+typedef struct _AiRoot		AiRoot;
+typedef struct _AiRootClass	AiRootClass;
+
+struct _AiRoot
+{
+	 GObject		 parent;
+	 AiRootPrivate		*priv;
+};
+
+struct _AiRootClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_root_get_type		  	(void);
+AiRoot		*ai_root_new				(void);
+gboolean	 ai_root_load_archive			(AiRoot		*root,
+							 const gchar	*filename,
+							 gchar		**patterns,
+							 GError		**error);
+void		 ai_root_add_data			(AiRoot		*root,
+							 const gchar	*path,
+							 const gchar	*data,
+							 gsize		 length);
+void		 ai_root_add_link			(AiRoot		*root,
+							 const gchar	*path,
+							 const gchar	*target);
+const gchar	*ai_root_get_data			(AiRoot		*root,
+							 const gchar	*path,
+							 gsize		*length);
+GPtrArray	*ai_root_get_paths			(AiRoot		*root);
+guint64		 ai_root_get_size			(AiRoot		*root);
+
+G_END_DECLS
+
+#endif /* __AI_ROOT_H */
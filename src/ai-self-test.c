@@ -19,11 +19,34 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
 
 #include "egg-debug.h"
+#include "ai-catalog.h"
+#include "ai-common.h"
+#include "ai-completion.h"
+#include "ai-compose-cache.h"
+#include "ai-config.h"
 #include "ai-database.h"
+#include "ai-desktop.h"
+#include "ai-generator.h"
+#include "ai-result.h"
+#include "ai-root.h"
+#include "ai-trigram.h"
+#include "ai-utils-private.h"
+#include "ai-whitelist.h"
+#include "ai-icon-index.h"
+#include "ai-icon-archive.h"
+#include "ai-icon-atlas.h"
+#include "ai-icon-cache.h"
+#include "ai-icon-encoder.h"
+#include "ai-icon-pack.h"
+#include "ai-icon-scale.h"
 
 static void
 ai_test_database_func (void)
@@ -204,6 +227,1299 @@ ai_test_database_func (void)
 	g_unlink ("test2.db");
 }
 
+static void
+ai_test_config_func (void)
+{
+	AiConfig *config;
+	GArray *sizes;
+	gchar **dirs;
+	gboolean ret;
+	GError *error = NULL;
+	const gchar *filename = "/tmp/ai-self-test.conf";
+
+	/* defaults match the shipped file */
+	config = ai_config_new ();
+	sizes = ai_config_get_copy_icon_sizes (config);
+	g_assert_cmpint (sizes->len, ==, 3);
+	g_assert_cmpint (g_array_index (sizes, guint, 2), ==, AI_CONFIG_ICON_SIZE_SCALABLE);
+
+	/* nothing copied, two sizes generated */
+	ret = g_file_set_contents (filename, "[Generator]\nCopyIconSizes=\nEnsureIconSizes=32x32, 48\n", -1, NULL);
+	g_assert (ret);
+	ret = ai_config_load (config, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_config_get_copy_icon_sizes (config)->len, ==, 0);
+	sizes = ai_config_get_ensure_icon_sizes (config);
+	g_assert_cmpint (sizes->len, ==, 2);
+	g_assert_cmpint (g_array_index (sizes, guint, 0), ==, 32);
+	dirs = ai_config_get_icon_dirs (config);
+	g_assert_cmpstr (dirs[0], ==, "32x32");
+	g_assert_cmpstr (dirs[1], ==, "48x48");
+	g_assert (dirs[2] == NULL);
+
+	/* scalable icons cannot be generated */
+	ret = g_file_set_contents (filename, "[Generator]\nCopyIconSizes=64\nEnsureIconSizes=24,scalable\n", -1, NULL);
+	g_assert (ret);
+	ret = ai_config_load (config, filename, NULL);
+	g_assert (!ret);
+
+	/* and a failed load leaves the previous sizes alone */
+	g_assert_cmpint (ai_config_get_copy_icon_sizes (config)->len, ==, 0);
+	g_assert_cmpint (ai_config_get_ensure_icon_sizes (config)->len, ==, 2);
+	g_assert_cmpstr (ai_config_get_icon_dirs (config)[0], ==, "32x32");
+
+	g_unlink (filename);
+	g_object_unref (config);
+}
+
+static void
+ai_test_desktop_func (void)
+{
+	gboolean ret;
+	GError *error = NULL;
+	AiDesktop *desktop;
+	GPtrArray *locales;
+	const gchar *data =
+		"# comment\n"
+		"[Desktop Entry]\n"
+		"Name=GNOME PackageKit\n"
+		"Name[en_GB]=GNOME PackageKit\n"
+		"Name[sr@latin] = Instaler paketa\n"
+		"Comment=Add [and] remove = software\n"
+		"Comment[en_GB]=Add and remove software\n"
+		"Icon=gpk-app\r\n"
+		"\n"
+		"[Desktop Action Update]\n"
+		"Name=Update\n"
+		"Name[de]=Aktualisieren";
+
+	desktop = ai_desktop_new ();
+	g_assert (desktop != NULL);
+
+	/* parse data */
+	ret = ai_desktop_load_from_data (desktop, data, strlen (data), &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* values containing '=' and '[' */
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Comment", NULL), ==, "Add [and] remove = software");
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Icon", NULL), ==, "gpk-app");
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Name", "sr@latin"), ==, "Instaler paketa");
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Name", "en_GB"), ==, "GNOME PackageKit");
+
+	/* other groups are ignored */
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Name", NULL), ==, "GNOME PackageKit");
+	g_assert (ai_desktop_get_value (desktop, "Name", "de") == NULL);
+
+	/* unique locales in order */
+	locales = ai_desktop_get_locales (desktop);
+	g_assert_cmpint (locales->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (locales, 0), ==, "en_GB");
+	g_assert_cmpstr (g_ptr_array_index (locales, 1), ==, "sr@latin");
+
+	/* no main group */
+	ret = ai_desktop_load_from_data (desktop, "Name=foo\n", 9, NULL);
+	g_assert (!ret);
+
+	/* a file we cannot write to, as in /usr/share/applications */
+	g_file_set_contents ("/tmp/ai-self-test.desktop", data, -1, NULL);
+	g_chmod ("/tmp/ai-self-test.desktop", 0444);
+	ret = ai_desktop_load_from_file (desktop, "/tmp/ai-self-test.desktop", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (ai_desktop_get_value (desktop, "Icon", NULL), ==, "gpk-app");
+	g_unlink ("/tmp/ai-self-test.desktop");
+
+	g_object_unref (desktop);
+}
+
+static void
+ai_test_whitelist_func (void)
+{
+	/* compiled-in entries, with and without suffix */
+	g_assert (ai_whitelist_contains ("accessories-calculator"));
+	g_assert (ai_whitelist_contains ("accessories-calculator.png"));
+	g_assert (ai_whitelist_contains ("application-rss+xml"));
+
+	/* prefixes and unknown names */
+	g_assert (!ai_whitelist_contains ("accessories"));
+	g_assert (!ai_whitelist_contains ("accessories-calculator-extra"));
+	g_assert (!ai_whitelist_contains ("gpk-app"));
+}
+
+static void
+ai_test_icon_index_func (void)
+{
+	AiIconIndex *icon_index;
+	const AiIconIndexItem *item;
+	gchar *path;
+	gint ret;
+
+	icon_index = ai_icon_index_new ();
+	ai_icon_index_add_path (icon_index, "/usr/share/pixmaps/foo.xpm");
+	ai_icon_index_add_path (icon_index, "/usr/share/icons/hicolor/32x32/apps/foo.png");
+	ai_icon_index_add_path (icon_index, "/usr/share/icons/hicolor/48x48/apps/foo.png");
+	ai_icon_index_add_path (icon_index, "/usr/share/icons/hicolor/128x128/apps/foo.png");
+	ai_icon_index_add_path (icon_index, "/usr/share/icons/hicolor/scalable/apps/foo.svg");
+	ai_icon_index_add_path (icon_index, "/usr/share/pixmaps/bar.png");
+	ai_icon_index_add_path (icon_index, "/usr/share/doc/foo/README");
+	g_assert_cmpint (ai_icon_index_get_length (icon_index), ==, 6);
+
+	/* exact size in the theme beats pixmaps */
+	item = ai_icon_index_lookup (icon_index, "foo", 48);
+	g_assert (item != NULL);
+	g_assert_cmpstr (item->path, ==, "usr/share/icons/hicolor/48x48/apps/foo.png");
+
+	/* a suffix in the icon name is ignored */
+	item = ai_icon_index_lookup (icon_index, "foo.png", 32);
+	g_assert (item != NULL);
+	g_assert_cmpint (item->size, ==, 32);
+
+	/* scale down rather than up */
+	item = ai_icon_index_lookup (icon_index, "foo", 64);
+	g_assert (item != NULL);
+	g_assert_cmpint (item->size, ==, 128);
+
+	/* scalable */
+	item = ai_icon_index_lookup_exact (icon_index, "foo", "hicolor", 0);
+	g_assert (item != NULL);
+	g_assert_cmpstr (item->format, ==, "svg");
+	g_assert (ai_icon_index_lookup_exact (icon_index, "foo", "hicolor", 24) == NULL);
+
+	/* pixmaps and absolute names */
+	item = ai_icon_index_lookup (icon_index, "bar", 48);
+	g_assert (item != NULL);
+	g_assert_cmpint (item->kind, ==, AI_ICON_INDEX_KIND_PIXMAPS);
+	item = ai_icon_index_lookup (icon_index, "/usr/share/pixmaps/bar.png", 48);
+	g_assert (item != NULL);
+	g_assert (ai_icon_index_lookup (icon_index, "baz", 48) == NULL);
+	g_object_unref (icon_index);
+
+	/* a symlink loop in a package tree is not followed */
+	ai_utils_directory_remove ("/tmp/ai-self-test-index");
+	path = g_build_filename ("/tmp/ai-self-test-index", ICONS_DIR, "hicolor", "48x48", "apps", NULL);
+	g_mkdir_with_parents (path, 0755);
+	g_free (path);
+	path = g_build_filename ("/tmp/ai-self-test-index", ICONS_DIR, "hicolor", "48x48", "apps", "foo.png", NULL);
+	g_file_set_contents (path, "", -1, NULL);
+	g_free (path);
+	path = g_build_filename ("/tmp/ai-self-test-index", ICONS_DIR, "hicolor", "loop", NULL);
+	ret = symlink ("..", path);
+	g_assert_cmpint (ret, ==, 0);
+	g_free (path);
+	icon_index = ai_icon_index_new ();
+	ai_icon_index_add_root (icon_index, "/tmp/ai-self-test-index");
+	g_assert_cmpint (ai_icon_index_get_length (icon_index), ==, 1);
+	g_object_unref (icon_index);
+}
+
+static void
+ai_test_icon_scale_func (void)
+{
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *tmp;
+	GPtrArray *array;
+	GTimer *timer;
+	guint8 *pixels;
+	guint rowstride;
+	guint x, y;
+	guint i, j;
+	gdouble elapsed;
+	const guint sizes[] = { 22, 24, 32, 48, 0 };
+
+	/* a one pixel checkerboard is the worst case for aliasing */
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 256, 256);
+	pixels = gdk_pixbuf_get_pixels (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	for (y=0; y<256; y++) {
+		for (x=0; x<256; x++) {
+			memset (pixels + y * rowstride + x * 4, ((x + y) % 2) ? 0xff : 0x00, 3);
+			pixels[y * rowstride + x * 4 + 3] = 0xff;
+		}
+	}
+
+	/* every size is made, and the pattern averages out to grey */
+	array = ai_icon_scale_multi (pixbuf, sizes);
+	g_assert_cmpint (array->len, ==, 4);
+	for (i=0; i<array->len; i++) {
+		tmp = g_ptr_array_index (array, i);
+		g_assert_cmpint (gdk_pixbuf_get_width (tmp), ==, sizes[i]);
+		g_assert_cmpint (gdk_pixbuf_get_height (tmp), ==, sizes[i]);
+	}
+	tmp = g_ptr_array_index (array, 3);
+	pixels = gdk_pixbuf_get_pixels (tmp);
+	g_assert_cmpint (pixels[0], >, 0x70);
+	g_assert_cmpint (pixels[0], <, 0x90);
+	g_ptr_array_unref (array);
+
+	/* compare against scaling each size directly */
+	timer = g_timer_new ();
+	for (j=0; j<20; j++) {
+		for (i=0; sizes[i] != 0; i++) {
+			tmp = gdk_pixbuf_scale_simple (pixbuf, sizes[i], sizes[i], GDK_INTERP_BILINEAR);
+			g_object_unref (tmp);
+		}
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_reset (timer);
+	for (j=0; j<20; j++) {
+		array = ai_icon_scale_multi (pixbuf, sizes);
+		g_ptr_array_unref (array);
+	}
+	egg_debug ("bilinear: %.1fms, cascade: %.1fms", elapsed * 1000 / 20,
+		   g_timer_elapsed (timer, NULL) * 1000 / 20);
+	g_timer_destroy (timer);
+
+	g_object_unref (pixbuf);
+}
+
+static void
+ai_test_icon_encoder_func (void)
+{
+	AiIconEncoder *encoder;
+	GdkPixbuf *pixbuf;
+	gboolean ret;
+	gchar *buffer = NULL;
+	gsize buffer_size;
+	gsize default_size;
+	guint i;
+
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 48, 48);
+	gdk_pixbuf_fill (pixbuf, 0x336699ff);
+
+	/* default settings */
+	encoder = ai_icon_encoder_new ();
+	ret = ai_icon_encoder_encode (encoder, pixbuf, &buffer, &default_size, NULL);
+	g_assert (ret);
+	g_assert (memcmp (buffer, "\211PNG", 4) == 0);
+	g_free (buffer);
+
+	/* optimizing never makes it bigger */
+	ai_icon_encoder_set_optimize (encoder, TRUE);
+	ret = ai_icon_encoder_encode (encoder, pixbuf, &buffer, &buffer_size, NULL);
+	g_assert (ret);
+	g_assert_cmpint (buffer_size, <=, default_size);
+	g_free (buffer);
+
+	/* filters */
+	g_assert_cmpint (ai_icon_encoder_filter_from_string ("paeth"), ==, AI_ICON_ENCODER_FILTER_PAETH);
+	g_assert_cmpint (ai_icon_encoder_filter_from_string (NULL), ==, AI_ICON_ENCODER_FILTER_DEFAULT);
+	g_assert_cmpint (ai_icon_encoder_filter_from_string ("foo"), ==, AI_ICON_ENCODER_FILTER_UNKNOWN);
+
+	/* a dry run counts the icons but does not write them */
+	ai_icon_encoder_set_dry_run (encoder, TRUE);
+	ai_icon_encoder_set_threads (encoder, 2);
+	for (i=0; i<4; i++) {
+		ret = ai_icon_encoder_add (encoder, pixbuf, "/tmp/ai-self-test-does-not-exist/icon.png", NULL);
+		g_assert (ret);
+	}
+	ret = ai_icon_encoder_wait (encoder, NULL);
+	g_assert (ret);
+	g_assert_cmpint (ai_icon_encoder_get_count (encoder), ==, 4);
+	g_assert_cmpint (ai_icon_encoder_get_size (encoder), ==, buffer_size * 4);
+
+	g_object_unref (encoder);
+	g_object_unref (pixbuf);
+}
+
+static void
+ai_test_icon_cache_func (void)
+{
+	AiIconCache *cache;
+	gboolean ret;
+	gchar *checksum;
+	gchar *key;
+	gchar *key2;
+	gchar *data = NULL;
+	gsize length;
+
+	cache = ai_icon_cache_new ();
+	ret = ai_icon_cache_set_directory (cache, "/tmp/ai-self-test-cache", NULL);
+	g_assert (ret);
+
+	/* the key changes with the size and the settings */
+	ret = g_file_set_contents ("/tmp/ai-self-test-cache/source", "data", -1, NULL);
+	g_assert (ret);
+	checksum = ai_icon_cache_get_checksum ("/tmp/ai-self-test-cache/source", NULL);
+	g_assert_cmpstr (checksum, ==, "a17c9aaa61e80a1bf71d0d850af4e5baa9800bbd");
+	key = ai_icon_cache_get_key (checksum, 48, "libpng-c9-f0");
+	key2 = ai_icon_cache_get_key (checksum, 24, "libpng-c9-f0");
+	g_assert_cmpstr (key, !=, key2);
+
+	/* miss, store, then hit */
+	g_assert (!ai_icon_cache_lookup (cache, key, &data, &length));
+	ret = ai_icon_cache_store (cache, key, "png", 3, NULL);
+	g_assert (ret);
+	ret = ai_icon_cache_lookup (cache, key, &data, &length);
+	g_assert (ret);
+	g_assert_cmpint (length, ==, 3);
+	g_assert (memcmp (data, "png", 3) == 0);
+	g_assert_cmpint (ai_icon_cache_get_hits (cache), ==, 1);
+	g_assert_cmpint (ai_icon_cache_get_misses (cache), ==, 1);
+
+	ai_utils_directory_remove ("/tmp/ai-self-test-cache");
+	g_free (data);
+	g_free (key);
+	g_free (key2);
+	g_free (checksum);
+	g_object_unref (cache);
+}
+
+static void
+ai_test_root_func (void)
+{
+	AiRoot *root;
+	const gchar *data;
+	gsize length = 0;
+
+	root = ai_root_new ();
+	ai_root_add_data (root, "./usr/share/icons/hicolor/48x48/apps/dave.png", "png", 3);
+	ai_root_add_link (root, "/usr/share/pixmaps/dave.png", "../icons/hicolor/48x48/apps/dave.png");
+	ai_root_add_link (root, "/usr/share/pixmaps/absolute.png", "/usr/share/pixmaps/dave.png");
+	ai_root_add_link (root, "/usr/share/pixmaps/dangling.png", "missing.png");
+	g_assert_cmpint (ai_root_get_paths (root)->len, ==, 4);
+	g_assert_cmpint (ai_root_get_size (root), ==, 3);
+
+	/* paths are normalised */
+	data = ai_root_get_data (root, "usr/share/icons/hicolor/48x48/apps/dave.png", &length);
+	g_assert_cmpstr (data, ==, "png");
+	g_assert_cmpint (length, ==, 3);
+
+	/* links are followed */
+	data = ai_root_get_data (root, "usr/share/pixmaps/dave.png", NULL);
+	g_assert_cmpstr (data, ==, "png");
+	data = ai_root_get_data (root, "usr/share/pixmaps/absolute.png", NULL);
+	g_assert_cmpstr (data, ==, "png");
+	g_assert (ai_root_get_data (root, "usr/share/pixmaps/dangling.png", NULL) == NULL);
+	g_assert (ai_root_get_data (root, "usr/share/pixmaps/none.png", NULL) == NULL);
+
+	g_object_unref (root);
+}
+
+static void
+ai_test_generator_func (void)
+{
+	gchar *name;
+
+	/* strip the version, release and arch */
+	name = ai_generator_get_package_name ("/repo/i386/gnome-packagekit-2.29.1-1.fc13.i686.rpm");
+	g_assert_cmpstr (name, ==, "gnome-packagekit");
+	g_free (name);
+
+	/* not a binary package */
+	name = ai_generator_get_package_name ("gnome-packagekit.tar.gz");
+	g_assert (name == NULL);
+	name = ai_generator_get_package_name ("noversion.i686.rpm");
+	g_assert (name == NULL);
+}
+
+static void
+ai_test_generator_desktop_func (void)
+{
+	AiConfig *config;
+	AiDatabase *db;
+	AiIconEncoder *encoder;
+	GPtrArray *array;
+	GError *error = NULL;
+	gboolean ret;
+	gchar *path;
+
+	/* a package root with one application using a themed icon */
+	ai_utils_directory_remove ("/tmp/ai-self-test-generator");
+	path = g_build_filename ("/tmp/ai-self-test-generator/root", APPLICATIONS_DIR, NULL);
+	g_mkdir_with_parents (path, 0755);
+	g_free (path);
+	path = g_build_filename ("/tmp/ai-self-test-generator/root", APPLICATIONS_DIR, "calc.desktop", NULL);
+	ret = g_file_set_contents (path, "[Desktop Entry]\nName=Calculator\nName[fr]=Calculatrice\n"
+				   "Comment=Add up\nIcon=accessories-calculator\n", -1, NULL);
+	g_assert (ret);
+	g_free (path);
+	path = g_build_filename ("/tmp/ai-self-test-generator/root", APPLICATIONS_DIR, "noicon.desktop", NULL);
+	ret = g_file_set_contents (path, "[Desktop Entry]\nName=No Icon\n", -1, NULL);
+	g_assert (ret);
+	g_free (path);
+	ret = g_file_set_contents ("/tmp/ai-self-test-generator/generator.conf",
+				   "[Generator]\nCopyIconSizes=48\nEnsureIconSizes=48\n", -1, NULL);
+	g_assert (ret);
+
+	config = ai_config_new ();
+	ret = ai_config_load (config, "/tmp/ai-self-test-generator/generator.conf", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-generator/test.db", NULL);
+	ret = ai_database_open (db, FALSE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	encoder = ai_icon_encoder_new ();
+	ai_generator_create_icon_directories (config, "/tmp/ai-self-test-generator/icons");
+
+	/* a dry run adds nothing */
+	ai_icon_encoder_set_dry_run (encoder, TRUE);
+	ret = ai_generator_add_desktop_file (db, config, encoder, NULL, "/tmp/ai-self-test-generator/root",
+					     "calc.desktop", "fedora", "gcalctool",
+					     "/tmp/ai-self-test-generator/icons", NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = ai_database_search_by_id (db, "calc", NULL);
+	g_assert (array != NULL);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+	ai_icon_encoder_set_dry_run (encoder, FALSE);
+
+	/* the whole of app-install-generate, in-process */
+	ret = ai_generator_add_desktop_file (db, config, encoder, NULL, "/tmp/ai-self-test-generator/root",
+					     "calc.desktop", "fedora", "gcalctool",
+					     "/tmp/ai-self-test-generator/icons", NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = ai_database_search_by_id (db, "calc", NULL);
+	g_assert (array != NULL);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+
+	/* applications without icons are not added */
+	ret = ai_generator_add_desktop_file (db, config, encoder, NULL, "/tmp/ai-self-test-generator/root",
+					     "noicon.desktop", "fedora", "noicon",
+					     "/tmp/ai-self-test-generator/icons", NULL, &error);
+	g_assert (!ret);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+	g_object_unref (config);
+	g_object_unref (encoder);
+}
+
+static void
+ai_test_icon_archive_func (void)
+{
+	AiIconArchive *archive;
+	AiRoot *root;
+	GPtrArray *paths;
+	gboolean ret;
+	GError *error = NULL;
+	const gchar *data;
+	gchar *contents;
+
+	/* icons are written in the order they are added */
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons.tar.gz", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = ai_icon_archive_add (archive, "48x48/zebra.png", "zzz", 3, NULL);
+	g_assert (ret);
+	ret = ai_icon_archive_add (archive, "48x48/apple.png", "aaa", 3, NULL);
+	g_assert (ret);
+	ret = ai_icon_archive_add (archive, "64x64/apple.png", "bbb", 3, NULL);
+	g_assert (ret);
+	ret = ai_icon_archive_close (archive, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_icon_archive_get_count (archive), ==, 3);
+	g_object_unref (archive);
+
+	/* read it back */
+	root = ai_root_new ();
+	ret = ai_root_load_archive (root, "/tmp/ai-self-test-icons.tar.gz", NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	paths = ai_root_get_paths (root);
+	g_assert_cmpint (paths->len, ==, 3);
+	g_assert_cmpstr (g_ptr_array_index (paths, 0), ==, "icons/48x48/zebra.png");
+	g_assert_cmpstr (g_ptr_array_index (paths, 2), ==, "icons/64x64/apple.png");
+	data = ai_root_get_data (root, "icons/48x48/apple.png", NULL);
+	g_assert_cmpstr (data, ==, "aaa");
+	g_object_unref (root);
+
+	/* a package cut off after the first entry is not loaded */
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons.tar", NULL);
+	g_assert (ret);
+	ai_icon_archive_add (archive, "48x48/zebra.png", "zzz", 3, NULL);
+	ai_icon_archive_add (archive, "48x48/apple.png", "aaa", 3, NULL);
+	ret = ai_icon_archive_close (archive, NULL);
+	g_assert (ret);
+	g_object_unref (archive);
+	ret = g_file_get_contents ("/tmp/ai-self-test-icons.tar", &contents, NULL, NULL);
+	g_assert (ret);
+	g_file_set_contents ("/tmp/ai-self-test-icons.tar", contents, 1024 + 100, NULL);
+	g_free (contents);
+	root = ai_root_new ();
+	ret = ai_root_load_archive (root, "/tmp/ai-self-test-icons.tar", NULL, &error);
+	g_assert (error != NULL);
+	g_assert (!ret);
+	g_clear_error (&error);
+	g_object_unref (root);
+
+	/* the compression has to be known */
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons.zip", NULL);
+	g_assert (!ret);
+	g_object_unref (archive);
+}
+
+static void
+ai_test_icon_pack_func (void)
+{
+	AiIconPack *pack;
+	gboolean ret;
+	GError *error = NULL;
+	const gchar *data;
+	gsize length = 0;
+	guint count = 0;
+
+	ai_utils_directory_remove ("/tmp/ai-self-test-pack");
+	g_mkdir_with_parents ("/tmp/ai-self-test-pack/48x48", 0755);
+	g_file_set_contents ("/tmp/ai-self-test-pack/48x48/gpm.png", "png", 3, NULL);
+	g_file_set_contents ("/tmp/ai-self-test-pack/48x48/gpm.svg", "svg", 3, NULL);
+	g_file_set_contents ("/tmp/ai-self-test-pack/48x48/gnome-calculator.png", "calc", 4, NULL);
+
+	/* the png wins over the svg */
+	ret = ai_icon_pack_build ("/tmp/ai-self-test-pack/48x48", "/tmp/ai-self-test-pack/48x48.pack", &count, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (count, ==, 2);
+
+	pack = ai_icon_pack_new ();
+	ret = ai_icon_pack_load (pack, "/tmp/ai-self-test-pack/48x48.pack", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_icon_pack_get_count (pack), ==, 2);
+	data = ai_icon_pack_lookup (pack, "gpm", &length);
+	g_assert (data != NULL);
+	g_assert_cmpint (length, ==, 3);
+	g_assert (memcmp (data, "png", 3) == 0);
+	data = ai_icon_pack_lookup (pack, "gnome-calculator", &length);
+	g_assert (data != NULL);
+	g_assert_cmpint (length, ==, 4);
+	g_assert (ai_icon_pack_lookup (pack, "gpm.png", NULL) == NULL);
+	g_assert (ai_icon_pack_lookup (pack, "missing", NULL) == NULL);
+
+	/* not a pack */
+	ret = ai_icon_pack_load (pack, "/tmp/ai-self-test-pack/48x48/gpm.png", NULL);
+	g_assert (!ret);
+	g_assert_cmpint (ai_icon_pack_get_count (pack), ==, 0);
+	g_object_unref (pack);
+}
+
+static void
+ai_test_icon_atlas_func (void)
+{
+	AiIconAtlas *atlas;
+	AiIconAtlasEntry *entry;
+	GdkPixbuf *pixbuf;
+	GPtrArray *entries;
+	gboolean ret;
+	GError *error = NULL;
+	gchar *filename;
+	guint i;
+	const gchar *names[] = { "a.png", "b.png", "c.png", "d.png", "e.png", NULL };
+
+	ai_utils_directory_remove ("/tmp/ai-self-test-atlas");
+	g_mkdir_with_parents ("/tmp/ai-self-test-atlas/24x24", 0755);
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 24, 24);
+	gdk_pixbuf_fill (pixbuf, 0xff0000ff);
+	for (i=0; names[i] != NULL; i++) {
+		filename = g_build_filename ("/tmp/ai-self-test-atlas/24x24", names[i], NULL);
+		gdk_pixbuf_save (pixbuf, filename, "png", NULL, NULL);
+		g_free (filename);
+	}
+	g_object_unref (pixbuf);
+	g_file_set_contents ("/tmp/ai-self-test-atlas/24x24/e.svg", "not loaded", -1, NULL);
+
+	/* four icons fit on a sheet, and "e" is only drawn once */
+	atlas = ai_icon_atlas_new ();
+	ai_icon_atlas_set_columns (atlas, 2);
+	ret = ai_icon_atlas_build (atlas, "/tmp/ai-self-test-atlas/24x24", 24, "/tmp/ai-self-test-atlas/24x24", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_icon_atlas_get_sheets (atlas), ==, 2);
+	entries = ai_icon_atlas_get_entries (atlas);
+	g_assert_cmpint (entries->len, ==, 5);
+	entry = g_ptr_array_index (entries, 3);
+	g_assert_cmpstr (entry->name, ==, "d");
+	g_assert_cmpint (entry->sheet, ==, 0);
+	g_assert_cmpint (entry->x, ==, 24);
+	g_assert_cmpint (entry->y, ==, 24);
+	entry = g_ptr_array_index (entries, 4);
+	g_assert_cmpstr (entry->name, ==, "e");
+	g_assert_cmpint (entry->sheet, ==, 1);
+	g_assert_cmpint (entry->x, ==, 0);
+	g_assert_cmpint (entry->y, ==, 0);
+
+	/* the last sheet is only as big as it needs to be */
+	pixbuf = gdk_pixbuf_new_from_file ("/tmp/ai-self-test-atlas/24x24-0.png", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 48);
+	g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 48);
+	g_object_unref (pixbuf);
+	pixbuf = gdk_pixbuf_new_from_file ("/tmp/ai-self-test-atlas/24x24-1.png", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf), ==, 24);
+	g_assert_cmpint (gdk_pixbuf_get_height (pixbuf), ==, 24);
+	g_object_unref (pixbuf);
+	g_object_unref (atlas);
+}
+
+static void
+ai_test_catalog_func (void)
+{
+	AiCatalog *catalog;
+	AiDatabase *db;
+	GPtrArray *array;
+	gboolean ret;
+	GError *error = NULL;
+
+	g_unlink ("/tmp/ai-self-test-catalog.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-catalog.db", NULL);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "gpm", "gnome-power-manager", "System;Settings;", "fedora", "gpm", "Power", "Save power", NULL);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calc", "Add up", NULL);
+	ai_database_add_application (db, "gpk", "gnome-packagekit", "System;", "fedora", "gpk", "Add/Remove", "Install", NULL);
+	ai_database_add_translation (db, "calc", "Calculadora", "Somar", "pt_BR", NULL);
+
+	catalog = ai_catalog_new ();
+	ai_catalog_set_filename (catalog, "/tmp/ai-self-test-catalog.db", NULL);
+	ret = ai_catalog_load (catalog, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_catalog_get_size (catalog), ==, 3);
+	g_assert (!ai_catalog_get_is_stale (catalog));
+
+	/* translated */
+	array = ai_catalog_search_by_id (catalog, "calc", "pt_BR");
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Calculadora");
+	g_ptr_array_unref (array);
+	array = ai_catalog_search_by_name (catalog, "CALCULA", "pt_BR");
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	array = ai_catalog_search_by_name (catalog, "calcula", NULL);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
+	/* in name order */
+	array = ai_catalog_search_by_category (catalog, "System", NULL);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (ai_result_get_application_id (g_ptr_array_index (array, 0)), ==, "gpk");
+	g_ptr_array_unref (array);
+
+	/* a commit from another connection is noticed */
+	ai_database_add_application (db, "gedit", "gedit", "Utility;", "fedora", "gedit", "Editor", "Edit text", NULL);
+	g_assert (ai_catalog_get_is_stale (catalog));
+	ret = ai_catalog_load (catalog, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (ai_catalog_get_size (catalog), ==, 4);
+
+	g_object_unref (catalog);
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_completion_func (void)
+{
+	AiCompletion *completion;
+	AiDatabase *db;
+	gchar **completions;
+	gchar *text;
+	const gchar *keywords[] = { "gnome-packagekit", NULL };
+	gboolean ret;
+	GError *error = NULL;
+	GTimer *timer;
+	gdouble elapsed;
+	guint i;
+
+	text = ai_completion_normalize ("  Éditeur de   Texte! ");
+	g_assert_cmpstr (text, ==, "editeur de texte");
+	g_free (text);
+
+	/* best rated first, and each word is a token */
+	completion = ai_completion_new ();
+	ai_completion_add (completion, "Add/Remove Software", keywords, 10);
+	ai_completion_add (completion, "Software Update", NULL, 50);
+	ai_completion_add (completion, "Sound", NULL, 20);
+	completions = ai_completion_complete (completion, "so", 0);
+	g_assert_cmpint (g_strv_length (completions), ==, 3);
+	g_assert_cmpstr (completions[0], ==, "Software Update");
+	g_assert_cmpstr (completions[2], ==, "Add/Remove Software");
+	g_strfreev (completions);
+	completions = ai_completion_complete (completion, "so", 1);
+	g_assert_cmpint (g_strv_length (completions), ==, 1);
+	g_strfreev (completions);
+	completions = ai_completion_complete (completion, "add/rem", 0);
+	g_assert_cmpint (g_strv_length (completions), ==, 1);
+	g_strfreev (completions);
+	completions = ai_completion_complete (completion, "packagek", 0);
+	g_assert_cmpstr (completions[0], ==, "Add/Remove Software");
+	g_strfreev (completions);
+	completions = ai_completion_complete (completion, "", 0);
+	g_assert_cmpint (g_strv_length (completions), ==, 0);
+	g_strfreev (completions);
+
+	/* the same name twice is offered once, with the best rating */
+	ai_completion_add (completion, "Sound", NULL, 60);
+	g_assert_cmpint (ai_completion_get_size (completion), ==, 3);
+	completions = ai_completion_complete (completion, "so", 0);
+	g_assert_cmpint (g_strv_length (completions), ==, 3);
+	g_assert_cmpstr (completions[0], ==, "Sound");
+	g_strfreev (completions);
+	completions = ai_completion_complete (completion, "softw", 1);
+	g_assert_cmpint (g_strv_length (completions), ==, 1);
+	g_assert_cmpstr (completions[0], ==, "Software Update");
+	g_strfreev (completions);
+	g_object_unref (completion);
+
+	/* short prefixes match most of a large catalog, but are still fast */
+	completion = ai_completion_new ();
+	for (i=0; i<100000; i++) {
+		text = g_strdup_printf ("Application %i", i);
+		ai_completion_add (completion, text, NULL, i % 1000);
+		g_free (text);
+	}
+	completions = ai_completion_complete (completion, "a", 10);
+	g_assert_cmpint (g_strv_length (completions), ==, 10);
+	g_strfreev (completions);
+	timer = g_timer_new ();
+	for (i=0; i<100; i++) {
+		completions = ai_completion_complete (completion, i % 2 ? "a" : "app", 10);
+		g_strfreev (completions);
+	}
+	elapsed = g_timer_elapsed (timer, NULL) * 1000 / 100;
+	egg_debug ("completing in %.3fms", elapsed);
+	g_assert_cmpfloat (elapsed, <, 1.0f);
+	g_timer_destroy (timer);
+	g_object_unref (completion);
+
+	g_unlink ("/tmp/ai-self-test-completion.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-completion.db", NULL);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calc", "Add up", NULL);
+	ai_database_add_translation (db, "calc", "Calculadora", "Somar", "pt_BR", NULL);
+
+	/* translated, but the untranslated name still matches */
+	completions = ai_database_complete (db, "calcu", "pt_BR", 10, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (g_strv_length (completions), ==, 1);
+	g_assert_cmpstr (completions[0], ==, "Calculadora");
+	g_strfreev (completions);
+	completions = ai_database_complete (db, "calc", NULL, 10, &error);
+	g_assert_cmpstr (completions[0], ==, "Calc");
+	g_strfreev (completions);
+
+	/* adding an application throws away the index */
+	ai_database_add_application (db, "gedit", "gedit", "Utility;", "fedora", "gedit", "Text Editor", "Edit text", NULL);
+	completions = ai_database_complete (db, "edi", NULL, 10, &error);
+	g_assert_cmpint (g_strv_length (completions), ==, 1);
+	g_strfreev (completions);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_trigram_func (void)
+{
+	AiTrigram *trigram;
+	AiDatabase *db;
+	GPtrArray *array;
+	gboolean ret;
+	GError *error = NULL;
+
+	trigram = ai_trigram_new ();
+	ai_trigram_add (trigram, "libreoffice-writer", "LibreOffice Writer", "Create and edit text documents");
+	ai_trigram_add (trigram, "gimp", "GIMP", "Create images and edit photographs");
+	ai_trigram_add (trigram, "gedit", "Text Editor", "Edit text files");
+	g_assert_cmpint (ai_trigram_get_size (trigram), ==, 3);
+
+	/* misspelled */
+	array = ai_trigram_search (trigram, "libreofice", 10);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "libreoffice-writer");
+	g_ptr_array_unref (array);
+	array = ai_trigram_search (trigram, "gimpp", 10);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "gimp");
+	g_ptr_array_unref (array);
+
+	/* best first, and the summary counts for less than the name */
+	array = ai_trigram_search (trigram, "edtor", 10);
+	g_assert_cmpint (array->len, >, 0);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "gedit");
+	g_ptr_array_unref (array);
+
+	/* nothing alike */
+	array = ai_trigram_search (trigram, "zzzz", 10);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+	g_object_unref (trigram);
+
+	g_unlink ("/tmp/ai-self-test-trigram.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-trigram.db", NULL);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calculator", "Add up", NULL);
+	ai_database_add_translation (db, "calc", "Calculadora", "Somar", "pt_BR", NULL);
+
+	array = ai_database_search_by_name_fuzzy (db, "calculadra", "pt_BR", 10, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Calculadora");
+	g_ptr_array_unref (array);
+
+	/* the index follows removals */
+	ai_database_remove_by_name (db, "gcalctool", NULL);
+	array = ai_database_search_by_name_fuzzy (db, "calculadra", "pt_BR", 10, &error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_database_cache_func (void)
+{
+	AiDatabase *db;
+	GPtrArray *array;
+	GPtrArray *array2;
+	guint hits;
+	guint misses;
+	gboolean ret;
+	GError *error = NULL;
+
+	g_unlink ("/tmp/ai-self-test-cache.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-cache.db", NULL);
+	ai_database_set_cache_size (db, 2);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calc", "Add up", NULL);
+
+	/* the repeat is the same array */
+	array = ai_database_search_by_name_locale (db, "Calc", "pt_BR", &error);
+	g_assert_no_error (error);
+	array2 = ai_database_search_by_name_locale (db, "Calc", "pt_BR", &error);
+	g_assert (array == array2);
+	g_ptr_array_unref (array2);
+	ai_database_get_cache_stats (db, &hits, &misses);
+	g_assert_cmpint (hits, ==, 1);
+	g_assert_cmpint (misses, ==, 1);
+
+	/* a different locale is a different search */
+	array2 = ai_database_search_by_name_locale (db, "Calc", NULL, &error);
+	g_assert (array != array2);
+	g_ptr_array_unref (array2);
+	g_ptr_array_unref (array);
+
+	/* the least recently used is dropped */
+	array = ai_database_search_by_id (db, "calc", &error);
+	g_ptr_array_unref (array);
+	array = ai_database_search_by_name_locale (db, "Calc", "pt_BR", &error);
+	g_ptr_array_unref (array);
+	ai_database_get_cache_stats (db, &hits, &misses);
+	g_assert_cmpint (hits, ==, 1);
+	g_assert_cmpint (misses, ==, 4);
+
+	/* writing throws the cache away */
+	ai_database_add_application (db, "calendar", "evolution", "Office;", "fedora", "calendar", "Calendar", "Plan", NULL);
+	array = ai_database_search_by_name_locale (db, "Calc", "pt_BR", &error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	array = ai_database_search_by_name_locale (db, "Cal", "pt_BR", &error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_ptr_array_unref (array);
+	ai_database_get_cache_stats (db, &hits, &misses);
+	g_assert_cmpint (misses, ==, 6);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_locale_func (void)
+{
+	AiDatabase *db;
+	AiCatalog *catalog;
+	GPtrArray *array;
+	gchar **fallbacks;
+	gboolean ret;
+	GError *error = NULL;
+
+	fallbacks = ai_utils_get_locale_fallbacks ("sr_RS.UTF-8@latin");
+	g_assert_cmpint (g_strv_length (fallbacks), ==, 4);
+	g_assert_cmpstr (fallbacks[0], ==, "sr_RS@latin");
+	g_assert_cmpstr (fallbacks[1], ==, "sr_RS");
+	g_assert_cmpstr (fallbacks[2], ==, "sr@latin");
+	g_assert_cmpstr (fallbacks[3], ==, "sr");
+	g_strfreev (fallbacks);
+	fallbacks = ai_utils_get_locale_fallbacks ("de_DE.UTF-8");
+	g_assert_cmpint (g_strv_length (fallbacks), ==, 2);
+	g_assert_cmpstr (fallbacks[0], ==, "de_DE");
+	g_strfreev (fallbacks);
+	fallbacks = ai_utils_get_locale_fallbacks ("C.UTF-8");
+	g_assert_cmpint (g_strv_length (fallbacks), ==, 0);
+	g_strfreev (fallbacks);
+
+	g_unlink ("/tmp/ai-self-test-locale.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-locale.db", NULL);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calc", "Add up", NULL);
+	ai_database_add_translation (db, "calc", "Rechner", "Rechnen", "de", NULL);
+	ai_database_add_translation (db, "calc", "Taschenrechner", "Rechnen", "de_AT", NULL);
+
+	/* the codeset is ignored and "de" is used for Germany */
+	array = ai_database_search_by_id_locale (db, "calc", "de_DE.UTF-8", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Rechner");
+	g_ptr_array_unref (array);
+
+	/* but the territory wins when there is one */
+	array = ai_database_search_by_name_locale (db, "calc", "de_AT", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Taschenrechner");
+	g_ptr_array_unref (array);
+
+	/* the translated name is searched too */
+	array = ai_database_search_by_name_locale (db, "rechner", "de_CH", &error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+
+	/* quotes in the search are not SQL */
+	array = ai_database_search_by_name_locale (db, "calc' OR '1'='1", "de", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+	array = ai_database_search_by_id_locale (db, "it's", "de", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
+	/* untranslated */
+	array = ai_database_search_by_id_locale (db, "calc", "C", &error);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Calc");
+	g_ptr_array_unref (array);
+
+	catalog = ai_catalog_new ();
+	ai_catalog_set_filename (catalog, "/tmp/ai-self-test-locale.db", NULL);
+	ret = ai_catalog_load (catalog, &error);
+	g_assert_no_error (error);
+	array = ai_catalog_search_by_id (catalog, "calc", "de_AT.UTF-8");
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Taschenrechner");
+	g_ptr_array_unref (array);
+	g_object_unref (catalog);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_display_func (void)
+{
+	AiDatabase *db;
+	GPtrArray *array;
+	gboolean ret;
+	GError *error = NULL;
+
+	g_unlink ("/tmp/ai-self-test-display.db");
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-display.db", NULL);
+	ret = ai_database_open (db, TRUE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, NULL);
+	g_assert (ret);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility;", "fedora", "calc", "Calc", "Add up", NULL);
+	ai_database_add_application (db, "abiword", "abiword", "Office;", "fedora", "abiword", "Word", "Write", NULL);
+	ai_database_add_translation (db, "calc", "Rechner", "Rechnen", "de", NULL);
+
+	/* nothing built yet, so the translations are joined */
+	array = ai_database_list_by_name_locale (db, "de_CH", 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Rechner");
+	g_ptr_array_unref (array);
+
+	ret = ai_database_update_display (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* the same answers from the display table */
+	array = ai_database_list_by_name_locale (db, "de_CH", 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Rechner");
+	g_assert_cmpstr (ai_result_get_application_summary (g_ptr_array_index (array, 0)), ==, "Rechnen");
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 1)), ==, "Word");
+	g_ptr_array_unref (array);
+	array = ai_database_list_by_name_locale (db, NULL, 1, 1, &error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Word");
+	g_ptr_array_unref (array);
+	array = ai_database_search_by_name_locale (db, "rechner", "de_DE", &error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+
+	/* a new translation is not lost while the table is stale */
+	ai_database_add_translation (db, "abiword", "Abiword", "Schreiben", "de", NULL);
+	array = ai_database_search_by_id_locale (db, "abiword", "de", &error);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Abiword");
+	g_ptr_array_unref (array);
+	array = ai_database_list_by_name_locale (db, "de", 0, 0, &error);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Abiword");
+	g_ptr_array_unref (array);
+
+	/* only the changed application is redone, in the same order */
+	ret = ai_database_refresh_display (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = ai_database_list_by_name_locale (db, "de", 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Abiword");
+	g_assert_cmpstr (ai_result_get_application_summary (g_ptr_array_index (array, 0)), ==, "Schreiben");
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 1)), ==, "Rechner");
+	g_ptr_array_unref (array);
+
+	/* a new locale needs rows for every application */
+	ai_database_add_translation (db, "calc", "Calculatrice", "Calculer", "fr", NULL);
+	ret = ai_database_refresh_display (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	array = ai_database_list_by_name_locale (db, "fr", 0, 0, &error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 0)), ==, "Calculatrice");
+	g_assert_cmpstr (ai_result_get_application_name (g_ptr_array_index (array, 1)), ==, "Word");
+	g_ptr_array_unref (array);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_database_icons_func (void)
+{
+	AiDatabase *db;
+	AiIconArchive *archive;
+	gboolean ret;
+	GError *error = NULL;
+	gchar *path;
+	gchar *data;
+	guint number = 0;
+	struct utimbuf times;
+
+	ai_utils_directory_remove ("/tmp/ai-self-test-icons");
+	g_mkdir_with_parents ("/tmp/ai-self-test-icons/system", 0755);
+
+	/* an uncompressed archive can be read in place, a compressed one cannot */
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons/fedora.tar", NULL);
+	g_assert (ret);
+	ai_icon_archive_add (archive, "32x32/gpm.png", "small", 5, NULL);
+	ai_icon_archive_add (archive, "48x48/gpm.png", "large", 5, NULL);
+	ai_icon_archive_add (archive, "48x48/gpm.x/../../../escape.png", "evil", 4, NULL);
+	ret = ai_icon_archive_close (archive, NULL);
+	g_assert (ret);
+	g_object_unref (archive);
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons/updates.tar.gz", NULL);
+	g_assert (ret);
+	ai_icon_archive_add (archive, "48x48/gnome-calculator.svg", "svg", 3, NULL);
+	ret = ai_icon_archive_close (archive, NULL);
+	g_assert (ret);
+	g_object_unref (archive);
+
+	db = ai_database_new ();
+	ai_database_set_filename (db, "/tmp/ai-self-test-icons/test.db", NULL);
+	ai_database_set_icon_path (db, "/tmp/ai-self-test-icons/system", NULL);
+	ret = ai_database_open (db, FALSE, NULL);
+	g_assert (ret);
+	ret = ai_database_create (db, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ai_database_add_application (db, "gpm", "gnome-power-manager", "System", "fedora", "gpm", "Power", "Save power", NULL);
+	ai_database_add_application (db, "calc", "gcalctool", "Utility", "updates", "gnome-calculator", "Calc", "Add up", NULL);
+
+	/* only the index is written on import */
+	ret = ai_database_import_icon_archive (db, "/tmp/ai-self-test-icons/fedora.tar", "fedora", &number, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (number, ==, 2);
+	ret = ai_database_import_icon_archive (db, "/tmp/ai-self-test-icons/updates.tar.gz", "updates", NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (!g_file_test ("/tmp/ai-self-test-icons/system/48x48/gpm.png", G_FILE_TEST_EXISTS));
+
+	/* written out on first use */
+	path = ai_database_get_icon_path (db, "gpm", 48, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (path, ==, "/tmp/ai-self-test-icons/system/48x48/gpm.png");
+	g_file_get_contents (path, &data, NULL, NULL);
+	g_assert_cmpstr (data, ==, "large");
+	g_free (data);
+	g_free (path);
+	path = ai_database_get_icon_path (db, "calc", 48, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (path, ==, "/tmp/ai-self-test-icons/system/48x48/gnome-calculator.svg");
+	g_free (path);
+	g_assert (!g_file_test ("/tmp/ai-self-test-icons/escape.png", G_FILE_TEST_EXISTS));
+
+	/* an icon written from an older archive is written again */
+	archive = ai_icon_archive_new ();
+	ret = ai_icon_archive_open (archive, "/tmp/ai-self-test-icons/fedora.tar", NULL);
+	g_assert (ret);
+	ai_icon_archive_add (archive, "48x48/gpm.png", "newer", 5, NULL);
+	ret = ai_icon_archive_close (archive, NULL);
+	g_assert (ret);
+	g_object_unref (archive);
+	ret = ai_database_import_icon_archive (db, "/tmp/ai-self-test-icons/fedora.tar", "fedora", NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	times.actime = 0;
+	times.modtime = 0;
+	g_utime ("/tmp/ai-self-test-icons/system/48x48/gpm.png", &times);
+	path = ai_database_get_icon_path (db, "gpm", 48, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (path, &data, NULL, NULL);
+	g_assert_cmpstr (data, ==, "newer");
+	g_free (data);
+	g_free (path);
+
+	/* no such size */
+	path = ai_database_get_icon_path (db, "gpm", 64, &error);
+	g_assert (path == NULL);
+	g_clear_error (&error);
+
+	/* the index goes with the repo */
+	ret = ai_database_remove_by_repo (db, "fedora", NULL);
+	g_assert (ret);
+	path = ai_database_get_icon_path (db, "gpm", 32, &error);
+	g_assert (path == NULL);
+	g_clear_error (&error);
+
+	ai_database_close (db, FALSE, NULL);
+	g_object_unref (db);
+}
+
+static void
+ai_test_compose_cache_func (void)
+{
+	AiComposeCache *cache;
+	AiComposeApp *app;
+	AiComposeIcon *icon;
+	GPtrArray *apps;
+	gboolean ret;
+	gchar *checksum;
+
+	g_unlink ("/tmp/ai-self-test-compose.db");
+	cache = ai_compose_cache_new ();
+	ret = ai_compose_cache_open (cache, "/tmp/ai-self-test-compose.db", "settings", NULL);
+	g_assert (ret);
+
+	/* nothing cached yet */
+	g_assert (ai_compose_cache_lookup (cache, "abc") == NULL);
+	g_assert (ai_compose_cache_lookup_stat (cache, "/repo/dave.rpm", 10, 20) == NULL);
+
+	/* store a package with one application, and one with none */
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_compose_app_free);
+	app = ai_compose_app_new ("dave", "[Desktop Entry]\n", 16);
+	ai_compose_app_add_icon (app, "48x48/dave.png", g_strdup ("png"), 3);
+	g_ptr_array_add (apps, app);
+	ret = ai_compose_cache_store (cache, "abc", "/repo/dave.rpm", 10, 20, apps, NULL);
+	g_assert (ret);
+	g_ptr_array_set_size (apps, 0);
+	ret = ai_compose_cache_store (cache, "def", "/repo/empty.rpm", 1, 2, apps, NULL);
+	g_assert (ret);
+	g_ptr_array_unref (apps);
+
+	/* the stat fast path */
+	checksum = ai_compose_cache_lookup_stat (cache, "/repo/dave.rpm", 10, 20);
+	g_assert_cmpstr (checksum, ==, "abc");
+	g_free (checksum);
+	g_assert (ai_compose_cache_lookup_stat (cache, "/repo/dave.rpm", 10, 21) == NULL);
+
+	/* get back what we stored */
+	apps = ai_compose_cache_lookup (cache, "abc");
+	g_assert (apps != NULL);
+	g_assert_cmpint (apps->len, ==, 1);
+	app = g_ptr_array_index (apps, 0);
+	g_assert_cmpstr (app->application_id, ==, "dave");
+	g_assert_cmpstr (app->desktop, ==, "[Desktop Entry]\n");
+	g_assert_cmpint (app->icons->len, ==, 1);
+	icon = g_ptr_array_index (app->icons, 0);
+	g_assert_cmpstr (icon->filename, ==, "48x48/dave.png");
+	g_assert_cmpint (icon->length, ==, 3);
+	g_ptr_array_unref (apps);
+
+	/* cached, but with no applications */
+	apps = ai_compose_cache_lookup (cache, "def");
+	g_assert (apps != NULL);
+	g_assert_cmpint (apps->len, ==, 0);
+	g_ptr_array_unref (apps);
+	g_assert_cmpint (ai_compose_cache_get_hits (cache), ==, 2);
+
+	/* a new build of the same package replaces the old one */
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) ai_compose_app_free);
+	app = ai_compose_app_new ("dave", "[Desktop Entry]\n", 16);
+	ai_compose_app_add_icon (app, "48x48/dave.png", g_strdup ("svg"), 3);
+	g_ptr_array_add (apps, app);
+	ret = ai_compose_cache_store (cache, "ghi", "/repo/dave.rpm", 11, 21, apps, NULL);
+	g_assert (ret);
+	g_ptr_array_unref (apps);
+	g_assert (ai_compose_cache_lookup (cache, "abc") == NULL);
+	checksum = ai_compose_cache_lookup_stat (cache, "/repo/dave.rpm", 11, 21);
+	g_assert_cmpstr (checksum, ==, "ghi");
+	g_free (checksum);
+
+	/* packages that have gone from the tree are dropped, other trees are kept */
+	apps = g_ptr_array_new ();
+	ret = ai_compose_cache_store (cache, "jkl", "/other/empty.rpm", 1, 2, apps, NULL);
+	g_assert (ret);
+	g_ptr_array_add (apps, (gpointer) "/repo/dave.rpm");
+	ret = ai_compose_cache_prune (cache, "/repo", apps, NULL);
+	g_assert (ret);
+	g_ptr_array_unref (apps);
+	g_assert (ai_compose_cache_lookup_stat (cache, "/repo/empty.rpm", 1, 2) == NULL);
+	checksum = ai_compose_cache_lookup_stat (cache, "/repo/dave.rpm", 11, 21);
+	g_assert_cmpstr (checksum, ==, "ghi");
+	g_free (checksum);
+	checksum = ai_compose_cache_lookup_stat (cache, "/other/empty.rpm", 1, 2);
+	g_assert_cmpstr (checksum, ==, "jkl");
+	g_free (checksum);
+	g_object_unref (cache);
+
+	/* results with other settings are not used */
+	cache = ai_compose_cache_new ();
+	ret = ai_compose_cache_open (cache, "/tmp/ai-self-test-compose.db", "other", NULL);
+	g_assert (ret);
+	g_assert (ai_compose_cache_lookup (cache, "abc") == NULL);
+	g_object_unref (cache);
+	g_unlink ("/tmp/ai-self-test-compose.db");
+}
+
 int
 main (int argc, char **argv)
 {
@@ -215,7 +1531,28 @@ main (int argc, char **argv)
 	g_test_init (&argc, &argv, NULL);
 
 	/* components */
+	g_test_add_func ("/app-install/config", ai_test_config_func);
+	g_test_add_func ("/app-install/compose-cache", ai_test_compose_cache_func);
 	g_test_add_func ("/app-install/database", ai_test_database_func);
+	g_test_add_func ("/app-install/database-icons", ai_test_database_icons_func);
+	g_test_add_func ("/app-install/desktop", ai_test_desktop_func);
+	g_test_add_func ("/app-install/generator", ai_test_generator_func);
+	g_test_add_func ("/app-install/generator-desktop", ai_test_generator_desktop_func);
+	g_test_add_func ("/app-install/root", ai_test_root_func);
+	g_test_add_func ("/app-install/whitelist", ai_test_whitelist_func);
+	g_test_add_func ("/app-install/icon-index", ai_test_icon_index_func);
+	g_test_add_func ("/app-install/icon-scale", ai_test_icon_scale_func);
+	g_test_add_func ("/app-install/icon-encoder", ai_test_icon_encoder_func);
+	g_test_add_func ("/app-install/icon-cache", ai_test_icon_cache_func);
+	g_test_add_func ("/app-install/icon-archive", ai_test_icon_archive_func);
+	g_test_add_func ("/app-install/icon-pack", ai_test_icon_pack_func);
+	g_test_add_func ("/app-install/icon-atlas", ai_test_icon_atlas_func);
+	g_test_add_func ("/app-install/catalog", ai_test_catalog_func);
+	g_test_add_func ("/app-install/completion", ai_test_completion_func);
+	g_test_add_func ("/app-install/trigram", ai_test_trigram_func);
+	g_test_add_func ("/app-install/database-cache", ai_test_database_cache_func);
+	g_test_add_func ("/app-install/locale", ai_test_locale_func);
+	g_test_add_func ("/app-install/display", ai_test_display_func);
 
 	return g_test_run ();
 }
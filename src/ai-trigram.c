@@ -0,0 +1,472 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <glib-object.h>
+
+#include "egg-debug.h"
+
+#include "ai-completion.h"
+#include "ai-trigram.h"
+
+static void     ai_trigram_finalize	(GObject     *object);
+
+#define AI_TRIGRAM_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), AI_TYPE_TRIGRAM, AiTrigramPrivate))
+
+/* a summary that contains every trigram of the value scores this much */
+#define AI_TRIGRAM_SUMMARY_WEIGHT	0.5
+
+/* edit distance is only worked out for this many of the best candidates */
+#define AI_TRIGRAM_CANDIDATES_MIN	50
+
+typedef struct {
+	const gchar	*id;
+	const gchar	*name;
+	guint		 name_trigrams;
+} AiTrigramItem;
+
+typedef struct {
+	guint		 item;
+	gdouble		 score;
+} AiTrigramMatch;
+
+/*
+ * AiTrigramPrivate:
+ *
+ * Private #AiTrigram data
+ */
+struct _AiTrigramPrivate
+{
+	GStringChunk			*chunk;
+	GArray				*items;
+	GHashTable			*names;
+	GHashTable			*summaries;
+	gdouble				 cutoff;
+};
+
+G_DEFINE_TYPE (AiTrigram, ai_trigram, G_TYPE_OBJECT)
+
+/*
+ * ai_trigram_extract:
+ *
+ * Each word is padded with two spaces in front and one behind, so short
+ * words still have trigrams and the start of a word counts for more
+ * than the end.
+ *
+ * Return value: the set of unique trigrams in @normalized
+ */
+static GHashTable *
+ai_trigram_extract (const gchar *normalized)
+{
+	GHashTable *set;
+	gchar **words;
+	gchar *padded;
+	const gchar *p;
+	const gchar *end;
+	guint i;
+	guint j;
+
+	set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	words = g_strsplit (normalized, " ", -1);
+	for (i=0; words[i] != NULL; i++) {
+		if (words[i][0] == '\0')
+			continue;
+		padded = g_strdup_printf ("  %s ", words[i]);
+		for (p = padded; *p != '\0'; p = g_utf8_next_char (p)) {
+			end = p;
+			for (j=0; j<3 && *end != '\0'; j++)
+				end = g_utf8_next_char (end);
+			if (j < 3)
+				break;
+			g_hash_table_insert (set, g_strndup (p, end - p), GINT_TO_POINTER (1));
+		}
+		g_free (padded);
+	}
+	g_strfreev (words);
+	return set;
+}
+
+/*
+ * ai_trigram_index:
+ */
+static void
+ai_trigram_index (AiTrigram *trigram, GHashTable *index, GHashTable *set, guint item)
+{
+	GList *keys;
+	GList *l;
+	GArray *postings;
+
+	keys = g_hash_table_get_keys (set);
+	for (l = keys; l != NULL; l = l->next) {
+		postings = g_hash_table_lookup (index, l->data);
+		if (postings == NULL) {
+			postings = g_array_new (FALSE, FALSE, sizeof (guint));
+			g_hash_table_insert (index, g_string_chunk_insert_const (trigram->priv->chunk, l->data), postings);
+		}
+		g_array_append_val (postings, item);
+	}
+	g_list_free (keys);
+}
+
+/*
+ * ai_trigram_add:
+ * @id: what is returned by ai_trigram_search()
+ * @name: the name to match against
+ * @summary: the summary to match against, or %NULL
+ */
+void
+ai_trigram_add (AiTrigram *trigram, const gchar *id, const gchar *name, const gchar *summary)
+{
+	gchar *normalized;
+	GHashTable *set;
+	AiTrigramItem item;
+	AiTrigramPrivate *priv = trigram->priv;
+
+	g_return_if_fail (AI_IS_TRIGRAM (trigram));
+	g_return_if_fail (id != NULL);
+	g_return_if_fail (name != NULL);
+
+	normalized = ai_completion_normalize (name);
+	set = ai_trigram_extract (normalized);
+	item.id = g_string_chunk_insert_const (priv->chunk, id);
+	item.name = g_string_chunk_insert_const (priv->chunk, normalized);
+	item.name_trigrams = g_hash_table_size (set);
+	g_array_append_val (priv->items, item);
+	ai_trigram_index (trigram, priv->names, set, priv->items->len - 1);
+	g_hash_table_unref (set);
+	g_free (normalized);
+
+	if (summary == NULL)
+		return;
+	normalized = ai_completion_normalize (summary);
+	set = ai_trigram_extract (normalized);
+	ai_trigram_index (trigram, priv->summaries, set, priv->items->len - 1);
+	g_hash_table_unref (set);
+	g_free (normalized);
+}
+
+/*
+ * ai_trigram_get_distance:
+ *
+ * Return value: the Levenshtein distance, using a single row
+ */
+static glong
+ai_trigram_get_distance (const gunichar *a, glong len_a, const gunichar *b, glong len_b)
+{
+	glong *row;
+	glong i;
+	glong j;
+	glong prev;
+	glong tmp;
+	glong distance;
+
+	row = g_new (glong, len_b + 1);
+	for (j=0; j<=len_b; j++)
+		row[j] = j;
+	for (i=1; i<=len_a; i++) {
+		prev = row[0];
+		row[0] = i;
+		for (j=1; j<=len_b; j++) {
+			tmp = row[j];
+			row[j] = MIN (MIN (row[j], row[j-1]) + 1, prev + (a[i-1] == b[j-1] ? 0 : 1));
+			prev = tmp;
+		}
+	}
+	distance = row[len_b];
+	g_free (row);
+	return distance;
+}
+
+/*
+ * ai_trigram_get_edit_score_for_text:
+ */
+static gdouble
+ai_trigram_get_edit_score_for_text (const gunichar *value, glong length, const gchar *text)
+{
+	gunichar *tmp;
+	glong tmp_length;
+	glong distance;
+
+	tmp = g_utf8_to_ucs4_fast (text, -1, &tmp_length);
+	distance = ai_trigram_get_distance (value, length, tmp, tmp_length);
+	g_free (tmp);
+	if (MAX (length, tmp_length) == 0)
+		return 0.0;
+	return 1.0 - (gdouble) distance / MAX (length, tmp_length);
+}
+
+/*
+ * ai_trigram_get_edit_score:
+ *
+ * Return value: 1.0 when @value is the whole name or one of its words,
+ * falling towards 0.0 as more edits are needed
+ */
+static gdouble
+ai_trigram_get_edit_score (const gunichar *value, glong length, const gchar *name)
+{
+	gchar **words;
+	gdouble score;
+	guint i;
+
+	score = ai_trigram_get_edit_score_for_text (value, length, name);
+	if (strchr (name, ' ') == NULL)
+		return score;
+	words = g_strsplit (name, " ", -1);
+	for (i=0; words[i] != NULL; i++)
+		score = MAX (score, ai_trigram_get_edit_score_for_text (value, length, words[i]));
+	g_strfreev (words);
+	return score;
+}
+
+/*
+ * ai_trigram_get_similarity:
+ *
+ * Return value: the shared trigrams as a fraction of all the trigrams
+ */
+static gdouble
+ai_trigram_get_similarity (guint shared, guint size1, guint size2)
+{
+	return (gdouble) shared / (size1 + size2 - shared);
+}
+
+/*
+ * ai_trigram_match_compare:
+ */
+static gint
+ai_trigram_match_compare (gconstpointer a, gconstpointer b)
+{
+	const AiTrigramMatch *match1 = (const AiTrigramMatch *) a;
+	const AiTrigramMatch *match2 = (const AiTrigramMatch *) b;
+
+	if (match1->score != match2->score)
+		return match1->score > match2->score ? -1 : 1;
+	return (gint) match1->item - (gint) match2->item;
+}
+
+/**
+ * ai_trigram_search:
+ * @value: the possibly misspelled text to look for
+ * @limit: the maximum number of results, or 0 for no limit
+ *
+ * Candidates are found by counting shared trigrams using the inverted
+ * index, so only items that share at least one trigram are looked at.
+ * The best of those are then scored on both trigram similarity and the
+ * edit distance to the closest word of the name.
+ *
+ * Return value: (element-type utf8) (transfer full): the IDs of the
+ * matches scoring at least the cutoff, best first
+ */
+GPtrArray *
+ai_trigram_search (AiTrigram *trigram, const gchar *value, guint limit)
+{
+	gchar *normalized;
+	gunichar *text = NULL;
+	glong length;
+	guint size;
+	guint i;
+	guint item;
+	guint16 *name_counts = NULL;
+	guint16 *summary_counts = NULL;
+	gdouble summary_score;
+	GList *keys = NULL;
+	GList *l;
+	GArray *postings;
+	GArray *candidates;
+	GPtrArray *array;
+	GHashTable *query;
+	AiTrigramMatch match;
+	AiTrigramMatch *tmp;
+	const AiTrigramItem *item_tmp;
+	AiTrigramPrivate *priv = trigram->priv;
+
+	g_return_val_if_fail (AI_IS_TRIGRAM (trigram), NULL);
+	g_return_val_if_fail (value != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func (g_free);
+	candidates = g_array_new (FALSE, FALSE, sizeof (AiTrigramMatch));
+	normalized = ai_completion_normalize (value);
+	query = ai_trigram_extract (normalized);
+	size = g_hash_table_size (query);
+	if (size == 0)
+		goto out;
+
+	/* count the trigrams each item shares with the value */
+	name_counts = g_new0 (guint16, priv->items->len);
+	summary_counts = g_new0 (guint16, priv->items->len);
+	keys = g_hash_table_get_keys (query);
+	match.score = 0.0;
+	for (l = keys; l != NULL; l = l->next) {
+		postings = g_hash_table_lookup (priv->names, l->data);
+		for (i=0; postings != NULL && i<postings->len; i++) {
+			item = g_array_index (postings, guint, i);
+			if (name_counts[item]++ == 0 && summary_counts[item] == 0) {
+				match.item = item;
+				g_array_append_val (candidates, match);
+			}
+		}
+		postings = g_hash_table_lookup (priv->summaries, l->data);
+		for (i=0; postings != NULL && i<postings->len; i++) {
+			item = g_array_index (postings, guint, i);
+			if (summary_counts[item]++ == 0 && name_counts[item] == 0) {
+				match.item = item;
+				g_array_append_val (candidates, match);
+			}
+		}
+	}
+
+	/* the name is scored on how alike the two sets are, but a summary
+	 * only on how much of the value it contains as it is much longer */
+	for (i=0; i<candidates->len; i++) {
+		tmp = &g_array_index (candidates, AiTrigramMatch, i);
+		item_tmp = &g_array_index (priv->items, AiTrigramItem, tmp->item);
+		tmp->score = ai_trigram_get_similarity (name_counts[tmp->item], size, item_tmp->name_trigrams);
+		summary_score = AI_TRIGRAM_SUMMARY_WEIGHT * summary_counts[tmp->item] / size;
+		tmp->score = MAX (tmp->score, summary_score);
+	}
+	g_array_sort (candidates, ai_trigram_match_compare);
+	if (limit > 0 && candidates->len > MAX (limit * 4, AI_TRIGRAM_CANDIDATES_MIN))
+		g_array_set_size (candidates, MAX (limit * 4, AI_TRIGRAM_CANDIDATES_MIN));
+
+	/* a single typo costs a short word a lot of trigrams, so the edit
+	 * distance is given the same weight */
+	text = g_utf8_to_ucs4_fast (normalized, -1, &length);
+	for (i=0; i<candidates->len; i++) {
+		tmp = &g_array_index (candidates, AiTrigramMatch, i);
+		item_tmp = &g_array_index (priv->items, AiTrigramItem, tmp->item);
+		summary_score = AI_TRIGRAM_SUMMARY_WEIGHT * summary_counts[tmp->item] / size;
+		tmp->score = ai_trigram_get_similarity (name_counts[tmp->item], size, item_tmp->name_trigrams);
+		tmp->score = (tmp->score + ai_trigram_get_edit_score (text, length, item_tmp->name)) / 2.0;
+		tmp->score = MAX (tmp->score, summary_score);
+	}
+	g_array_sort (candidates, ai_trigram_match_compare);
+
+	for (i=0; i<candidates->len; i++) {
+		if (limit > 0 && array->len >= limit)
+			break;
+		tmp = &g_array_index (candidates, AiTrigramMatch, i);
+		if (tmp->score < priv->cutoff)
+			break;
+		item_tmp = &g_array_index (priv->items, AiTrigramItem, tmp->item);
+		egg_debug ("%s scored %.2f", item_tmp->id, tmp->score);
+		g_ptr_array_add (array, g_strdup (item_tmp->id));
+	}
+out:
+	g_list_free (keys);
+	g_hash_table_unref (query);
+	g_array_free (candidates, TRUE);
+	g_free (name_counts);
+	g_free (summary_counts);
+	g_free (normalized);
+	g_free (text);
+	return array;
+}
+
+/*
+ * ai_trigram_set_cutoff:
+ *
+ * Sets the lowest score, from 0.0 to 1.0, that is still returned.
+ */
+void
+ai_trigram_set_cutoff (AiTrigram *trigram, gdouble cutoff)
+{
+	g_return_if_fail (AI_IS_TRIGRAM (trigram));
+	trigram->priv->cutoff = cutoff;
+}
+
+/*
+ * ai_trigram_get_size:
+ *
+ * Return value: the number of items that have been added
+ */
+guint
+ai_trigram_get_size (AiTrigram *trigram)
+{
+	g_return_val_if_fail (AI_IS_TRIGRAM (trigram), 0);
+	return trigram->priv->items->len;
+}
+
+/*
+ * ai_trigram_postings_free:
+ */
+static void
+ai_trigram_postings_free (GArray *postings)
+{
+	g_array_free (postings, TRUE);
+}
+
+/*
+ * ai_trigram_class_init:
+ */
+static void
+ai_trigram_class_init (AiTrigramClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = ai_trigram_finalize;
+	g_type_class_add_private (klass, sizeof (AiTrigramPrivate));
+}
+
+/*
+ * ai_trigram_init:
+ */
+static void
+ai_trigram_init (AiTrigram *trigram)
+{
+	trigram->priv = AI_TRIGRAM_GET_PRIVATE (trigram);
+	trigram->priv->chunk = g_string_chunk_new (4096);
+	trigram->priv->items = g_array_new (FALSE, FALSE, sizeof (AiTrigramItem));
+	trigram->priv->names = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) ai_trigram_postings_free);
+	trigram->priv->summaries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) ai_trigram_postings_free);
+	trigram->priv->cutoff = AI_TRIGRAM_CUTOFF;
+}
+
+/*
+ * ai_trigram_finalize:
+ */
+static void
+ai_trigram_finalize (GObject *object)
+{
+	AiTrigram *trigram = AI_TRIGRAM (object);
+	AiTrigramPrivate *priv = trigram->priv;
+
+	g_hash_table_unref (priv->names);
+	g_hash_table_unref (priv->summaries);
+	g_array_free (priv->items, TRUE);
+	g_string_chunk_free (priv->chunk);
+
+	G_OBJECT_CLASS (ai_trigram_parent_class)->finalize (object);
+}
+
+/*
+ * ai_trigram_new:
+ *
+ * Return value: a new AiTrigram object.
+ */
+AiTrigram *
+ai_trigram_new (void)
+{
+	AiTrigram *trigram;
+	trigram = g_object_new (AI_TYPE_TRIGRAM, NULL);
+	return AI_TRIGRAM (trigram);
+}
+
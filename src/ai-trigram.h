@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __AI_TRIGRAM_H
+#define __AI_TRIGRAM_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define AI_TYPE_TRIGRAM		(ai_trigram_get_type ())
+#define AI_TRIGRAM(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), AI_TYPE_TRIGRAM, AiTrigram))
+#define AI_TRIGRAM_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), AI_TYPE_TRIGRAM, AiTrigramClass))
+#define AI_IS_TRIGRAM(o)	(G_TYPE_CHECK_INSTANCE_TYPE ((o), AI_TYPE_TRIGRAM))
+#define AI_IS_TRIGRAM_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), AI_TYPE_TRIGRAM))
+#define AI_TRIGRAM_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), AI_TYPE_TRIGRAM, AiTrigramClass))
+
+/* the default lowest score that is still a match, from 0.0 to 1.0 */
+#define AI_TRIGRAM_CUTOFF	0.3
+
+typedef struct _AiTrigramPrivate	AiTrigramPrivate;
+typedef struct _AiTrigram		AiTrigram;
+typedef struct _AiTrigramClass		AiTrigramClass;
+
+struct _AiTrigram
+{
+	 GObject		 parent;
+	 AiTrigramPrivate	*priv;
+};
+
+struct _AiTrigramClass
+{
+	GObjectClass		 parent_class;
+};
+
+GType		 ai_trigram_get_type		  	(void);
+AiTrigram	*ai_trigram_new				(void);
+void		 ai_trigram_set_cutoff			(AiTrigram	*trigram,
+							 gdouble	 cutoff);
+void		 ai_trigram_add				(AiTrigram	*trigram,
+							 const gchar	*id,
+							 const gchar	*name,
+							 const gchar	*summary);
+GPtrArray	*ai_trigram_search			(AiTrigram	*trigram,
+							 const gchar	*value,
+							 guint		 limit);
+guint		 ai_trigram_get_size			(AiTrigram	*trigram);
+
+G_END_DECLS
+
+#endif /* __AI_TRIGRAM_H */
+
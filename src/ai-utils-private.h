@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __AI_UTILS_PRIVATE_H
+#define __AI_UTILS_PRIVATE_H
+
+#include <glib.h>
+
+#include "ai-utils.h"
+
+G_BEGIN_DECLS
+
+/* not installed, and hidden so they are not part of the library ABI */
+struct archive;
+
+G_GNUC_INTERNAL struct archive *ai_utils_archive_open (const gchar *filename, GMappedFile **mapped, GError **error);
+G_GNUC_INTERNAL void ai_utils_archive_close (struct archive *arch, GMappedFile *mapped);
+G_GNUC_INTERNAL const gchar *ai_utils_strip_root (const gchar *path);
+G_GNUC_INTERNAL gboolean ai_utils_path_is_safe (const gchar *path);
+G_GNUC_INTERNAL GPtrArray *ai_utils_compile_patterns (gchar **patterns);
+G_GNUC_INTERNAL gboolean ai_utils_path_matches (GPtrArray *specs, const gchar *path);
+G_GNUC_INTERNAL GPtrArray *ai_utils_get_icon_files (const gchar *directory, GError **error);
+G_GNUC_INTERNAL gchar **ai_utils_get_locale_fallbacks (const gchar *locale);
+
+G_END_DECLS
+
+#endif /* __AI_UTILS_PRIVATE_H */
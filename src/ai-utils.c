@@ -19,15 +19,21 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 
 #include <archive.h>
 #include <archive_entry.h>
 
-#define BLOCK_SIZE	(1024 * 4 * 10) /* bytes */
+#define BLOCK_SIZE	(1024 * 1024) /* bytes */
 
-#include "ai-utils.h"
+/* only set from main() before any threads are started */
+static guint ai_utils_block_size = BLOCK_SIZE;
+
+#include "egg-debug.h"
+
+#include "ai-utils-private.h"
 
 /*
  * ai_utils_directory_remove:
@@ -55,7 +61,9 @@ ai_utils_directory_remove_contents (const gchar *directory)
 	/* find each */
 	while ((filename = g_dir_read_name (dir))) {
 		src = g_build_filename (directory, filename, NULL);
-		ret = g_file_test (src, G_FILE_TEST_IS_DIR);
+		/* never follow symlinks out of the tree, packages ship plenty */
+		ret = g_file_test (src, G_FILE_TEST_IS_DIR) &&
+		      !g_file_test (src, G_FILE_TEST_IS_SYMLINK);
 		if (ret) {
 			/* recurse */
 			ai_utils_directory_remove_contents (src);
@@ -96,46 +104,365 @@ ai_utils_directory_remove (const gchar *directory)
 }
 
 /*
- * ai_utils_extract_archive:
+ * ai_utils_strip_root:
  *
- * Extracts an archive to a directory, fast.
+ * Archives use "./usr/share" or "/usr/share" depending on the format.
+ */
+const gchar *
+ai_utils_strip_root (const gchar *path)
+{
+	while (TRUE) {
+		if (path[0] == '/') {
+			path++;
+			continue;
+		}
+		if (path[0] == '.' && path[1] == '/') {
+			path += 2;
+			continue;
+		}
+		break;
+	}
+	return path;
+}
+
+/*
+ * ai_utils_compile_patterns:
+ *
+ * Return value: an array of #GPatternSpec, or %NULL if @patterns is %NULL
+ */
+GPtrArray *
+ai_utils_compile_patterns (gchar **patterns)
+{
+	GPtrArray *specs;
+	guint i;
+
+	if (patterns == NULL)
+		return NULL;
+	specs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+	for (i=0; patterns[i] != NULL; i++)
+		g_ptr_array_add (specs, g_pattern_spec_new (ai_utils_strip_root (patterns[i])));
+	return specs;
+}
+
+/*
+ * ai_utils_path_matches:
  */
 gboolean
-ai_utils_extract_archive (const gchar *filename, const gchar *directory, GError **error)
+ai_utils_path_matches (GPtrArray *specs, const gchar *path)
+{
+	guint i;
+
+	path = ai_utils_strip_root (path);
+	for (i=0; i<specs->len; i++) {
+		if (g_pattern_match_string (g_ptr_array_index (specs, i), path))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * ai_utils_icon_files_sort_cb:
+ */
+static gint
+ai_utils_icon_files_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*((const gchar **) a), *((const gchar **) b));
+}
+
+/*
+ * ai_utils_get_icon_files:
+ *
+ * Lists the icons in @directory in filename order. Only one file is kept
+ * for each icon name, and as the first one wins "png" beats "svg".
+ *
+ * Return value: an array of filenames without the directory
+ */
+GPtrArray *
+ai_utils_get_icon_files (const gchar *directory, GError **error)
+{
+	GDir *dir;
+	const gchar *tmp;
+	gchar *path;
+	gchar *name;
+	gchar *dot;
+	guint i;
+	GPtrArray *filenames = NULL;
+	GPtrArray *array;
+	GHashTable *seen;
+	GError *error_local = NULL;
+
+	dir = g_dir_open (directory, 0, &error_local);
+	if (dir == NULL) {
+		g_set_error (error, 1, 0, "cannot open %s: %s", directory, error_local->message);
+		g_error_free (error_local);
+		goto out;
+	}
+
+	/* the order on disk is not stable */
+	array = g_ptr_array_new_with_free_func (g_free);
+	while ((tmp = g_dir_read_name (dir)) != NULL)
+		g_ptr_array_add (array, g_strdup (tmp));
+	g_ptr_array_sort (array, ai_utils_icon_files_sort_cb);
+	g_dir_close (dir);
+
+	filenames = g_ptr_array_new_with_free_func (g_free);
+	seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i=0; i<array->len; i++) {
+		tmp = g_ptr_array_index (array, i);
+		path = g_build_filename (directory, tmp, NULL);
+		if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+			g_free (path);
+			continue;
+		}
+		g_free (path);
+		name = g_strdup (tmp);
+		dot = strrchr (name, '.');
+		if (dot != NULL)
+			*dot = '\0';
+		if (g_hash_table_lookup (seen, name) != NULL) {
+			g_free (name);
+			continue;
+		}
+		g_hash_table_insert (seen, name, GINT_TO_POINTER (1));
+		g_ptr_array_add (filenames, g_strdup (tmp));
+	}
+	g_hash_table_unref (seen);
+	g_ptr_array_unref (array);
+out:
+	return filenames;
+}
+
+/*
+ * ai_utils_get_locale_fallbacks:
+ * @locale: a locale such as "sr_RS.UTF-8@latin", or %NULL
+ *
+ * Drops the codeset and lists the locales whose translations should be
+ * tried, best first, e.g. "sr_RS@latin", "sr_RS", "sr@latin", "sr".
+ * The untranslated "C" text is always the last resort, so "C",
+ * "POSIX" and %NULL give an empty list.
+ *
+ * Return value: the locales to try, free with g_strfreev()
+ */
+gchar **
+ai_utils_get_locale_fallbacks (const gchar *locale)
+{
+	GPtrArray *array;
+	gchar *language = NULL;
+	gchar *territory = NULL;
+	const gchar *modifier = NULL;
+	const gchar *p;
+	gsize length;
+
+	array = g_ptr_array_new ();
+	if (locale == NULL || locale[0] == '\0' ||
+	    g_strcmp0 (locale, "C") == 0 ||
+	    g_str_has_prefix (locale, "C.") ||
+	    g_strcmp0 (locale, "POSIX") == 0)
+		goto out;
+
+	/* language[_territory][.codeset][@modifier] */
+	length = strcspn (locale, "_.@");
+	language = g_strndup (locale, length);
+	p = locale + length;
+	if (*p == '_') {
+		length = strcspn (p + 1, ".@");
+		territory = g_strndup (p + 1, length);
+		p += length + 1;
+	}
+	modifier = strchr (p, '@');
+	if (modifier != NULL && modifier[1] == '\0')
+		modifier = NULL;
+
+	if (territory != NULL && modifier != NULL)
+		g_ptr_array_add (array, g_strdup_printf ("%s_%s%s", language, territory, modifier));
+	if (territory != NULL)
+		g_ptr_array_add (array, g_strdup_printf ("%s_%s", language, territory));
+	if (modifier != NULL)
+		g_ptr_array_add (array, g_strdup_printf ("%s%s", language, modifier));
+	g_ptr_array_add (array, g_strdup (language));
+out:
+	g_ptr_array_add (array, NULL);
+	g_free (language);
+	g_free (territory);
+	return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+/*
+ * ai_utils_path_is_safe:
+ *
+ * Return value: %FALSE if the path could escape the destination
+ */
+gboolean
+ai_utils_path_is_safe (const gchar *path)
+{
+	gchar **split;
+	gboolean ret = TRUE;
+	guint i;
+
+	split = g_strsplit (path, "/", -1);
+	for (i=0; split[i] != NULL; i++) {
+		if (g_strcmp0 (split[i], "..") == 0) {
+			ret = FALSE;
+			break;
+		}
+	}
+	g_strfreev (split);
+	return ret;
+}
+
+/*
+ * ai_utils_copy_entry_data:
+ */
+static gboolean
+ai_utils_copy_entry_data (struct archive *arch, struct archive *disk, GError **error)
 {
 	gboolean ret = FALSE;
-	struct archive *arch = NULL;
-	struct archive_entry *entry;
+	const void *buffer;
+	size_t size;
+	off_t offset;
 	int r;
-	int retval;
-	gchar *retcwd;
-	gchar buf[PATH_MAX];
-
-	/* save the PWD as we chdir to extract */
-	retcwd = getcwd (buf, PATH_MAX);
-	if (retcwd == NULL) {
-		g_set_error_literal (error, 1, 0, "failed to get cwd");
-		goto out;
+
+	for (;;) {
+		r = archive_read_data_block (arch, &buffer, &size, &offset);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot read data: %s", archive_error_string (arch));
+			goto out;
+		}
+		r = archive_write_data_block (disk, buffer, size, offset);
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot write data: %s", archive_error_string (disk));
+			goto out;
+		}
 	}
+	ret = TRUE;
+out:
+	return ret;
+}
+
+/*
+ * ai_utils_set_block_size:
+ *
+ * Sets the read size used for packages that cannot be mapped.
+ */
+void
+ai_utils_set_block_size (guint block_size)
+{
+	g_return_if_fail (block_size > 0);
+	ai_utils_block_size = block_size;
+}
+
+/*
+ * ai_utils_archive_open:
+ *
+ * Opens a package for reading. Regular files are mapped so libarchive
+ * can read them without any copies, and anything else is read in large
+ * blocks. @mapped has to be freed with ai_utils_archive_close().
+ *
+ * Return value: the archive, or %NULL
+ */
+struct archive *
+ai_utils_archive_open (const gchar *filename, GMappedFile **mapped, GError **error)
+{
+	struct archive *arch;
+	GError *error_local = NULL;
+	int r;
 
 	/* we can only read tar achives */
 	arch = archive_read_new ();
 	archive_read_support_format_all (arch);
 	archive_read_support_compression_all (arch);
 
-	/* open the tar file */
-	r = archive_read_open_file (arch, filename, BLOCK_SIZE);
+	*mapped = NULL;
+	if (g_file_test (filename, G_FILE_TEST_IS_REGULAR)) {
+		*mapped = g_mapped_file_new (filename, FALSE, &error_local);
+		if (*mapped == NULL) {
+			egg_debug ("cannot map %s, reading instead: %s", filename, error_local->message);
+			g_error_free (error_local);
+		} else if (g_mapped_file_get_length (*mapped) == 0) {
+			/* empty files cannot be mapped on all platforms */
+			g_mapped_file_unref (*mapped);
+			*mapped = NULL;
+		}
+	}
+	if (*mapped != NULL) {
+		r = archive_read_open_memory (arch, g_mapped_file_get_contents (*mapped),
+					      g_mapped_file_get_length (*mapped));
+	} else {
+		r = archive_read_open_file (arch, filename, ai_utils_block_size);
+	}
 	if (r) {
 		g_set_error (error, 1, 0, "cannot open: %s", archive_error_string (arch));
-		goto out;
+		ai_utils_archive_close (arch, *mapped);
+		*mapped = NULL;
+		arch = NULL;
 	}
+	return arch;
+}
+
+/*
+ * ai_utils_archive_close:
+ */
+void
+ai_utils_archive_close (struct archive *arch, GMappedFile *mapped)
+{
+	/* the mapping has to outlive the reader */
+	archive_read_close (arch);
+	archive_read_finish (arch);
+	if (mapped != NULL)
+		g_mapped_file_unref (mapped);
+}
 
-	/* switch to our destination directory */
-	retval = chdir (directory);
-	if (retval != 0) {
-		g_set_error (error, 1, 0, "failed chdir to %s", directory);
+/*
+ * ai_utils_extract_archive:
+ *
+ * Extracts an archive to a directory, fast.
+ */
+gboolean
+ai_utils_extract_archive (const gchar *filename, const gchar *directory, GError **error)
+{
+	return ai_utils_extract_archive_filtered (filename, directory, NULL, error);
+}
+
+/*
+ * ai_utils_extract_archive_filtered:
+ *
+ * Extracts only the entries matching one of @patterns, or everything if
+ * @patterns is %NULL. A '*' in a pattern also matches '/', so a trailing
+ * '*' matches a whole tree.
+ *
+ * Every entry is written relative to @directory and the working
+ * directory is never changed, so this can be called from several
+ * threads at once.
+ */
+gboolean
+ai_utils_extract_archive_filtered (const gchar *filename, const gchar *directory, gchar **patterns, GError **error)
+{
+	gboolean ret = FALSE;
+	struct archive *arch = NULL;
+	struct archive *disk = NULL;
+	struct archive_entry *entry;
+	GMappedFile *mapped = NULL;
+	GPtrArray *specs = NULL;
+	const gchar *path;
+	const gchar *hardlink;
+	gchar *dest;
+	int r;
+
+	/* compile the patterns once for all the entries */
+	specs = ai_utils_compile_patterns (patterns);
+
+	/* open the package */
+	arch = ai_utils_archive_open (filename, &mapped, error);
+	if (arch == NULL)
 		goto out;
-	}
+
+	/* never write through a symlink the package created */
+	disk = archive_write_disk_new ();
+	archive_write_disk_set_options (disk, ARCHIVE_EXTRACT_TIME |
+					      ARCHIVE_EXTRACT_SECURE_SYMLINKS |
+					      ARCHIVE_EXTRACT_SECURE_NODOTDOT);
 
 	/* decompress each file */
 	for (;;) {
@@ -146,9 +473,53 @@ ai_utils_extract_archive (const gchar *filename, const gchar *directory, GError
 			g_set_error (error, 1, 0, "cannot read header: %s", archive_error_string (arch));
 			goto out;
 		}
-		r = archive_read_extract (arch, entry, 0);
+		path = ai_utils_strip_root (archive_entry_pathname (entry));
+
+		/* skipping is much cheaper than writing the file out */
+		if (path[0] == '\0' ||
+		    (specs != NULL && !ai_utils_path_matches (specs, path))) {
+			r = archive_read_data_skip (arch);
+			if (r != ARCHIVE_OK) {
+				g_set_error (error, 1, 0, "cannot skip: %s", archive_error_string (arch));
+				goto out;
+			}
+			continue;
+		}
+		if (!ai_utils_path_is_safe (path)) {
+			g_set_error (error, 1, 0, "refusing to extract %s outside %s", path, directory);
+			goto out;
+		}
+
+		/* rewrite the paths to be inside the destination */
+		dest = g_build_filename (directory, path, NULL);
+		archive_entry_set_pathname (entry, dest);
+		g_free (dest);
+		hardlink = archive_entry_hardlink (entry);
+		if (hardlink != NULL) {
+			hardlink = ai_utils_strip_root (hardlink);
+			if (!ai_utils_path_is_safe (hardlink)) {
+				g_set_error (error, 1, 0, "refusing to link %s outside %s", hardlink, directory);
+				goto out;
+			}
+			dest = g_build_filename (directory, hardlink, NULL);
+			archive_entry_set_hardlink (entry, dest);
+			g_free (dest);
+		}
+
+		r = archive_write_header (disk, entry);
 		if (r != ARCHIVE_OK) {
-			g_set_error (error, 1, 0, "cannot extract: %s", archive_error_string (arch));
+			g_set_error (error, 1, 0, "cannot extract: %s", archive_error_string (disk));
+			goto out;
+		}
+		if (archive_entry_size (entry) > 0) {
+			ret = ai_utils_copy_entry_data (arch, disk, error);
+			if (!ret)
+				goto out;
+			ret = FALSE;
+		}
+		r = archive_write_finish_entry (disk);
+		if (r != ARCHIVE_OK) {
+			g_set_error (error, 1, 0, "cannot extract: %s", archive_error_string (disk));
 			goto out;
 		}
 	}
@@ -157,16 +528,14 @@ ai_utils_extract_archive (const gchar *filename, const gchar *directory, GError
 	ret = TRUE;
 out:
 	/* close the archive */
-	if (arch != NULL) {
-		archive_read_close (arch);
-		archive_read_finish (arch);
+	if (arch != NULL)
+		ai_utils_archive_close (arch, mapped);
+	if (disk != NULL) {
+		archive_write_close (disk);
+		archive_write_finish (disk);
 	}
-
-	/* switch back to PWD */
-	retval = chdir (buf);
-	if (retval != 0)
-		g_warning ("cannot chdir back!");
-
+	if (specs != NULL)
+		g_ptr_array_unref (specs);
 	return ret;
 }
 
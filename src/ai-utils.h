@@ -28,8 +28,9 @@ G_BEGIN_DECLS
 
 gboolean ai_utils_directory_remove (const gchar *directory);
 gboolean ai_utils_extract_archive (const gchar *filename, const gchar *directory, GError **error);
+gboolean ai_utils_extract_archive_filtered (const gchar *filename, const gchar *directory, gchar **patterns, GError **error);
+void ai_utils_set_block_size (guint block_size);
 
 G_END_DECLS
 
 #endif /* __AI_UTILS_H */
-
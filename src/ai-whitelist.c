@@ -0,0 +1,129 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "egg-debug.h"
+
+#include "ai-whitelist.h"
+
+/* sorted table generated from data/whitelist.dat at build time */
+#include "ai-whitelist-data.h"
+
+/* only set if an override file has been loaded */
+static GHashTable *ai_whitelist_override = NULL;
+
+/*
+ * ai_whitelist_load_override:
+ *
+ * Replaces the compiled-in whitelist with the contents of a file.
+ * This is expected to be called once at startup.
+ */
+gboolean
+ai_whitelist_load_override (const gchar *filename, GError **error)
+{
+	gboolean ret;
+	gchar *contents = NULL;
+	gchar **split = NULL;
+	guint i;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* load whitelist file */
+	ret = g_file_get_contents (filename, &contents, NULL, error);
+	if (!ret)
+		goto out;
+
+	/* replace any existing override */
+	if (ai_whitelist_override != NULL)
+		g_hash_table_unref (ai_whitelist_override);
+	ai_whitelist_override = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* split into lines */
+	split = g_strsplit (contents, "\n", -1);
+	for (i=0; split[i] != NULL; i++) {
+		g_strstrip (split[i]);
+		if (split[i][0] == '\0' || split[i][0] == '#')
+			continue;
+		g_hash_table_insert (ai_whitelist_override, g_strdup (split[i]), GUINT_TO_POINTER (TRUE));
+	}
+	egg_debug ("loaded %i whitelist entries from %s", g_hash_table_size (ai_whitelist_override), filename);
+out:
+	g_free (contents);
+	g_strfreev (split);
+	return ret;
+}
+
+/*
+ * ai_whitelist_contains:
+ *
+ * Return value: %TRUE if the icon name (with any suffix ignored) is
+ * supplied by the icon theme, so the icon does not have to be copied.
+ */
+gboolean
+ai_whitelist_contains (const gchar *icon_name)
+{
+	gboolean ret = FALSE;
+	const gchar *dot;
+	gchar *tmp;
+	gsize len;
+	guint low;
+	guint high;
+	guint mid;
+	gint cmp;
+
+	g_return_val_if_fail (icon_name != NULL, FALSE);
+
+	/* ignore suffix */
+	dot = strchr (icon_name, '.');
+	len = (dot != NULL) ? (gsize) (dot - icon_name) : strlen (icon_name);
+
+	/* use the file the user specified */
+	if (ai_whitelist_override != NULL) {
+		tmp = g_strndup (icon_name, len);
+		ret = (g_hash_table_lookup (ai_whitelist_override, tmp) != NULL);
+		g_free (tmp);
+		goto out;
+	}
+
+	/* binary search the sorted table without copying the name */
+	low = 0;
+	high = G_N_ELEMENTS (ai_whitelist_builtin);
+	while (low < high) {
+		mid = (low + high) / 2;
+		cmp = strncmp (icon_name, ai_whitelist_builtin[mid], len);
+		if (cmp == 0 && ai_whitelist_builtin[mid][len] != '\0')
+			cmp = -1;
+		if (cmp == 0) {
+			ret = TRUE;
+			break;
+		}
+		if (cmp < 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+out:
+	return ret;
+}
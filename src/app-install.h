@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2010 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef __APP_INSTALL_H
+#define __APP_INSTALL_H
+
+#include "ai-catalog.h"
+#include "ai-completion.h"
+#include "ai-config.h"
+#include "ai-database.h"
+#include "ai-desktop.h"
+#include "ai-generator.h"
+#include "ai-icon-archive.h"
+#include "ai-icon-atlas.h"
+#include "ai-icon-cache.h"
+#include "ai-icon-encoder.h"
+#include "ai-icon-index.h"
+#include "ai-icon-pack.h"
+#include "ai-icon-scale.h"
+#include "ai-result.h"
+#include "ai-trigram.h"
+#include "ai-utils.h"
+#include "ai-whitelist.h"
+
+#endif /* __APP_INSTALL_H */
+